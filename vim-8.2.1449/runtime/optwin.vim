@@ -368,6 +368,10 @@ if has("reltime")
   call append("$", "redrawtime\ttimeout for 'hlsearch' and :match highlighting in msec")
   call append("$", " \tset rdt=" . &rdt)
 endif
+if has("timers")
+  call append("$", "redrawinterval\tminimal time in msec between redraws for async events")
+  call append("$", " \tset rdi=" . &rdi)
+endif
 call append("$", "writedelay\tdelay in msec for each char written to the display")
 call append("$", "\t(for debugging)")
 call append("$", " \tset wd=" . &wd)
@@ -555,6 +559,10 @@ call append("$", "ttybuiltin\tcheck built-in termcaps first")
 call <SID>BinOptionG("tbi", &tbi)
 call append("$", "ttyfast\tterminal connection is fast")
 call <SID>BinOptionG("tf", &tf)
+if has("unix")
+  call append("$", "ttyasync\tdon't wait for a slow terminal to accept output")
+  call <SID>BinOptionG("tta", &tta)
+endif
 call append("$", "weirdinvert\tterminal that requires extra redrawing")
 call <SID>BinOptionG("wiv", &wiv)
 call append("$", "esckeys\trecognize keys that start with <Esc> in Insert mode")
@@ -1355,6 +1363,10 @@ call append("$", "\t(local to buffer)")
 call <SID>BinOptionL("bl")
 call append("$", "debug\tset to \"msg\" to see all error messages")
 call append("$", " \tset debug=" . &debug)
+if has("eval")
+  call append("$", "defcachedir\tdirectory for the cache of compiled :def functions")
+  call <SID>OptionG("dcdir", &dcdir)
+endif
 if has("signs")
   call append("$", "signcolumn\twhether to show the signcolumn")
   call append("$", "\t(local to window)")
@@ -0,0 +1,168 @@
+#!/usr/bin/python3
+#
+# Job that talks to Vim through the "shm" channel transport: the text is
+# passed through shared memory, stdin and stdout only carry notifications.
+# Start it from Vim with:
+#  :let job = job_start(['python3', 'shmclient.py'], {'transport': 'shm'})
+#
+# Then Vim can send text, which is sent back:
+#  :call ch_sendraw(job, "hello\n")
+#
+# With the "--pipe" argument the text goes through stdin and stdout as usual,
+# this is useful to compare the speed of the two transports.
+#
+# See ":help channel-shm" in Vim.
+#
+# This requires Python 3.5 or later and Linux.
+
+import mmap
+import os
+import select
+import struct
+import sys
+
+MAGIC = b'VimShm01'
+HDR_SIZE = 4096
+TO_JOB = 0      # ring with text from Vim
+FROM_JOB = 1    # ring with text for Vim
+
+# Seconds to wait for a notification before looking at the rings anyway.
+# Python cannot use a memory barrier, this avoids hanging when a notification
+# was missed.
+POLL_TIMEOUT = 0.1
+
+
+class ShmChannel:
+    """The job side of a channel using the "shm" transport."""
+
+    def __init__(self):
+        fd = int(os.environ['VIM_CHANNEL_SHM'])
+        self.mem = mmap.mmap(fd, os.fstat(fd).st_size)
+        os.close(fd)
+        if self.mem[0:8] != MAGIC:
+            raise ValueError('not a Vim channel shared memory')
+        self.size = struct.unpack_from('I', self.mem, 8)[0]
+        self.mask = self.size - 1
+        self.eof = False
+        # Notifications must never block, when the pipe is full Vim still
+        # has some to read.
+        os.set_blocking(1, False)
+
+    def _get(self, name, ring):
+        return struct.unpack_from('I', self.mem, self._offset(name, ring))[0]
+
+    def _set(self, name, ring, value):
+        struct.pack_into('I', self.mem, self._offset(name, ring),
+                         value & 0xffffffff)
+
+    def _offset(self, name, ring):
+        return {'head': 64, 'tail': 128, 'wait': 192}[name] + ring * 192
+
+    def _data(self, ring):
+        return HDR_SIZE + ring * self.size
+
+    def _notify(self):
+        try:
+            os.write(1, b'\0')
+        except BlockingIOError:
+            pass
+
+    def _wait(self):
+        """Wait for a notification from Vim.  Sets self.eof when stdin was
+        closed."""
+        if self.eof:
+            select.select([], [], [], POLL_TIMEOUT)
+            return
+        ready = select.select([0], [], [], POLL_TIMEOUT)[0]
+        if ready and os.read(0, 4096) == b'':
+            self.eof = True
+
+    def read_available(self):
+        """Return the text that is in the ring from Vim, b'' when empty."""
+        head = self._get('head', TO_JOB)
+        tail = self._get('tail', TO_JOB)
+        count = (head - tail) & 0xffffffff
+        if count == 0:
+            return b''
+        start = self._data(TO_JOB)
+        off = tail & self.mask
+        if off + count <= self.size:
+            text = self.mem[start + off:start + off + count]
+        else:
+            text = (self.mem[start + off:start + self.size]
+                    + self.mem[start:start + off + count - self.size])
+        self._set('tail', TO_JOB, tail + count)
+        if self._get('wait', TO_JOB):
+            # Vim is waiting for room in the ring.
+            self._set('wait', TO_JOB, 0)
+            self._notify()
+        return text
+
+    def read(self):
+        """Return the text sent by Vim, wait until there is some.  Returns
+        b'' when Vim closed the channel."""
+        while True:
+            text = self.read_available()
+            if text or self.eof:
+                return text
+            self._wait()
+
+    def write(self, text):
+        """Send "text" (bytes) to Vim, wait for room in the ring when
+        needed."""
+        while text:
+            head = self._get('head', FROM_JOB)
+            room = self.size - ((head - self._get('tail', FROM_JOB))
+                                & 0xffffffff)
+            if room == 0:
+                # Ask Vim for a notification and check again, Vim may have
+                # read the ring meanwhile.
+                self._set('wait', FROM_JOB, 1)
+                if self._get('tail', FROM_JOB) == (head - self.size) \
+                        & 0xffffffff:
+                    self._wait()
+                continue
+            count = min(room, len(text))
+            start = self._data(FROM_JOB)
+            off = head & self.mask
+            first = min(count, self.size - off)
+            self.mem[start + off:start + off + first] = text[:first]
+            if first < count:
+                self.mem[start:start + count - first] = text[first:count]
+            self._set('head', FROM_JOB, head + count)
+            # Vim only needs to be woken up when it may have found the ring
+            # empty.
+            if self._get('tail', FROM_JOB) == head:
+                self._notify()
+            text = text[count:]
+
+
+class PipeChannel:
+    """Same interface using stdin and stdout."""
+
+    def read(self):
+        return os.read(0, 1024 * 1024)
+
+    def write(self, text):
+        while text:
+            text = text[os.write(1, text):]
+
+
+def main():
+    if '--pipe' in sys.argv[1:]:
+        channel = PipeChannel()
+    else:
+        channel = ShmChannel()
+
+    # Send back whatever is received, until Vim closes the channel.
+    while True:
+        text = channel.read()
+        if not text:
+            break
+        channel.write(text)
+
+
+if __name__ == '__main__':
+    main()
+
+# vim: sw=4 sts=4 et
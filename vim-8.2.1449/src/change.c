@@ -440,6 +440,7 @@ changed_common(
     pos_T	*p;
     int		add;
 #endif
+    varnumber_T	tick = CHANGEDTICK(curbuf);
 
     // mark the buffer as modified
     changed();
@@ -529,6 +530,9 @@ changed_common(
 	    if (wp->w_redr_type < VALID)
 		wp->w_redr_type = VALID;
 
+	    // Forget the cached widths of the changed lines.
+	    linewidth_cache_changed(wp, lnum, lnume, xtra, tick);
+
 	    // Check if a change in the buffer has invalidated the cached
 	    // values for the cursor.
 #ifdef FEAT_FOLDING
@@ -10,6 +10,11 @@
  * Implements communication through a socket or any file handle.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// Needed for memfd_create(), used for the "shm" transport.
+# define _GNU_SOURCE
+#endif
+
 #ifdef WIN32
 // Must include winsock2.h before windows.h since it conflicts with winsock.h
 // (included in windows.h).
@@ -49,9 +54,15 @@
 # include <netinet/in.h>
 # include <arpa/inet.h>
 # include <sys/socket.h>
+# ifdef UNIX
+#  include <sys/uio.h>	// for writev()
+# endif
 # ifdef HAVE_LIBGEN_H
 #  include <libgen.h>
 # endif
+# if defined(HAVE_SYS_IOCTL_H) && !defined(SUN_SYSTEM)
+#  include <sys/ioctl.h>	// for FIONREAD
+# endif
 # define SOCK_ERRNO
 # define sock_write(sd, buf, len) write(sd, buf, len)
 # define sock_read(sd, buf, len) read(sd, buf, len)
@@ -59,6 +70,15 @@
 # define fd_read(fd, buf, len) read(fd, buf, len)
 # define fd_write(sd, buf, len) write(sd, buf, len)
 # define fd_close(sd) close(sd)
+# if defined(HAVE_SYS_EPOLL_H) && !defined(PROTO)
+#  include <sys/epoll.h>
+#  ifdef EPOLL_CLOEXEC
+#   define CH_USE_EPOLL
+#  endif
+# endif
+# ifdef FEAT_CHANNEL_SHM
+#  include <sys/mman.h>
+# endif
 #endif
 
 static void channel_read(channel_T *channel, ch_part_T part, char *func);
@@ -83,6 +103,49 @@ static int safe_to_invoke_callback = 0;
 
 static char *part_names[] = {"sock", "out", "err", "in"};
 
+// When more than CH_WRITEQUE_HIGH bytes are waiting to be written the write
+// queue is "full".  When it goes down to CH_WRITEQUE_LOW bytes the drain
+// callback is invoked.
+#define CH_WRITEQUE_HIGH    (1024 * 1024)
+#define CH_WRITEQUE_LOW	    (64 * 1024)
+
+// Buffer lines are written in blocks of about this many bytes.
+#define CH_WRITE_BLOCK_SIZE (64 * 1024)
+
+#ifdef UNIX
+// Maximum number of write queue entries written with one writev().
+# define CH_WRITEV_MAX 16
+#endif
+
+#ifdef FEAT_CHANNEL_SHM
+/*
+ * Layout of the shared memory used for the "shm" transport.  After the
+ * header there are two rings: one for text from Vim to the job and one for
+ * text from the job to Vim.  Each ring has three 32 bit values, each in its
+ * own cache line:
+ * "head" - number of bytes written, only changed by the writer
+ * "tail" - number of bytes read, only changed by the reader
+ * "wait" - set by the writer when the ring is full, the reader clears it and
+ *	    sends a notification after making room
+ * The values wrap around, "head - tail" is the number of bytes in the ring.
+ * See runtime/tools/shmclient.py for the job side.
+ */
+# define SHM_MAGIC	"VimShm01"
+# define SHM_RING_SIZE	(1024 * 1024)	// must be a power of two
+# define SHM_HDR_SIZE	4096
+# define SHM_SIZE	(SHM_HDR_SIZE + 2 * SHM_RING_SIZE)
+# define SHM_TO_JOB	0		// ring from Vim to the job
+# define SHM_FROM_JOB	1		// ring from the job to Vim
+# define SHM_HEAD(ring)	(64 + (ring) * 192)
+# define SHM_TAIL(ring)	(128 + (ring) * 192)
+# define SHM_WAIT(ring)	(192 + (ring) * 192)
+# define SHM_DATA(ring)	(SHM_HDR_SIZE + (ring) * SHM_RING_SIZE)
+# define SHM_LOAD(mem, off) \
+	__atomic_load_n((UINT32_T *)((mem) + (off)), __ATOMIC_SEQ_CST)
+# define SHM_STORE(mem, off, val) \
+	__atomic_store_n((UINT32_T *)((mem) + (off)), (val), __ATOMIC_SEQ_CST)
+#endif
+
 #ifdef MSWIN
     static int
 fd_read(sock_T fd, char *buf, size_t len)
@@ -327,6 +390,9 @@ add_channel(void)
     for (part = PART_SOCK; part < PART_COUNT; ++part)
     {
 	channel->ch_part[part].ch_fd = INVALID_FD;
+#ifdef HAVE_SYS_EPOLL_H
+	channel->ch_part[part].ch_epoll_fd = INVALID_FD;
+#endif
 #ifdef FEAT_GUI_X11
 	channel->ch_part[part].ch_inputHandler = (XtInputId)NULL;
 #endif
@@ -1205,6 +1271,8 @@ channel_set_options(channel_T *channel, jobopt_T *opt)
 							      &opt->jo_err_cb);
     if (opt->jo_set & JO_CLOSE_CALLBACK)
 	free_set_callback(&channel->ch_close_cb, &opt->jo_close_cb);
+    if (opt->jo_set2 & JO2_DRAIN_CB)
+	free_set_callback(&channel->ch_drain_cb, &opt->jo_drain_cb);
     channel->ch_drop_never = opt->jo_drop_never;
 
     if ((opt->jo_set & JO_OUT_IO) && opt->jo_io[PART_OUT] == JIO_BUFFER)
@@ -1233,6 +1301,9 @@ channel_set_options(channel_T *channel, jobopt_T *opt)
 	    if (opt->jo_set & JO_OUT_MODIFIABLE)
 		channel->ch_part[PART_OUT].ch_nomodifiable =
 						!opt->jo_modifiable[PART_OUT];
+	    if (opt->jo_set2 & JO2_OUT_MAXLINES)
+		channel->ch_part[PART_OUT].ch_maxlines =
+						    opt->jo_maxlines[PART_OUT];
 
 	    if (!buf->b_p_ma && !channel->ch_part[PART_OUT].ch_nomodifiable)
 	    {
@@ -1280,6 +1351,9 @@ channel_set_options(channel_T *channel, jobopt_T *opt)
 	    if (opt->jo_set & JO_ERR_MODIFIABLE)
 		channel->ch_part[PART_ERR].ch_nomodifiable =
 						!opt->jo_modifiable[PART_ERR];
+	    if (opt->jo_set2 & JO2_ERR_MAXLINES)
+		channel->ch_part[PART_ERR].ch_maxlines =
+						    opt->jo_maxlines[PART_ERR];
 	    if (!buf->b_p_ma && !channel->ch_part[PART_ERR].ch_nomodifiable)
 	    {
 		emsg(_(e_modifiable));
@@ -1364,7 +1438,8 @@ channel_open_func(typval_T *argvars)
     opt.jo_mode = MODE_JSON;
     opt.jo_timeout = 2000;
     if (get_job_options(&argvars[1], &opt,
-	    JO_MODE_ALL + JO_CB_ALL + JO_WAITTIME + JO_TIMEOUT_ALL, 0) == FAIL)
+		JO_MODE_ALL + JO_CB_ALL + JO_WAITTIME + JO_TIMEOUT_ALL,
+							 JO2_DRAIN_CB) == FAIL)
 	goto theend;
     if (opt.jo_timeout < 0)
     {
@@ -1383,11 +1458,140 @@ theend:
     return channel;
 }
 
+#ifdef CH_USE_EPOLL
+// The epoll instance that holds the read fds of the channels.  Only this fd
+// is passed to select() or poll(), thus the cost of waiting no longer grows
+// with the number of idle channels.
+// -2: not created yet, -1: epoll can't be used.
+static int channel_epoll_fd = -2;
+
+// Maximum number of ready fds obtained with one epoll_wait() call.  When
+// there are more they are reported the next time.
+# define CH_EPOLL_EVENTS 64
+
+# if defined(UNIX) && !defined(HAVE_SELECT)
+// Index of the epoll fd in the fds used by channel_poll_setup().
+static int channel_epoll_poll_idx = -1;
+# endif
+
+/*
+ * Stop watching the fd of "part" with epoll.
+ */
+    static void
+channel_epoll_remove(channel_T *channel, ch_part_T part)
+{
+    sock_T		fd = channel->ch_part[part].ch_epoll_fd;
+    ch_part_T		p;
+    struct epoll_event	ev;
+
+    if (fd == INVALID_FD)
+	return;
+    channel->ch_part[part].ch_epoll_fd = INVALID_FD;
+
+    // When using a pty the same FD is used for multiple parts, keep it
+    // registered while another part still uses it.
+    for (p = PART_SOCK; p < PART_IN; ++p)
+	if (channel->ch_part[p].ch_epoll_fd == fd)
+	    return;
+    vim_memset(&ev, 0, sizeof(ev));
+    epoll_ctl(channel_epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+}
+
+/*
+ * Make sure the fd of "part" is watched with epoll when it can be, and is not
+ * watched for a keep-open channel.  The registration persists until the fd
+ * is closed, thus usually this does not make a system call.
+ * Returns TRUE when the fd is watched with epoll, FALSE when select() or
+ * poll() needs to check it.
+ */
+    static int
+channel_epoll_update(channel_T *channel, ch_part_T part)
+{
+    chanpart_T		*ch_part = &channel->ch_part[part];
+    struct epoll_event	ev;
+
+    if (channel_epoll_fd == -2)
+    {
+	channel_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (channel_epoll_fd < 0)
+	{
+	    channel_epoll_fd = -1;
+	    ch_log(NULL, "epoll_create1() failed, using select() or poll()");
+	}
+    }
+    if (channel_epoll_fd < 0)
+	return FALSE;
+
+    if (ch_part->ch_fd == INVALID_FD || channel->ch_keep_open)
+    {
+	channel_epoll_remove(channel, part);
+	return FALSE;
+    }
+    if (ch_part->ch_epoll_fd == ch_part->ch_fd)
+	return TRUE;
+    channel_epoll_remove(channel, part);
+
+    // Level-triggered: channel_read() may leave data behind, it must be
+    // reported again.
+    vim_memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = ch_part->ch_fd;
+    if (epoll_ctl(channel_epoll_fd, EPOLL_CTL_ADD, ch_part->ch_fd, &ev) < 0
+							   && errno != EEXIST)
+	// E.g. a regular file, select() and poll() can handle those.
+	return FALSE;
+    ch_part->ch_epoll_fd = ch_part->ch_fd;
+    return TRUE;
+}
+
+/*
+ * Get the fds that epoll reports as readable into "events".
+ * Returns the number of events.
+ */
+    static int
+channel_epoll_wait(struct epoll_event *events)
+{
+    int n = epoll_wait(channel_epoll_fd, events, CH_EPOLL_EVENTS, 0);
+
+    return n < 0 ? 0 : n;
+}
+
+/*
+ * Return TRUE when the fd of "part" is in "events".  It is removed from
+ * "events", so that a pty fd used for several parts is read only once.
+ */
+    static int
+channel_epoll_ready(
+	channel_T	    *channel,
+	ch_part_T	    part,
+	struct epoll_event  *events,
+	int		    nevents)
+{
+    sock_T  fd = channel->ch_part[part].ch_epoll_fd;
+    int	    i;
+
+    if (fd == INVALID_FD)
+	return FALSE;
+    for (i = 0; i < nevents; ++i)
+	if (events[i].data.fd == fd)
+	{
+	    events[i].data.fd = INVALID_FD;
+	    return TRUE;
+	}
+    return FALSE;
+}
+#endif
+
     static void
 ch_close_part(channel_T *channel, ch_part_T part)
 {
     sock_T *fd = &channel->ch_part[part].ch_fd;
 
+#ifdef CH_USE_EPOLL
+    // Always remove the fd before closing it, a job may still have it open
+    // and then epoll would keep reporting it.
+    channel_epoll_remove(channel, part);
+#endif
     if (*fd != INVALID_FD)
     {
 	if (part == PART_SOCK)
@@ -1454,6 +1658,63 @@ channel_set_pipes(channel_T *channel, sock_T in, sock_T out, sock_T err)
     }
 }
 
+#if defined(FEAT_CHANNEL_SHM) || defined(PROTO)
+/*
+ * Create the shared memory for the "shm" transport of a job.
+ * Returns the file descriptor to be passed to the job and sets "*memp" to
+ * the mapped memory.  Returns -1 on failure.
+ */
+    int
+channel_shm_create(char_u **memp)
+{
+    int		fd;
+    char_u	*mem;
+
+    fd = memfd_create("vim-channel", MFD_CLOEXEC);
+    if (fd < 0)
+	return -1;
+    if (ftruncate(fd, SHM_SIZE) < 0)
+    {
+	close(fd);
+	return -1;
+    }
+    mem = mmap(NULL, SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED)
+    {
+	close(fd);
+	return -1;
+    }
+    // A new memfd is filled with zeros, only the header needs to be set.
+    mch_memmove(mem, SHM_MAGIC, 8);
+    *(UINT32_T *)(mem + 8) = SHM_RING_SIZE;
+    *memp = mem;
+    return fd;
+}
+
+/*
+ * Free shared memory "mem" obtained with channel_shm_create().
+ */
+    void
+channel_shm_free(char_u *mem)
+{
+    munmap(mem, SHM_SIZE);
+}
+
+/*
+ * Use the "shm" transport for "channel": the text goes through the rings in
+ * "mem", the stdin and stdout pipes are only used for notifications.
+ */
+    void
+channel_set_shm(channel_T *channel, char_u *mem)
+{
+    channel->ch_shm = mem;
+    // Writing a notification must not block.  When the pipe is full the job
+    // did not read the previous ones yet, that is sufficient.
+    channel_set_nonblock(channel, PART_IN);
+    ch_log(channel, "Using shared memory transport");
+}
+#endif
+
 /*
  * Sets the job the channel is associated with and associated options.
  * This does not keep a refcount, when the job is freed ch_job is cleared.
@@ -1522,34 +1783,6 @@ channel_set_req_callback(
     }
 }
 
-    static void
-write_buf_line(buf_T *buf, linenr_T lnum, channel_T *channel)
-{
-    char_u  *line = ml_get_buf(buf, lnum, FALSE);
-    int	    len = (int)STRLEN(line);
-    char_u  *p;
-    int	    i;
-
-    // Need to make a copy to be able to append a NL.
-    if ((p = alloc(len + 2)) == NULL)
-	return;
-    memcpy((char *)p, (char *)line, len);
-
-    if (channel->ch_write_text_mode)
-	p[len] = CAR;
-    else
-    {
-	for (i = 0; i < len; ++i)
-	    if (p[i] == NL)
-		p[i] = NUL;
-
-	p[len] = NL;
-    }
-    p[len + 1] = NUL;
-    channel_send(channel, PART_IN, p, len + 1, "write_buf_line");
-    vim_free(p);
-}
-
 /*
  * Return TRUE if "channel" can be written to.
  * Returns FALSE if the input is closed or the write would block.
@@ -1619,6 +1852,78 @@ can_write_buf_line(channel_T *channel)
     return TRUE;
 }
 
+/*
+ * Append line "lnum" of "buf" to "gap", followed by a NL or CR.
+ */
+    static void
+add_buf_line(buf_T *buf, linenr_T lnum, channel_T *channel, garray_T *gap)
+{
+    char_u  *line = ml_get_buf(buf, lnum, FALSE);
+    int	    len = (int)STRLEN(line);
+    char_u  *p;
+    int	    i;
+
+    if (ga_grow(gap, len + 1) == FAIL)
+	return;
+    p = (char_u *)gap->ga_data + gap->ga_len;
+    mch_memmove(p, line, len);
+
+    if (channel->ch_write_text_mode)
+	p[len] = CAR;
+    else
+    {
+	for (i = 0; i < len; ++i)
+	    if (p[i] == NL)
+		p[i] = NUL;
+
+	p[len] = NL;
+    }
+    gap->ga_len += len + 1;
+}
+
+/*
+ * Write lines "lnum" to "last" of "buf" to "channel".  The lines are written
+ * in blocks, a big buffer takes only a few system calls.
+ * Stops when the input can't be written to.
+ * Returns the number of lines written.
+ */
+    static int
+write_buf_lines(buf_T *buf, linenr_T lnum, linenr_T last, channel_T *channel)
+{
+    chanpart_T	*in_part = &channel->ch_part[PART_IN];
+    garray_T	ga;
+    int		written = 0;
+#ifdef MSWIN
+    int		block_size = 0;	// writing may block, one line at a time
+#else
+    int		block_size = CH_WRITE_BLOCK_SIZE;
+
+    // What can't be written right away goes into the write queue, it is
+    // written when the input is ready for it.
+    if (!in_part->ch_nonblocking)
+	channel_set_nonblock(channel, PART_IN);
+#endif
+
+    // For testing: "block_write" is about writing one line at a time.
+    if (in_part->ch_block_write != 0)
+	block_size = 0;
+
+    ga_init2(&ga, 1, CH_WRITE_BLOCK_SIZE + 1000);
+    while (lnum <= last && in_part->ch_writeque.wq_next == NULL
+					       && can_write_buf_line(channel))
+    {
+	for (;;)
+	{
+	    add_buf_line(buf, lnum++, channel, &ga);
+	    ++written;
+	    if (lnum > last || ga.ga_len >= block_size)
+		break;
+	}
+	channel_send_ga(channel, PART_IN, &ga, "write_buf_line");
+    }
+    return written;
+}
+
 /*
  * Write any buffer lines to the input channel.
  */
@@ -1640,14 +1945,12 @@ channel_write_in(channel_T *channel)
 	return;
     }
 
-    for (lnum = in_part->ch_buf_top; lnum <= in_part->ch_buf_bot
-				   && lnum <= buf->b_ml.ml_line_count; ++lnum)
-    {
-	if (!can_write_buf_line(channel))
-	    break;
-	write_buf_line(buf, lnum, channel);
-	++written;
-    }
+    lnum = in_part->ch_buf_top;
+    written = write_buf_lines(buf, lnum,
+		in_part->ch_buf_bot < buf->b_ml.ml_line_count
+			  ? in_part->ch_buf_bot : buf->b_ml.ml_line_count,
+		channel);
+    lnum += written;
 
     if (written == 1)
 	ch_log(channel, "written line %d to channel", (int)lnum - 1);
@@ -1657,6 +1960,11 @@ channel_write_in(channel_T *channel)
     in_part->ch_buf_top = lnum;
     if (lnum > buf->b_ml.ml_line_count || lnum > in_part->ch_buf_bot)
     {
+	// Wait for the text in the write queue to be written before
+	// closing.
+	if (in_part->ch_writeque.wq_next != NULL)
+	    return;
+
 #if defined(FEAT_TERMINAL)
 	// Send CTRL-D or "eof_chars" to close stdin on MS-Windows.
 	if (channel->ch_job != NULL)
@@ -1751,14 +2059,10 @@ channel_write_new_lines(buf_T *buf)
 	    if (in_part->ch_fd == INVALID_FD)
 		continue;  // pipe was closed
 	    found_one = TRUE;
-	    for (lnum = in_part->ch_buf_bot; lnum < buf->b_ml.ml_line_count;
-								       ++lnum)
-	    {
-		if (!can_write_buf_line(channel))
-		    break;
-		write_buf_line(buf, lnum, channel);
-		++written;
-	    }
+	    lnum = in_part->ch_buf_bot;
+	    written = write_buf_lines(buf, lnum, buf->b_ml.ml_line_count - 1,
+								      channel);
+	    lnum += written;
 
 	    if (written == 1)
 		ch_log(channel, "written line %d to channel", (int)lnum - 1);
@@ -1815,22 +2119,21 @@ channel_peek(channel_T *channel, ch_part_T part)
     char_u *
 channel_first_nl(readq_T *node)
 {
-    char_u  *buffer = node->rq_buffer;
-    long_u  i;
-
-    for (i = 0; i < node->rq_buflen; ++i)
-	if (buffer[i] == NL)
-	    return buffer + i;
-    return NULL;
+    return (char_u *)memchr(node->rq_buffer, NL, (size_t)node->rq_buflen);
 }
 
 /*
- * Return the first buffer from channel "channel"/"part" and remove it.
- * The caller must free it.
+ * Remove the first node from "channel"/"part" and return its allocated
+ * memory, without moving the text.  The text starts at "*offset" and is
+ * "*len" bytes long, followed by a NUL.  The caller must free the memory.
  * Returns NULL if there is nothing.
  */
-    char_u *
-channel_get(channel_T *channel, ch_part_T part, int *outlen)
+    static char_u *
+channel_get_alloced(
+	channel_T   *channel,
+	ch_part_T   part,
+	long_u	    *offset,
+	long_u	    *len)
 {
     readq_T *head = &channel->ch_part[part].ch_head;
     readq_T *node = head->rq_next;
@@ -1838,10 +2141,10 @@ channel_get(channel_T *channel, ch_part_T part, int *outlen)
 
     if (node == NULL)
 	return NULL;
-    if (outlen != NULL)
-	*outlen += node->rq_buflen;
     // dispose of the node but keep the buffer
-    p = node->rq_buffer;
+    p = node->rq_alloced;
+    *offset = (long_u)(node->rq_buffer - p);
+    *len = node->rq_buflen;
     head->rq_next = node->rq_next;
     if (node->rq_next == NULL)
 	head->rq_prev = NULL;
@@ -1851,6 +2154,29 @@ channel_get(channel_T *channel, ch_part_T part, int *outlen)
     return p;
 }
 
+/*
+ * Return the first buffer from channel "channel"/"part" and remove it.
+ * The caller must free it.
+ * Returns NULL if there is nothing.
+ */
+    char_u *
+channel_get(channel_T *channel, ch_part_T part, int *outlen)
+{
+    long_u  offset;
+    long_u  len;
+    char_u  *p = channel_get_alloced(channel, part, &offset, &len);
+
+    if (p == NULL)
+	return NULL;
+    if (outlen != NULL)
+	*outlen += len;
+    if (offset > 0)
+	// Part of the text was consumed, move the rest to the start,
+	// including the NUL.
+	mch_memmove(p, p + offset, len + 1);
+    return p;
+}
+
 /*
  * Returns the whole buffer contents concatenated for "channel"/"part".
  * Replaces NUL bytes with NL.
@@ -1864,26 +2190,37 @@ channel_get_all(channel_T *channel, ch_part_T part, int *outlen)
     char_u  *res;
     char_u  *p;
 
-    // Concatenate everything into one buffer.
-    for (node = head->rq_next; node != NULL; node = node->rq_next)
-	len += node->rq_buflen;
-    res = alloc(len + 1);
-    if (res == NULL)
-	return NULL;
-    p = res;
-    for (node = head->rq_next; node != NULL; node = node->rq_next)
+    if (head->rq_next != NULL && head->rq_next->rq_next == NULL)
     {
-	mch_memmove(p, node->rq_buffer, node->rq_buflen);
-	p += node->rq_buflen;
+	// Only one buffer, no need to copy the text.
+	len = head->rq_next->rq_buflen;
+	res = channel_get(channel, part, NULL);
+	if (res == NULL)
+	    return NULL;
     }
-    *p = NUL;
-
-    // Free all buffers
-    do
+    else
     {
-	p = channel_get(channel, part, NULL);
-	vim_free(p);
-    } while (p != NULL);
+	// Concatenate everything into one buffer.
+	for (node = head->rq_next; node != NULL; node = node->rq_next)
+	    len += node->rq_buflen;
+	res = alloc(len + 1);
+	if (res == NULL)
+	    return NULL;
+	p = res;
+	for (node = head->rq_next; node != NULL; node = node->rq_next)
+	{
+	    mch_memmove(p, node->rq_buffer, node->rq_buflen);
+	    p += node->rq_buflen;
+	}
+	*p = NUL;
+
+	// Free all buffers
+	do
+	{
+	    p = channel_get(channel, part, NULL);
+	    vim_free(p);
+	} while (p != NULL);
+    }
 
     if (outlen != NULL)
     {
@@ -1932,11 +2269,12 @@ channel_consume(channel_T *channel, ch_part_T part, int len)
 {
     readq_T *head = &channel->ch_part[part].ch_head;
     readq_T *node = head->rq_next;
-    char_u *buf = node->rq_buffer;
 
-    mch_memmove(buf, buf + len, node->rq_buflen - len);
+    // Only move the start of the text.  The consumed space is reused when
+    // appending, see channel_grow_node().  Moving the text here would make
+    // handling many messages in one buffer slow.
+    node->rq_buffer += len;
     node->rq_buflen -= len;
-    node->rq_buffer[node->rq_buflen] = NUL;
 }
 
 /*
@@ -1973,14 +2311,15 @@ channel_collapse(channel_T *channel, ch_part_T part, int want_nl)
 	return FAIL;	    // out of memory
     mch_memmove(p, node->rq_buffer, node->rq_buflen);
     p += node->rq_buflen;
-    vim_free(node->rq_buffer);
-    node->rq_buffer = newbuf;
+    vim_free(node->rq_alloced);
+    node->rq_alloced = node->rq_buffer = newbuf;
+    node->rq_size = len + 1;
     for (n = node; n != last_node; )
     {
 	n = n->rq_next;
 	mch_memmove(p, n->rq_buffer, n->rq_buflen);
 	p += n->rq_buflen;
-	vim_free(n->rq_buffer);
+	vim_free(n->rq_alloced);
     }
     *p = NUL;
     node->rq_buflen = (long_u)(p - newbuf);
@@ -2001,47 +2340,55 @@ channel_collapse(channel_T *channel, ch_part_T part, int want_nl)
 }
 
 /*
- * Store "buf[len]" on "channel"/"part".
- * When "prepend" is TRUE put in front, otherwise append at the end.
+ * Make room for "len" more bytes and a NUL after the text in "node".
  * Returns OK or FAIL.
  */
     static int
-channel_save(channel_T *channel, ch_part_T part, char_u *buf, int len,
-						      int prepend, char *lead)
+channel_grow_node(readq_T *node, long_u len)
 {
-    readq_T *node;
-    readq_T *head = &channel->ch_part[part].ch_head;
+    long_u  offset = (long_u)(node->rq_buffer - node->rq_alloced);
+    long_u  needed = node->rq_buflen + len + 1;
+    long_u  newsize;
     char_u  *p;
-    int	    i;
 
-    node = ALLOC_ONE(readq_T);
-    if (node == NULL)
-	return FAIL;	    // out of memory
-    // A NUL is added at the end, because netbeans code expects that.
-    // Otherwise a NUL may appear inside the text.
-    node->rq_buffer = alloc(len + 1);
-    if (node->rq_buffer == NULL)
-    {
-	vim_free(node);
-	return FAIL;	    // out of memory
+    if (offset + needed <= node->rq_size)
+	return OK;
+    if (offset > 0 && offset >= node->rq_buflen)
+    {
+	// More text was consumed than is left, moving the rest to the start
+	// is cheap.
+	mch_memmove(node->rq_alloced, node->rq_buffer, node->rq_buflen + 1);
+	node->rq_buffer = node->rq_alloced;
+	offset = 0;
+	if (needed <= node->rq_size)
+	    return OK;
     }
 
-    if (channel->ch_part[part].ch_mode == MODE_NL)
-    {
-	// Drop any CR before a NL.
-	p = node->rq_buffer;
-	for (i = 0; i < len; ++i)
-	    if (buf[i] != CAR || i + 1 >= len || buf[i + 1] != NL)
-		*p++ = buf[i];
-	*p = NUL;
-	node->rq_buflen = (long_u)(p - node->rq_buffer);
-    }
-    else
-    {
-	mch_memmove(node->rq_buffer, buf, len);
-	node->rq_buffer[len] = NUL;
-	node->rq_buflen = (long_u)len;
-    }
+    // Grow by 50% to avoid reallocating for every read.
+    newsize = node->rq_size + node->rq_size / 2;
+    if (newsize < offset + needed)
+	newsize = offset + needed;
+    p = vim_realloc(node->rq_alloced, newsize);
+    if (p == NULL)
+	return FAIL;	    // out of memory
+    node->rq_alloced = p;
+    node->rq_buffer = p + offset;
+    node->rq_size = newsize;
+    return OK;
+}
+
+/*
+ * Add "node" to the queue of "channel"/"part".
+ * When "prepend" is TRUE put in front, otherwise append at the end.
+ */
+    static void
+channel_add_node(
+	channel_T   *channel,
+	ch_part_T   part,
+	readq_T	    *node,
+	int	    prepend)
+{
+    readq_T *head = &channel->ch_part[part].ch_head;
 
     if (prepend)
     {
@@ -2065,15 +2412,103 @@ channel_save(channel_T *channel, ch_part_T part, char_u *buf, int len,
 	    head->rq_prev->rq_next = node;
 	head->rq_prev = node;
     }
-
-    if (ch_log_active() && lead != NULL)
-    {
-	ch_log_lead(lead, channel, part);
-	fprintf(log_fd, "'");
-	vim_ignored = (int)fwrite(buf, len, 1, log_fd);
-	fprintf(log_fd, "'\n");
-    }
-    return OK;
+}
+
+/*
+ * Put the text "buf[offset]", which is "len" bytes long and followed by a
+ * NUL, in front of the queue of "channel"/"part" without copying it.
+ * "buf" is allocated with at least "size" bytes, it is taken over.
+ * Returns OK or FAIL.
+ */
+    static int
+channel_unget(
+	channel_T   *channel,
+	ch_part_T   part,
+	char_u	    *buf,
+	long_u	    offset,
+	long_u	    len,
+	long_u	    size)
+{
+    readq_T *node = ALLOC_ONE(readq_T);
+
+    if (node == NULL)
+    {
+	vim_free(buf);
+	return FAIL;	    // out of memory
+    }
+    node->rq_alloced = buf;
+    node->rq_size = size;
+    node->rq_buffer = buf + offset;
+    node->rq_buflen = len;
+    channel_add_node(channel, part, node, TRUE);
+    return OK;
+}
+
+/*
+ * Store "buf[len]" on "channel"/"part".
+ * When "prepend" is TRUE put in front, otherwise append at the end.
+ * When appending the text is added to the last buffer, so that a long
+ * message that arrives in many pieces doesn't result in many buffers.
+ * Returns OK or FAIL.
+ */
+    static int
+channel_save(channel_T *channel, ch_part_T part, char_u *buf, int len,
+						      int prepend, char *lead)
+{
+    readq_T *node;
+    readq_T *head = &channel->ch_part[part].ch_head;
+    char_u  *p;
+    int	    i;
+
+    if (!prepend && head->rq_prev != NULL)
+    {
+	node = head->rq_prev;
+	if (channel_grow_node(node, (long_u)len) == FAIL)
+	    return FAIL;	    // out of memory
+    }
+    else
+    {
+	node = ALLOC_ONE(readq_T);
+	if (node == NULL)
+	    return FAIL;	    // out of memory
+	// A NUL is added at the end, because netbeans code expects that.
+	// Otherwise a NUL may appear inside the text.
+	node->rq_alloced = alloc(len + 1);
+	if (node->rq_alloced == NULL)
+	{
+	    vim_free(node);
+	    return FAIL;	    // out of memory
+	}
+	node->rq_size = len + 1;
+	node->rq_buffer = node->rq_alloced;
+	node->rq_buflen = 0;
+	channel_add_node(channel, part, node, prepend);
+    }
+
+    p = node->rq_buffer + node->rq_buflen;
+    if (channel->ch_part[part].ch_mode == MODE_NL)
+    {
+	// Drop any CR before a NL.
+	for (i = 0; i < len; ++i)
+	    if (buf[i] != CAR || i + 1 >= len || buf[i + 1] != NL)
+		*p++ = buf[i];
+    }
+    else
+    {
+	mch_memmove(p, buf, len);
+	p += len;
+    }
+    *p = NUL;
+    node->rq_buflen = (long_u)(p - node->rq_buffer);
+
+    if (ch_log_active() && lead != NULL)
+    {
+	ch_log_lead(lead, channel, part);
+	fprintf(log_fd, "'");
+	vim_ignored = (int)fwrite(buf, len, 1, log_fd);
+	fprintf(log_fd, "'\n");
+    }
+    return OK;
 }
 
 /*
@@ -2085,34 +2520,125 @@ channel_fill(js_read_T *reader)
 {
     channel_T	*channel = (channel_T *)reader->js_cookie;
     ch_part_T	part = reader->js_cookie_arg;
-    char_u	*next = channel_get(channel, part, NULL);
-    int		keeplen;
-    int		addlen;
+    long_u	offset;
+    long_u	addlen;
+    char_u	*next = channel_get_alloced(channel, part, &offset, &addlen);
+    long_u	keeplen;
     char_u	*p;
 
     if (next == NULL)
 	return FALSE;
 
-    keeplen = reader->js_end - reader->js_buf;
-    if (keeplen > 0)
+    // Append the text to the unused text.
+    keeplen = (long_u)(reader->js_end - reader->js_buf);
+    p = vim_realloc(reader->js_buf, keeplen + addlen + 1);
+    if (p == NULL)
     {
-	// Prepend unused text.
-	addlen = (int)STRLEN(next);
-	p = alloc(keeplen + addlen + 1);
-	if (p == NULL)
+	vim_free(next);
+	return FALSE;
+    }
+    mch_memmove(p + keeplen, next + offset, addlen + 1);
+    vim_free(next);
+    reader->js_buf = p;
+    reader->js_end = p + keeplen + addlen;
+    return TRUE;
+}
+
+/*
+ * Decode a Language Server Protocol message from "reader": a header with the
+ * Content-Length, an empty line and a JSON object.
+ * The result in "res" is a List with the ID of a response, or zero for a
+ * request or notification, and the Dict.  That is what JSON mode produces,
+ * thus the same queue and callbacks can be used.
+ * When the message is invalid "res" is set to VAR_UNKNOWN.
+ * Sets "*incomplete" when the header is complete but the body is not.
+ * Returns OK, FAIL for an invalid header or MAYBE when more is needed.
+ */
+    static int
+channel_decode_lsp(js_read_T *reader, typval_T *res, int *incomplete)
+{
+    char_u	*p = reader->js_buf + reader->js_used;
+    char_u	*hdr_end;
+    char_u	*eol;
+    char_u	*body;
+    char_u	*save_end;
+    long	len = -1;
+    int		c;
+    int		status;
+    typval_T	tv;
+    dictitem_T	*di;
+    varnumber_T	id = 0;
+
+    // Find the empty line that ends the header.
+    for (hdr_end = p; ; ++hdr_end)
+    {
+	hdr_end = memchr(hdr_end, CAR, reader->js_end - hdr_end);
+	if (hdr_end == NULL || reader->js_end - hdr_end < 4)
+	    return MAYBE;
+	if (STRNCMP(hdr_end, "\r\n\r\n", 4) == 0)
+	    break;
+    }
+
+    // Only the Content-Length is used, other header fields are ignored.
+    for ( ; p < hdr_end; p = eol + 2)
+    {
+	eol = memchr(p, CAR, hdr_end - p + 1);
+	if (STRNICMP(p, "Content-Length:", 15) == 0)
 	{
-	    vim_free(next);
-	    return FALSE;
+	    p = skipwhite(p + 15);
+	    if (VIM_ISDIGIT(*p))
+		len = getdigits(&p);
 	}
-	mch_memmove(p, reader->js_buf, keeplen);
-	mch_memmove(p + keeplen, next, addlen + 1);
-	vim_free(next);
-	next = p;
+    }
+    body = hdr_end + 4;
+    if (len < 0)
+    {
+	reader->js_used = (int)(body - reader->js_buf);
+	return FAIL;
+    }
+    if (reader->js_end - body < len)
+    {
+	*incomplete = TRUE;
+	return MAYBE;
     }
 
-    vim_free(reader->js_buf);
-    reader->js_buf = next;
-    return TRUE;
+    // Decode only the body, the next message may follow it.
+    save_end = reader->js_end;
+    reader->js_end = body + len;
+    c = *reader->js_end;
+    *reader->js_end = NUL;
+    reader->js_used = (int)(body - reader->js_buf);
+    ++emsg_silent;
+    status = json_decode(reader, &tv, 0);
+    --emsg_silent;
+    if (status == OK && (tv.v_type != VAR_DICT
+			   || reader->js_buf + reader->js_used < body + len))
+    {
+	clear_tv(&tv);
+	status = FAIL;
+    }
+    *reader->js_end = c;
+    reader->js_end = save_end;
+    reader->js_used = (int)(body + len - reader->js_buf);
+
+    res->v_type = VAR_UNKNOWN;
+    if (status != OK)
+	return OK;
+
+    // A response has an "id" but no "method".
+    di = dict_find(tv.vval.v_dict, (char_u *)"id", -1);
+    if (di != NULL && di->di_tv.v_type == VAR_NUMBER
+		   && dict_find(tv.vval.v_dict, (char_u *)"method", -1) == NULL)
+	id = di->di_tv.vval.v_number;
+    if (rettv_list_alloc(res) == OK
+	    && (list_append_number(res->vval.v_list, id) == FAIL
+		|| list_append_dict(res->vval.v_list, tv.vval.v_dict) == FAIL))
+    {
+	clear_tv(res);
+	res->v_type = VAR_UNKNOWN;
+    }
+    clear_tv(&tv);
+    return OK;
 }
 
 /*
@@ -2130,12 +2656,19 @@ channel_parse_json(channel_T *channel, ch_part_T part)
     jsonq_T	*head = &chanpart->ch_json_head;
     int		status;
     int		ret;
+    long_u	start = 0;	// avoid compiler warning
+    long_u	len = 0;	// avoid compiler warning
+    int		incomplete = FALSE;
 
     if (channel_peek(channel, part) == NULL)
 	return FALSE;
 
-    reader.js_buf = channel_get(channel, part, NULL);
-    reader.js_used = 0;
+    // Use all the text that was read, decode it where it is.
+    while (channel_collapse(channel, part, FALSE) == OK)
+	;
+    reader.js_buf = channel_get_alloced(channel, part, &start, &len);
+    reader.js_used = (int)start;
+    reader.js_end = reader.js_buf + start + len;
     reader.js_fill = channel_fill;
     reader.js_cookie = channel;
     reader.js_cookie_arg = part;
@@ -2144,17 +2677,24 @@ channel_parse_json(channel_T *channel, ch_part_T part)
     // arrive.  After the delay drop the input, otherwise a truncated string
     // or list will make us hang.
     // Do not generate error messages, they will be written in a channel log.
-    ++emsg_silent;
-    status = json_decode(&reader, &listtv,
+    if (chanpart->ch_mode == MODE_LSP)
+	status = channel_decode_lsp(&reader, &listtv, &incomplete);
+    else
+    {
+	++emsg_silent;
+	status = json_decode(&reader, &listtv,
 				  chanpart->ch_mode == MODE_JS ? JSON_JS : 0);
-    --emsg_silent;
+	--emsg_silent;
+    }
     if (status == OK)
     {
 	// Only accept the response when it is a list with at least two
 	// items.
 	if (listtv.v_type != VAR_LIST || listtv.vval.v_list->lv_len < 2)
 	{
-	    if (listtv.v_type != VAR_LIST)
+	    if (listtv.v_type == VAR_UNKNOWN)
+		ch_error(channel, "Invalid LSP message, discarding");
+	    else if (listtv.v_type != VAR_LIST)
 		ch_error(channel, "Did not receive a list, discarding");
 	    else
 		ch_error(channel, "Expected list with two items, got %d",
@@ -2194,16 +2734,23 @@ channel_parse_json(channel_T *channel, ch_part_T part)
 	chanpart->ch_wait_len = 0;
     else if (status == MAYBE)
     {
-	size_t buflen = STRLEN(reader.js_buf);
+	size_t buflen = (size_t)(reader.js_end - reader.js_buf) - start;
 
-	if (chanpart->ch_wait_len < buflen)
+	if (incomplete)
+	{
+	    // The length of the message is known, wait for the rest of it
+	    // without a deadline.
+	    reader.js_used = (int)start;
+	    chanpart->ch_wait_len = 0;
+	}
+	else if (chanpart->ch_wait_len < buflen)
 	{
 	    // First time encountering incomplete message or after receiving
 	    // more (but still incomplete): set a deadline of 100 msec.
 	    ch_log(channel,
 		    "Incomplete message (%d bytes) - wait 100 msec for more",
 		    (int)buflen);
-	    reader.js_used = 0;
+	    reader.js_used = (int)start;
 	    chanpart->ch_wait_len = buflen;
 #ifdef MSWIN
 	    chanpart->ch_deadline = GetTickCount() + 100L;
@@ -2240,7 +2787,7 @@ channel_parse_json(channel_T *channel, ch_part_T part)
 	    }
 	    else
 	    {
-		reader.js_used = 0;
+		reader.js_used = (int)start;
 		ch_log(channel, "still waiting on incomplete message");
 	    }
 	}
@@ -2254,10 +2801,11 @@ channel_parse_json(channel_T *channel, ch_part_T part)
     }
     else if (reader.js_buf[reader.js_used] != NUL)
     {
-	// Put the unread part back into the channel.
-	channel_save(channel, part, reader.js_buf + reader.js_used,
-			(int)(reader.js_end - reader.js_buf) - reader.js_used,
-								  TRUE, NULL);
+	// Put the unread part back into the channel, without copying it.
+	channel_unget(channel, part, reader.js_buf, reader.js_used,
+		      (long_u)(reader.js_end - reader.js_buf) - reader.js_used,
+			       (long_u)(reader.js_end - reader.js_buf) + 1);
+	reader.js_buf = NULL;
 	ret = status == MAYBE ? FALSE: TRUE;
     }
     else
@@ -2546,7 +3094,6 @@ channel_exe_cmd(channel_T *channel, ch_part_T part, typval_T *argv)
 	    typval_T	*tv = NULL;
 	    typval_T	res_tv;
 	    typval_T	err_tv;
-	    char_u	*json = NULL;
 
 	    // Don't pollute the display with errors.
 	    ++emsg_skip;
@@ -2564,26 +3111,22 @@ channel_exe_cmd(channel_T *channel, ch_part_T part, typval_T *argv)
 
 	    if (argv[id_idx].v_type == VAR_NUMBER)
 	    {
-		int id = argv[id_idx].vval.v_number;
+		int	    id = argv[id_idx].vval.v_number;
+		garray_T    ga;
 
-		if (tv != NULL)
-		    json = json_encode_nr_expr(id, tv, options | JSON_NL);
-		if (tv == NULL || (json != NULL && *json == NUL))
+		ga_init2(&ga, 1, 4000);
+		if (tv == NULL || json_encode_nr_expr_ga(&ga, id, tv,
+						   options | JSON_NL) == FAIL)
 		{
 		    // If evaluation failed or the result can't be encoded
 		    // then return the string "ERROR".
-		    vim_free(json);
+		    ga_clear(&ga);
 		    err_tv.v_type = VAR_STRING;
 		    err_tv.vval.v_string = (char_u *)"ERROR";
-		    json = json_encode_nr_expr(id, &err_tv, options | JSON_NL);
-		}
-		if (json != NULL)
-		{
-		    channel_send(channel,
-				 part == PART_SOCK ? PART_SOCK : PART_IN,
-				 json, (int)STRLEN(json), (char *)cmd);
-		    vim_free(json);
+		    json_encode_nr_expr_ga(&ga, id, &err_tv, options | JSON_NL);
 		}
+		channel_send_ga(channel, part == PART_SOCK ? PART_SOCK : PART_IN,
+							     &ga, (char *)cmd);
 	    }
 	    --emsg_skip;
 	    if (tv == &res_tv)
@@ -2620,8 +3163,17 @@ invoke_one_time_callback(
     vim_free(item);
 }
 
+/*
+ * Append "count" lines to "buffer".  "msg" holds the lines, each one
+ * terminated with a NUL.
+ */
     static void
-append_to_buffer(buf_T *buffer, char_u *msg, channel_T *channel, ch_part_T part)
+append_to_buffer(
+	buf_T	    *buffer,
+	char_u	    *msg,
+	int	    count,
+	channel_T   *channel,
+	ch_part_T   part)
 {
     bufref_T	save_curbuf = {NULL, 0, 0};
     win_T	*save_curwin = NULL;
@@ -2631,6 +3183,8 @@ append_to_buffer(buf_T *buffer, char_u *msg, channel_T *channel, ch_part_T part)
     chanpart_T  *ch_part = &channel->ch_part[part];
     int		save_p_ma = buffer->b_p_ma;
     int		empty = (buffer->b_ml.ml_flags & ML_EMPTY) ? 1 : 0;
+    char_u	*p = msg;
+    int		i;
 
     if (!buffer->b_p_ma && !ch_part->ch_nomodifiable)
     {
@@ -2650,27 +3204,63 @@ append_to_buffer(buf_T *buffer, char_u *msg, channel_T *channel, ch_part_T part)
 	buffer->b_write_to_channel = FALSE;
     }
 
-    // Append to the buffer
-    ch_log(channel, "appending line %d to buffer", (int)lnum + 1 - empty);
-
     buffer->b_p_ma = TRUE;
 
     // Save curbuf/curwin/curtab and make "buffer" the current buffer.
     switch_to_win_for_buf(buffer, &save_curwin, &save_curtab, &save_curbuf);
 
     u_sync(TRUE);
+
+    // With "out_maxlines" drop the oldest lines at once and don't append
+    // lines that would be dropped right away.
+    if (ch_part->ch_maxlines > 0 && !save_write_to)
+    {
+	linenr_T    drop;
+
+	for ( ; count > ch_part->ch_maxlines; --count)
+	    p += STRLEN(p) + 1;
+	drop = lnum - empty + count - ch_part->ch_maxlines;
+	if (drop > 0)
+	{
+	    ch_log(channel, "dropping %ld lines from buffer", (long)drop);
+	    // ignore undo failure, undo is not very useful here
+	    vim_ignored = u_savedel(1, drop);
+	    for (i = 0; i < drop; ++i)
+		ml_delete(1);
+	    deleted_lines_mark(1, drop);
+	    // Other windows were adjusted, curwin wasn't.
+	    curwin->w_cursor.lnum = curwin->w_cursor.lnum > drop
+					    ? curwin->w_cursor.lnum - drop : 1;
+	    curwin->w_topline = curwin->w_topline > drop
+					    ? curwin->w_topline - drop : 1;
+	    lnum = buffer->b_ml.ml_line_count;
+	    empty = (buffer->b_ml.ml_flags & ML_EMPTY) ? 1 : 0;
+	}
+    }
+
+    // Append to the buffer
+    if (count == 1)
+	ch_log(channel, "appending line %d to buffer", (int)lnum + 1 - empty);
+    else
+	ch_log(channel, "appending lines %d to %d to buffer",
+			     (int)lnum + 1 - empty, (int)lnum - empty + count);
+
     // ignore undo failure, undo is not very useful here
     vim_ignored = u_save(lnum - empty, lnum + 1);
 
     if (empty)
     {
 	// The buffer is empty, replace the first (dummy) line.
-	ml_replace(lnum, msg, TRUE);
+	ml_replace(lnum, p, TRUE);
+	p += STRLEN(p) + 1;
 	lnum = 0;
     }
-    else
-	ml_append(lnum, msg, 0, FALSE);
-    appended_lines_mark(lnum, 1L);
+    for (i = empty; i < count; ++i)
+    {
+	ml_append(lnum + i, p, 0, FALSE);
+	p += STRLEN(p) + 1;
+    }
+    appended_lines_mark(lnum, count);
 
     // Restore curbuf/curwin/curtab
     restore_win_for_buf(save_curwin, save_curtab, &save_curbuf);
@@ -2688,17 +3278,19 @@ append_to_buffer(buf_T *buffer, char_u *msg, channel_T *channel, ch_part_T part)
 	{
 	    if (wp->w_buffer == buffer)
 	    {
+		// When the buffer was empty the first line was replaced, a
+		// cursor in it moves down with the following lines.
 		int move_cursor = save_write_to
 			    ? wp->w_cursor.lnum == lnum + 1
-			    : (wp->w_cursor.lnum == lnum
+			    : (wp->w_cursor.lnum == lnum + empty
 				&& wp->w_cursor.col == 0);
 
-		// If the cursor is at or above the new line, move it one line
-		// down.  If the topline is outdated update it now.
+		// If the cursor is at or above the new lines, move it down.
+		// If the topline is outdated update it now.
 		if (move_cursor || wp->w_topline > buffer->b_ml.ml_line_count)
 		{
 		    if (move_cursor)
-			++wp->w_cursor.lnum;
+			wp->w_cursor.lnum += count - empty;
 		    save_curwin = curwin;
 		    curwin = wp;
 		    curbuf = curwin->w_buffer;
@@ -2741,6 +3333,56 @@ drop_messages(channel_T *channel, ch_part_T part)
     }
 }
 
+/*
+ * Append all complete lines in the first buffer of NL mode "channel"/"part"
+ * to "buffer".  Appending them one by one makes Vim slower than a job that
+ * produces many lines.
+ * Returns FALSE when there is no complete line.
+ */
+    static int
+channel_append_lines(channel_T *channel, ch_part_T part, buf_T *buffer)
+{
+    readq_T *node;
+    char_u  *buf;
+    char_u  *last_nl;
+    char_u  *p;
+    int	    count = 0;
+
+    // Make sure the first buffer has a complete line.
+    while (TRUE)
+    {
+	node = channel_peek(channel, part);
+	if (node == NULL)
+	    return FALSE;
+	if (channel_first_nl(node) != NULL)
+	    break;
+	if (channel_collapse(channel, part, TRUE) == FAIL)
+	    return FALSE;
+    }
+    buf = node->rq_buffer;
+    for (last_nl = buf + node->rq_buflen - 1; *last_nl != NL; --last_nl)
+	;
+
+    // Turn the lines into NUL terminated strings.  Convert NUL to NL, the
+    // internal representation.
+    for (p = buf; p <= last_nl; ++p)
+	if (*p == NL)
+	{
+	    *p = NUL;
+	    ++count;
+	}
+	else if (*p == NUL)
+	    *p = NL;
+
+    append_to_buffer(buffer, buf, count, channel, part);
+
+    if (last_nl + 1 == buf + node->rq_buflen)
+	vim_free(channel_get(channel, part, NULL));
+    else
+	channel_consume(channel, part, (int)(last_nl - buf) + 1);
+    return TRUE;
+}
+
 /*
  * Invoke a callback for "channel"/"part" if needed.
  * This does not redraw but sets channel_need_redraw when redraw is needed.
@@ -2786,7 +3428,7 @@ may_invoke_callback(channel_T *channel, ch_part_T part)
 	buffer = NULL;
     }
 
-    if (ch_mode == MODE_JSON || ch_mode == MODE_JS)
+    if (ch_mode == MODE_JSON || ch_mode == MODE_JS || ch_mode == MODE_LSP)
     {
 	listitem_T	*item;
 	int		argc = 0;
@@ -2841,6 +3483,15 @@ may_invoke_callback(channel_T *channel, ch_part_T part)
 	    return FALSE;
 	}
 
+	// Without a callback all complete lines can be appended to the
+	// buffer at once.
+	if (ch_mode == MODE_NL && callback == NULL
+#ifdef FEAT_TERMINAL
+		&& buffer->b_term == NULL
+#endif
+		&& channel_append_lines(channel, part, buffer))
+	    return TRUE;
+
 	if (ch_mode == MODE_NL)
 	{
 	    char_u  *nl = NULL;
@@ -2877,9 +3528,9 @@ may_invoke_callback(channel_T *channel, ch_part_T part)
 	    }
 	    else if (nl + 1 == buf + node->rq_buflen)
 	    {
-		// get the whole buffer
+		// get the whole buffer, the text may be moved
 		msg = channel_get(channel, part, NULL);
-		*nl = NUL;
+		msg[nl - buf] = NUL;
 	    }
 	    else
 	    {
@@ -2934,8 +3585,10 @@ may_invoke_callback(channel_T *channel, ch_part_T part)
 	if (buffer != NULL)
 	{
 	    if (msg == NULL)
-		// JSON or JS mode: re-encode the message.
-		msg = json_encode(listtv, ch_mode);
+		// JSON or JS mode: re-encode the message, LSP mode: only the
+		// Dict.
+		msg = ch_mode == MODE_LSP ? json_encode(&argv[1], 0)
+						: json_encode(listtv, ch_mode);
 	    if (msg != NULL)
 	    {
 #ifdef FEAT_TERMINAL
@@ -2943,7 +3596,7 @@ may_invoke_callback(channel_T *channel, ch_part_T part)
 		    write_to_term(buffer, msg, channel);
 		else
 #endif
-		    append_to_buffer(buffer, msg, channel, part);
+		    append_to_buffer(buffer, msg, 1, channel, part);
 	    }
 	}
 
@@ -3004,7 +3657,7 @@ channel_has_readahead(channel_T *channel, ch_part_T part)
 {
     ch_mode_T	ch_mode = channel->ch_part[part].ch_mode;
 
-    if (ch_mode == MODE_JSON || ch_mode == MODE_JS)
+    if (ch_mode == MODE_JSON || ch_mode == MODE_JS || ch_mode == MODE_LSP)
     {
 	jsonq_T   *head = &channel->ch_part[part].ch_json_head;
 
@@ -3090,6 +3743,7 @@ channel_part_info(channel_T *channel, dict_T *dict, char *name, ch_part_T part)
 	case MODE_RAW: s = "RAW"; break;
 	case MODE_JSON: s = "JSON"; break;
 	case MODE_JS: s = "JS"; break;
+	case MODE_LSP: s = "LSP"; break;
     }
     dict_add_string(dict, namebuf, (char_u *)s);
 
@@ -3108,6 +3762,14 @@ channel_part_info(channel_T *channel, dict_T *dict, char *name, ch_part_T part)
 
     STRCPY(namebuf + tail, "timeout");
     dict_add_number(dict, namebuf, chanpart->ch_timeout);
+
+    if (part == PART_SOCK || part == PART_IN)
+    {
+	STRCPY(namebuf + tail, "pending");
+	dict_add_number(dict, namebuf, (varnumber_T)chanpart->ch_writeque_len);
+	STRCPY(namebuf + tail, "full");
+	dict_add_bool(dict, namebuf, chanpart->ch_writeque_full);
+    }
 }
 
     static void
@@ -3270,6 +3932,8 @@ channel_clear_one(channel_T *channel, ch_part_T part)
     while (ch_part->ch_writeque.wq_next != NULL)
 	remove_from_writeque(&ch_part->ch_writeque,
 						 ch_part->ch_writeque.wq_next);
+    ch_part->ch_writeque_len = 0;
+    ch_part->ch_writeque_full = FALSE;
 }
 
 /*
@@ -3286,6 +3950,14 @@ channel_clear(channel_T *channel)
     channel_clear_one(channel, PART_IN);
     free_callback(&channel->ch_callback);
     free_callback(&channel->ch_close_cb);
+    free_callback(&channel->ch_drain_cb);
+#ifdef FEAT_CHANNEL_SHM
+    if (channel->ch_shm != NULL)
+    {
+	channel_shm_free(channel->ch_shm);
+	channel->ch_shm = NULL;
+    }
+#endif
 }
 
 #if defined(EXITFREE) || defined(PROTO)
@@ -3307,6 +3979,9 @@ channel_free_all(void)
 // Buffer size for reading incoming messages.
 #define MAXMSGSIZE 4096
 
+// Maximum buffer size when more is available, see channel_read_size().
+#define MAXREADSIZE (1024 * 1024)
+
 #if defined(HAVE_SELECT)
 /*
  * Add write fds where we are waiting for writing to be possible.
@@ -3322,6 +3997,10 @@ channel_fill_wfds(int maxfd_arg, fd_set *wfds)
 	chanpart_T  *in_part = &ch->ch_part[PART_IN];
 
 	if (in_part->ch_fd != INVALID_FD
+#ifdef FEAT_CHANNEL_SHM
+		// the job sends a notification when there is room in the ring
+		&& ch->ch_shm == NULL
+#endif
 		&& (in_part->ch_bufref.br_buf != NULL
 		    || in_part->ch_writeque.wq_next != NULL))
 	{
@@ -3347,6 +4026,10 @@ channel_fill_poll_write(int nfd_in, struct pollfd *fds)
 	chanpart_T  *in_part = &ch->ch_part[PART_IN];
 
 	if (in_part->ch_fd != INVALID_FD
+#ifdef FEAT_CHANNEL_SHM
+		// the job sends a notification when there is room in the ring
+		&& ch->ch_shm == NULL
+#endif
 		&& (in_part->ch_bufref.br_buf != NULL
 		    || in_part->ch_writeque.wq_next != NULL))
 	{
@@ -3535,6 +4218,200 @@ channel_close_now(channel_T *channel)
     channel_close(channel, TRUE);
 }
 
+/*
+ * Return the number of bytes to read from "fd": what is available if that
+ * can be found out, but at least MAXMSGSIZE and at most MAXREADSIZE.
+ * This avoids many system calls when a lot of text is sent at once.
+ */
+    static int
+channel_read_size(sock_T fd, int use_socket UNUSED)
+{
+    int	    size = MAXMSGSIZE;
+#ifdef MSWIN
+    u_long  avail = 0;
+
+    // Only works for a socket.
+    if (use_socket && ioctlsocket(fd, FIONREAD, &avail) == 0
+						&& avail > (u_long)MAXMSGSIZE)
+	size = avail > MAXREADSIZE ? MAXREADSIZE : (int)avail;
+#elif defined(FIONREAD)
+    int	    avail = 0;
+
+    if (ioctl(fd, FIONREAD, &avail) == 0 && avail > MAXMSGSIZE)
+	size = avail > MAXREADSIZE ? MAXREADSIZE : avail;
+#endif
+    return size;
+}
+
+#ifdef FEAT_CHANNEL_SHM
+/*
+ * Notify the job using the "shm" transport of "channel" by writing a byte to
+ * its stdin.  An error for a full pipe is ignored, the job then still has
+ * notifications to read.
+ * Returns FAIL when the pipe is broken.
+ */
+    static int
+channel_shm_notify(channel_T *channel)
+{
+    sock_T	fd = channel->CH_IN_FD;
+
+    if (fd != INVALID_FD && fd_write(fd, "", 1) < 0 && errno != EWOULDBLOCK
+# ifdef EAGAIN
+	    && errno != EAGAIN
+# endif
+	    )
+	return FAIL;
+    return OK;
+}
+
+/*
+ * Called when a head or tail in the shared memory is more than the ring size
+ * away from the other one.  Only a broken job can do that, using the values
+ * would access memory outside of the ring.  Close the channel instead.
+ */
+    static void
+channel_shm_error(channel_T *channel, char *func)
+{
+    ch_error(channel, "%s(): invalid position in shared memory ring", func);
+    ch_close_part(channel, PART_IN);
+    ch_close_part_on_error(channel, PART_OUT, TRUE, func);
+}
+
+/*
+ * Copy "buf[len]" into the ring from Vim to the job of "channel".
+ * Returns the number of bytes copied, zero when the ring is full and -1 for
+ * an error.
+ */
+    static int
+channel_shm_write(channel_T *channel, char_u *buf, int len)
+{
+    char_u	*mem = channel->ch_shm;
+    char_u	*data = mem + SHM_DATA(SHM_TO_JOB);
+    UINT32_T	head = SHM_LOAD(mem, SHM_HEAD(SHM_TO_JOB));
+    UINT32_T	off = head & (SHM_RING_SIZE - 1);
+    UINT32_T	used;
+
+    if (channel->CH_IN_FD == INVALID_FD)
+	return -1;
+    used = head - SHM_LOAD(mem, SHM_TAIL(SHM_TO_JOB));
+    if (used == SHM_RING_SIZE)
+    {
+	// Ask the job for a notification when it made room.  Check again
+	// after setting the flag, the job may have read the ring meanwhile.
+	SHM_STORE(mem, SHM_WAIT(SHM_TO_JOB), 1);
+	used = head - SHM_LOAD(mem, SHM_TAIL(SHM_TO_JOB));
+	if (used == SHM_RING_SIZE)
+	    return 0;
+    }
+    // The tail is written by the job, it must not be ahead of the head.
+    if (used > SHM_RING_SIZE)
+    {
+	channel_shm_error(channel, "channel_shm_write");
+	return -1;
+    }
+    if ((UINT32_T)len > SHM_RING_SIZE - used)
+	len = (int)(SHM_RING_SIZE - used);
+    if ((UINT32_T)len <= SHM_RING_SIZE - off)
+	mch_memmove(data + off, buf, len);
+    else
+    {
+	mch_memmove(data + off, buf, SHM_RING_SIZE - off);
+	mch_memmove(data, buf + SHM_RING_SIZE - off,
+					      len - (SHM_RING_SIZE - off));
+    }
+    SHM_STORE(mem, SHM_HEAD(SHM_TO_JOB), head + len);
+
+    // The job only needs to be woken up when it may have found the ring
+    // empty.
+    if (SHM_LOAD(mem, SHM_TAIL(SHM_TO_JOB)) == head
+				       && channel_shm_notify(channel) == FAIL)
+	return -1;
+    return len;
+}
+
+/*
+ * Read from the "shm" transport of "channel": consume the notifications on
+ * the stdout pipe and put the text in the ring from the job in the read
+ * queue.
+ */
+    static void
+channel_shm_read(channel_T *channel, char *func)
+{
+    char_u	*mem = channel->ch_shm;
+    char_u	*data = mem + SHM_DATA(SHM_FROM_JOB);
+    sock_T	fd = channel->CH_OUT_FD;
+    char_u	buf[MAXMSGSIZE];
+    int		len = 0;
+    int		eof = FALSE;
+    int		readlen = 0;
+    UINT32_T	head;
+    UINT32_T	tail;
+    UINT32_T	off;
+    UINT32_T	n;
+
+    // Consume the notifications first, the text written before them is then
+    // in the ring.
+    while (channel_wait(channel, fd, 0) == CW_READY)
+    {
+	len = fd_read(fd, (char *)buf, MAXMSGSIZE);
+	if (len <= 0)
+	{
+	    eof = TRUE;
+	    break;
+	}
+	if (len < MAXMSGSIZE)
+	    break;
+    }
+
+    // Keep reading until the ring is found empty, the job does not send
+    // another notification while there is text in the ring.
+    tail = SHM_LOAD(mem, SHM_TAIL(SHM_FROM_JOB));
+    while ((head = SHM_LOAD(mem, SHM_HEAD(SHM_FROM_JOB))) != tail)
+    {
+	off = tail & (SHM_RING_SIZE - 1);
+	n = head - tail;
+	// The head is written by the job, it must not be more than the ring
+	// size ahead.
+	if (n > SHM_RING_SIZE)
+	{
+	    channel_shm_error(channel, func);
+	    return;
+	}
+	if (n > SHM_RING_SIZE - off)
+	    n = SHM_RING_SIZE - off;
+	channel_save(channel, PART_OUT, data + off, (int)n, FALSE, "RECV ");
+	readlen += (int)n;
+	tail += n;
+	SHM_STORE(mem, SHM_TAIL(SHM_FROM_JOB), tail);
+
+	if (SHM_LOAD(mem, SHM_WAIT(SHM_FROM_JOB)))
+	{
+	    // The job is waiting for room in the ring.
+	    SHM_STORE(mem, SHM_WAIT(SHM_FROM_JOB), 0);
+	    channel_shm_notify(channel);
+	}
+    }
+
+    // When the pipe was closed but there was text in the ring, close the
+    // next time.
+    if (eof && readlen == 0)
+    {
+	if (!channel->ch_keep_open)
+	    ch_close_part_on_error(channel, PART_OUT, (len < 0), func);
+	return;
+    }
+
+    // The notification may be for room in the ring from Vim to the job.
+    if (channel->CH_IN_FD != INVALID_FD)
+	channel_write_input(channel);
+# if defined(CH_HAS_GUI) && defined(FEAT_GUI_GTK)
+    if (readlen > 0 && CH_HAS_GUI && gtk_main_level() > 0)
+	// signal the main loop that there is something to read
+	gtk_main_quit();
+# endif
+}
+#endif
+
 /*
  * Read from channel "channel" for as long as there is something to read.
  * "part" is PART_SOCK, PART_OUT or PART_ERR.
@@ -3544,8 +4421,10 @@ channel_close_now(channel_T *channel)
 channel_read(channel_T *channel, ch_part_T part, char *func)
 {
     static char_u	*buf = NULL;
+    static int		bufsize = 0;
     int			len = 0;
     int			readlen = 0;
+    int			size;
     sock_T		fd;
     int			use_socket = FALSE;
 
@@ -3558,33 +4437,52 @@ channel_read(channel_T *channel, ch_part_T part, char *func)
     }
     use_socket = fd == channel->CH_SOCK_FD;
 
-    // Allocate a buffer to read into.
-    if (buf == NULL)
+#ifdef FEAT_CHANNEL_SHM
+    if (part == PART_OUT && channel->ch_shm != NULL)
     {
-	buf = alloc(MAXMSGSIZE);
-	if (buf == NULL)
-	    return;	// out of memory!
+	channel_shm_read(channel, func);
+	return;
     }
+#endif
 
     // Keep on reading for as long as there is something to read.
     // Use select() or poll() to avoid blocking on a message that is exactly
-    // MAXMSGSIZE long.
+    // "size" long.
     for (;;)
     {
 	if (channel_wait(channel, fd, 0) != CW_READY)
 	    break;
+
+	// Allocate a buffer to read into, big enough to read what is
+	// available at once.
+	size = channel_read_size(fd, use_socket);
+	if (size > bufsize)
+	{
+	    vim_free(buf);
+	    buf = alloc(size);
+	    if (buf == NULL)
+	    {
+		bufsize = 0;
+		return;	// out of memory!
+	    }
+	    bufsize = size;
+	}
+
 	if (use_socket)
-	    len = sock_read(fd, (char *)buf, MAXMSGSIZE);
+	    len = sock_read(fd, (char *)buf, size);
 	else
-	    len = fd_read(fd, (char *)buf, MAXMSGSIZE);
+	    len = fd_read(fd, (char *)buf, size);
 	if (len <= 0)
 	    break;	// error or nothing more to read
 
 	// Store the read message in the queue.
 	channel_save(channel, part, buf, len, FALSE, "RECV ");
 	readlen += len;
-	if (len < MAXMSGSIZE)
+	if (len < size)
 	    break;	// did read everything that's available
+	if (readlen >= MAXREADSIZE * 4
+			       && channel->ch_part[part].ch_mode == MODE_RAW)
+	    break;	// let the callback handle this much first
     }
 
     // Reading a disconnection (readlen == 0), or an error.
@@ -3674,9 +4572,9 @@ channel_read_block(
 	}
 	else if (nl + 1 == buf + node->rq_buflen)
 	{
-	    // get the whole buffer
+	    // get the whole buffer, the text may be moved
 	    msg = channel_get(channel, part, NULL);
-	    *nl = NUL;
+	    msg[nl - buf] = NUL;
 	}
 	else
 	{
@@ -3906,7 +4804,16 @@ common_channel_read(typval_T *argvars, typval_T *rettv, int raw, int blob)
 	    if (opt.jo_set & JO_ID)
 		id = opt.jo_id;
 	    channel_read_json_block(channel, part, timeout, id, &listtv);
-	    if (listtv != NULL)
+	    if (listtv != NULL && mode == MODE_LSP)
+	    {
+		list_T *list = listtv->vval.v_list;
+
+		// Only return the Dict, the ID is in it.
+		*rettv = list->lv_u.mat.lv_last->li_tv;
+		list->lv_u.mat.lv_last->li_tv.v_type = VAR_NUMBER;
+		free_tv(listtv);
+	    }
+	    else if (listtv != NULL)
 	    {
 		*rettv = *listtv;
 		vim_free(listtv);
@@ -3988,51 +4895,267 @@ channel_any_keep_open()
 	    return TRUE;
     return FALSE;
 }
-# endif
+# endif
+
+/*
+ * Set "channel"/"part" to non-blocking.
+ * Only works for sockets and pipes.
+ */
+    void
+channel_set_nonblock(channel_T *channel, ch_part_T part)
+{
+    chanpart_T *ch_part = &channel->ch_part[part];
+    int		fd = ch_part->ch_fd;
+
+    if (fd != INVALID_FD)
+    {
+#ifdef MSWIN
+	u_long	val = 1;
+
+	ioctlsocket(fd, FIONBIO, &val);
+#else
+	(void)fcntl(fd, F_SETFL, O_NONBLOCK);
+#endif
+	ch_part->ch_nonblocking = TRUE;
+    }
+}
+
+/*
+ * Add "buf[len]" to the write queue of "ch_part".  When "gap" is not NULL
+ * "buf" points into its data and the growarray may be taken over, so that the
+ * text does not need to be copied.
+ */
+    static void
+channel_add_to_writeque(
+	chanpart_T  *ch_part,
+	char_u	    *buf,
+	int	    len,
+	garray_T    *gap)
+{
+    writeq_T	*wq = &ch_part->ch_writeque;
+
+    if (len <= 0)
+	return;
+
+    // Append to the last entry.  Limit entries to 4000 bytes.  When there is
+    // more text in "gap" it is cheaper to take over the growarray.
+    if (wq->wq_prev != NULL
+	    && wq->wq_prev->wq_ga.ga_len + len < 4000
+	    && (gap == NULL || len < 1000))
+    {
+	writeq_T *last = wq->wq_prev;
+
+	if (ga_grow(&last->wq_ga, len) == OK)
+	{
+	    mch_memmove((char *)last->wq_ga.ga_data + last->wq_ga.ga_len,
+								    buf, len);
+	    last->wq_ga.ga_len += len;
+	    ch_part->ch_writeque_len += len;
+	}
+    }
+    else
+    {
+	writeq_T *last = ALLOC_ONE(writeq_T);
+
+	if (last != NULL)
+	{
+	    last->wq_prev = wq->wq_prev;
+	    last->wq_next = NULL;
+	    if (wq->wq_prev == NULL)
+		wq->wq_next = last;
+	    else
+		wq->wq_prev->wq_next = last;
+	    wq->wq_prev = last;
+	    last->wq_done = 0;
+	    if (gap != NULL)
+	    {
+		// Take over the text, "buf" points into it.
+		last->wq_ga = *gap;
+		last->wq_done = (int)(buf - (char_u *)gap->ga_data);
+		ga_init(gap);
+		ch_part->ch_writeque_len += len;
+	    }
+	    else
+	    {
+		ga_init2(&last->wq_ga, 1, 1000);
+		if (ga_grow(&last->wq_ga, len) == OK)
+		{
+		    mch_memmove(last->wq_ga.ga_data, buf, len);
+		    last->wq_ga.ga_len = len;
+		    ch_part->ch_writeque_len += len;
+		}
+	    }
+	}
+    }
+}
+
+/*
+ * Remove "len" bytes that were written from the start of the write queue of
+ * "ch_part".
+ */
+    static void
+channel_consume_writeque(chanpart_T *ch_part, long_u len)
+{
+    writeq_T	*wq = &ch_part->ch_writeque;
+
+    ch_part->ch_writeque_len -= len;
+    while (len > 0 && wq->wq_next != NULL)
+    {
+	writeq_T    *entry = wq->wq_next;
+	long_u	    left = entry->wq_ga.ga_len - entry->wq_done;
+
+	if (len < left)
+	{
+	    // Skip over the bytes that were written.  Moving the rest to the
+	    // start would make sending a big message slow.
+	    entry->wq_done += (int)len;
+	    break;
+	}
+	len -= left;
+	remove_from_writeque(wq, entry);
+    }
+}
+
+/*
+ * Write "buf[len]" to "channel"/"part".
+ * Returns the number of bytes written, zero when the write would block and
+ * -1 for an error.
+ */
+    static int
+channel_write_fd(channel_T *channel, ch_part_T part, char_u *buf, int len)
+{
+    sock_T	fd = channel->ch_part[part].ch_fd;
+    int		res;
+
+#ifdef FEAT_CHANNEL_SHM
+    if (part == PART_IN && channel->ch_shm != NULL)
+	return channel_shm_write(channel, buf, len);
+#endif
+    if (part == PART_SOCK)
+	res = sock_write(fd, (char *)buf, len);
+    else
+    {
+	res = fd_write(fd, (char *)buf, len);
+#ifdef MSWIN
+	if (channel->ch_named_pipe && res < 0)
+	{
+	    DisconnectNamedPipe((HANDLE)fd);
+	    ConnectNamedPipe((HANDLE)fd, NULL);
+	}
+#endif
+    }
+    if (res < 0 && (errno == EWOULDBLOCK
+#ifdef EAGAIN
+			|| errno == EAGAIN
+#endif
+		    ))
+	res = 0; // nothing got written
+    return res;
+}
+
+/*
+ * Write what is in the write queue of "channel"/"part".  On Unix several
+ * entries are written with one writev() call.
+ * Returns the number of bytes written, zero when the write would block and
+ * -1 for an error.
+ */
+    static int
+channel_write_queued(channel_T *channel, ch_part_T part)
+{
+    chanpart_T	*ch_part = &channel->ch_part[part];
+    writeq_T	*entry = ch_part->ch_writeque.wq_next;
+    int		res;
+#ifdef UNIX
+    struct iovec iov[CH_WRITEV_MAX];
+    int		count = 0;
+
+# ifdef FEAT_CHANNEL_SHM
+    if (part == PART_IN && channel->ch_shm != NULL)
+	// Copied into the ring one entry at a time.
+	res = channel_write_fd(channel, part,
+			(char_u *)entry->wq_ga.ga_data + entry->wq_done,
+			entry->wq_ga.ga_len - entry->wq_done);
+    else
+# endif
+    {
+	for ( ; entry != NULL && count < CH_WRITEV_MAX;
+							entry = entry->wq_next)
+	{
+	    iov[count].iov_base =
+			       (char *)entry->wq_ga.ga_data + entry->wq_done;
+	    iov[count].iov_len = entry->wq_ga.ga_len - entry->wq_done;
+	    ++count;
+	}
+	res = writev(ch_part->ch_fd, iov, count);
+	if (res < 0 && (errno == EWOULDBLOCK
+# ifdef EAGAIN
+			    || errno == EAGAIN
+# endif
+			))
+	    res = 0; // nothing got written
+    }
+#else
+    res = channel_write_fd(channel, part,
+		    (char_u *)entry->wq_ga.ga_data + entry->wq_done,
+		    entry->wq_ga.ga_len - entry->wq_done);
+#endif
+    if (res > 0)
+    {
+	ch_log(channel, "Sent %d bytes now", res);
+	channel_consume_writeque(ch_part, res);
+	if (ch_part->ch_writeque.wq_next == NULL)
+	    ch_log(channel, "Write queue empty");
+    }
+    return res;
+}
 
 /*
- * Set "channel"/"part" to non-blocking.
- * Only works for sockets and pipes.
+ * Check the amount of text in the write queue of "channel"/"part" against
+ * the watermarks.  When it went above CH_WRITEQUE_HIGH and is now down to
+ * CH_WRITEQUE_LOW the drain callback is to be invoked.
  */
-    void
-channel_set_nonblock(channel_T *channel, ch_part_T part)
+    static void
+channel_check_writeque(channel_T *channel, ch_part_T part)
 {
-    chanpart_T *ch_part = &channel->ch_part[part];
-    int		fd = ch_part->ch_fd;
+    chanpart_T	*ch_part = &channel->ch_part[part];
 
-    if (fd != INVALID_FD)
+    if (ch_part->ch_writeque_len > CH_WRITEQUE_HIGH)
     {
-#ifdef MSWIN
-	u_long	val = 1;
-
-	ioctlsocket(fd, FIONBIO, &val);
-#else
-	(void)fcntl(fd, F_SETFL, O_NONBLOCK);
-#endif
-	ch_part->ch_nonblocking = TRUE;
+	if (!ch_part->ch_writeque_full)
+	    ch_log(channel, "Write queue is full");
+	ch_part->ch_writeque_full = TRUE;
+    }
+    else if (ch_part->ch_writeque_full
+			       && ch_part->ch_writeque_len <= CH_WRITEQUE_LOW)
+    {
+	ch_log(channel, "Write queue was drained");
+	ch_part->ch_writeque_full = FALSE;
+	if (channel->ch_drain_cb.cb_name != NULL)
+	    channel->ch_drain_pending = TRUE;
     }
 }
 
 /*
- * Write "buf" (NUL terminated string) to "channel"/"part".
+ * Write "buf_arg[len_arg]" to "channel"/"part".
+ * When "gap" is not NULL "buf_arg" points into its data and when the text
+ * can't be written at once the growarray is moved into the write queue, so
+ * that the text does not need to be copied.
  * When "fun" is not NULL an error message might be given.
  * Return FAIL or OK.
  */
-    int
-channel_send(
+    static int
+channel_write(
 	channel_T *channel,
 	ch_part_T part,
 	char_u	  *buf_arg,
 	int	  len_arg,
+	garray_T  *gap,
 	char	  *fun)
 {
-    int		res;
-    sock_T	fd;
+    int		res = 0;
     chanpart_T	*ch_part = &channel->ch_part[part];
-    int		did_use_queue = FALSE;
 
-    fd = ch_part->ch_fd;
-    if (fd == INVALID_FD)
+    if (ch_part->ch_fd == INVALID_FD)
     {
 	if (!channel->ch_error && fun != NULL)
 	{
@@ -4046,7 +5169,7 @@ channel_send(
     if (channel->ch_nonblock && !ch_part->ch_nonblocking)
 	channel_set_nonblock(channel, part);
 
-    if (ch_log_active())
+    if (ch_log_active() && len_arg > 0)
     {
 	ch_log_lead("SEND ", channel, part);
 	fprintf(log_fd, "'");
@@ -4056,146 +5179,92 @@ channel_send(
 	did_repeated_msg = 0;
     }
 
-    for (;;)
-    {
-	writeq_T    *wq = &ch_part->ch_writeque;
-	char_u	    *buf;
-	int	    len;
-
-	if (wq->wq_next != NULL)
-	{
-	    // first write what was queued
-	    buf = wq->wq_next->wq_ga.ga_data;
-	    len = wq->wq_next->wq_ga.ga_len;
-	    did_use_queue = TRUE;
-	}
-	else
-	{
-	    if (len_arg == 0)
-		// nothing to write, called from channel_select_check()
-		return OK;
-	    buf = buf_arg;
-	    len = len_arg;
-	}
+    // First write what was queued, the text must go after it.
+    while (ch_part->ch_writeque.wq_next != NULL
+			   && (res = channel_write_queued(channel, part)) > 0)
+	;
 
-	if (part == PART_SOCK)
-	    res = sock_write(fd, (char *)buf, len);
-	else
+    if (res >= 0 && ch_part->ch_writeque.wq_next != NULL)
+    {
+	// Can't write more now.
+	if (len_arg > 0)
+	    ch_log(channel, "Adding %d bytes to the write queue", len_arg);
+	channel_add_to_writeque(ch_part, buf_arg, len_arg, gap);
+    }
+    else if (res >= 0 && len_arg > 0)
+    {
+	res = channel_write_fd(channel, part, buf_arg, len_arg);
+	if (res >= 0 && ch_part->ch_nonblocking)
 	{
-	    res = fd_write(fd, (char *)buf, len);
-#ifdef MSWIN
-	    if (channel->ch_named_pipe && res < 0)
+	    if (res < len_arg)
 	    {
-		DisconnectNamedPipe((HANDLE)fd);
-		ConnectNamedPipe((HANDLE)fd, NULL);
+		// Wrote only buf_arg[res] bytes, can't write more now.
+		ch_log(channel, "Adding %d bytes to the write queue",
+								len_arg - res);
+		channel_add_to_writeque(ch_part, buf_arg + res, len_arg - res,
+									  gap);
 	    }
-#endif
 	}
-	if (res < 0 && (errno == EWOULDBLOCK
-#ifdef EAGAIN
-			|| errno == EAGAIN
-#endif
-		    ))
-	    res = 0; // nothing got written
+	else if (res != len_arg)
+	    res = -1;
+    }
 
-	if (res >= 0 && ch_part->ch_nonblocking)
+    if (res < 0)
+    {
+	if (!channel->ch_error && fun != NULL)
 	{
-	    writeq_T *entry = wq->wq_next;
-
-	    if (did_use_queue)
-		ch_log(channel, "Sent %d bytes now", res);
-	    if (res == len)
-	    {
-		// Wrote all the buf[len] bytes.
-		if (entry != NULL)
-		{
-		    // Remove the entry from the write queue.
-		    remove_from_writeque(wq, entry);
-		    continue;
-		}
-		if (did_use_queue)
-		    ch_log(channel, "Write queue empty");
-	    }
-	    else
-	    {
-		// Wrote only buf[res] bytes, can't write more now.
-		if (entry != NULL)
-		{
-		    if (res > 0)
-		    {
-			// Remove the bytes that were written.
-			mch_memmove(entry->wq_ga.ga_data,
-				    (char *)entry->wq_ga.ga_data + res,
-				    len - res);
-			entry->wq_ga.ga_len -= res;
-		    }
-		    buf = buf_arg;
-		    len = len_arg;
-		}
-		else
-		{
-		    buf += res;
-		    len -= res;
-		}
-		ch_log(channel, "Adding %d bytes to the write queue", len);
+	    ch_error(channel, "%s(): write failed", fun);
+	    semsg(_("E631: %s(): write failed"), fun);
+	}
+	channel->ch_error = TRUE;
+	return FAIL;
+    }
 
-		// Append the not written bytes of the argument to the write
-		// buffer.  Limit entries to 4000 bytes.
-		if (wq->wq_prev != NULL
-			&& wq->wq_prev->wq_ga.ga_len + len < 4000)
-		{
-		    writeq_T *last = wq->wq_prev;
+    channel_check_writeque(channel, part);
+    channel->ch_error = FALSE;
+    return OK;
+}
 
-		    // append to the last entry
-		    if (len > 0 && ga_grow(&last->wq_ga, len) == OK)
-		    {
-			mch_memmove((char *)last->wq_ga.ga_data
-							  + last->wq_ga.ga_len,
-				    buf, len);
-			last->wq_ga.ga_len += len;
-		    }
-		}
-		else
-		{
-		    writeq_T *last = ALLOC_ONE(writeq_T);
+/*
+ * Write "buf" (NUL terminated string) to "channel"/"part".
+ * When "fun" is not NULL an error message might be given.
+ * Return FAIL or OK.
+ */
+    int
+channel_send(
+	channel_T *channel,
+	ch_part_T part,
+	char_u	  *buf_arg,
+	int	  len_arg,
+	char	  *fun)
+{
+    return channel_write(channel, part, buf_arg, len_arg, NULL, fun);
+}
 
-		    if (last != NULL)
-		    {
-			last->wq_prev = wq->wq_prev;
-			last->wq_next = NULL;
-			if (wq->wq_prev == NULL)
-			    wq->wq_next = last;
-			else
-			    wq->wq_prev->wq_next = last;
-			wq->wq_prev = last;
-			ga_init2(&last->wq_ga, 1, 1000);
-			if (len > 0 && ga_grow(&last->wq_ga, len) == OK)
-			{
-			    mch_memmove(last->wq_ga.ga_data, buf, len);
-			    last->wq_ga.ga_len = len;
-			}
-		    }
-		}
-	    }
-	}
-	else if (res != len)
-	{
-	    if (!channel->ch_error && fun != NULL)
-	    {
-		ch_error(channel, "%s(): write failed", fun);
-		semsg(_("E631: %s(): write failed"), fun);
-	    }
-	    channel->ch_error = TRUE;
-	    return FAIL;
-	}
+/*
+ * Write the bytes in growarray "gap" to "channel"/"part".
+ * What can't be written right away is kept in the write queue without
+ * copying it.  "gap" is cleared.
+ * When "fun" is not NULL an error message might be given.
+ * Return FAIL or OK.
+ */
+    int
+channel_send_ga(
+	channel_T *channel,
+	ch_part_T part,
+	garray_T  *gap,
+	char	  *fun)
+{
+    int ret = channel_write(channel, part, gap->ga_data, gap->ga_len,
+								     gap, fun);
 
-	channel->ch_error = FALSE;
-	return OK;
-    }
+    ga_clear(gap);
+    return ret;
 }
 
 /*
  * Common for "ch_sendexpr()" and "ch_sendraw()".
+ * Sends "text[len]", or the text in "gap" when it is not NULL.
  * Returns the channel if the caller should read the response.
  * Sets "part_read" to the read fd.
  * Otherwise returns NULL.
@@ -4205,6 +5274,7 @@ send_common(
 	typval_T    *argvars,
 	char_u	    *text,
 	int	    len,
+	garray_T    *gap,
 	int	    id,
 	int	    eval,
 	jobopt_T    *opt,
@@ -4237,19 +5307,55 @@ send_common(
 	channel_set_req_callback(channel, *part_read, &opt->jo_callback, id);
     }
 
-    if (channel_send(channel, part_send, text, len, fun) == OK
+    if ((gap != NULL ? channel_send_ga(channel, part_send, gap, fun)
+			   : channel_send(channel, part_send, text, len, fun)) == OK
 					   && opt->jo_callback.cb_name == NULL)
 	return channel;
     return NULL;
 }
 
+/*
+ * Encode "val", which must be a Dict, as an LSP message into "gap".
+ * "jsonrpc" is added and "id" when it is not zero, to a copy of the Dict.
+ * Returns FAIL when encoding fails.
+ */
+    static int
+channel_encode_lsp(garray_T *gap, typval_T *val, int id)
+{
+    typval_T	tv;
+    dictitem_T	*di;
+    int		ret = FAIL;
+
+    tv.v_type = VAR_DICT;
+    tv.vval.v_dict = dict_copy(val->vval.v_dict, FALSE, 0);
+    if (tv.vval.v_dict == NULL)
+	return FAIL;
+    if (dict_find(tv.vval.v_dict, (char_u *)"jsonrpc", -1) == NULL
+	    && dict_add_string(tv.vval.v_dict, "jsonrpc",
+						 (char_u *)"2.0") == FAIL)
+	goto theend;
+    if (id != 0)
+    {
+	di = dict_find(tv.vval.v_dict, (char_u *)"id", -1);
+	if (di != NULL)
+	    dictitem_remove(tv.vval.v_dict, di);
+	if (dict_add_number(tv.vval.v_dict, "id", id) == FAIL)
+	    goto theend;
+    }
+    ret = json_encode_lsp_msg_ga(gap, &tv);
+
+theend:
+    clear_tv(&tv);
+    return ret;
+}
+
 /*
  * common for "ch_evalexpr()" and "ch_sendexpr()"
  */
     static void
 ch_expr_common(typval_T *argvars, typval_T *rettv, int eval)
 {
-    char_u	*text;
+    garray_T	ga;
     typval_T	*listtv;
     channel_T	*channel;
     int		id;
@@ -4275,15 +5381,37 @@ ch_expr_common(typval_T *argvars, typval_T *rettv, int eval)
 	return;
     }
 
-    id = ++channel->ch_last_msg_id;
-    text = json_encode_nr_expr(id, &argvars[1],
-				 (ch_mode == MODE_JS ? JSON_JS : 0) | JSON_NL);
-    if (text == NULL)
-	return;
+    // Encode into a growarray that can be put in the write queue as-is.
+    ga_init2(&ga, 1, 4000);
+    if (ch_mode == MODE_LSP)
+    {
+	if (argvars[1].v_type != VAR_DICT)
+	{
+	    emsg(_(e_dictreq));
+	    return;
+	}
+	// Only a request gets an ID, a notification does not have a reply.
+	if (eval || (argvars[2].v_type == VAR_DICT
+		  && dict_find(argvars[2].vval.v_dict,
+					    (char_u *)"callback", -1) != NULL))
+	    id = ++channel->ch_last_msg_id;
+	else
+	    id = 0;
+	if (channel_encode_lsp(&ga, &argvars[1], id) == FAIL)
+	    ga_clear(&ga);
+    }
+    else
+    {
+	id = ++channel->ch_last_msg_id;
+	if (json_encode_nr_expr_ga(&ga, id, &argvars[1],
+		       (ch_mode == MODE_JS ? JSON_JS : 0) | JSON_NL) == FAIL)
+	    // nothing to send, like an empty message before
+	    ga_clear(&ga);
+    }
 
-    channel = send_common(argvars, text, (int)STRLEN(text), id, eval, &opt,
+    channel = send_common(argvars, NULL, 0, &ga, id, eval, &opt,
 			    eval ? "ch_evalexpr" : "ch_sendexpr", &part_read);
-    vim_free(text);
+    ga_clear(&ga);
     if (channel != NULL && eval)
     {
 	if (opt.jo_set & JO_TIMEOUT)
@@ -4333,7 +5461,7 @@ ch_raw_common(typval_T *argvars, typval_T *rettv, int eval)
 	text = tv_get_string_buf(&argvars[1], buf);
 	len = (int)STRLEN(text);
     }
-    channel = send_common(argvars, text, len, 0, eval, &opt,
+    channel = send_common(argvars, text, len, NULL, 0, eval, &opt,
 			      eval ? "ch_evalraw" : "ch_sendraw", &part_read);
     if (channel != NULL && eval)
     {
@@ -4363,12 +5491,24 @@ channel_poll_setup(int nfd_in, void *fds_in, int *towait)
     struct	pollfd *fds = fds_in;
     ch_part_T	part;
 
+# ifdef CH_USE_EPOLL
+    int		use_epoll = FALSE;
+# endif
+
     FOR_ALL_CHANNELS(channel)
     {
 	for (part = PART_SOCK; part < PART_IN; ++part)
 	{
 	    chanpart_T	*ch_part = &channel->ch_part[part];
 
+# ifdef CH_USE_EPOLL
+	    if (channel_epoll_update(channel, part))
+	    {
+		ch_part->ch_poll_idx = -1;
+		use_epoll = TRUE;
+	    }
+	    else
+# endif
 	    if (ch_part->ch_fd != INVALID_FD)
 	    {
 		if (channel->ch_keep_open)
@@ -4392,6 +5532,18 @@ channel_poll_setup(int nfd_in, void *fds_in, int *towait)
 	}
     }
 
+# ifdef CH_USE_EPOLL
+    if (use_epoll)
+    {
+	channel_epoll_poll_idx = nfd;
+	fds[nfd].fd = channel_epoll_fd;
+	fds[nfd].events = POLLIN;
+	nfd++;
+    }
+    else
+	channel_epoll_poll_idx = -1;
+# endif
+
     nfd = channel_fill_poll_write(nfd, fds);
 
     return nfd;
@@ -4409,6 +5561,17 @@ channel_poll_check(int ret_in, void *fds_in)
     ch_part_T	part;
     int		idx;
     chanpart_T	*in_part;
+# ifdef CH_USE_EPOLL
+    struct epoll_event	events[CH_EPOLL_EVENTS];
+    int			nevents = 0;
+
+    idx = channel_epoll_poll_idx;
+    if (ret > 0 && idx != -1 && (fds[idx].revents & POLLIN))
+    {
+	nevents = channel_epoll_wait(events);
+	--ret;
+    }
+# endif
 
     FOR_ALL_CHANNELS(channel)
     {
@@ -4421,6 +5584,10 @@ channel_poll_check(int ret_in, void *fds_in)
 		channel_read(channel, part, "channel_poll_check");
 		--ret;
 	    }
+# ifdef CH_USE_EPOLL
+	    else if (channel_epoll_ready(channel, part, events, nevents))
+		channel_read(channel, part, "channel_poll_check");
+# endif
 	    else if (channel->ch_part[part].ch_fd != INVALID_FD
 						      && channel->ch_keep_open)
 	    {
@@ -4460,6 +5627,9 @@ channel_select_setup(
     fd_set	*rfds = rfds_in;
     fd_set	*wfds = wfds_in;
     ch_part_T	part;
+# ifdef CH_USE_EPOLL
+    int		use_epoll = FALSE;
+# endif
 
     FOR_ALL_CHANNELS(channel)
     {
@@ -4467,6 +5637,11 @@ channel_select_setup(
 	{
 	    sock_T fd = channel->ch_part[part].ch_fd;
 
+# ifdef CH_USE_EPOLL
+	    if (channel_epoll_update(channel, part))
+		use_epoll = TRUE;
+	    else
+# endif
 	    if (fd != INVALID_FD)
 	    {
 		if (channel->ch_keep_open)
@@ -4492,6 +5667,15 @@ channel_select_setup(
 	}
     }
 
+# ifdef CH_USE_EPOLL
+    if (use_epoll)
+    {
+	FD_SET(channel_epoll_fd, rfds);
+	if (maxfd < channel_epoll_fd)
+	    maxfd = channel_epoll_fd;
+    }
+# endif
+
     maxfd = channel_fill_wfds(maxfd, wfds);
 
     return maxfd;
@@ -4509,6 +5693,17 @@ channel_select_check(int ret_in, void *rfds_in, void *wfds_in)
     fd_set	*wfds = wfds_in;
     ch_part_T	part;
     chanpart_T	*in_part;
+# ifdef CH_USE_EPOLL
+    struct epoll_event	events[CH_EPOLL_EVENTS];
+    int			nevents = 0;
+
+    if (ret > 0 && channel_epoll_fd >= 0 && FD_ISSET(channel_epoll_fd, rfds))
+    {
+	nevents = channel_epoll_wait(events);
+	FD_CLR(channel_epoll_fd, rfds);
+	--ret;
+    }
+# endif
 
     FOR_ALL_CHANNELS(channel)
     {
@@ -4522,6 +5717,10 @@ channel_select_check(int ret_in, void *rfds_in, void *wfds_in)
 		FD_CLR(fd, rfds);
 		--ret;
 	    }
+# ifdef CH_USE_EPOLL
+	    else if (channel_epoll_ready(channel, part, events, nevents))
+		channel_read(channel, part, "channel_select_check");
+# endif
 	    else if (fd != INVALID_FD && channel->ch_keep_open)
 	    {
 		// polling a keep-open channel
@@ -4626,6 +5825,35 @@ channel_parse_messages(void)
 	    }
 	}
 
+	if (channel->ch_drain_pending)
+	{
+	    channel->ch_drain_pending = FALSE;
+	    if (channel->ch_drain_cb.cb_name != NULL)
+	    {
+		typval_T	argv[1];
+		typval_T	rettv;
+
+		// Increase the refcount, in case the callback causes the
+		// channel to be unreferenced or closed.
+		++channel->ch_refcount;
+		ch_log(channel, "Invoking drain callback %s",
+					 (char *)channel->ch_drain_cb.cb_name);
+		argv[0].v_type = VAR_CHANNEL;
+		argv[0].vval.v_channel = channel;
+		call_callback(&channel->ch_drain_cb, -1, &rettv, 1, argv);
+		clear_tv(&rettv);
+		channel_need_redraw = TRUE;
+		ret = TRUE;
+		if (channel_unref(channel))
+		{
+		    // channel was freed, start over
+		    channel = first_channel;
+		    part = PART_SOCK;
+		    continue;
+		}
+	    }
+	}
+
 	if (channel->ch_part[part].ch_fd != INVALID_FD
 				      || channel_has_readahead(channel, part))
 	{
@@ -4662,7 +5890,7 @@ channel_parse_messages(void)
     if (channel_need_redraw)
     {
 	channel_need_redraw = FALSE;
-	redraw_after_callback(TRUE);
+	redraw_after_async();
     }
 
     --safe_to_invoke_callback;
@@ -4717,6 +5945,30 @@ set_ref_in_channel(int copyID)
     return abort;
 }
 
+/*
+ * Mark references in channels that were already marked with "copyID" once
+ * more, callbacks and messages may have been added since then.  Used when
+ * finishing an incremental garbage collection.
+ */
+    int
+set_ref_in_marked_channels(int copyID)
+{
+    int		abort = FALSE;
+    channel_T	*channel;
+    typval_T	tv;
+
+    for (channel = first_channel; !abort && channel != NULL;
+						   channel = channel->ch_next)
+	if (channel->ch_copyID == copyID)
+	{
+	    channel->ch_copyID = 0;
+	    tv.v_type = VAR_CHANNEL;
+	    tv.vval.v_channel = channel;
+	    abort = abort || set_ref_in_item(&tv, copyID, NULL, NULL);
+	}
+    return abort;
+}
+
 /*
  * Return the "part" to write to for "channel".
  */
@@ -4774,6 +6026,8 @@ handle_mode(typval_T *item, jobopt_T *opt, ch_mode_T *modep, int jo)
 	*modep = MODE_JS;
     else if (STRCMP(val, "json") == 0)
 	*modep = MODE_JSON;
+    else if (STRCMP(val, "lsp") == 0)
+	*modep = MODE_LSP;
     else
     {
 	semsg(_(e_invarg2), val);
@@ -4837,6 +6091,10 @@ free_job_options(jobopt_T *opt)
 	partial_unref(opt->jo_close_cb.cb_partial);
     else if (opt->jo_close_cb.cb_name != NULL)
 	func_unref(opt->jo_close_cb.cb_name);
+    if (opt->jo_drain_cb.cb_partial != NULL)
+	partial_unref(opt->jo_drain_cb.cb_partial);
+    else if (opt->jo_drain_cb.cb_name != NULL)
+	func_unref(opt->jo_drain_cb.cb_name);
     if (opt->jo_exit_cb.cb_partial != NULL)
 	partial_unref(opt->jo_exit_cb.cb_partial);
     else if (opt->jo_exit_cb.cb_name != NULL)
@@ -4951,6 +6209,24 @@ get_job_options(typval_T *tv, jobopt_T *opt, int supported, int supported2)
 		    break;
 		opt->jo_pty = tv_get_number(item);
 	    }
+	    else if (STRCMP(hi->hi_key, "transport") == 0)
+	    {
+		if (!(supported2 & JO2_TRANSPORT))
+		    break;
+		opt->jo_set2 |= JO2_TRANSPORT;
+		val = tv_get_string(item);
+		if (STRCMP(val, "pipe") == 0)
+		    opt->jo_shm = FALSE;
+#ifdef FEAT_CHANNEL_SHM
+		else if (STRCMP(val, "shm") == 0)
+		    opt->jo_shm = TRUE;
+#endif
+		else
+		{
+		    semsg(_(e_invargval), "transport");
+		    return FAIL;
+		}
+	    }
 	    else if (STRCMP(hi->hi_key, "in_buf") == 0
 		    || STRCMP(hi->hi_key, "out_buf") == 0
 		    || STRCMP(hi->hi_key, "err_buf") == 0)
@@ -4992,6 +6268,21 @@ get_job_options(typval_T *tv, jobopt_T *opt, int supported, int supported2)
 		opt->jo_set2 |= JO2_OUT_MSG << (part - PART_OUT);
 		opt->jo_message[part] = tv_get_number(item);
 	    }
+	    else if (STRCMP(hi->hi_key, "out_maxlines") == 0
+		    || STRCMP(hi->hi_key, "err_maxlines") == 0)
+	    {
+		part = part_from_char(*hi->hi_key);
+
+		if (!(supported & JO_OUT_IO))
+		    break;
+		opt->jo_set2 |= JO2_OUT_MAXLINES << (part - PART_OUT);
+		opt->jo_maxlines[part] = tv_get_number(item);
+		if (opt->jo_maxlines[part] < 0)
+		{
+		    semsg(_(e_invargNval), hi->hi_key, tv_get_string(item));
+		    return FAIL;
+		}
+	    }
 	    else if (STRCMP(hi->hi_key, "in_top") == 0
 		    || STRCMP(hi->hi_key, "in_bot") == 0)
 	    {
@@ -5076,6 +6367,18 @@ get_job_options(typval_T *tv, jobopt_T *opt, int supported, int supported2)
 		    return FAIL;
 		}
 	    }
+	    else if (STRCMP(hi->hi_key, "drain_cb") == 0)
+	    {
+		if (!(supported2 & JO2_DRAIN_CB))
+		    break;
+		opt->jo_set2 |= JO2_DRAIN_CB;
+		opt->jo_drain_cb = get_callback(item);
+		if (opt->jo_drain_cb.cb_name == NULL)
+		{
+		    semsg(_(e_invargval), "drain_cb");
+		    return FAIL;
+		}
+	    }
 	    else if (STRCMP(hi->hi_key, "drop") == 0)
 	    {
 		int never = FALSE;
@@ -5807,6 +7110,27 @@ set_ref_in_job(int copyID)
     return abort;
 }
 
+/*
+ * Like set_ref_in_marked_channels() for jobs.
+ */
+    int
+set_ref_in_marked_jobs(int copyID)
+{
+    int		abort = FALSE;
+    job_T	*job;
+    typval_T	tv;
+
+    for (job = first_job; !abort && job != NULL; job = job->jv_next)
+	if (job->jv_copyID == copyID)
+	{
+	    job->jv_copyID = 0;
+	    tv.v_type = VAR_JOB;
+	    tv.vval.v_job = job;
+	    abort = abort || set_ref_in_item(&tv, copyID, NULL, NULL);
+	}
+    return abort;
+}
+
 /*
  * Dereference "job".  Note that after this "job" may have been freed.
  */
@@ -5988,7 +7312,7 @@ job_check_ended(void)
     if (channel_need_redraw)
     {
 	channel_need_redraw = FALSE;
-	redraw_after_callback(TRUE);
+	redraw_after_async();
     }
     return did_end;
 }
@@ -6039,10 +7363,23 @@ job_start(
 	if (get_job_options(&argvars[1], &opt,
 		    JO_MODE_ALL + JO_CB_ALL + JO_TIMEOUT_ALL + JO_STOPONEXIT
 			 + JO_EXIT_CB + JO_OUT_IO + JO_BLOCK_WRITE,
-		     JO2_ENV + JO2_CWD) == FAIL)
+		     JO2_ENV + JO2_CWD + JO2_DRAIN_CB + JO2_TRANSPORT) == FAIL)
 	    goto theend;
     }
 
+    // The "shm" transport needs pipes for stdin and stdout, stderr must not
+    // go to the stdout pipe.
+    if (opt.jo_shm && (opt.jo_pty
+		|| opt.jo_io[PART_IN] == JIO_NULL
+		|| opt.jo_io[PART_IN] == JIO_FILE
+		|| opt.jo_io[PART_OUT] == JIO_NULL
+		|| opt.jo_io[PART_OUT] == JIO_FILE
+		|| opt.jo_io[PART_ERR] == JIO_OUT))
+    {
+	semsg(_(e_invargval), "transport");
+	goto theend;
+    }
+
     // Check that when io is "file" that there is a file name.
     for (part = PART_OUT; part < PART_COUNT; ++part)
 	if ((opt.jo_set & (JO_OUT_IO << (part - PART_OUT)))
@@ -6607,7 +7944,7 @@ f_ch_setoptions(typval_T *argvars, typval_T *rettv UNUSED)
 	return;
     clear_job_options(&opt);
     if (get_job_options(&argvars[1], &opt,
-			    JO_CB_ALL + JO_TIMEOUT_ALL + JO_MODE_ALL, 0) == OK)
+		 JO_CB_ALL + JO_TIMEOUT_ALL + JO_MODE_ALL, JO2_DRAIN_CB) == OK)
 	channel_set_options(channel, &opt);
     free_job_options(&opt);
 }
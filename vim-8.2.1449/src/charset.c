@@ -37,6 +37,19 @@ static char_u	g_chartab[256];
 
 static int in_win_border(win_T *wp, colnr_T vcol);
 
+// Number of bytes between virtual column checkpoints in a long line.
+#define VCOL_CP_INTERVAL 1024
+
+// Number of entries in the cache of line widths of a window, must be a power
+// of two.
+#define LINEWIDTH_CACHE_SIZE 512
+
+// Flags for lw_flags, the window options the line widths depend on.
+#define LW_WRAP		1
+#define LW_LIST		2
+#define LW_LBR		4
+#define LW_BRI		8
+
 /*
  * Fill g_chartab[].  Also fills curbuf->b_chartab[] with flags for keyword
  * characters for current buffer.
@@ -83,6 +96,9 @@ buf_init_chartab(
 
     if (global)
     {
+	// Cell widths may change, cached virtual columns are invalid.
+	++cellwidth_tick;
+
 	/*
 	 * Set the default size for printable characters:
 	 * From <Space> to '~' is 1 (printable), others are 2 (not printable).
@@ -824,6 +840,154 @@ win_linetabsize(win_T *wp, char_u *line, colnr_T len)
     return (int)col;
 }
 
+/*
+ * Check that the cached line widths of window "wp" are valid for the
+ * current buffer text and option values.  If not then clear the cache.
+ * Returns FAIL when the cache can't be used.
+ */
+    static int
+linewidth_cache_check(win_T *wp)
+{
+    linewidth_T	*lw = &wp->w_linewidth;
+    buf_T	*buf = wp->w_buffer;
+    int		width1 = wp->w_width - win_col_off(wp);
+    int		width2 = width1 + win_col_off2(wp);
+    int		flags = 0;
+
+    if (wp->w_p_wrap)
+	flags |= LW_WRAP;
+    if (wp->w_p_list)
+	flags |= LW_LIST;
+#ifdef FEAT_LINEBREAK
+    if (wp->w_p_lbr)
+	flags |= LW_LBR;
+    if (wp->w_p_bri)
+	flags |= LW_BRI;
+#endif
+    if (lw->lw_entries != NULL
+	    && lw->lw_fnum == buf->b_fnum
+	    && lw->lw_changedtick == CHANGEDTICK(buf)
+	    && lw->lw_lines_moved == buf->b_ml.ml_lines_moved
+	    && lw->lw_display_opt_tick == display_opt_tick
+	    && lw->lw_cellwidth_tick == cellwidth_tick
+	    && lw->lw_width1 == width1
+	    && lw->lw_width2 == width2
+	    && lw->lw_ts == buf->b_p_ts
+	    && lw->lw_flags == flags)
+	return OK;
+
+    if (lw->lw_entries == NULL)
+    {
+	lw->lw_entries = ALLOC_MULT(lwentry_T, LINEWIDTH_CACHE_SIZE);
+	if (lw->lw_entries == NULL)
+	    return FAIL;
+    }
+    vim_memset(lw->lw_entries, 0, LINEWIDTH_CACHE_SIZE * sizeof(lwentry_T));
+    lw->lw_fnum = buf->b_fnum;
+    lw->lw_changedtick = CHANGEDTICK(buf);
+    lw->lw_lines_moved = buf->b_ml.ml_lines_moved;
+    lw->lw_display_opt_tick = display_opt_tick;
+    lw->lw_cellwidth_tick = cellwidth_tick;
+    lw->lw_width1 = width1;
+    lw->lw_width2 = width2;
+    lw->lw_ts = buf->b_p_ts;
+    lw->lw_flags = flags;
+    return OK;
+}
+
+/*
+ * Return the number of virtual columns text "line" of line "lnum" takes in
+ * window "wp", like win_linetabsize() with MAXCOL.  The result is cached.
+ */
+    int
+win_line_vcols(win_T *wp, linenr_T lnum, char_u *line)
+{
+    lwentry_T	*lwe;
+
+    if (linewidth_cache_check(wp) == FAIL)
+	return win_linetabsize(wp, line, (colnr_T)MAXCOL);
+    lwe = &wp->w_linewidth.lw_entries[lnum & (LINEWIDTH_CACHE_SIZE - 1)];
+    if (lwe->lw_lnum != lnum)
+    {
+	lwe->lw_vcols = win_linetabsize(wp, line, (colnr_T)MAXCOL);
+	lwe->lw_lnum = lnum;
+    }
+    return lwe->lw_vcols;
+}
+
+/*
+ * Called from changed_common() for window "wp" showing the current buffer:
+ * lines "lnum" to "lnume" (not including) were changed and "xtra" lines
+ * were added (negative when deleted).  "tick" is the b:changedtick before
+ * the change.  When the cached line widths and virtual column checkpoints
+ * were valid, only drop the affected lines, other lines remain valid.
+ */
+    void
+linewidth_cache_changed(
+    win_T	*wp,
+    linenr_T	lnum,
+    linenr_T	lnume,
+    long	xtra,
+    varnumber_T	tick)
+{
+    linewidth_T	*lw = &wp->w_linewidth;
+    vcolcp_T	*cp = &wp->w_vcolcp;
+    int		i;
+
+    if (cp->vc_lnum != 0 && cp->vc_fnum == wp->w_buffer->b_fnum
+	    && cp->vc_changedtick == tick
+	    && xtra == 0 && (cp->vc_lnum < lnum || cp->vc_lnum >= lnume))
+	cp->vc_changedtick = CHANGEDTICK(wp->w_buffer);
+
+    if (lw->lw_entries == NULL || lw->lw_fnum != wp->w_buffer->b_fnum
+						  || lw->lw_changedtick != tick)
+	return;
+    for (i = 0; i < LINEWIDTH_CACHE_SIZE; ++i)
+    {
+	linenr_T l = lw->lw_entries[i].lw_lnum;
+
+	// When lines were inserted or deleted the following lines moved.
+	if (l >= lnum && (l < lnume || xtra != 0))
+	    lw->lw_entries[i].lw_lnum = 0;
+    }
+    lw->lw_changedtick = CHANGEDTICK(wp->w_buffer);
+}
+
+/*
+ * Called when the text of line "lnum" in buffer "buf" was replaced, before
+ * b:changedtick is incremented: forget the cached widths of the line.
+ */
+    void
+linewidth_line_replaced(buf_T *buf, linenr_T lnum)
+{
+    tabpage_T	*tp;
+    win_T	*wp;
+    lwentry_T	*lwe;
+
+    FOR_ALL_TAB_WINDOWS(tp, wp)
+	if (wp->w_buffer == buf)
+	{
+	    if (wp->w_vcolcp.vc_lnum == lnum)
+		wp->w_vcolcp.vc_lnum = 0;
+	    if (wp->w_linewidth.lw_entries != NULL)
+	    {
+		lwe = &wp->w_linewidth.lw_entries[
+					   lnum & (LINEWIDTH_CACHE_SIZE - 1)];
+		if (lwe->lw_lnum == lnum)
+		    lwe->lw_lnum = 0;
+	    }
+	}
+}
+
+/*
+ * Free the cache of line widths of window "wp".
+ */
+    void
+linewidth_cache_free(win_T *wp)
+{
+    VIM_CLEAR(wp->w_linewidth.lw_entries);
+}
+
 /*
  * Return TRUE if 'c' is a normal identifier character:
  * Letters and characters from the 'isident' option.
@@ -1198,6 +1362,228 @@ in_win_border(win_T *wp, colnr_T vcol)
     return ((vcol - width1) % width2 == width2 - 1);
 }
 
+/*
+ * Return the number of cells character "ptr" occupies at virtual column
+ * "vcol" in window "wp", when 'list' (without "tab" in 'listchars'),
+ * 'linebreak', 'showbreak' and 'breakindent' don't matter.
+ * Sets "*headp" to one when a double-width character doesn't fit at the end
+ * of a screen line and wraps to the next one.
+ */
+    static int
+vcol_char_size(win_T *wp, char_u *ptr, colnr_T vcol, int *headp)
+{
+    int		c = *ptr;
+    int		incr;
+
+    // A tab gets expanded, depending on the current column
+    if (c == TAB)
+#ifdef FEAT_VARTABS
+	return tabstop_padding(vcol, wp->w_buffer->b_p_ts,
+					    wp->w_buffer->b_p_vts_array);
+#else
+	return wp->w_buffer->b_p_ts - (vcol % wp->w_buffer->b_p_ts);
+#endif
+    if (has_mbyte)
+    {
+	// For utf-8, if the byte is >= 0x80, need to look at
+	// further bytes to find the cell width.
+	if (enc_utf8 && c >= 0x80)
+	    incr = utf_ptr2cells(ptr);
+	else
+	    incr = g_chartab[c] & CT_CELL_MASK;
+
+	// If a double-cell char doesn't fit at the end of a line
+	// it wraps to the next line, it's like this char is three
+	// cells wide.
+	if (incr == 2 && wp->w_p_wrap && MB_BYTE2LEN(*ptr) > 1
+		&& in_win_border(wp, vcol))
+	{
+	    ++incr;
+	    *headp = 1;
+	}
+	return incr;
+    }
+    return g_chartab[c] & CT_CELL_MASK;
+}
+
+/*
+ * Check that the virtual column checkpoints of window "wp" are valid for line
+ * "lnum" with the current option values.  When they are not valid start over
+ * with only the checkpoint at column zero.
+ * Returns FALSE when out of memory.
+ */
+    static int
+vcol_cp_check(win_T *wp, linenr_T lnum)
+{
+    vcolcp_T	*cp = &wp->w_vcolcp;
+    buf_T	*buf = wp->w_buffer;
+    int		width1 = 0;
+    int		width2 = 0;
+
+    if (wp->w_p_wrap)
+    {
+	width1 = wp->w_width - win_col_off(wp);
+	width2 = width1 + win_col_off2(wp);
+    }
+    if (cp->vc_lnum == lnum
+	    && cp->vc_fnum == buf->b_fnum
+	    && cp->vc_changedtick == CHANGEDTICK(buf)
+	    && cp->vc_lines_moved == buf->b_ml.ml_lines_moved
+	    && cp->vc_ts == buf->b_p_ts
+	    && cp->vc_display_opt_tick == display_opt_tick
+	    && cp->vc_width1 == width1
+	    && cp->vc_width2 == width2
+	    && cp->vc_cellwidth_tick == cellwidth_tick)
+	return TRUE;
+
+    if (cp->vc_size == 0)
+    {
+	cp->vc_col = ALLOC_MULT(colnr_T, 64);
+	cp->vc_vcol = ALLOC_MULT(colnr_T, 64);
+	if (cp->vc_col == NULL || cp->vc_vcol == NULL)
+	{
+	    vcol_cp_clear(wp);
+	    return FALSE;
+	}
+	cp->vc_size = 64;
+    }
+    cp->vc_lnum = lnum;
+    cp->vc_fnum = buf->b_fnum;
+    cp->vc_changedtick = CHANGEDTICK(buf);
+    cp->vc_lines_moved = buf->b_ml.ml_lines_moved;
+    cp->vc_ts = buf->b_p_ts;
+    cp->vc_display_opt_tick = display_opt_tick;
+    cp->vc_width1 = width1;
+    cp->vc_width2 = width2;
+    cp->vc_cellwidth_tick = cellwidth_tick;
+    cp->vc_count = 1;
+    cp->vc_col[0] = 0;
+    cp->vc_vcol[0] = 0;
+    cp->vc_done = FALSE;
+    return TRUE;
+}
+
+/*
+ * Add virtual column checkpoints for "line" until one is found after byte
+ * index "col" or at or after virtual column "vcol", or the end of the line
+ * is reached.
+ */
+    static void
+vcol_cp_extend(win_T *wp, char_u *line, colnr_T col, colnr_T vcol)
+{
+    vcolcp_T	*cp = &wp->w_vcolcp;
+    char_u	*ptr;
+    char_u	*next;
+    colnr_T	v;
+    int		head;
+
+    while (!cp->vc_done
+	    && cp->vc_col[cp->vc_count - 1] <= col
+	    && cp->vc_vcol[cp->vc_count - 1] < vcol)
+    {
+	ptr = line + cp->vc_col[cp->vc_count - 1];
+	v = cp->vc_vcol[cp->vc_count - 1];
+	next = line + (long)cp->vc_count * VCOL_CP_INTERVAL;
+	while (ptr < next && *ptr != NUL)
+	{
+	    v += vcol_char_size(wp, ptr, v, &head);
+	    MB_PTR_ADV(ptr);
+	}
+	if (*ptr == NUL)
+	    cp->vc_done = TRUE;
+
+	if (cp->vc_count == cp->vc_size)
+	{
+	    int		new_size = cp->vc_size * 2;
+	    colnr_T	*new_col;
+	    colnr_T	*new_vcol;
+
+	    new_col = vim_realloc(cp->vc_col, new_size * sizeof(colnr_T));
+	    if (new_col != NULL)
+		cp->vc_col = new_col;
+	    new_vcol = vim_realloc(cp->vc_vcol, new_size * sizeof(colnr_T));
+	    if (new_vcol != NULL)
+		cp->vc_vcol = new_vcol;
+	    if (new_col == NULL || new_vcol == NULL)
+	    {
+		// Out of memory: keep what we have, don't try adding more.
+		cp->vc_done = TRUE;
+		break;
+	    }
+	    cp->vc_size = new_size;
+	}
+	cp->vc_col[cp->vc_count] = (colnr_T)(ptr - line);
+	cp->vc_vcol[cp->vc_count] = v;
+	++cp->vc_count;
+    }
+}
+
+/*
+ * Find a checkpoint to start computing virtual columns in a long line, to
+ * avoid walking the line from the start every time.
+ * "line" is line "lnum" in the buffer of window "wp".  Find the last
+ * checkpoint at or before byte index "col" or before virtual column "vcol",
+ * the other one must be MAXCOL.
+ * Returns FALSE when no useful checkpoint was found, start at the beginning
+ * of the line then.  Otherwise sets "*cp_col" and "*cp_vcol".
+ * Only valid when 'linebreak', 'showbreak' and 'breakindent' are off and
+ * 'list' is off or "tab" is in 'listchars'.
+ */
+    int
+vcol_checkpoint(
+    win_T	*wp,
+    linenr_T	lnum,
+    char_u	*line,
+    colnr_T	col,
+    colnr_T	vcol,
+    colnr_T	*cp_col,
+    colnr_T	*cp_vcol)
+{
+    vcolcp_T	*cp = &wp->w_vcolcp;
+    int		lo, hi, mid;
+
+    if ((col == MAXCOL ? vcol < VCOL_CP_INTERVAL : col < VCOL_CP_INTERVAL)
+	    || (wp->w_p_list && lcs_tab1 == NUL)
+#ifdef FEAT_LINEBREAK
+	    || wp->w_p_lbr || *get_showbreak_value(wp) != NUL || wp->w_p_bri
+#endif
+	    )
+	return FALSE;
+    if (!vcol_cp_check(wp, lnum))
+	return FALSE;
+    vcol_cp_extend(wp, line, col, vcol);
+
+    // Binary search for the last checkpoint before the position.
+    lo = 0;
+    hi = cp->vc_count - 1;
+    while (lo < hi)
+    {
+	mid = (lo + hi + 1) / 2;
+	if (col != MAXCOL ? cp->vc_col[mid] <= col : cp->vc_vcol[mid] < vcol)
+	    lo = mid;
+	else
+	    hi = mid - 1;
+    }
+    if (lo == 0)
+	return FALSE;
+    *cp_col = cp->vc_col[lo];
+    *cp_vcol = cp->vc_vcol[lo];
+    return TRUE;
+}
+
+/*
+ * Free the virtual column checkpoints of window "wp".
+ */
+    void
+vcol_cp_clear(win_T *wp)
+{
+    VIM_CLEAR(wp->w_vcolcp.vc_col);
+    VIM_CLEAR(wp->w_vcolcp.vc_vcol);
+    wp->w_vcolcp.vc_size = 0;
+    wp->w_vcolcp.vc_count = 0;
+    wp->w_vcolcp.vc_lnum = 0;
+}
+
 /*
  * Get virtual column number of pos.
  *  start: on the first position of this character (TAB, ctrl)
@@ -1220,11 +1606,6 @@ getvcol(
     char_u	*line;		// start of the line
     int		incr;
     int		head;
-#ifdef FEAT_VARTABS
-    int		*vts = wp->w_buffer->b_p_vts_array;
-#endif
-    int		ts = wp->w_buffer->b_p_ts;
-    int		c;
 
     vcol = 0;
     line = ptr = ml_get_buf(wp->w_buffer, pos->lnum, FALSE);
@@ -1254,47 +1635,33 @@ getvcol(
 #endif
        )
     {
+	colnr_T	cp_col;
+	colnr_T	cp_vcol;
+
+	if (posptr == NULL)
+	{
+	    // The width of the whole line is cached.
+	    vcol = win_line_vcols(wp, pos->lnum, line);
+	    ptr = line + STRLEN(line);
+	}
+	// In a long line start at the closest checkpoint.
+	else if (vcol_checkpoint(wp, pos->lnum, line,
+			    (colnr_T)(posptr - line), MAXCOL, &cp_col, &cp_vcol))
+	{
+	    ptr = line + cp_col;
+	    vcol = cp_vcol;
+	}
+
 	for (;;)
 	{
 	    head = 0;
-	    c = *ptr;
 	    // make sure we don't go past the end of the line
-	    if (c == NUL)
+	    if (*ptr == NUL)
 	    {
 		incr = 1;	// NUL at end of line only takes one column
 		break;
 	    }
-	    // A tab gets expanded, depending on the current column
-	    if (c == TAB)
-#ifdef FEAT_VARTABS
-		incr = tabstop_padding(vcol, ts, vts);
-#else
-		incr = ts - (vcol % ts);
-#endif
-	    else
-	    {
-		if (has_mbyte)
-		{
-		    // For utf-8, if the byte is >= 0x80, need to look at
-		    // further bytes to find the cell width.
-		    if (enc_utf8 && c >= 0x80)
-			incr = utf_ptr2cells(ptr);
-		    else
-			incr = g_chartab[c] & CT_CELL_MASK;
-
-		    // If a double-cell char doesn't fit at the end of a line
-		    // it wraps to the next line, it's like this char is three
-		    // cells wide.
-		    if (incr == 2 && wp->w_p_wrap && MB_BYTE2LEN(*ptr) > 1
-			    && in_win_border(wp, vcol))
-		    {
-			++incr;
-			head = 1;
-		    }
-		}
-		else
-		    incr = g_chartab[c] & CT_CELL_MASK;
-	    }
+	    incr = vcol_char_size(wp, ptr, vcol, &head);
 
 	    if (posptr != NULL && ptr >= posptr) // character at pos->col
 		break;
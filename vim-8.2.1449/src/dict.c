@@ -194,17 +194,26 @@ dict_free_nonref(int copyID)
     return did_free;
 }
 
-    void
+/*
+ * Free the dicts that do not have "copyID".
+ * Returns the number of dicts freed.
+ */
+    int
 dict_free_items(int copyID)
 {
     dict_T	*dd, *dd_next;
+    int		count = 0;
 
     for (dd = first_dict; dd != NULL; dd = dd_next)
     {
 	dd_next = dd->dv_used_next;
 	if ((dd->dv_copyID & COPYID_MASK) != (copyID & COPYID_MASK))
+	{
 	    dict_free_dict(dd);
+	    ++count;
+	}
     }
+    return count;
 }
 
 /*
@@ -346,6 +355,7 @@ dict_copy(dict_T *orig, int deep, int copyID)
     int
 dict_add(dict_T *d, dictitem_T *item)
 {
+    GC_CHANGED_DICT(d);
     return hash_add(&d->dv_hashtab, item->di_key);
 }
 
@@ -391,6 +401,30 @@ dict_add_bool(dict_T *d, char *key, varnumber_T nr)
     return dict_add_number_special(d, key, nr, VAR_BOOL);
 }
 
+#if defined(FEAT_FLOAT) || defined(PROTO)
+/*
+ * Add a float entry to dictionary "d".
+ * Returns FAIL when out of memory and when key already exists.
+ */
+    int
+dict_add_float(dict_T *d, char *key, float_T f)
+{
+    dictitem_T	*item;
+
+    item = dictitem_alloc((char_u *)key);
+    if (item == NULL)
+	return FAIL;
+    item->di_tv.v_type = VAR_FLOAT;
+    item->di_tv.vval.v_float = f;
+    if (dict_add(d, item) == FAIL)
+    {
+	dictitem_free(item);
+	return FAIL;
+    }
+    return OK;
+}
+#endif
+
 /*
  * Add a string entry to dictionary "d".
  * Returns FAIL when out of memory and when key already exists.
@@ -589,31 +623,15 @@ dict_len(dict_T *d)
     dictitem_T *
 dict_find(dict_T *d, char_u *key, int len)
 {
-#define AKEYLEN 200
-    char_u	buf[AKEYLEN];
-    char_u	*akey;
-    char_u	*tofree = NULL;
     hashitem_T	*hi;
 
     if (d == NULL)
 	return NULL;
     if (len < 0)
-	akey = key;
-    else if (len >= AKEYLEN)
-    {
-	tofree = akey = vim_strnsave(key, len);
-	if (akey == NULL)
-	    return NULL;
-    }
+	hi = hash_find(&d->dv_hashtab, key);
     else
-    {
-	// Avoid a malloc/free by using buf[].
-	vim_strncpy(buf, key, len);
-	akey = buf;
-    }
-
-    hi = hash_find(&d->dv_hashtab, akey);
-    vim_free(tofree);
+	// Avoid making a NUL terminated copy of the key.
+	hi = hash_find_len(&d->dv_hashtab, key, len);
     if (HASHITEM_EMPTY(hi))
 	return NULL;
     return HI2DI(hi);
@@ -999,6 +1017,7 @@ dict_extend(dict_T *d1, dict_T *d2, char_u *action)
 		    break;
 		clear_tv(&di1->di_tv);
 		copy_tv(&HI2DI(hi2)->di_tv, &di1->di_tv);
+		GC_STORED_TV(&di1->di_tv);
 	    }
 	}
     }
@@ -1224,6 +1243,8 @@ dict_remove(typval_T *argvars, typval_T *rettv, char_u *arg_errmsg)
 			&& !var_check_ro(di->di_flags, arg_errmsg, TRUE))
 	    {
 		*rettv = di->di_tv;
+		// "di_str_len" does not go with the String
+		rettv->v_lock &= ~VAR_APPENDED;
 		init_tv(&di->di_tv);
 		dictitem_remove(d, di);
 	    }
@@ -767,6 +767,18 @@ win_line(
     if (v > 0 && !number_only)
     {
 	char_u	*prev_ptr = ptr;
+	colnr_T	cp_col;
+	colnr_T	cp_vcol;
+
+	// In a long line start at the closest checkpoint, instead of going
+	// over all the characters from the start of the line.
+	if (vcol_checkpoint(wp, lnum, line, MAXCOL, (colnr_T)v,
+							   &cp_col, &cp_vcol))
+	{
+	    ptr = line + cp_col;
+	    prev_ptr = ptr;
+	    vcol = cp_vcol;
+	}
 
 	while (vcol < v && *ptr != NUL)
 	{
@@ -152,6 +152,22 @@ update_screen(int type_arg)
     }
     updating_screen = TRUE;
 
+#ifdef UNIX
+    // When the terminal is slow and output of previous frames is still
+    // waiting to be written, this frame replaces it, see 'ttyasync'.
+    if (mch_tty_supersede())
+    {
+	// The terminal may be in any state, restore the attributes and the
+	// cursor position before clearing.
+	out_str(T_ME);
+	screen_start();
+	type = CLEAR;
+    }
+#endif
+
+    // Collect the output for the whole frame, it is written at once.
+    out_frame_start();
+
 #ifdef FEAT_PROP_POPUP
     // Update popup_mask if needed.  This may set w_redraw_top and w_redraw_bot
     // in some windows.
@@ -348,6 +364,11 @@ update_screen(int type_arg)
 	maybe_intro_message();
     did_intro = TRUE;
 
+    out_frame_end();
+#ifdef FEAT_TIMERS
+    redraw_async_frame_done();
+#endif
+
 #ifdef FEAT_GUI
     // Redraw the cursor and update the scrollbars when all screen updating is
     // done.
@@ -2970,6 +2991,142 @@ redraw_after_callback(int call_update_screen)
     --redrawing_for_callback;
 }
 
+#if defined(FEAT_TIMERS) || defined(PROTO)
+// State for coalescing redraws caused by asynchronous events, see
+// 'redrawinterval'.
+static proftime_T   async_redraw_next;	    // earliest time for next redraw
+static int	    async_redraw_next_set = FALSE;
+static int	    async_redraw_pending = FALSE;
+static long	    async_redraw_count = 0;	// async redraws done
+static long	    async_redraw_skipped = 0;	// async redraws postponed
+static proftime_T   fps_start;		    // start of current second
+static int	    fps_start_set = FALSE;
+static long	    fps_frames = 0;	    // frames in current second
+static long	    fps_last = 0;	    // frames in previous second
+
+/*
+ * Called at the end of update_screen(): remember when the next redraw for an
+ * asynchronous event may be done and count the frame rate.
+ */
+    void
+redraw_async_frame_done(void)
+{
+    proftime_T	now;
+
+    // Whatever was pending has been drawn now.
+    async_redraw_pending = FALSE;
+
+    if (p_rdi > 0)
+    {
+	profile_setlimit(p_rdi, &async_redraw_next);
+	async_redraw_next_set = TRUE;
+    }
+    else
+	async_redraw_next_set = FALSE;
+
+    profile_start(&now);
+    if (!fps_start_set || proftime_time_left(&fps_start, &now) < -1000)
+    {
+	fps_last = fps_start_set ? fps_frames : 0;
+	fps_frames = 0;
+	fps_start = now;
+	fps_start_set = TRUE;
+    }
+    ++fps_frames;
+}
+#endif
+
+/*
+ * Return TRUE when a redraw for an asynchronous event should be postponed,
+ * because the screen was updated less than 'redrawinterval' msec ago.  The
+ * redraw is then done later by redraw_async_check().
+ */
+    int
+redraw_async_postpone(void)
+{
+#ifdef FEAT_TIMERS
+    if (p_rdi > 0 && async_redraw_next_set
+			       && !profile_passed_limit(&async_redraw_next))
+    {
+	async_redraw_pending = TRUE;
+	++async_redraw_skipped;
+	return TRUE;
+    }
+#endif
+    return FALSE;
+}
+
+/*
+ * Like redraw_after_callback(TRUE), but to be used for events that may arrive
+ * at a high rate, such as job output.  Drawing is limited by
+ * 'redrawinterval'.
+ */
+    void
+redraw_after_async(void)
+{
+    if (redraw_async_postpone())
+	return;
+#ifdef FEAT_TIMERS
+    ++async_redraw_count;
+#endif
+    redraw_after_callback(TRUE);
+}
+
+#if defined(FEAT_TIMERS) || defined(PROTO)
+/*
+ * Do a postponed redraw when it is due.  Called from check_due_timer().
+ * Returns "next_due" adjusted for when the pending redraw is due.
+ */
+    long
+redraw_async_check(proftime_T *now, long next_due)
+{
+    long    this_due;
+
+    if (!async_redraw_pending)
+	return next_due;
+    this_due = async_redraw_next_set
+			  ? proftime_time_left(&async_redraw_next, now) : 0;
+    if (this_due <= 1)
+    {
+	async_redraw_pending = FALSE;
+	++async_redraw_count;
+	redraw_after_callback(TRUE);
+# ifdef FEAT_TERMINAL
+	// redraw_after_callback() put the cursor in the window, a job in a
+	// terminal may have it elsewhere
+	term_postponed_redraw_done();
+# endif
+	return next_due;
+    }
+    if (next_due == -1 || next_due > this_due)
+	return this_due;
+    return next_due;
+}
+
+# if defined(FEAT_EVAL) || defined(PROTO)
+/*
+ * Add the asynchronous redraw statistics to "d", for redrawstats().
+ */
+    void
+redraw_async_add_stats(dict_T *d)
+{
+    proftime_T	now;
+    long	fps = fps_last;
+
+    profile_start(&now);
+    // When no frame was drawn for a while the rate has dropped.
+    if (fps_start_set && proftime_time_left(&fps_start, &now) < -2000)
+	fps = 0;
+    else if (fps_start_set && proftime_time_left(&fps_start, &now) < -1000)
+	fps = fps_frames;
+    dict_add_number(d, "async_redraws", async_redraw_count);
+    dict_add_number(d, "async_skipped", async_redraw_skipped);
+    dict_add_number(d, "async_pending", async_redraw_pending);
+    dict_add_number(d, "fps", fps);
+}
+# endif
+#endif
+
 /*
  * Redraw the current window later, with update_screen(type).
  * Set must_redraw only if not already set to a higher value.
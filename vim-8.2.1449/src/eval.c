@@ -31,6 +31,31 @@ static char *e_dictrange = N_("E719: Cannot use [:] with a Dictionary");
  */
 static int current_copyID = 0;
 
+/*
+ * Statistics about garbage collection, returned by gcstats().
+ */
+static long	gc_count = 0;		// nr of collections done
+static long	gc_freed = 0;		// total nr of lists and dicts freed
+static long	gc_last_freed = 0;	// lists and dicts freed by the last one
+static long	gc_steps = 0;		// nr of incremental steps done
+#if defined(FEAT_RELTIME) && defined(FEAT_FLOAT)
+static float_T	gc_last_pause = 0.0;	// duration of the last one in seconds
+static float_T	gc_max_pause = 0.0;	// longest duration in seconds
+static float_T	gc_total_pause = 0.0;	// total duration in seconds
+#endif
+
+/*
+ * Lists and dicts marked by an incremental garbage collection, of which the
+ * items still need to be marked.  Each entry holds a reference.
+ */
+static garray_T	gc_gray = {0, 0, sizeof(typval_T), 100, NULL};
+static int	gc_mark_abort = FALSE;	// TRUE when marks can't be trusted
+
+// Time in msec spent on one step of an incremental garbage collection.
+#define GC_STEP_MSEC 10
+// Number of lists and dicts marked in one step without the +reltime feature.
+#define GC_STEP_COUNT 1000
+
 /*
  * Info used by a ":for" loop.
  */
@@ -55,6 +80,10 @@ static int eval7(char_u **arg, typval_T *rettv, evalarg_T *evalarg, int want_str
 static int eval7_leader(typval_T *rettv, int numeric_only, char_u *start_leader, char_u **end_leaderp);
 
 static int free_unref_items(int copyID);
+#if defined(FEAT_RELTIME) && defined(FEAT_FLOAT)
+static void gc_add_pause(proftime_T *pause);
+#endif
+static int gc_mark_gray(proftime_T *tm, int count);
 static char_u *make_expanded_name(char_u *in_start, char_u *expr_start, char_u *expr_end, char_u *in_end);
 
 /*
@@ -138,6 +167,8 @@ eval_init(void)
     void
 eval_clear(void)
 {
+    // Drop the references of an incremental garbage collection.
+    garbage_collect_abort();
     evalvars_clear();
     free_scriptnames();  // must come after evalvars_clear().
     free_locales();
@@ -1275,7 +1306,9 @@ set_var_lval(
 
 	    // handle +=, -=, *=, /=, %= and .=
 	    di = NULL;
-	    if (eval_variable(lp->ll_name, (int)STRLEN(lp->ll_name),
+	    if (*op == '.' && append_var_string(lp->ll_name, rettv) != NOTDONE)
+		;
+	    else if (eval_variable(lp->ll_name, (int)STRLEN(lp->ll_name),
 					     &tv, &di, TRUE, FALSE) == OK)
 	    {
 		if ((di == NULL
@@ -1335,6 +1368,7 @@ set_var_lval(
 	    {
 		clear_tv(&lp->ll_li->li_tv);
 		copy_tv(&ri->li_tv, &lp->ll_li->li_tv);
+		GC_STORED_TV(&lp->ll_li->li_tv);
 	    }
 	    ri = ri->li_next;
 	    if (ri == NULL || (!lp->ll_empty2 && lp->ll_n2 == lp->ll_n1))
@@ -1406,6 +1440,7 @@ set_var_lval(
 	    lp->ll_tv->v_lock = 0;
 	    init_tv(rettv);
 	}
+	GC_STORED_TV(lp->ll_tv);
     }
 }
 
@@ -3944,6 +3979,22 @@ partial_unref(partial_T *pt)
  */
     int
 get_copyID(void)
+{
+    current_copyID += COPYID_INC;
+
+    // The caller may overwrite the copyID of lists and dicts, then the marks
+    // of an incremental garbage collection can't be trusted.
+    if (gc_mark_copyID != 0)
+	gc_mark_abort = TRUE;
+    return current_copyID;
+}
+
+/*
+ * Like get_copyID(), for a caller that restores the copyID of every list and
+ * dict it sets it in.  Does not disturb an incremental garbage collection.
+ */
+    int
+get_copyID_restore(void)
 {
     current_copyID += COPYID_INC;
     return current_copyID;
@@ -3978,11 +4029,15 @@ get_copyID(void)
 garbage_collect(int testing)
 {
     int		copyID;
+    int		incremental;
     int		abort = FALSE;
     buf_T	*buf;
     win_T	*wp;
     int		did_free = FALSE;
     tabpage_T	*tp;
+#if defined(FEAT_RELTIME) && defined(FEAT_FLOAT)
+    proftime_T	pause;
+#endif
 
     if (!testing)
     {
@@ -4016,9 +4071,25 @@ garbage_collect(int testing)
 	}
     }
 
-    // We advance by two because we add one for items referenced through
-    // previous_funccal.
-    copyID = get_copyID();
+#if defined(FEAT_RELTIME) && defined(FEAT_FLOAT)
+    profile_start(&pause);
+#endif
+    ++gc_count;
+    gc_last_freed = 0;
+
+    // Finish an incremental collection that is in progress: what it marked
+    // is kept and the roots are marked again to find what was added since.
+    incremental = gc_mark_copyID != 0 && !gc_mark_abort;
+    if (incremental)
+	copyID = gc_mark_copyID;
+    else
+    {
+	garbage_collect_abort();
+
+	// We advance by two because we add one for items referenced through
+	// previous_funccal.
+	copyID = get_copyID();
+    }
 
     /*
      * 1. Go through all accessible variables and mark all lists and dicts
@@ -4113,6 +4184,20 @@ garbage_collect(int testing)
     abort = abort || set_ref_in_popups(copyID);
 #endif
 
+    if (incremental)
+    {
+#ifdef FEAT_JOB_CHANNEL
+	// Callbacks and messages of channels and jobs may have been added
+	// after they were marked.
+	abort = abort || set_ref_in_marked_channels(copyID);
+	abort = abort || set_ref_in_marked_jobs(copyID);
+#endif
+	// Lists and dicts that changed after they were marked.
+	(void)gc_mark_gray(NULL, 0);
+	abort = abort || gc_mark_abort;
+	garbage_collect_abort();
+    }
+
     if (!abort)
     {
 	/*
@@ -4131,9 +4216,282 @@ garbage_collect(int testing)
 	verb_msg(_("Not enough memory to set references, garbage collection aborted!"));
     }
 
+    gc_freed += gc_last_freed;
+#if defined(FEAT_RELTIME) && defined(FEAT_FLOAT)
+    gc_add_pause(&pause);
+#endif
+
     return did_free;
 }
 
+#if defined(FEAT_RELTIME) && defined(FEAT_FLOAT)
+/*
+ * Add the time since "pause" to the garbage collection statistics.
+ */
+    static void
+gc_add_pause(proftime_T *pause)
+{
+    profile_end(pause);
+    gc_last_pause = profile_float(pause);
+    if (gc_last_pause > gc_max_pause)
+	gc_max_pause = gc_last_pause;
+    gc_total_pause += gc_last_pause;
+}
+#endif
+
+/*
+ * Do one step of an incremental garbage collection: mark Lists and
+ * Dictionaries for a short time.  Starts a collection when none is in
+ * progress and finishes it with garbage_collect() when everything was marked.
+ * This spreads the work over the time Vim is waiting for a character, instead
+ * of blocking until all variables were visited.
+ * When "testing" is TRUE this is called from test_garbagecollect_step() and
+ * only one List or Dictionary is marked.
+ * Returns TRUE when the collection is still in progress.
+ */
+    int
+garbage_collect_step(int testing)
+{
+    buf_T	*buf;
+    win_T	*wp;
+    tabpage_T	*tp;
+    int		done;
+#ifdef FEAT_RELTIME
+    proftime_T	tm;
+#endif
+#if defined(FEAT_RELTIME) && defined(FEAT_FLOAT)
+    proftime_T	pause;
+
+    profile_start(&pause);
+#endif
+    ++gc_steps;
+
+    if (gc_mark_copyID == 0)
+    {
+	// Start a collection with the variables, other roots are marked when
+	// finishing it.
+	gc_mark_copyID = get_copyID();
+	gc_mark_abort = FALSE;
+	gc_mark_vars();
+	FOR_ALL_BUFFERS(buf)
+	    gc_mark_tv(&buf->b_bufvar.di_tv);
+	FOR_ALL_TAB_WINDOWS(tp, wp)
+	    gc_mark_tv(&wp->w_winvar.di_tv);
+	FOR_ALL_TABPAGES(tp)
+	    gc_mark_tv(&tp->tp_winvar.di_tv);
+    }
+
+    if (testing)
+	done = gc_mark_gray(NULL, 1);
+    else
+    {
+#ifdef FEAT_RELTIME
+	profile_setlimit(GC_STEP_MSEC, &tm);
+	done = gc_mark_gray(&tm, 0);
+#else
+	done = gc_mark_gray(NULL, GC_STEP_COUNT);
+#endif
+    }
+#if defined(FEAT_RELTIME) && defined(FEAT_FLOAT)
+    gc_add_pause(&pause);
+#endif
+
+    if (done || gc_mark_abort)
+    {
+	(void)garbage_collect(testing);
+	return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Return TRUE when an incremental garbage collection is in progress.
+ */
+    int
+garbage_collect_busy(void)
+{
+    return gc_mark_copyID != 0;
+}
+
+/*
+ * Stop an incremental garbage collection, dropping what it marked.
+ */
+    void
+garbage_collect_abort(void)
+{
+    gc_mark_copyID = 0;
+    gc_mark_abort = FALSE;
+    while (gc_gray.ga_len > 0)
+	clear_tv((typval_T *)gc_gray.ga_data + --gc_gray.ga_len);
+    ga_clear(&gc_gray);
+}
+
+/*
+ * Add list or dict "tv" to the ones of which the items still need to be
+ * marked by the incremental garbage collection.
+ */
+    static void
+gc_add_gray(typval_T *tv)
+{
+    if (ga_grow(&gc_gray, 1) == FAIL)
+    {
+	// Out of memory, garbage_collect() will start over.
+	gc_mark_abort = TRUE;
+	return;
+    }
+    copy_tv(tv, (typval_T *)gc_gray.ga_data + gc_gray.ga_len);
+    ++gc_gray.ga_len;
+}
+
+/*
+ * Mark "tv" for the incremental garbage collection.  A List or Dictionary
+ * gets its items marked later, other items are marked right away.
+ */
+    void
+gc_mark_tv(typval_T *tv)
+{
+    if (tv->v_type == VAR_LIST)
+    {
+	list_T	*l = tv->vval.v_list;
+
+	if (l != NULL && l->lv_copyID != gc_mark_copyID)
+	{
+	    l->lv_copyID = gc_mark_copyID;
+	    gc_add_gray(tv);
+	}
+    }
+    else if (tv->v_type == VAR_DICT)
+    {
+	dict_T	*d = tv->vval.v_dict;
+
+	if (d != NULL && d->dv_copyID != gc_mark_copyID)
+	{
+	    d->dv_copyID = gc_mark_copyID;
+	    gc_add_gray(tv);
+	}
+    }
+    else if (set_ref_in_item(tv, gc_mark_copyID, NULL, NULL))
+	gc_mark_abort = TRUE;
+}
+
+/*
+ * Mark the items in hashtab "ht" for the incremental garbage collection.
+ */
+    void
+gc_mark_ht(hashtab_T *ht)
+{
+    int		todo = (int)ht->ht_used;
+    hashitem_T	*hi;
+
+    for (hi = ht->ht_array; todo > 0; ++hi)
+	if (!HASHITEM_EMPTY(hi))
+	{
+	    --todo;
+	    gc_mark_tv(&HI2DI(hi)->di_tv);
+	}
+}
+
+/*
+ * Called when an item was added to list "l" while an incremental garbage
+ * collection is marking.  When "l" was marked already, its items are marked
+ * again.  Resetting the copyID avoids doing that for every item added.
+ */
+    void
+gc_changed_list(list_T *l)
+{
+    typval_T	tv;
+
+    if (l->lv_copyID == gc_mark_copyID)
+    {
+	l->lv_copyID = 0;
+	tv.v_type = VAR_LIST;
+	tv.vval.v_list = l;
+	gc_add_gray(&tv);
+    }
+}
+
+/*
+ * Like gc_changed_list() for dict "d".
+ */
+    void
+gc_changed_dict(dict_T *d)
+{
+    typval_T	tv;
+
+    if (d->dv_copyID == gc_mark_copyID)
+    {
+	d->dv_copyID = 0;
+	tv.v_type = VAR_DICT;
+	tv.vval.v_dict = d;
+	gc_add_gray(&tv);
+    }
+}
+
+/*
+ * Mark the items of the Lists and Dictionaries in "gc_gray".  Stop after
+ * "count" of them when it is not zero, or when "tm" is not NULL and that time
+ * was passed.
+ * Returns TRUE when all were done.
+ */
+    static int
+gc_mark_gray(proftime_T *tm UNUSED, int count)
+{
+    typval_T	tv;
+    int		done = 0;
+
+    while (gc_gray.ga_len > 0 && !gc_mark_abort)
+    {
+	if (count > 0 && done == count)
+	    return FALSE;
+#ifdef FEAT_RELTIME
+	if (tm != NULL && done % 20 == 19 && profile_passed_limit(tm))
+	    return FALSE;
+#endif
+	++done;
+
+	tv = *((typval_T *)gc_gray.ga_data + --gc_gray.ga_len);
+	if (tv.v_type == VAR_LIST)
+	{
+	    list_T	*l = tv.vval.v_list;
+	    listitem_T	*li;
+
+	    l->lv_copyID = gc_mark_copyID;
+	    if (l->lv_first != &range_list_item)
+		for (li = l->lv_first; li != NULL; li = li->li_next)
+		    gc_mark_tv(&li->li_tv);
+	}
+	else
+	{
+	    tv.vval.v_dict->dv_copyID = gc_mark_copyID;
+	    gc_mark_ht(&tv.vval.v_dict->dv_hashtab);
+	}
+	clear_tv(&tv);
+    }
+    return gc_gray.ga_len == 0;
+}
+
+/*
+ * "gcstats()" function
+ */
+    void
+f_gcstats(typval_T *argvars UNUSED, typval_T *rettv)
+{
+    dict_T	*d;
+
+    if (rettv_dict_alloc(rettv) != OK)
+	return;
+    d = rettv->vval.v_dict;
+    dict_add_number(d, "count", gc_count);
+    dict_add_number(d, "freed", gc_freed);
+    dict_add_number(d, "lastfreed", gc_last_freed);
+    dict_add_number(d, "steps", gc_steps);
+#if defined(FEAT_RELTIME) && defined(FEAT_FLOAT)
+    dict_add_float(d, "lastpause", gc_last_pause);
+    dict_add_float(d, "maxpause", gc_max_pause);
+    dict_add_float(d, "totalpause", gc_total_pause);
+#endif
+}
+
 /*
  * Free lists, dictionaries, channels and jobs that are no longer referenced.
  */
@@ -4171,8 +4529,8 @@ free_unref_items(int copyID)
     /*
      * PASS 2: free the items themselves.
      */
-    dict_free_items(copyID);
-    list_free_items(copyID);
+    gc_last_freed += dict_free_items(copyID);
+    gc_last_freed += list_free_items(copyID);
 
 #ifdef FEAT_JOB_CHANNEL
     // Go through the list of jobs and free items without the copyID. This
@@ -4479,6 +4837,12 @@ set_ref_in_item(
 		dtv.vval.v_partial = ch->ch_close_cb.cb_partial;
 		set_ref_in_item(&dtv, copyID, ht_stack, list_stack);
 	    }
+	    if (ch->ch_drain_cb.cb_partial != NULL)
+	    {
+		dtv.v_type = VAR_PARTIAL;
+		dtv.vval.v_partial = ch->ch_drain_cb.cb_partial;
+		set_ref_in_item(&dtv, copyID, ht_stack, list_stack);
+	    }
 	}
     }
 #endif
@@ -4894,6 +5258,10 @@ var2fpos(
     {
 	if (dollar_lnum)
 	{
+#ifdef FEAT_TERMINAL
+	    // A terminal may not have added the scrolled lines yet.
+	    term_add_pending_lines(curbuf);
+#endif
 	    pos.lnum = curbuf->b_ml.ml_line_count;
 	    pos.col = 0;
 	}
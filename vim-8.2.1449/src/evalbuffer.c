@@ -554,6 +554,9 @@ get_buffer_info(buf_T *buf)
     dict_add_string(dict, "name", buf->b_ffname);
     dict_add_number(dict, "lnum", buf == curbuf ? curwin->w_cursor.lnum
 						     : buflist_findlnum(buf));
+#ifdef FEAT_TERMINAL
+    term_add_pending_lines(buf);
+#endif
     dict_add_number(dict, "linecount", buf->b_ml.ml_line_count);
     dict_add_number(dict, "loaded", buf->b_ml.ml_mfp != NULL);
     dict_add_number(dict, "listed", buf->b_p_bl);
@@ -750,6 +753,11 @@ f_getbufline(typval_T *argvars, typval_T *rettv)
     ++emsg_off;
     buf = tv_get_buf(&argvars[0], FALSE);
     --emsg_off;
+#ifdef FEAT_TERMINAL
+    // A terminal may not have added the scrolled lines yet.
+    if (buf != NULL)
+	term_add_pending_lines(buf);
+#endif
 
     lnum = tv_get_lnum_buf(&argvars[1], buf);
     if (argvars[2].v_type == VAR_UNKNOWN)
@@ -776,6 +784,10 @@ f_getline(typval_T *argvars, typval_T *rettv)
     linenr_T	end;
     int		retlist;
 
+#ifdef FEAT_TERMINAL
+    // A terminal may not have added the scrolled lines yet.
+    term_add_pending_lines(curbuf);
+#endif
     lnum = tv_get_lnum(argvars);
     if (argvars[1].v_type == VAR_UNKNOWN)
     {
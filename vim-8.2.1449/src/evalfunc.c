@@ -628,6 +628,7 @@ static funcentry_T global_functions[] =
     {"funcref",		1, 3, FEARG_1,	  ret_func_any, f_funcref},
     {"function",	1, 3, FEARG_1,	  ret_f_function, f_function},
     {"garbagecollect",	0, 1, 0,	  ret_void,	f_garbagecollect},
+    {"gcstats",		0, 0, 0,	  ret_dict_any,	f_gcstats},
     {"get",		2, 3, FEARG_1,	  ret_any,	f_get},
     {"getbufinfo",	0, 1, FEARG_1,	  ret_list_dict_any, f_getbufinfo},
     {"getbufline",	2, 3, FEARG_1,	  ret_list_string, f_getbufline},
@@ -844,6 +845,7 @@ static funcentry_T global_functions[] =
     {"readdir",		1, 3, FEARG_1,	  ret_list_string, f_readdir},
     {"readdirex",	1, 3, FEARG_1,	  ret_list_dict_any, f_readdirex},
     {"readfile",	1, 3, FEARG_1,	  ret_any,	f_readfile},
+    {"redrawstats",	0, 0, 0,	  ret_dict_number, f_redrawstats},
     {"reduce",		2, 3, FEARG_1,	  ret_any,	f_reduce},
     {"reg_executing",	0, 0, 0,	  ret_string,	f_reg_executing},
     {"reg_recording",	0, 0, 0,	  ret_string,	f_reg_recording},
@@ -997,6 +999,7 @@ static funcentry_T global_functions[] =
     {"term_getline",	2, 2, FEARG_1,	  ret_string,	TERM_FUNC(f_term_getline)},
     {"term_getscrolled", 1, 1, FEARG_1,	  ret_number,	TERM_FUNC(f_term_getscrolled)},
     {"term_getsize",	1, 1, FEARG_1,	  ret_list_number, TERM_FUNC(f_term_getsize)},
+    {"term_getstats",	1, 1, FEARG_1,	  ret_dict_number, TERM_FUNC(f_term_getstats)},
     {"term_getstatus",	1, 1, FEARG_1,	  ret_string,	TERM_FUNC(f_term_getstatus)},
     {"term_gettitle",	1, 1, FEARG_1,	  ret_string,	TERM_FUNC(f_term_gettitle)},
     {"term_gettty",	1, 2, FEARG_1,	  ret_string,	TERM_FUNC(f_term_gettty)},
@@ -1022,6 +1025,7 @@ static funcentry_T global_functions[] =
     {"test_feedinput",	1, 1, FEARG_1,	  ret_void,	f_test_feedinput},
     {"test_garbagecollect_now",	0, 0, 0,  ret_void,	f_test_garbagecollect_now},
     {"test_garbagecollect_soon", 0, 0, 0, ret_void,	f_test_garbagecollect_soon},
+    {"test_garbagecollect_step", 0, 0, 0, ret_number,	f_test_garbagecollect_step},
     {"test_getvalue",	1, 1, FEARG_1,	  ret_number,	f_test_getvalue},
     {"test_ignore_error", 1, 1, FEARG_1,  ret_void,	f_test_ignore_error},
     {"test_null_blob",	0, 0, 0,	  ret_blob,	f_test_null_blob},
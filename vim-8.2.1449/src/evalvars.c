@@ -37,7 +37,7 @@ static hashtab_T	compat_hashtab;
 #define VV_RO		2	// read-only
 #define VV_RO_SBX	4	// read-only in the sandbox
 
-#define VV_NAME(s, t)	s, {{t, 0, {0}}, 0, {0}}
+#define VV_NAME(s, t)	s, {{t, 0, {0}}, 0, 0, 0, {0}}
 
 typedef struct vimvar vimvar_T;
 
@@ -310,6 +310,21 @@ garbage_collect_scriptvars(int copyID)
     return abort;
 }
 
+/*
+ * Mark the global, v: and script-local variables for an incremental garbage
+ * collection.
+ */
+    void
+gc_mark_vars(void)
+{
+    int		i;
+
+    gc_mark_ht(&globvarht);
+    gc_mark_ht(&vimvarht);
+    for (i = 1; i <= script_items.ga_len; ++i)
+	gc_mark_ht(&SCRIPT_VARS(i));
+}
+
 /*
  * Set an internal variable to a string value. Creates the variable if it does
  * not already exist.
@@ -2589,6 +2604,10 @@ lookup_scriptvar(char_u *name, size_t len, cctx_T *dummy UNUSED)
 
     if (ht == NULL)
 	return NULL;
+    hi = hash_find_len(ht, name, (int)len);
+    if (!HASHITEM_EMPTY(hi))
+	return IObuff;
+
     if (len < sizeof(buffer) - 1)
     {
 	// avoid an alloc/free for short names
@@ -2602,12 +2621,8 @@ lookup_scriptvar(char_u *name, size_t len, cctx_T *dummy UNUSED)
 	    return NULL;
     }
 
-    hi = hash_find(ht, p);
-    res = HASHITEM_EMPTY(hi) ? NULL : hi;
-
     // if not script-local, then perhaps imported
-    if (res == NULL && find_imported(p, 0, NULL) != NULL)
-	res = p;
+    res = find_imported(p, 0, NULL) != NULL ? p : NULL;
 
     if (p != buffer)
 	vim_free(p);
@@ -3069,10 +3084,62 @@ set_var_const(
 	init_tv(tv);
     }
 
+    GC_STORED_TV(&di->di_tv);
+
     if (flags & LET_IS_CONST)
 	di->di_tv.v_lock |= VAR_LOCKED;
 }
 
+/*
+ * Append "tv" to the String value of variable "name" in place, for
+ * ":let var ..= expr".  The length and allocated size of the String are kept
+ * in the dictitem, thus appending many times takes linear time.
+ * Does the same checks as set_var_const() for an existing variable.
+ * Returns OK when appended, FAIL when an error was given and NOTDONE when
+ * the caller has to concatenate and use set_var().
+ */
+    int
+append_var_string(char_u *name, typval_T *tv)
+{
+    dictitem_T	*di;
+    char_u	*varname;
+    hashtab_T	*ht;
+    char_u	numbuf[NUMBUFLEN];
+    char_u	*s;
+
+    if (tv->v_type != VAR_STRING && tv->v_type != VAR_NUMBER)
+	return NOTDONE;
+    ht = find_var_ht(name, &varname);
+    if (ht == NULL || *varname == NUL || ht == &vimvarht
+		       || (ht == get_script_local_ht() && in_vim9script()))
+	return NOTDONE;
+    di = find_var_in_ht(ht, 0, varname, TRUE);
+    if (di == NULL)
+	di = find_var_in_scoped_ht(name, TRUE);
+    if (di == NULL || (di->di_flags & DI_FLAGS_RELOAD)
+	    || di->di_tv.v_type != VAR_STRING
+	    || di->di_tv.vval.v_string == NULL)
+	return NOTDONE;
+
+    if (var_check_ro(di->di_flags, name, FALSE)
+			       || var_check_lock(di->di_tv.v_lock, name, FALSE))
+	return FAIL;
+
+    if ((di->di_tv.v_lock & VAR_APPENDED) == 0)
+    {
+	// Not appended to before, the allocated size is unknown.
+	di->di_str_len = STRLEN(di->di_tv.vval.v_string);
+	di->di_str_size = di->di_str_len + 1;
+    }
+    s = append_str(di->di_tv.vval.v_string, &di->di_str_len,
+			&di->di_str_size, tv_get_string_buf(tv, numbuf), TRUE);
+    if (s == NULL)
+	return FAIL;
+    di->di_tv.vval.v_string = s;
+    di->di_tv.v_lock |= VAR_APPENDED;
+    return OK;
+}
+
 /*
  * Return TRUE if di_flags "flags" indicates variable "name" is read-only.
  * Also give an error message.
@@ -277,6 +277,10 @@ linelen(int *has_tab)
 static char_u	*sortbuf1;
 static char_u	*sortbuf2;
 
+// When not NULL: the text to sort on for all lines, each one NUL terminated.
+// "start_col_nr" is then the offset of the text of a line.
+static char_u	*sort_keys;
+
 static int	sort_ic;	// ignore case
 static int	sort_nr;	// sort on number
 static int	sort_rx;	// sort on regex instead of skipping it
@@ -338,6 +342,12 @@ sort_compare(const void *s1, const void *s2)
 	result = l1.st_u.value_flt == l2.st_u.value_flt ? 0
 			     : l1.st_u.value_flt > l2.st_u.value_flt ? 1 : -1;
 #endif
+    else if (sort_keys != NULL)
+    {
+	// With 'i' the keys were already folded to lower case.
+	result = STRCMP(sort_keys + l1.st_u.line.start_col_nr,
+					sort_keys + l2.st_u.line.start_col_nr);
+    }
     else
     {
 	// We need to copy one line into "sortbuf1", because there is no
@@ -360,6 +370,83 @@ sort_compare(const void *s1, const void *s2)
     return result;
 }
 
+/*
+ * Copy the text to sort on for each line into one block of memory, so that
+ * comparing lines doesn't need to get them from the memline every time.
+ * For 'i' the text is folded to lower case here.
+ * When out of memory "sort_keys" remains NULL and sort_compare() gets the
+ * lines from the buffer.
+ */
+    static void
+sort_make_keys(sorti_T *nrs, size_t count)
+{
+    size_t	total = 0;
+    size_t	i;
+    char_u	*p;
+    char_u	*s;
+    colnr_T	len;
+
+    for (i = 0; i < count; ++i)
+	total += nrs[i].st_u.line.end_col_nr - nrs[i].st_u.line.start_col_nr
+									   + 1;
+    sort_keys = alloc(total);
+    if (sort_keys == NULL)
+	return;
+
+    p = sort_keys;
+    for (i = 0; i < count; ++i)
+    {
+	s = ml_get(nrs[i].lnum) + nrs[i].st_u.line.start_col_nr;
+	len = (colnr_T)(nrs[i].st_u.line.end_col_nr
+					     - nrs[i].st_u.line.start_col_nr);
+	vim_strncpy(p, s, len);
+	if (sort_ic)
+	    for (s = p; *s != NUL; ++s)
+		*s = TOLOWER_LOC(*s);
+	nrs[i].st_u.line.start_col_nr = p - sort_keys;
+	p += len + 1;
+    }
+}
+
+/*
+ * Sort "nrs[count]" on the numbers of the lines, in linear time.  Lines
+ * without a number go first.  Lines with the same number keep their order,
+ * like with sort_compare().
+ * Returns FAIL when out of memory.
+ */
+    static int
+sort_numbers(sorti_T *nrs, size_t count)
+{
+    sorti_T	*tmp;
+    size_t	no_number = 0;
+    size_t	i;
+    size_t	nr_idx;
+
+    for (i = 0; i < count; ++i)
+	if (!nrs[i].st_u.num.is_number)
+	    ++no_number;
+    if (no_number > 0 && no_number < count)
+    {
+	// Move the lines without a number to the start, keeping the order.
+	tmp = ALLOC_MULT(sorti_T, count);
+	if (tmp == NULL)
+	    return FAIL;
+	nr_idx = no_number;
+	no_number = 0;
+	for (i = 0; i < count; ++i)
+	    if (nrs[i].st_u.num.is_number)
+		tmp[nr_idx++] = nrs[i];
+	    else
+		tmp[no_number++] = nrs[i];
+	mch_memmove(nrs, tmp, count * sizeof(sorti_T));
+	vim_free(tmp);
+    }
+    if (no_number == count)
+	return OK;
+    return radix_sort_nr(nrs + no_number, count - no_number, sizeof(sorti_T),
+					   offsetof(sorti_T, st_u.num.value));
+}
+
 /*
  * ":sort".
  */
@@ -393,6 +480,7 @@ ex_sort(exarg_T *eap)
 	return;
     sortbuf1 = NULL;
     sortbuf2 = NULL;
+    sort_keys = NULL;
     regmatch.regprog = NULL;
     nrs = ALLOC_MULT(sorti_T, count);
     if (nrs == NULL)
@@ -597,7 +685,19 @@ ex_sort(exarg_T *eap)
 	goto sortend;
 
     // Sort the array of line numbers.  Note: can't be interrupted!
-    qsort((void *)nrs, count, sizeof(sorti_T), sort_compare);
+    if (sort_nr)
+    {
+	if (sort_numbers(nrs, count) == FAIL)
+	    qsort((void *)nrs, count, sizeof(sorti_T), sort_compare);
+    }
+    else
+    {
+#ifdef FEAT_FLOAT
+	if (!sort_flt)
+#endif
+	    sort_make_keys(nrs, count);
+	qsort((void *)nrs, count, sizeof(sorti_T), sort_compare);
+    }
 
     if (sort_abort)
 	goto sortend;
@@ -655,6 +755,7 @@ sortend:
     vim_free(nrs);
     vim_free(sortbuf1);
     vim_free(sortbuf2);
+    VIM_CLEAR(sort_keys);
     vim_regfree(regmatch.regprog);
     if (got_int)
 	emsg(_(e_interr));
@@ -1132,6 +1132,15 @@
 # undef FEAT_JOB_CHANNEL
 #endif
 
+/*
+ * The "shm" transport for job channels needs memfd_create() and the atomic
+ * builtins of GCC and clang.
+ */
+#if defined(FEAT_JOB_CHANNEL) && defined(HAVE_MEMFD_CREATE) \
+	&& defined(__ATOMIC_SEQ_CST)
+# define FEAT_CHANNEL_SHM
+#endif
+
 /*
  * +terminal		":terminal" command.  Runs a terminal in a window.
  *			requires +channel
@@ -1557,8 +1557,10 @@ before_blocking(void)
 {
     updatescript(0);
 #ifdef FEAT_EVAL
+    // Start garbage collection, the following steps are done while waiting,
+    // see inchar_loop().
     if (may_garbage_collect)
-	garbage_collect(FALSE);
+	(void)garbage_collect_step(FALSE);
 #endif
 }
 
@@ -383,6 +383,13 @@ EXTERN int	may_garbage_collect INIT(= FALSE);
 EXTERN int	want_garbage_collect INIT(= FALSE);
 EXTERN int	garbage_collect_at_exit INIT(= FALSE);
 
+/*
+ * "gc_mark_copyID" is the copyID used by an incremental garbage collection
+ * while it is marking Lists and Dictionaries, zero otherwise.  See
+ * garbage_collect_step().
+ */
+EXTERN int	gc_mark_copyID INIT(= 0);
+
 // Script CTX being sourced or was sourced to define the current function.
 EXTERN sctx_T	current_sctx INIT4(0, 0, 0, 0);
 
@@ -1333,6 +1340,15 @@ EXTERN int	fill_vert INIT(= ' ');
 EXTERN int	fill_fold INIT(= '-');
 EXTERN int	fill_diff INIT(= '-');
 
+// Incremented when the number of cells a character occupies may have
+// changed, e.g. by 'isprint' or 'ambiwidth'.  Used to invalidate cached
+// virtual columns.
+EXTERN int	cellwidth_tick INIT(= 0);
+
+// Incremented when an option that changes how text is displayed was set,
+// including the 'vartabstop' array.  Used to invalidate cached line widths.
+EXTERN int	display_opt_tick INIT(= 0);
+
 #ifdef FEAT_FOLDING
 EXTERN int	disable_fold_update INIT(= 0);
 #endif
@@ -39,6 +39,15 @@ static long hash_count_perturb = 0;	// count number of "misses"
 // Magic value for algorithm that walks through the array.
 #define PERTURB_SHIFT 5
 
+// Used for "ht_changed".  Every change of any hashtable gets a new number,
+// thus the same value is never used for two different tables, also not when
+// a table is freed and another one is allocated in the same place.  This
+// allows for caching a found item, see find_var_cached().
+static unsigned hash_changed_count = 0;
+
+#define HASH_CHANGED(ht) (ht)->ht_changed = (int)++hash_changed_count
+
+static hashitem_T *hash_lookup_len(hashtab_T *ht, char_u *key, int len, hash_T hash);
 static int hash_may_resize(hashtab_T *ht, int minitems);
 
 #if 0 // currently not used
@@ -68,6 +77,7 @@ hash_init(hashtab_T *ht)
     CLEAR_POINTER(ht);
     ht->ht_array = ht->ht_smallarray;
     ht->ht_mask = HT_INIT_SIZE - 1;
+    HASH_CHANGED(ht);
 }
 
 /*
@@ -79,6 +89,7 @@ hash_clear(hashtab_T *ht)
 {
     if (ht->ht_array != ht->ht_smallarray)
 	vim_free(ht->ht_array);
+    HASH_CHANGED(ht);
 }
 
 #if defined(FEAT_SPELL) || defined(PROTO)
@@ -120,11 +131,44 @@ hash_find(hashtab_T *ht, char_u *key)
     return hash_lookup(ht, key, hash_hash(key));
 }
 
+/*
+ * Like hash_find(), but "key" is "len" bytes and does not need to be NUL
+ * terminated.  Avoids the caller making a copy of the key.
+ * Unlike hash_find() the returned empty item must not be used for adding.
+ */
+    hashitem_T *
+hash_find_len(hashtab_T *ht, char_u *key, int len)
+{
+    return hash_lookup_len(ht, key, len, hash_hash_len(key, len));
+}
+
 /*
  * Like hash_find(), but caller computes "hash".
  */
     hashitem_T *
 hash_lookup(hashtab_T *ht, char_u *key, hash_T hash)
+{
+    return hash_lookup_len(ht, key, -1, hash);
+}
+
+/*
+ * Return TRUE if item "hi" has "key".  When "len" is negative "key" is NUL
+ * terminated, otherwise it is "len" bytes long.
+ * The cached hash is compared first, it avoids nearly all string compares
+ * for items that don't match.
+ */
+#define HI_KEY_MATCHES(hi, key, len, hash) \
+	((hi)->hi_hash == (hash) \
+	    && ((len) < 0 ? STRCMP((hi)->hi_key, (key)) == 0 \
+		: (STRNCMP((hi)->hi_key, (key), (len)) == 0 \
+					    && (hi)->hi_key[len] == NUL)))
+
+/*
+ * Like hash_lookup(), but "key" is "len" bytes long when "len" is not
+ * negative.
+ */
+    static hashitem_T *
+hash_lookup_len(hashtab_T *ht, char_u *key, int len, hash_T hash)
 {
     hash_T	perturb;
     hashitem_T	*freeitem;
@@ -148,7 +192,7 @@ hash_lookup(hashtab_T *ht, char_u *key, hash_T hash)
 	return hi;
     if (hi->hi_key == HI_KEY_REMOVED)
 	freeitem = hi;
-    else if (hi->hi_hash == hash && STRCMP(hi->hi_key, key) == 0)
+    else if (HI_KEY_MATCHES(hi, key, len, hash))
 	return hi;
     else
 	freeitem = NULL;
@@ -171,9 +215,7 @@ hash_lookup(hashtab_T *ht, char_u *key, hash_T hash)
 	hi = &ht->ht_array[idx & ht->ht_mask];
 	if (hi->hi_key == NULL)
 	    return freeitem == NULL ? hi : freeitem;
-	if (hi->hi_hash == hash
-		&& hi->hi_key != HI_KEY_REMOVED
-		&& STRCMP(hi->hi_key, key) == 0)
+	if (hi->hi_key != HI_KEY_REMOVED && HI_KEY_MATCHES(hi, key, len, hash))
 	    return hi;
 	if (hi->hi_key == HI_KEY_REMOVED && freeitem == NULL)
 	    freeitem = hi;
@@ -236,7 +278,7 @@ hash_add_item(
 	return FAIL;
 
     ++ht->ht_used;
-    ++ht->ht_changed;
+    HASH_CHANGED(ht);
     if (hi->hi_key == NULL)
 	++ht->ht_filled;
     hi->hi_key = key;
@@ -272,7 +314,7 @@ hash_set(hashitem_T *hi, char_u *key)
 hash_remove(hashtab_T *ht, hashitem_T *hi)
 {
     --ht->ht_used;
-    ++ht->ht_changed;
+    HASH_CHANGED(ht);
     hi->hi_key = HI_KEY_REMOVED;
     hash_may_resize(ht, 0);
 }
@@ -450,7 +492,7 @@ hash_may_resize(
     ht->ht_array = newarray;
     ht->ht_mask = newmask;
     ht->ht_filled = ht->ht_used;
-    ++ht->ht_changed;
+    HASH_CHANGED(ht);
     ht->ht_error = FALSE;
 
     return OK;
@@ -462,21 +504,56 @@ hash_may_resize(
  * run a script that uses hashtables a lot.  Vim will then print statistics
  * when exiting.  Try that with the current hash algorithm and yours.  The
  * lower the percentage the better.
+ * Note that the order in which items of a Dictionary are listed depends on
+ * the hash, scripts and tests may rely on it.
  */
     hash_T
 hash_hash(char_u *key)
+{
+    return hash_hash_len(key, -1);
+}
+
+/*
+ * Like hash_hash(), but "key" is "len" bytes long when "len" is not negative.
+ */
+    hash_T
+hash_hash_len(char_u *key, int len)
 {
     hash_T	hash;
     char_u	*p;
+    char_u	*end;
 
-    if ((hash = *key) == 0)
+    if (len == 0 || (hash = *key) == 0)
 	return (hash_T)0;
     p = key + 1;
 
     // A simplistic algorithm that appears to do very well.
     // Suggested by George Reilly.
-    while (*p != NUL)
-	hash = hash * 101 + *p++;
+    // "hash = hash * 101 + *p++" is done for four bytes at a time, this gives
+    // the same result but the multiplications can be done in parallel.
+    if (len < 0)
+    {
+	while (p[0] != NUL && p[1] != NUL && p[2] != NUL && p[3] != NUL)
+	{
+	    hash = hash * 104060401 + p[0] * 1030301 + p[1] * 10201
+							   + p[2] * 101 + p[3];
+	    p += 4;
+	}
+	while (*p != NUL)
+	    hash = hash * 101 + *p++;
+    }
+    else
+    {
+	end = key + len;
+	while (end - p >= 4)
+	{
+	    hash = hash * 104060401 + p[0] * 1030301 + p[1] * 10201
+							   + p[2] * 101 + p[3];
+	    p += 4;
+	}
+	while (p < end)
+	    hash = hash * 101 + *p++;
+    }
 
     return hash;
 }
@@ -954,6 +954,7 @@ luaV_list_newindex(lua_State *L)
 	    luaV_checktypval(L, 3, &v, "setting list item");
 	    clear_tv(&li->li_tv);
 	    li->li_tv = v;
+	    GC_STORED_TV(&li->li_tv);
         }
     }
     return 0;
@@ -1144,7 +1145,10 @@ luaV_dict_newindex(lua_State *L)
 	dictitem_free(di);
     }
     else
+    {
 	di->di_tv = tv;
+	GC_STORED_TV(&di->di_tv);
+    }
     return 0;
 }
 
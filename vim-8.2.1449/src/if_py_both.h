@@ -1922,6 +1922,7 @@ DictionaryAssItem(
     Py_XDECREF(todecref);
 
     copy_tv(&tv, &di->di_tv);
+    GC_STORED_TV(&di->di_tv);
     clear_tv(&tv);
     return 0;
 }
@@ -2730,6 +2731,7 @@ ListAssIndex(ListObject *self, Py_ssize_t index, PyObject *obj)
 	}
 	clear_tv(&li->li_tv);
 	copy_tv(&tv, &li->li_tv);
+	GC_STORED_TV(&li->li_tv);
 	clear_tv(&tv);
     }
     return 0;
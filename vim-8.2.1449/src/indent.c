@@ -26,6 +26,9 @@ tabstop_set(char_u *var, int **array)
     int t;
     char_u *cp;
 
+    // cached line widths depend on 'vartabstop'
+    ++display_opt_tick;
+
     if (var[0] == NUL || (var[0] == '0' && var[1] == NUL))
     {
 	*array = NULL;
@@ -30,7 +30,7 @@ static char e_json_error[] = N_("E491: json decode error at '%s'");
     static int
 json_encode_gap(garray_T *gap, typval_T *val, int options)
 {
-    if (json_encode_item(gap, val, get_copyID(), options) == FAIL)
+    if (json_encode_item(gap, val, get_copyID_restore(), options) == FAIL)
     {
 	ga_clear(gap);
 	gap->ga_data = vim_strsave((char_u *)"");
@@ -60,34 +60,79 @@ json_encode(typval_T *val, int options)
 #if defined(FEAT_JOB_CHANNEL) || defined(PROTO)
 /*
  * Encode ["nr", "val"] into a JSON format string in allocated memory.
- * "options" can contain JSON_JS, JSON_NO_NONE and JSON_NL.
+ * "options" can contain JSON_JS and JSON_NL, see json_encode_nr_expr_ga().
  * Returns NULL when out of memory.
  */
     char_u *
 json_encode_nr_expr(int nr, typval_T *val, int options)
 {
-    typval_T	listtv;
-    typval_T	nrtv;
     garray_T	ga;
 
-    nrtv.v_type = VAR_NUMBER;
-    nrtv.vval.v_number = nr;
-    if (rettv_list_alloc(&listtv) == FAIL)
-	return NULL;
-    if (list_append_tv(listtv.vval.v_list, &nrtv) == FAIL
-	    || list_append_tv(listtv.vval.v_list, val) == FAIL)
-    {
-	list_unref(listtv.vval.v_list);
-	return NULL;
-    }
-
     ga_init2(&ga, 1, 4000);
-    if (json_encode_gap(&ga, &listtv, options) == OK && (options & JSON_NL))
-	ga_append(&ga, '\n');
-    list_unref(listtv.vval.v_list);
+    if (json_encode_nr_expr_ga(&ga, nr, val, options) == FAIL)
+	ga_clear(&ga);
     ga_append(&ga, NUL);
     return ga.ga_data;
 }
+
+/*
+ * Encode ["nr", "val"] and append it to "gap", without a terminating NUL.
+ * This avoids building a List and copying the text when the caller can use
+ * the growarray directly, e.g. to put it in a channel write queue.
+ * "options" can contain JSON_JS and JSON_NL.  "val" is encoded like an item of
+ * a List, thus JSON_NO_NONE does not apply: with JSON_JS v:none is an empty
+ * item.
+ * Returns FAIL when encoding fails.
+ */
+    int
+json_encode_nr_expr_ga(garray_T *gap, int nr, typval_T *val, int options)
+{
+    char_u	numbuf[NUMBUFLEN];
+
+    // Same as encoding a List with two items.
+    vim_snprintf((char *)numbuf, NUMBUFLEN, "[%d,", nr);
+    ga_concat(gap, numbuf);
+    if (json_encode_item(gap, val, get_copyID_restore(), options & JSON_JS) == FAIL)
+	return FAIL;
+    if ((options & JSON_JS) && val->v_type == VAR_SPECIAL
+					  && val->vval.v_number == VVAL_NONE)
+	// add an extra comma if the last item is v:none
+	ga_append(gap, ',');
+    ga_append(gap, ']');
+    if (options & JSON_NL)
+	ga_append(gap, '\n');
+    return OK;
+}
+
+/*
+ * Encode "val" as a Language Server Protocol message and append it to "gap":
+ * a header with the Content-Length, an empty line and the JSON.
+ * Returns FAIL when encoding fails.
+ */
+    int
+json_encode_lsp_msg_ga(garray_T *gap, typval_T *val)
+{
+    char_u	hdr[50];
+    int		hdrlen;
+    int		start = gap->ga_len;
+    int		len;
+
+    if (json_encode_item(gap, val, get_copyID_restore(), 0) == FAIL)
+	return FAIL;
+
+    // The length is only known after encoding, insert the header before
+    // the JSON.
+    len = gap->ga_len - start;
+    hdrlen = vim_snprintf((char *)hdr, sizeof(hdr),
+					    "Content-Length: %d\r\n\r\n", len);
+    if (ga_grow(gap, hdrlen) == FAIL)
+	return FAIL;
+    mch_memmove((char_u *)gap->ga_data + start + hdrlen,
+				      (char_u *)gap->ga_data + start, len);
+    mch_memmove((char_u *)gap->ga_data + start, hdr, hdrlen);
+    gap->ga_len += hdrlen;
+    return OK;
+}
 #endif
 
     static void
@@ -118,7 +163,26 @@ write_string(garray_T *gap, char_u *str)
 	ga_append(gap, '"');
 	while (*res != NUL)
 	{
-	    int c;
+	    int		c;
+	    char_u	*p;
+
+	    // Copy a run of printable ASCII characters that don't need
+	    // escaping at once.
+	    for (p = res; *p >= 0x20 && *p < 0x80 && *p != '"' && *p != '\\';
+									  ++p)
+		;
+	    if (p > res)
+	    {
+		if (ga_grow(gap, (int)(p - res)) == OK)
+		{
+		    mch_memmove((char *)gap->ga_data + gap->ga_len, res,
+							     (size_t)(p - res));
+		    gap->ga_len += (int)(p - res);
+		}
+		res = p;
+		continue;
+	    }
+
 	    // always use utf-8 encoding, ignore 'encoding'
 	    c = utf_ptr2char(res);
 
@@ -264,6 +328,8 @@ json_encode_item(garray_T *gap, typval_T *val, int copyID, int options)
 		else
 		{
 		    listitem_T	*li;
+		    int		old_copyID = l->lv_copyID;
+		    int		ret = OK;
 
 		    l->lv_copyID = copyID;
 		    ga_append(gap, '[');
@@ -272,7 +338,10 @@ json_encode_item(garray_T *gap, typval_T *val, int copyID, int options)
 		    {
 			if (json_encode_item(gap, &li->li_tv, copyID,
 						   options & JSON_JS) == FAIL)
-			    return FAIL;
+			{
+			    ret = FAIL;
+			    break;
+			}
 			if ((options & JSON_JS)
 				&& li->li_next == NULL
 				&& li->li_tv.v_type == VAR_SPECIAL
@@ -284,7 +353,11 @@ json_encode_item(garray_T *gap, typval_T *val, int copyID, int options)
 			    ga_append(gap, ',');
 		    }
 		    ga_append(gap, ']');
-		    l->lv_copyID = 0;
+		    // Restore the copyID, an incremental garbage collection
+		    // may be using it.
+		    l->lv_copyID = old_copyID;
+		    if (ret == FAIL)
+			return FAIL;
 		}
 	    }
 	    break;
@@ -302,6 +375,8 @@ json_encode_item(garray_T *gap, typval_T *val, int copyID, int options)
 		    int		first = TRUE;
 		    int		todo = (int)d->dv_hashtab.ht_used;
 		    hashitem_T	*hi;
+		    int		old_copyID = d->dv_copyID;
+		    int		ret = OK;
 
 		    d->dv_copyID = copyID;
 		    ga_append(gap, '{');
@@ -323,10 +398,15 @@ json_encode_item(garray_T *gap, typval_T *val, int copyID, int options)
 			    ga_append(gap, ':');
 			    if (json_encode_item(gap, &dict_lookup(hi)->di_tv,
 				      copyID, options | JSON_NO_NONE) == FAIL)
-				return FAIL;
+			    {
+				ret = FAIL;
+				break;
+			    }
 			}
 		    ga_append(gap, '}');
-		    d->dv_copyID = 0;
+		    d->dv_copyID = old_copyID;
+		    if (ret == FAIL)
+			return FAIL;
 		}
 	    }
 	    break;
@@ -404,19 +484,56 @@ json_skip_white(js_read_T *reader)
     fill_numbuflen(reader);
 }
 
+/*
+ * Append the bytes from "from" up to "to" to "gap".
+ * Returns FAIL when out of memory, "gap" is then cleared.
+ */
+    static int
+json_append_bytes(garray_T *gap, char_u *from, char_u *to)
+{
+    if (ga_grow(gap, (int)(to - from)) == FAIL)
+    {
+	ga_clear(gap);
+	return FAIL;
+    }
+    mch_memmove((char *)gap->ga_data + gap->ga_len, from, (size_t)(to - from));
+    gap->ga_len += (int)(to - from);
+    return OK;
+}
+
     static int
 json_decode_string(js_read_T *reader, typval_T *res, int quote)
 {
     garray_T    ga;
     int		len;
     char_u	*p;
+    char_u	*s;
     int		c;
     varnumber_T	nr;
+    char_u	*str = NULL;
 
-    if (res != NULL)
+    p = reader->js_buf + reader->js_used + 1; // skip over " or '
+
+    // Most strings only contain ASCII characters without a backslash.  When
+    // such a string is complete it can be copied at once.
+    for (s = p; *p != quote && *p != '\\' && *p != NUL && *p < 0x80; ++p)
+	;
+    if (*p == quote)
+    {
+	if (res != NULL)
+	{
+	    str = vim_strnsave(s, p - s);
+	    if (str == NULL)
+		return FAIL;
+	}
+    }
+    else if (res != NULL)
+    {
 	ga_init2(&ga, 1, 200);
+	if (json_append_bytes(&ga, s, p) == FAIL)
+	    return FAIL;
+    }
 
-    p = reader->js_buf + reader->js_used + 1; // skip over " or '
     while (*p != quote)
     {
 	// The JSON is always expected to be utf-8, thus use utf functions
@@ -516,18 +633,15 @@ json_decode_string(js_read_T *reader, typval_T *res, int quote)
 	}
 	else
 	{
-	    len = utf_ptr2len(p);
-	    if (res != NULL)
-	    {
-		if (ga_grow(&ga, len) == FAIL)
-		{
-		    ga_clear(&ga);
-		    return FAIL;
-		}
-		mch_memmove((char *)ga.ga_data + ga.ga_len, p, (size_t)len);
-		ga.ga_len += len;
-	    }
-	    p += len;
+	    // Copy a sequence of ASCII characters or one multi-byte character.
+	    s = p;
+	    if (*p < 0x80)
+		while (*++p != quote && *p != '\\' && *p != NUL && *p < 0x80)
+		    ;
+	    else
+		p += utf_ptr2len(p);
+	    if (res != NULL && json_append_bytes(&ga, s, p) == FAIL)
+		return FAIL;
 	}
     }
 
@@ -537,7 +651,11 @@ json_decode_string(js_read_T *reader, typval_T *res, int quote)
 	++reader->js_used;
 	if (res != NULL)
 	{
-	    ga_append(&ga, NUL);
+	    if (str == NULL)
+	    {
+		ga_append(&ga, NUL);
+		str = ga.ga_data;
+	    }
 	    res->v_type = VAR_STRING;
 #if defined(USE_ICONV)
 	    if (!enc_utf8)
@@ -549,15 +667,14 @@ json_decode_string(js_read_T *reader, typval_T *res, int quote)
 		convert_setup(&conv, (char_u*)"utf-8", p_enc);
 		if (conv.vc_type != CONV_NONE)
 		{
-		    res->vval.v_string =
-				      string_convert(&conv, ga.ga_data, NULL);
-		    vim_free(ga.ga_data);
+		    res->vval.v_string = string_convert(&conv, str, NULL);
+		    vim_free(str);
 		}
 		convert_setup(&conv, NULL, NULL);
 	    }
 	    else
 #endif
-		res->vval.v_string = ga.ga_data;
+		res->vval.v_string = str;
 	}
 	return OK;
     }
@@ -802,11 +919,23 @@ json_decode_item(js_read_T *reader, typval_T *res, int options)
 			else
 #endif
 			{
-			    varnumber_T nr;
+			    varnumber_T nr = 0;
 
-			    vim_str2nr(reader->js_buf + reader->js_used,
-				    NULL, &len, 0, // what
-				    &nr, NULL, 0, TRUE);
+			    if (sp - p <= 18)
+			    {
+				char_u *dp;
+
+				// Short decimal number, cannot overflow.
+				for (dp = *p == '-' ? p + 1 : p; dp < sp; ++dp)
+				    nr = nr * 10 + (*dp - '0');
+				if (*p == '-')
+				    nr = -nr;
+				len = (int)(sp - p);
+			    }
+			    else
+				vim_str2nr(reader->js_buf + reader->js_used,
+					NULL, &len, 0, // what
+					&nr, NULL, 0, TRUE);
 			    if (len == 0)
 			    {
 				semsg(_(e_json_error), p);
@@ -992,21 +1121,26 @@ item_end:
 		break;
 
 	    case JSON_OBJECT:
-		if (cur_item != NULL
-			&& dict_find(top_item->jd_tv.vval.v_dict,
-						 top_item->jd_key, -1) != NULL)
-		{
-		    semsg(_("E938: Duplicate key in JSON: \"%s\""),
-							     top_item->jd_key);
-		    clear_tv(cur_item);
-		    retval = FAIL;
-		    goto theend;
-		}
-
 		if (cur_item != NULL)
 		{
-		    dictitem_T *di = dictitem_alloc(top_item->jd_key);
+		    hashtab_T	*ht = &top_item->jd_tv.vval.v_dict->dv_hashtab;
+		    hash_T	hash = hash_hash(top_item->jd_key);
+		    hashitem_T	*hi;
+		    dictitem_T	*di;
 
+		    // Look up the key only once, for checking it is not a
+		    // duplicate and for adding it.
+		    hi = hash_lookup(ht, top_item->jd_key, hash);
+		    if (!HASHITEM_EMPTY(hi))
+		    {
+			semsg(_("E938: Duplicate key in JSON: \"%s\""),
+							     top_item->jd_key);
+			clear_tv(cur_item);
+			retval = FAIL;
+			goto theend;
+		    }
+
+		    di = dictitem_alloc(top_item->jd_key);
 		    clear_tv(&top_item->jd_key_tv);
 		    if (di == NULL)
 		    {
@@ -1016,7 +1150,7 @@ item_end:
 		    }
 		    di->di_tv = *cur_item;
 		    di->di_tv.v_lock = 0;
-		    if (dict_add(top_item->jd_tv.vval.v_dict, di) == FAIL)
+		    if (hash_add_item(ht, hi, di->di_key, hash) == FAIL)
 		    {
 			dictitem_free(di);
 			retval = FAIL;
@@ -1095,6 +1229,8 @@ json_decode_all(js_read_T *reader, typval_T *res, int options)
 #if defined(FEAT_JOB_CHANNEL) || defined(PROTO)
 /*
  * Decode the JSON from "reader" and store the result in "res".
+ * The caller must set "reader->js_end", there may be more messages after the
+ * first one and finding the end every time would be slow.
  * "options" can be JSON_JS or zero;
  * Return FAIL for a decoding error.
  * Return MAYBE for an incomplete message.
@@ -1105,8 +1241,6 @@ json_decode(js_read_T *reader, typval_T *res, int options)
 {
     int ret;
 
-    // We find the end once, to avoid calling strlen() many times.
-    reader->js_end = reader->js_buf + STRLEN(reader->js_buf);
     json_skip_white(reader);
     ret = json_decode_item(reader, res, options);
     json_skip_white(reader);
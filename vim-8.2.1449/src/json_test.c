@@ -189,15 +189,77 @@ test_fill_called_on_string(void)
     reader.js_cookie =	      " \"foobar\"  ";
     assert(json_decode_string(&reader, NULL, '"') == OK);
 }
+
+/*
+ * Test json_decode_string() result for an incomplete string with escapes,
+ * calling the fill function.
+ */
+    static void
+test_fill_called_on_string_value(void)
+{
+    js_read_T	reader;
+    typval_T	tv;
+
+    reader.js_fill = fill_from_cookie;
+    reader.js_used = 1;
+    reader.js_buf = (char_u *)" \"foo";
+    reader.js_end = reader.js_buf + STRLEN(reader.js_buf);
+    reader.js_cookie =	      " \"foo\\tbar\\u00e9x\"  ";
+    assert(json_decode_string(&reader, &tv, '"') == OK);
+    assert(tv.v_type == VAR_STRING);
+    assert(STRCMP(tv.vval.v_string, "foo\tbar\303\251x") == 0);
+    assert(reader.js_used == 18);
+    clear_tv(&tv);
+}
+
+/*
+ * Test json_decode_all() on strings and numbers.
+ */
+    static void
+test_decode_values(void)
+{
+    js_read_T	reader;
+    typval_T	tv;
+    list_T	*l;
+
+    reader.js_fill = NULL;
+    reader.js_used = 0;
+    reader.js_buf = (char_u *)"[\"plain\", \"a\\\"b\", \"\303\251t\303\251\", \"\","
+			   " 0, -12, 123456789012345678, 12345678901234567890123]";
+    assert(json_decode_all(&reader, &tv, 0) == OK);
+    assert(tv.v_type == VAR_LIST);
+    l = tv.vval.v_list;
+    assert(l->lv_len == 8);
+    assert(STRCMP(list_find(l, 0)->li_tv.vval.v_string, "plain") == 0);
+    assert(STRCMP(list_find(l, 1)->li_tv.vval.v_string, "a\"b") == 0);
+    assert(STRCMP(list_find(l, 2)->li_tv.vval.v_string,
+						   "\303\251t\303\251") == 0);
+    assert(STRCMP(list_find(l, 3)->li_tv.vval.v_string, "") == 0);
+    assert(list_find(l, 4)->li_tv.vval.v_number == 0);
+    assert(list_find(l, 5)->li_tv.vval.v_number == -12);
+    assert(list_find(l, 6)->li_tv.vval.v_number == 123456789012345678LL);
+    assert(list_find(l, 7)->li_tv.vval.v_number == VARNUM_MAX);
+    clear_tv(&tv);
+}
 #endif
 
     int
-main(void)
+main(int argc, char **argv)
 {
 #if defined(FEAT_EVAL)
+    mparm_T params;
+
+    CLEAR_FIELD(params);
+    params.argc = argc;
+    params.argv = argv;
+    common_init(&params);
+    set_option_value((char_u *)"encoding", 0, (char_u *)"utf-8", 0);
+
     test_decode_find_end();
     test_fill_called_on_find_end();
     test_fill_called_on_string();
+    test_fill_called_on_string_value();
+    test_decode_values();
 #endif
     return 0;
 }
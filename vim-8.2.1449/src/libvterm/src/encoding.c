@@ -223,6 +223,19 @@ encodings[] = {
   { 0, 0, NULL },
 };
 
+/* Return TRUE when "encoding" decodes printable ASCII bytes to the same
+ * codepoints in its current state.  For UTF-8 this is not so in the middle of
+ * a multibyte sequence.
+ */
+INTERNAL int vterm_encoding_passes_ascii(const VTermEncodingInstance *encoding)
+{
+  if(encoding->enc == &encoding_usascii)
+    return 1;
+  if(encoding->enc == &encoding_utf8)
+    return ((const struct UTF8DecoderData *)encoding->data)->bytes_remaining == 0;
+  return 0;
+}
+
 /* This ought to be INTERNAL but isn't because it's used by unit testing */
 VTermEncoding *vterm_lookup_encoding(VTermEncodingType type, char designation)
 {
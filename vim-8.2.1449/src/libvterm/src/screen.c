@@ -193,15 +193,26 @@ static int putglyph(VTermGlyphInfo *info, VTermPos pos, void *user)
     onecell->chars[0] = (uint32_t)-1;
   }
 
+  cell->pen.protected_cell = info->protected_cell;
+  cell->pen.dwl            = info->dwl;
+  cell->pen.dhl            = info->dhl;
+
+  /* Text usually continues the damaged part of the row, extend it here
+   * instead of calling damagerect() for every character */
+  if(screen->damage_merge == VTERM_DAMAGE_ROW &&
+      screen->damaged.start_row == pos.row &&
+      screen->damaged.start_col <= pos.col &&
+      screen->damaged.end_col >= pos.col) {
+    if(screen->damaged.end_col < pos.col + info->width)
+      screen->damaged.end_col = pos.col + info->width;
+    return 1;
+  }
+
   rect.start_row = pos.row;
   rect.end_row   = pos.row+1;
   rect.start_col = pos.col;
   rect.end_col   = pos.col+info->width;
 
-  cell->pen.protected_cell = info->protected_cell;
-  cell->pen.dwl            = info->dwl;
-  cell->pen.dhl            = info->dhl;
-
   damagerect(screen, rect);
 
   return 1;
@@ -3,6 +3,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
 #define strneq(a,b,n) (strncmp(a,b,n)==0)
 
 #if defined(DEBUG) && DEBUG > 1
@@ -11,6 +15,9 @@
 
 static int on_resize(int rows, int cols, void *user);
 
+/* Number of characters in a glyph that on_text() handles without allocating */
+#define GLYPH_CHARS_BUF 8
+
 /* Some convenient wrappers to make callback functions easier */
 
 static void putglyph(VTermState *state, const uint32_t chars[], int width, VTermPos pos)
@@ -273,6 +280,96 @@ static void set_lineinfo(VTermState *state, int row, int force, int dwl, int dhl
     state->lineinfo[row] = info;
 }
 
+/* Return the length of the run of printable ASCII characters at the start of
+ * "bytes", stops at a control character, DEL or a byte with the high bit set.
+ */
+static size_t printable_ascii_len(const char bytes[], size_t len)
+{
+  size_t n = 0;
+
+#ifdef __SSE2__
+  const __m128i space = _mm_set1_epi8(0x20);
+  const __m128i del = _mm_set1_epi8(0x7f);
+
+  for( ; n + 16 <= len; n += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(bytes + n));
+    // Signed compare: bytes with the high bit set are below 0x20 too
+    int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del)));
+
+    if(mask)
+      return n + __builtin_ctz(mask);
+  }
+#endif
+
+  for( ; n < len; n++) {
+    unsigned char c = bytes[n];
+
+    if(c < 0x20 || c >= 0x7f)
+      break;
+  }
+  return n;
+}
+
+/* Fast path for a run of printable ASCII characters with the US-ASCII or UTF-8
+ * set: these do not need decoding, are never combining and always have width one.
+ * Returns the number of bytes handled, zero when on_text() must do the work.
+ */
+static size_t on_text_ascii(VTermState *state, const char bytes[], size_t len)
+{
+  VTermPos oldpos = state->pos;
+  uint32_t chars[2];
+  size_t n;
+  size_t i;
+
+  if(state->gsingle_set || state->mode.insert ||
+      vterm_get_special_pty_type() == 2 ||
+      !vterm_encoding_passes_ascii(&state->encoding[state->gl_set]))
+    return 0;
+
+  n = printable_ascii_len(bytes, len);
+  // A following non-ASCII character may be combining, leave the last
+  // character to on_text() to put them in one glyph.
+  if(n > 0 && n < len && (bytes[n] & 0x80))
+    n--;
+  if(n == 0)
+    return 0;
+
+  chars[1] = 0;
+  for(i = 0; i < n; i++) {
+    chars[0] = (unsigned char)bytes[i];
+
+    if(state->at_phantom || state->pos.col + 1 > THISROWWIDTH(state)) {
+      linefeed(state);
+      state->pos.col = 0;
+      state->at_phantom = 0;
+      state->lineinfo[state->pos.row].continuation = 1;
+    }
+
+    putglyph(state, chars, 1, state->pos);
+
+    if(i == n - 1) {
+      /* A combining character may follow in the next call */
+      state->combine_chars[0] = chars[0];
+      state->combine_chars[1] = 0;
+      state->combine_width = 1;
+      state->combine_pos = state->pos;
+    }
+
+    if(state->pos.col + 1 >= THISROWWIDTH(state)) {
+      if(state->mode.autowrap)
+        state->at_phantom = 1;
+    }
+    else {
+      state->pos.col++;
+    }
+  }
+
+  updatecursor(state, &oldpos, 0);
+
+  return n;
+}
+
 static int on_text(const char bytes[], size_t len, void *user)
 {
   VTermState *state = user;
@@ -284,6 +381,10 @@ static int on_text(const char bytes[], size_t len, void *user)
 
   VTermPos oldpos = state->pos;
 
+  eaten = on_text_ascii(state, bytes, len);
+  if(eaten)
+    return (int)eaten;
+
   // We'll have at most len codepoints, plus one from a previous incomplete
   // sequence.
   codepoints = vterm_allocator_malloc(state->vt, (len + 1) * sizeof(uint32_t));
@@ -360,14 +461,20 @@ static int on_text(const char bytes[], size_t len, void *user)
     int glyph_ends;
     int width = 0;
     uint32_t *chars;
+    uint32_t chars_buf[GLYPH_CHARS_BUF + 1];
 
     for(glyph_ends = i + 1; glyph_ends < npoints; glyph_ends++)
       if(!vterm_unicode_is_combining(codepoints[glyph_ends]))
         break;
 
-    chars = vterm_allocator_malloc(state->vt, (glyph_ends - glyph_starts + 1) * sizeof(uint32_t));
-    if (chars == NULL)
-      break;
+    // Only a glyph with many combining characters needs allocating.
+    if(glyph_ends - glyph_starts < GLYPH_CHARS_BUF)
+      chars = chars_buf;
+    else {
+      chars = vterm_allocator_malloc(state->vt, (glyph_ends - glyph_starts + 1) * sizeof(uint32_t));
+      if (chars == NULL)
+        break;
+    }
 
     for( ; i < glyph_ends; i++) {
       int this_width;
@@ -442,7 +549,8 @@ static int on_text(const char bytes[], size_t len, void *user)
     else {
       state->pos.col += width;
     }
-    vterm_allocator_free(state->vt, chars);
+    if(chars != chars_buf)
+      vterm_allocator_free(state->vt, chars);
   }
 
   updatecursor(state, &oldpos, 0);
@@ -0,0 +1,155 @@
+/* Measures how fast output is processed by the parser, state and screen
+ * layers, in MB/s.  Usage:
+ *   t/benchmark [-d cell|row|screen|scroll] [megabytes]
+ * The -d argument selects the damage merge size, the default is "row", which
+ * is what Vim uses.
+ */
+#include "vterm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define streq(a,b) (!strcmp(a,b))
+
+#define ROWS 25
+#define COLS 80
+
+static int damage_count;
+static int pushline_count;
+
+static int cb_damage(VTermRect rect, void *user)
+{
+  (void)rect;
+  (void)user;
+  damage_count++;
+  return 1;
+}
+
+static int cb_sb_pushline(int cols, const VTermScreenCell *cells, void *user)
+{
+  (void)cols;
+  (void)cells;
+  (void)user;
+  pushline_count++;
+  return 1;
+}
+
+static VTermScreenCallbacks screen_cbs = {
+  cb_damage, // damage
+  NULL, // moverect
+  NULL, // movecursor
+  NULL, // settermprop
+  NULL, // bell
+  NULL, // resize
+  cb_sb_pushline, // sb_pushline
+  NULL, // sb_popline
+};
+
+/* Fill "buf" with "len" bytes of output, repeating lines made by "mkline". */
+static void fill(char *buf, size_t len, int (*mkline)(char *line, int n))
+{
+  char line[256];
+  size_t pos = 0;
+  int n = 0;
+
+  while(pos < len) {
+    int linelen = (*mkline)(line, n++);
+    if(linelen > (int)(len - pos))
+      linelen = (int)(len - pos);
+    memcpy(buf + pos, line, linelen);
+    pos += linelen;
+  }
+}
+
+/* Lines that fill the screen, moving the cursor home instead of scrolling. */
+static int mkline_plain(char *line, int n)
+{
+  int len = sprintf(line, "%sline %6d of plain text, as a file would contain it with some words\r\n",
+      n % (ROWS - 1) == 0 ? "\x1b[H" : "", n);
+  return len;
+}
+
+/* Same, but a few words have a color, like a compiler warning or ls. */
+static int mkline_colored(char *line, int n)
+{
+  int len = sprintf(line, "%s\x1b[1;33mwarning:\x1b[0m file%d.c:%d: \x1b[32msomething\x1b[0m is \x1b[4mnot\x1b[24m right\r\n",
+      n % (ROWS - 1) == 0 ? "\x1b[H" : "", n, n);
+  return len;
+}
+
+/* Lines that scroll the screen, lines go to the scrollback. */
+static int mkline_scroll(char *line, int n)
+{
+  return sprintf(line, "line %6d of text scrolling by, as the output of cat or a build\r\n", n);
+}
+
+static double run(const char *name, int (*mkline)(char *line, int n),
+    size_t len, VTermDamageSize merge)
+{
+  char *buf = malloc(len);
+  VTerm *vt = vterm_new(ROWS, COLS);
+  VTermScreen *screen;
+  size_t pos;
+  clock_t start;
+  double secs;
+
+  vterm_set_utf8(vt, 1);
+  screen = vterm_obtain_screen(vt);
+  vterm_screen_set_callbacks(screen, &screen_cbs, NULL);
+  vterm_screen_set_damage_merge(screen, merge);
+  vterm_screen_reset(screen, 1);
+
+  fill(buf, len, mkline);
+  damage_count = 0;
+  pushline_count = 0;
+
+  start = clock();
+  // Write in chunks like the output of a job is read.
+  for(pos = 0; pos < len; pos += 4096) {
+    vterm_input_write(vt, buf + pos, len - pos < 4096 ? len - pos : 4096);
+    vterm_screen_flush_damage(screen);
+  }
+  secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  printf("%-8s %8.1f MB/s  %9d damage  %9d pushline\n", name,
+      secs > 0 ? len / secs / 1000000 : 0.0, damage_count, pushline_count);
+
+  vterm_free(vt);
+  free(buf);
+  return secs;
+}
+
+int main(int argc, char **argv)
+{
+  VTermDamageSize merge = VTERM_DAMAGE_ROW;
+  size_t len = 20;
+  int argi = 1;
+
+  if(argi + 1 < argc && streq(argv[argi], "-d")) {
+    const char *name = argv[argi + 1];
+    if(streq(name, "cell"))
+      merge = VTERM_DAMAGE_CELL;
+    else if(streq(name, "row"))
+      merge = VTERM_DAMAGE_ROW;
+    else if(streq(name, "screen"))
+      merge = VTERM_DAMAGE_SCREEN;
+    else if(streq(name, "scroll"))
+      merge = VTERM_DAMAGE_SCROLL;
+    else {
+      fprintf(stderr, "Unknown damage size %s\n", name);
+      return 1;
+    }
+    argi += 2;
+  }
+  if(argi < argc)
+    len = strtoul(argv[argi], NULL, 10);
+  len *= 1000000;
+
+  run("plain", mkline_plain, len, merge);
+  run("colored", mkline_colored, len, merge);
+  run("scroll", mkline_scroll, len, merge);
+
+  return 0;
+}
@@ -25,6 +25,10 @@ static list_T		*first_list = NULL;	// list of all lists
 
 static void list_free_item(list_T *l, listitem_T *item);
 
+// A list with at least this many items gets an array of item pointers when
+// it is indexed, so that finding an item doesn't require walking the list.
+#define LIST_IDX_ARRAY_MIN 64
+
 /*
  * Add a watcher to a list.
  */
@@ -233,6 +237,7 @@ list_free_contents(list_T *l)
 	    clear_tv(&item->li_tv);
 	    list_free_item(l, item);
 	}
+    l->lv_idx_valid = FALSE;
 }
 
 /*
@@ -270,13 +275,19 @@ list_free_list(list_T  *l)
     if (l->lv_used_next != NULL)
 	l->lv_used_next->lv_used_prev = l->lv_used_prev;
 
+    vim_free(l->lv_idx_array);
     vim_free(l);
 }
 
-    void
+/*
+ * Free the lists that do not have "copyID".
+ * Returns the number of lists freed.
+ */
+    int
 list_free_items(int copyID)
 {
     list_T	*ll, *ll_next;
+    int		count = 0;
 
     for (ll = first_list; ll != NULL; ll = ll_next)
     {
@@ -288,8 +299,10 @@ list_free_items(int copyID)
 	    // into Lists and Dictionaries, they will be in the list of dicts
 	    // or list of lists.
 	    list_free_list(ll);
+	    ++count;
 	}
     }
+    return count;
 }
 
     void
@@ -389,6 +402,122 @@ list_equal(
     return item1 == NULL && item2 == NULL;
 }
 
+/*
+ * Fill the array of item pointers of list "l", so that an item can be found
+ * by its index directly.  Returns FAIL when out of memory.
+ */
+    static int
+list_idx_array_fill(list_T *l)
+{
+    listitem_T	*item;
+    int		idx = 0;
+
+    if (l->lv_idx_array_size < l->lv_len)
+    {
+	// leave room for appending items
+	int		new_size = l->lv_len + l->lv_len / 2;
+	listitem_T	**p;
+
+	p = ALLOC_MULT(listitem_T *, new_size);
+	if (p == NULL)
+	    return FAIL;
+	vim_free(l->lv_idx_array);
+	l->lv_idx_array = p;
+	l->lv_idx_array_size = new_size;
+    }
+    FOR_ALL_LIST_ITEMS(l, item)
+	l->lv_idx_array[idx++] = item;
+    l->lv_idx_array_start = 0;
+    l->lv_idx_valid = TRUE;
+    return OK;
+}
+
+/*
+ * Make room for one more item in the array of item pointers of list "l",
+ * which has "used" items.  With "front" before the first item, otherwise
+ * after the last one.  When the items are moved or the array is reallocated
+ * the free space is divided between both ends, so that adding at either end
+ * takes constant time on average.
+ * Returns FAIL when out of memory, the array is dropped then.
+ */
+    static int
+list_idx_array_room(list_T *l, int used, int front)
+{
+    int		start = l->lv_idx_array_start;
+    int		new_size = l->lv_idx_array_size;
+    listitem_T	**p = l->lv_idx_array;
+
+    if (front ? start > 0 : start + used < new_size)
+	return OK;
+
+    if (used >= new_size / 2)
+    {
+	new_size = used * 2 + 16;
+	p = ALLOC_MULT(listitem_T *, new_size);
+	if (p == NULL)
+	{
+	    l->lv_idx_valid = FALSE;
+	    return FAIL;
+	}
+    }
+    l->lv_idx_array_start = (new_size - used) / 2;
+    mch_memmove(p + l->lv_idx_array_start, l->lv_idx_array + start,
+						  used * sizeof(listitem_T *));
+    if (p != l->lv_idx_array)
+    {
+	vim_free(l->lv_idx_array);
+	l->lv_idx_array = p;
+	l->lv_idx_array_size = new_size;
+    }
+    return OK;
+}
+
+/*
+ * Insert "item" at index "idx" in the array of item pointers of list "l",
+ * which has "used" items before the insert.  Moves the items before or after
+ * "idx", whichever are fewer.
+ */
+    static void
+list_idx_array_insert(list_T *l, int used, int idx, listitem_T *item)
+{
+    int		front = idx < used - idx;
+    listitem_T	**p;
+
+    if (list_idx_array_room(l, used, front) == FAIL)
+	return;
+    if (front)
+    {
+	p = l->lv_idx_array + --l->lv_idx_array_start;
+	mch_memmove(p, p + 1, idx * sizeof(listitem_T *));
+    }
+    else
+    {
+	p = l->lv_idx_array + l->lv_idx_array_start;
+	mch_memmove(p + idx + 1, p + idx, (used - idx) * sizeof(listitem_T *));
+    }
+    p[idx] = item;
+}
+
+/*
+ * Remove "count" items at index "idx" from the array of item pointers of list
+ * "l", which has "used" items before the removal.  Moves the items before or
+ * after the removed ones, whichever are fewer.
+ */
+    static void
+list_idx_array_remove(list_T *l, int used, int idx, int count)
+{
+    listitem_T	**p = l->lv_idx_array + l->lv_idx_array_start;
+
+    if (idx < used - idx - count)
+    {
+	mch_memmove(p + count, p, idx * sizeof(listitem_T *));
+	l->lv_idx_array_start += count;
+    }
+    else
+	mch_memmove(p + idx, p + idx + count,
+				    (used - idx - count) * sizeof(listitem_T *));
+}
+
 /*
  * Locate item with index "n" in list "l" and return it.
  * A negative index is counted from the end; -1 is the last item.
@@ -413,6 +542,17 @@ list_find(list_T *l, long n)
 
     CHECK_LIST_MATERIALIZE(l);
 
+    // For a long list use the array of items.  Also cache the index, then
+    // inserting or removing the item can keep the array valid.
+    if (l->lv_idx_valid || (l->lv_len >= LIST_IDX_ARRAY_MIN
+					       && list_idx_array_fill(l) == OK))
+    {
+	item = l->lv_idx_array[l->lv_idx_array_start + n];
+	l->lv_u.mat.lv_idx = n;
+	l->lv_u.mat.lv_idx_item = item;
+	return item;
+    }
+
     // When there is a cached index may start search from there.
     if (l->lv_u.mat.lv_idx_item != NULL)
     {
@@ -557,6 +697,7 @@ list_idx_of_item(list_T *l, listitem_T *item)
 list_append(list_T *l, listitem_T *item)
 {
     CHECK_LIST_MATERIALIZE(l);
+    GC_CHANGED_LIST(l);
     if (l->lv_u.mat.lv_last == NULL)
     {
 	// empty list
@@ -572,6 +713,11 @@ list_append(list_T *l, listitem_T *item)
     }
     ++l->lv_len;
     item->li_next = NULL;
+
+    // Keep the array of items valid, grow it when needed.
+    if (l->lv_idx_valid
+	       && list_idx_array_room(l, l->lv_len - 1, FALSE) == OK)
+	l->lv_idx_array[l->lv_idx_array_start + l->lv_len - 1] = item;
 }
 
 /*
@@ -707,11 +853,14 @@ list_insert_tv(list_T *l, typval_T *tv, listitem_T *item)
 list_insert(list_T *l, listitem_T *ni, listitem_T *item)
 {
     CHECK_LIST_MATERIALIZE(l);
+    GC_CHANGED_LIST(l);
     if (item == NULL)
 	// Append new item at end of list.
 	list_append(l, ni);
     else
     {
+	int	idx = -1;
+
 	// Insert new item before existing item.
 	ni->li_prev = item->li_prev;
 	ni->li_next = item;
@@ -719,13 +868,30 @@ list_insert(list_T *l, listitem_T *ni, listitem_T *item)
 	{
 	    l->lv_first = ni;
 	    ++l->lv_u.mat.lv_idx;
+	    idx = 0;
 	}
 	else
 	{
 	    item->li_prev->li_next = ni;
-	    l->lv_u.mat.lv_idx_item = NULL;
+	    if (l->lv_u.mat.lv_idx_item == item)
+	    {
+		// "item" moves up, the cached index remains valid.
+		idx = l->lv_u.mat.lv_idx;
+		++l->lv_u.mat.lv_idx;
+	    }
+	    else
+		l->lv_u.mat.lv_idx_item = NULL;
 	}
 	item->li_prev = ni;
+
+	// Keep the array of items valid when the index is known.
+	if (l->lv_idx_valid)
+	{
+	    if (idx >= 0)
+		list_idx_array_insert(l, l->lv_len, idx, ni);
+	    else
+		l->lv_idx_valid = FALSE;
+	}
 	++l->lv_len;
     }
 }
@@ -954,18 +1120,39 @@ list_copy(list_T *orig, int deep, int copyID)
 vimlist_remove(list_T *l, listitem_T *item, listitem_T *item2)
 {
     listitem_T	*ip;
+    int		count = 0;
+    int		idx = -1;
 
     CHECK_LIST_MATERIALIZE(l);
 
     // notify watchers
     for (ip = item; ip != NULL; ip = ip->li_next)
     {
-	--l->lv_len;
+	++count;
 	list_fix_watch(l, ip);
 	if (ip == item2)
 	    break;
     }
 
+    // Keep the array of items valid when the index is known, which is the
+    // case after list_find() and when removing at the start or the end.
+    if (l->lv_idx_valid)
+    {
+	if (item->li_prev == NULL)
+	    idx = 0;
+	else if (item2->li_next == NULL)
+	    idx = l->lv_len - count;
+	else if (l->lv_u.mat.lv_idx_item == item)
+	    idx = l->lv_u.mat.lv_idx;
+	else if (l->lv_u.mat.lv_idx_item == item2)
+	    idx = l->lv_u.mat.lv_idx - count + 1;
+	if (idx >= 0)
+	    list_idx_array_remove(l, l->lv_len, idx, count);
+	else
+	    l->lv_idx_valid = FALSE;
+    }
+    l->lv_len -= count;
+
     if (item2->li_next == NULL)
 	l->lv_u.mat.lv_last = item->li_prev;
     else
@@ -1448,6 +1635,12 @@ typedef struct
 {
     listitem_T	*item;
     int		idx;
+    union
+    {
+	varnumber_T	n;
+	double		d;
+	char_u		*s;
+    } key;		// sort key, when computed beforehand
 } sortItem_T;
 
 // struct storing information about current sort
@@ -1555,6 +1748,147 @@ item_compare(const void *s1, const void *s2)
     return res;
 }
 
+/*
+ * Compare functions used by sort() when all items have a key computed
+ * beforehand.  When the keys are equal the item indexes are compared, which
+ * makes the sort stable.
+ */
+    static int
+item_compare_nr(const void *s1, const void *s2)
+{
+    sortItem_T  *si1 = (sortItem_T *)s1;
+    sortItem_T  *si2 = (sortItem_T *)s2;
+
+    if (si1->key.n != si2->key.n)
+	return si1->key.n > si2->key.n ? 1 : -1;
+    return si1->idx > si2->idx ? 1 : -1;
+}
+
+    static int
+item_compare_double(const void *s1, const void *s2)
+{
+    sortItem_T  *si1 = (sortItem_T *)s1;
+    sortItem_T  *si2 = (sortItem_T *)s2;
+
+    if (si1->key.d != si2->key.d)
+	return si1->key.d > si2->key.d ? 1 : -1;
+    return si1->idx > si2->idx ? 1 : -1;
+}
+
+    static int
+item_compare_str(const void *s1, const void *s2)
+{
+    sortItem_T  *si1 = (sortItem_T *)s1;
+    sortItem_T  *si2 = (sortItem_T *)s2;
+    int		res = STRCMP(si1->key.s, si2->key.s);
+
+    if (res == 0)
+	return si1->idx > si2->idx ? 1 : -1;
+    return res;
+}
+
+    static int
+item_compare_str_ic(const void *s1, const void *s2)
+{
+    sortItem_T  *si1 = (sortItem_T *)s1;
+    sortItem_T  *si2 = (sortItem_T *)s2;
+    int		res = STRICMP(si1->key.s, si2->key.s);
+
+    if (res == 0)
+	return si1->idx > si2->idx ? 1 : -1;
+    return res;
+}
+
+/*
+ * Sort "ptrs[len]" for sort() without a compare function.
+ * When the items allow for it a key is computed once for each item and a
+ * compare function is used that doesn't need to check the type of the item
+ * every time.  Sorting on Numbers uses a radix sort.  Otherwise falls back
+ * to item_compare(), which handles any mix of types.
+ */
+    static void
+sort_items_builtin(sortItem_T *ptrs, long len)
+{
+    int		(*cmp)(const void *, const void *) = item_compare;
+    int		all_numbers = TRUE;
+    int		all_strings = TRUE;
+#ifdef FEAT_FLOAT
+    int		all_float = TRUE;
+#endif
+    long	i;
+
+    for (i = 0; i < len; ++i)
+    {
+	vartype_T   type = ptrs[i].item->li_tv.v_type;
+
+	if (type != VAR_NUMBER)
+	    all_numbers = FALSE;
+	if (type != VAR_STRING)
+	    all_strings = FALSE;
+#ifdef FEAT_FLOAT
+	if (type != VAR_NUMBER && type != VAR_FLOAT)
+	    all_float = FALSE;
+#endif
+    }
+
+    if (sortinfo->item_compare_numbers)
+    {
+	if (all_numbers)
+	{
+	    for (i = 0; i < len; ++i)
+		ptrs[i].key.n = ptrs[i].item->li_tv.vval.v_number;
+	    if (radix_sort_nr(ptrs, (size_t)len, sizeof(sortItem_T),
+					 offsetof(sortItem_T, key.n)) == OK)
+		return;
+	    cmp = item_compare_nr;
+	}
+    }
+#ifdef FEAT_FLOAT
+    else if (sortinfo->item_compare_float)
+    {
+	if (all_float)
+	{
+	    for (i = 0; i < len; ++i)
+		ptrs[i].key.d = tv_get_float(&ptrs[i].item->li_tv);
+	    cmp = item_compare_double;
+	}
+    }
+#endif
+    else if (sortinfo->item_compare_numeric)
+    {
+	// Same as what item_compare() does: a String is zero and other types
+	// are converted to a string and then to a number.
+	for (i = 0; i < len; ++i)
+	{
+	    typval_T	*tv = &ptrs[i].item->li_tv;
+	    char_u	*tofree = NULL;
+	    char_u	numbuf[NUMBUFLEN];
+	    char_u	*p;
+
+	    if (tv->v_type == VAR_STRING)
+		p = (char_u *)"'";
+	    else
+		p = tv2string(tv, &tofree, numbuf, 0);
+	    ptrs[i].key.d = p == NULL ? 0.0 : strtod((char *)p, NULL);
+	    vim_free(tofree);
+	}
+	cmp = item_compare_double;
+    }
+    else if (all_strings)
+    {
+	for (i = 0; i < len; ++i)
+	{
+	    ptrs[i].key.s = ptrs[i].item->li_tv.vval.v_string;
+	    if (ptrs[i].key.s == NULL)
+		ptrs[i].key.s = (char_u *)"";
+	}
+	cmp = sortinfo->item_compare_ic ? item_compare_str_ic
+							    : item_compare_str;
+    }
+
+    qsort((void *)ptrs, (size_t)len, sizeof(sortItem_T), cmp);
+}
+
     static int
 item_compare2(const void *s1, const void *s2)
 {
@@ -1746,10 +2080,12 @@ do_sort_uniq(typval_T *argvars, typval_T *rettv, int sort)
 	    else
 	    {
 		// Sort the array with item pointers.
-		qsort((void *)ptrs, (size_t)len, sizeof(sortItem_T),
-		    info.item_compare_func == NULL
-					  && info.item_compare_partial == NULL
-					       ? item_compare : item_compare2);
+		if (info.item_compare_func == NULL
+					   && info.item_compare_partial == NULL)
+		    sort_items_builtin(ptrs, len);
+		else
+		    qsort((void *)ptrs, (size_t)len, sizeof(sortItem_T),
+								item_compare2);
 
 		if (!info.item_compare_func_err)
 		{
@@ -1800,6 +2136,8 @@ do_sort_uniq(typval_T *argvars, typval_T *rettv, int sort)
 		    listitem_free(l, li);
 		    l->lv_len--;
 		}
+		l->lv_u.mat.lv_idx_item = NULL;
+		l->lv_idx_valid = FALSE;
 	    }
 	}
 
@@ -1848,6 +2186,7 @@ filter_map_one(typval_T *tv, typval_T *expr, int map, int *remp)
 	clear_tv(tv);
 	rettv.v_lock = 0;
 	*tv = rettv;
+	GC_STORED_TV(tv);
     }
     else
     {
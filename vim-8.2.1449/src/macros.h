@@ -384,6 +384,13 @@
 # define CHECK_CURBUF
 #endif
 
+// Write barriers for an incremental garbage collection: to be used when an
+// item is added to list "l" or dict "d", and after storing a value in "tv"
+// that replaced another one.  Inline the condition for performance.
+#define GC_CHANGED_LIST(l) if (gc_mark_copyID != 0) gc_changed_list(l)
+#define GC_CHANGED_DICT(d) if (gc_mark_copyID != 0) gc_changed_dict(d)
+#define GC_STORED_TV(tv) if (gc_mark_copyID != 0) gc_mark_tv(tv)
+
 // Inline the condition for performance.
 #define CHECK_LIST_MATERIALIZE(l) if ((l)->lv_first == &range_list_item) range_list_materialize(l)
 
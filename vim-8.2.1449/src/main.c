@@ -1418,6 +1418,9 @@ main_loop(
 	    if (time_fd != NULL)
 	    {
 		TIME_MSG("first screen update");
+# ifdef FEAT_EVAL
+		def_cache_time_msg();
+# endif
 		TIME_MSG("--- VIM STARTED ---");
 		fclose(time_fd);
 		time_fd = NULL;
@@ -1999,7 +1999,7 @@ recover_names(
     return file_count;
 }
 
-#if defined(UNIX) || defined(MSWIN) || defined(PROTO)
+#if defined(UNIX) || defined(MSWIN) || defined(FEAT_EVAL) || defined(PROTO)
 /*
  * Need _very_ long file names.
  * Append the full path to name with path separators made into percent
@@ -2714,6 +2714,7 @@ ml_append_int(
 
     if (lowest_marked && lowest_marked > lnum)
 	lowest_marked = lnum + 1;
+    ++buf->b_ml.ml_lines_moved;
 
     if (len == 0)
 	len = (colnr_T)STRLEN(line) + 1;	// space needed for the text
@@ -3355,6 +3356,8 @@ ml_replace_len(
 	netbeans_inserted(curbuf, lnum, 0, line, (int)STRLEN(line));
     }
 #endif
+    linewidth_line_replaced(curbuf, lnum);
+
     if (curbuf->b_ml.ml_line_lnum != lnum)
     {
 	// another line is buffered, flush it
@@ -3532,6 +3535,7 @@ ml_delete_int(buf_T *buf, linenr_T lnum, int flags)
 
     if (lowest_marked && lowest_marked > lnum)
 	lowest_marked--;
+    ++buf->b_ml.ml_lines_moved;
 
 /*
  * If the file becomes empty the last line is replaced by an empty line.
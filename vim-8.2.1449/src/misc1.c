@@ -397,7 +397,7 @@ plines_win_nofold(win_T *wp, linenr_T lnum)
     s = ml_get_buf(wp->w_buffer, lnum, FALSE);
     if (*s == NUL)		// empty line
 	return 1;
-    col = win_linetabsize(wp, s, (colnr_T)MAXCOL);
+    col = win_line_vcols(wp, lnum, s);
 
     /*
      * If list mode is on, then the '$' at the end of the line may take up one
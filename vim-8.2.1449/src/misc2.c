@@ -1245,6 +1245,7 @@ free_all_mem(void)
 # endif
 
     free_termoptions();
+    free_out_buf();
 
     // screenlines (can't display anything now!)
     free_screenlines();
@@ -1318,6 +1319,57 @@ vim_memsave(char_u *p, size_t len)
     return ret;
 }
 
+/*
+ * Append "str2" to allocated string "str1".  "*len1" is the length of "str1"
+ * and "*size" the size of the allocated block, both are updated.  The caller
+ * must use the returned pointer instead of "str1", which may have been
+ * reallocated.
+ * When "grow" is TRUE more is expected to be appended: extra room is
+ * allocated, so that building a string by appending many pieces takes linear
+ * time instead of quadratic.
+ * Returns NULL when out of memory, "str1" is then unchanged.
+ */
+    char_u *
+append_str(
+	char_u	*str1,
+	size_t	*len1,
+	size_t	*size,
+	char_u	*str2,
+	int	grow)
+{
+    size_t	len2 = STRLEN(str2);
+    size_t	newsize;
+    char_u	*p;
+
+    if (str2 >= str1 && str2 <= str1 + *len1)
+    {
+	// Appending (part of) the string to itself, the text would move when
+	// reallocating.
+	p = concat_str(str1, str2);
+	if (p == NULL)
+	    return NULL;
+	vim_free(str1);
+	*len1 += len2;
+	*size = *len1 + 1;
+	return p;
+    }
+
+    if (*len1 + len2 + 1 > *size)
+    {
+	newsize = *len1 + len2 + 1;
+	if (grow)
+	    newsize += newsize / 2;
+	p = vim_realloc(str1, newsize);
+	if (p == NULL)
+	    return NULL;
+	str1 = p;
+	*size = newsize;
+    }
+    mch_memmove(str1 + *len1, str2, len2 + 1);
+    *len1 += len2;
+    return str1;
+}
+
 /*
  * Same as vim_strsave(), but any characters found in esc_chars are preceded
  * by a backslash.
@@ -3923,6 +3975,86 @@ sort_strings(
     qsort((void *)files, (size_t)count, sizeof(char_u *), sort_compare);
 }
 
+/*
+ * Sort "count" items of "size" bytes at "base" on the varnumber_T at offset
+ * "key_off" in each item.  This is a radix sort, it does not compare items
+ * and takes linear time.  It is stable: items with the same key keep their
+ * order.
+ * Returns FAIL when out of memory, the items are not sorted then.
+ */
+    int
+radix_sort_nr(void *base, size_t count, size_t size, size_t key_off)
+{
+    int		nbytes = (int)sizeof(varnumber_T);
+    size_t	(*counts)[256];
+    char_u	*tmp;
+    char_u	*src = base;
+    char_u	*dst;
+    char_u	*p;
+    size_t	i;
+    size_t	total;
+    size_t	n;
+    int		b;
+
+    if (count < 2)
+	return OK;
+    counts = (size_t (*)[256])alloc_clear(nbytes * sizeof(*counts));
+    if (counts == NULL)
+	return FAIL;
+    tmp = alloc(count * size);
+    if (tmp == NULL)
+    {
+	vim_free(counts);
+	return FAIL;
+    }
+    dst = tmp;
+
+    // Count the occurrences of each value of each byte of the keys in one
+    // pass.  Flipping the sign bit makes negative numbers sort first.
+#define RADIX_KEY(p) ((uvarnumber_T)*(varnumber_T *)((p) + key_off) \
+		    ^ ((uvarnumber_T)1 << (nbytes * 8 - 1)))
+    for (i = 0, p = src; i < count; ++i, p += size)
+    {
+	uvarnumber_T	key = RADIX_KEY(p);
+
+	for (b = 0; b < nbytes; ++b)
+	    ++counts[b][(key >> (b * 8)) & 0xff];
+    }
+
+    for (b = 0; b < nbytes; ++b)
+    {
+	char_u	*t;
+
+	// Skip a byte that is the same in all keys, e.g. the upper bytes of
+	// small numbers.
+	if (counts[b][(RADIX_KEY(src) >> (b * 8)) & 0xff] == count)
+	    continue;
+
+	// Turn the counts into the offset where each value goes.
+	total = 0;
+	for (i = 0; i < 256; ++i)
+	{
+	    n = counts[b][i];
+	    counts[b][i] = total;
+	    total += n;
+	}
+
+	for (i = 0, p = src; i < count; ++i, p += size)
+	    mch_memmove(dst + counts[b][(RADIX_KEY(p) >> (b * 8)) & 0xff]++
+								 * size, p, size);
+	t = src;
+	src = dst;
+	dst = t;
+    }
+#undef RADIX_KEY
+
+    if (src != base)
+	mch_memmove(base, src, count * size);
+    vim_free(tmp);
+    vim_free(counts);
+    return OK;
+}
+
 /*
  * The putenv() implementation below comes from the "screen" program.
  * Included with permission from Juergen Weigert.
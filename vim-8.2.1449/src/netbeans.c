@@ -376,7 +376,6 @@ netbeans_parse_messages(void)
     readq_T	*node;
     char_u	*buffer;
     char_u	*p;
-    int		own_node;
 
     while (nb_channel != NULL)
     {
@@ -398,31 +397,28 @@ netbeans_parse_messages(void)
 
 	// There is a complete command at the start of the buffer.
 	// Terminate it with a NUL.  When no more text is following unlink
-	// the buffer.  Do this before executing, because new buffers can
-	// be added while busy handling the command.
+	// the buffer, otherwise copy the command.  Do this before executing,
+	// because text can be added to the buffer while busy handling the
+	// command, which may move it.
 	*p++ = NUL;
 	if (*p == NUL)
 	{
-	    own_node = TRUE;
 	    buffer = channel_get(nb_channel, PART_SOCK, NULL);
 	    // "node" is now invalid!
 	}
 	else
 	{
-	    own_node = FALSE;
-	    buffer = node->rq_buffer;
+	    buffer = vim_strsave(node->rq_buffer);
+	    channel_consume(nb_channel, PART_SOCK,
+					     (int)(p - node->rq_buffer));
 	}
+	if (buffer == NULL)
+	    break;	// out of memory
 
 	// Now, parse and execute the commands.  This may set nb_channel to
 	// NULL if the channel is closed.
 	nb_parse_cmd(buffer);
-
-	if (own_node)
-	    // buffer finished, dispose of it
-	    vim_free(buffer);
-	else if (nb_channel != NULL)
-	    // more follows, move it to the start
-	    channel_consume(nb_channel, PART_SOCK, (int)(p - buffer));
+	vim_free(buffer);
     }
 }
 
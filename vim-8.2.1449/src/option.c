@@ -2913,6 +2913,15 @@ set_bool_option(
 	    win_equal(curwin, FALSE, 0);
     }
 
+#ifdef UNIX
+    // When 'ttyasync' is reset write any queued output now.
+    else if ((int *)varp == &p_tta)
+    {
+	if (!p_tta && old_value)
+	    mch_tty_out_flush();
+    }
+#endif
+
     else if ((int *)varp == &p_wiv)
     {
 	/*
@@ -3467,6 +3476,16 @@ set_num_option(
 	if (p_uc && !old_value)
 	    ml_open_files();
     }
+#ifdef FEAT_TIMERS
+    else if (pp == &p_rdi)
+    {
+	if (p_rdi < 0)
+	{
+	    errmsg = e_positive;
+	    p_rdi = 0;
+	}
+    }
+#endif
 #ifdef FEAT_CONCEAL
     else if (pp == &curwin->w_p_cole)
     {
@@ -3720,7 +3739,10 @@ check_redraw(long_u flags)
 	status_redraw_all();
 
     if ((flags & P_RBUF) || (flags & P_RWIN) || all)
+    {
 	changed_window_setting();
+	++display_opt_tick;
+    }
     if (flags & P_RBUF)
 	redraw_curbuf_later(NOT_VALID);
     if (flags & P_RWINONLY)
@@ -5937,7 +5959,10 @@ buf_copy_options(buf_T *buf, int flags)
 		if (p_vts && p_vts != empty_option && !buf->b_p_vts_array)
 		    tabstop_set(p_vts, &buf->b_p_vts_array);
 		else
+		{
 		    buf->b_p_vts_array = NULL;
+		    ++display_opt_tick;
+		}
 #endif
 	    }
 	    else
@@ -5952,7 +5977,10 @@ buf_copy_options(buf_T *buf, int flags)
 		if (p_vts && p_vts != empty_option && !buf->b_p_vts_array)
 		    tabstop_set(p_vts, &buf->b_p_vts_array);
 		else
+		{
 		    buf->b_p_vts_array = NULL;
+		    ++display_opt_tick;
+		}
 #endif
 		buf->b_help = FALSE;
 		if (buf->b_p_bt[0] == 'h')
@@ -504,6 +504,9 @@ EXTERN long	p_cspc;		// 'cscopepathcomp'
 EXTERN int	p_csverbose;	// 'cscopeverbose'
 #endif
 EXTERN char_u	*p_debug;	// 'debug'
+#ifdef FEAT_EVAL
+EXTERN char_u	*p_dcdir;	// 'defcachedir'
+#endif
 #ifdef FEAT_FIND_ID
 EXTERN char_u	*p_def;		// 'define'
 EXTERN char_u	*p_inc;
@@ -792,6 +795,9 @@ EXTERN int	p_ro;		// 'readonly'
 #ifdef FEAT_RELTIME
 EXTERN long	p_rdt;		// 'redrawtime'
 #endif
+#ifdef FEAT_TIMERS
+EXTERN long	p_rdi;		// 'redrawinterval'
+#endif
 EXTERN int	p_remap;	// 'remap'
 EXTERN long	p_re;		// 'regexpengine'
 #ifdef FEAT_RENDER_OPTIONS
@@ -972,6 +978,9 @@ EXTERN char_u	*p_titlestring;	// 'titlestring'
 EXTERN char_u	*p_tsr;		// 'thesaurus'
 EXTERN int	p_ttimeout;	// 'ttimeout'
 EXTERN long	p_ttm;		// 'ttimeoutlen'
+#ifdef UNIX
+EXTERN int	p_tta;		// 'ttyasync'
+#endif
 EXTERN int	p_tbi;		// 'ttybuiltin'
 EXTERN int	p_tf;		// 'ttyfast'
 #if defined(FEAT_TOOLBAR) && !defined(FEAT_GUI_MSWIN)
@@ -871,6 +871,8 @@ did_set_string_option(
 	    errmsg = _("E834: Conflicts with value of 'listchars'");
 	else if (set_chars_option(&p_fcs) != NULL)
 	    errmsg = _("E835: Conflicts with value of 'fillchars'");
+	else
+	    ++cellwidth_tick;
     }
 
     // 'background'
@@ -2204,6 +2206,7 @@ did_set_string_option(
 	    {
 		vim_free(curbuf->b_p_vts_array);
 		curbuf->b_p_vts_array = NULL;
+		++display_opt_tick;
 	    }
 	}
 	else
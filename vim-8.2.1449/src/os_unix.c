@@ -18,6 +18,11 @@
  * changed beyond recognition.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// Needed for POSIX_SPAWN_SETSID and close_range().
+# define _GNU_SOURCE
+#endif
+
 #include "vim.h"
 
 #ifdef FEAT_MZSCHEME
@@ -344,12 +349,314 @@ mch_chdir(char *path)
 # define NEW_TTY_SYSTEM
 #endif
 
+/*
+ * Output queue for 'ttyasync'.  When the terminal does not accept all output
+ * right away the rest is kept here and written when the terminal is ready,
+ * while waiting for a character.  Bytes before "tty_out_keep" must be written,
+ * the rest is output of screen updates that have not started to be written
+ * yet and may be dropped when a newer frame replaces them.
+ */
+#define TTY_OUT_MAX	(256 * 1024)	// limit for the queued output
+
+static char_u	*tty_out_buf = NULL;
+static int	tty_out_len = 0;	// number of bytes in tty_out_buf
+static int	tty_out_size = 0;	// allocated size of tty_out_buf
+static int	tty_out_keep = 0;	// bytes that can't be dropped
+static long	tty_out_superseded = 0;	// number of times output was dropped
+static long	tty_out_blocked = 0;	// times a write had to wait
+static int	tty_out_fd = -1;	// terminal opened non-blocking
+static int	tty_out_fd_tried = FALSE; // TRUE when tried opening it
+static int	tty_out_flags = -1;	// stdout flags before setting
+					// O_NONBLOCK, -1 when not set
+
+/*
+ * Return a file descriptor to write to the terminal without blocking.  When
+ * stdout is a terminal it is opened again, so that O_NONBLOCK is set on Vim's
+ * own file description, not on the one shared with the shell and other
+ * processes using the terminal.  Otherwise O_NONBLOCK is set on stdout until
+ * tty_nonblock_end() is called.
+ */
+    static int
+tty_nonblock_start(void)
+{
+    int	    flags;
+    char    *name;
+
+    if (!tty_out_fd_tried)
+    {
+	tty_out_fd_tried = TRUE;
+	if (isatty(1) && (name = ttyname(1)) != NULL)
+	    tty_out_fd = open(name, O_WRONLY | O_NONBLOCK
+# ifdef O_NOCTTY
+		    | O_NOCTTY
+# endif
+# ifdef O_CLOEXEC
+		    | O_CLOEXEC
+# endif
+		    , 0);
+    }
+    if (tty_out_fd >= 0)
+	return tty_out_fd;
+
+    flags = fcntl(1, F_GETFL);
+    if (flags != -1 && (flags & O_NONBLOCK) == 0
+				 && fcntl(1, F_SETFL, flags | O_NONBLOCK) == 0)
+	tty_out_flags = flags;
+    return 1;
+}
+
+/*
+ * Undo setting O_NONBLOCK on stdout by tty_nonblock_start().
+ */
+    static void
+tty_nonblock_end(void)
+{
+    if (tty_out_flags == -1)
+	return;
+    (void)fcntl(1, F_SETFL, tty_out_flags);
+    tty_out_flags = -1;
+}
+
+/*
+ * Write "s[len]" to "fd" from tty_nonblock_start().
+ * Returns the number of bytes written, -1 for an error other than the
+ * terminal not being ready.
+ */
+    static int
+tty_write_nonblock(int fd, char_u *s, int len)
+{
+    int	    n;
+
+    n = (int)write(fd, (char *)s, len);
+    if (n < 0 && (errno == EAGAIN
+# ifdef EWOULDBLOCK
+		|| errno == EWOULDBLOCK
+# endif
+		|| errno == EINTR))
+	n = 0;
+    return n;
+}
+
+/*
+ * Wait for stdout to accept output.  Only needed when someone else made it
+ * non-blocking.
+ */
+    static void
+tty_wait_writable(void)
+{
+# ifndef HAVE_SELECT
+    struct pollfd   fds;
+
+    fds.fd = 1;
+    fds.events = POLLOUT;
+    (void)poll(&fds, 1, -1);
+# else
+    fd_set	    wfds;
+
+    FD_ZERO(&wfds);
+    FD_SET(1, &wfds);
+    (void)select(2, NULL, &wfds, NULL, NULL);
+# endif
+}
+
+/*
+ * Write "s[len]" to stdout, waiting until all of it was written.
+ */
+    static void
+tty_write_all(char_u *s, int len)
+{
+    int	    n;
+
+    while (len > 0)
+    {
+	n = (int)write(1, (char *)s, len);
+	if (n < 0)
+	{
+	    if (errno == EINTR)
+		continue;
+	    if (errno == EAGAIN
+# ifdef EWOULDBLOCK
+		    || errno == EWOULDBLOCK
+# endif
+	       )
+	    {
+		tty_wait_writable();
+		continue;
+	    }
+	    break;
+	}
+	s += n;
+	len -= n;
+    }
+}
+
+/*
+ * Remove the first "n" bytes from the output queue.
+ */
+    static void
+tty_out_remove(int n)
+{
+    tty_out_len -= n;
+    if (tty_out_len > 0)
+	mch_memmove(tty_out_buf, tty_out_buf + n, (size_t)tty_out_len);
+    // Once written partly the rest of it must be written too.
+    tty_out_keep = tty_out_len;
+}
+
+/*
+ * Write as much of the queued output to "fd" as the terminal accepts.
+ */
+    static void
+tty_out_drain_fd(int fd)
+{
+    int	    n;
+
+    if (tty_out_len == 0)
+	return;
+    n = tty_write_nonblock(fd, tty_out_buf, tty_out_len);
+    if (n < 0)
+	// Cannot write to the terminal, nothing we can do.
+	tty_out_len = tty_out_keep = 0;
+    else if (n > 0)
+	tty_out_remove(n);
+}
+
+/*
+ * Write as much of the queued output as the terminal accepts.
+ */
+    static void
+tty_out_drain(void)
+{
+    if (tty_out_len == 0)
+	return;
+    tty_out_drain_fd(tty_nonblock_start());
+    tty_nonblock_end();
+}
+
+/*
+ * Write all the queued output, waiting for the terminal if needed.  To be
+ * used before changing the terminal mode, executing a shell command and when
+ * 'ttyasync' is reset.
+ */
+    void
+mch_tty_out_flush(void)
+{
+    if (tty_out_len == 0)
+	return;
+    tty_write_all(tty_out_buf, tty_out_len);
+    tty_out_len = tty_out_keep = 0;
+}
+
+/*
+ * Write "s[len]" for 'ttyasync': what the terminal doesn't accept right away
+ * is appended to the output queue.
+ */
+    static void
+tty_out_write(char_u *s, int len)
+{
+    int	    fd;
+    int	    n;
+    int	    frame = out_frame_may_drop();
+
+    fd = tty_nonblock_start();
+    tty_out_drain_fd(fd);
+    if (tty_out_len == 0)
+    {
+	n = tty_write_nonblock(fd, s, len);
+	if (n < 0 || n == len)
+	{
+	    tty_nonblock_end();
+	    return;
+	}
+	s += n;
+	len -= n;
+	if (n > 0)
+	    // rest of a partly written frame can't be dropped
+	    frame = FALSE;
+    }
+    tty_nonblock_end();
+
+    if (tty_out_len + len > TTY_OUT_MAX)
+    {
+	// The queue is full, wait for the terminal.
+	++tty_out_blocked;
+	mch_tty_out_flush();
+	tty_write_all(s, len);
+	return;
+    }
+    if (tty_out_len + len > tty_out_size)
+    {
+	int	new_size = tty_out_size == 0 ? 4096 : tty_out_size;
+	char_u	*p;
+
+	while (new_size < tty_out_len + len)
+	    new_size *= 2;
+	p = vim_realloc(tty_out_buf, new_size);
+	if (p == NULL)
+	{
+	    mch_tty_out_flush();
+	    tty_write_all(s, len);
+	    return;
+	}
+	tty_out_buf = p;
+	tty_out_size = new_size;
+    }
+    mch_memmove(tty_out_buf + tty_out_len, s, (size_t)len);
+    tty_out_len += len;
+    if (!frame)
+	tty_out_keep = tty_out_len;
+}
+
+/*
+ * Return TRUE when there is output waiting to be written.
+ */
+    static int
+tty_out_pending(void)
+{
+    return tty_out_len > 0;
+}
+
+/*
+ * Called before drawing a frame.  When the output of previous frames is
+ * still waiting to be written and it is more than what redrawing the whole
+ * screen takes, drop it.  Returns TRUE when this was done, the caller must
+ * then redraw the whole screen.
+ */
+    int
+mch_tty_supersede(void)
+{
+    if (!p_tta || tty_out_len - tty_out_keep <= (long)Rows * Columns)
+	return FALSE;
+    tty_out_len = tty_out_keep;
+    ++tty_out_superseded;
+    return TRUE;
+}
+
+# if defined(FEAT_EVAL) || defined(PROTO)
+/*
+ * Add the 'ttyasync' statistics to "d", for redrawstats().
+ */
+    void
+mch_tty_add_stats(dict_T *d)
+{
+    dict_add_number(d, "tty_queued", tty_out_len);
+    dict_add_number(d, "tty_superseded", tty_out_superseded);
+    dict_add_number(d, "tty_blocked", tty_out_blocked);
+}
+# endif
+
 /*
  * Write s[len] to the screen (stdout).
  */
     void
 mch_write(char_u *s, int len)
 {
+    if (p_tta && !p_wd)
+    {
+	tty_out_write(s, len);
+	return;
+    }
+    mch_tty_out_flush();
     vim_ignored = (int)write(1, (char *)s, len);
     if (p_wd)		// Unix is too fast, slow down a bit more
 	RealWaitForChar(read_cmd_fd, p_wd, NULL, NULL);
@@ -585,6 +892,9 @@ mch_delay(long msec, int ignoreinput)
     long	total = msec; // remember original value
 #endif
 
+    // Don't keep output waiting while sleeping.
+    mch_tty_out_flush();
+
     if (ignoreinput)
     {
 	// Go to cooked mode without echo, to allow SIGINT interrupting us
@@ -1260,6 +1570,7 @@ mch_suspend(void)
     out_flush();	    // needed to make cursor visible on some systems
     settmode(TMODE_COOK);
     out_flush();	    // needed to disable mouse on some systems
+    mch_tty_out_flush();
 
 # if defined(FEAT_CLIPBOARD) && defined(FEAT_X11)
     loose_clipboard();
@@ -1462,22 +1773,32 @@ catch_signals(
 }
 
 #ifdef HAVE_SIGPROCMASK
+/*
+ * Get the set of signals that Vim handles, reset_signals() sets these to the
+ * default.
+ */
     static void
-block_signals(sigset_t *set)
+get_signal_set(sigset_t *set)
 {
-    sigset_t	newset;
     int		i;
 
-    sigemptyset(&newset);
+    sigemptyset(set);
 
     for (i = 0; signal_info[i].sig != -1; i++)
-	sigaddset(&newset, signal_info[i].sig);
+	sigaddset(set, signal_info[i].sig);
 
 # if defined(SIGCONT)
     // SIGCONT isn't in the list, because its default action is ignore
-    sigaddset(&newset, SIGCONT);
+    sigaddset(set, SIGCONT);
 # endif
+}
+
+    static void
+block_signals(sigset_t *set)
+{
+    sigset_t	newset;
 
+    get_signal_set(&newset);
     sigprocmask(SIG_BLOCK, &newset, set);
 }
 
@@ -3298,6 +3619,14 @@ mch_free_mem(void)
     vim_free(oldtitle);
     vim_free(oldicon);
 # endif
+    mch_tty_out_flush();
+    VIM_CLEAR(tty_out_buf);
+    tty_out_size = 0;
+    if (tty_out_fd >= 0)
+    {
+	close(tty_out_fd);
+	tty_out_fd = -1;
+    }
 }
 #endif
 
@@ -3379,6 +3708,7 @@ mch_exit(int r)
 	    cursor_on();
     }
     out_flush();
+    mch_tty_out_flush();
     ml_close_all(TRUE);		// remove all memfiles
 
 #ifdef USE_GCOV_FLUSH
@@ -4270,6 +4600,51 @@ set_default_child_environment(int is_terminal)
 {
     set_child_environment(Rows, Columns, "dumb", is_terminal);
 }
+
+# ifdef USE_POSIX_SPAWN
+/*
+ * Start "argv" with posix_spawnp(), using "actions" for the file descriptors
+ * and "envp" for the environment.  Signals are reset like reset_signals()
+ * does and the signal mask is set to "mask".  With "new_session" the child
+ * gets its own session, like with setsid().
+ * posix_spawn() avoids copying the page tables of Vim, which takes long when
+ * a lot of memory is used.
+ * Returns the process ID, -1 when failed.
+ */
+    static pid_t
+spawn_child(
+	char			    **argv,
+	posix_spawn_file_actions_t  *actions,
+	char			    **envp,
+	sigset_t		    *mask,
+	int			    new_session)
+{
+    posix_spawnattr_t	attr;
+    sigset_t		dflset;
+    short		flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+    pid_t		pid = -1;
+
+    if (posix_spawnattr_init(&attr) != 0)
+	return -1;
+
+    get_signal_set(&dflset);
+#  ifdef SIGTSTP
+    if (ignore_sigtstp)
+	sigdelset(&dflset, SIGTSTP);
+#  endif
+    if (new_session)
+	flags |= POSIX_SPAWN_SETSID;
+
+    if (posix_spawnattr_setsigdefault(&attr, &dflset) != 0
+	    || posix_spawnattr_setsigmask(&attr, mask) != 0
+	    || posix_spawnattr_setflags(&attr, flags) != 0
+	    || posix_spawnp(&pid, argv[0], actions, &attr, argv, envp) != 0)
+	pid = -1;
+
+    posix_spawnattr_destroy(&attr);
+    return pid;
+}
+# endif
 #endif
 
 #if defined(FEAT_GUI) || defined(FEAT_JOB_CHANNEL)
@@ -4557,6 +4932,36 @@ mch_call_shell_system(
 			    // 127, some shells use that already
 # define OPEN_NULL_FAILED 123 // Exit code if /dev/null can't be opened
 
+# ifdef USE_POSIX_SPAWN
+/*
+ * Start the shell command "argv" with posix_spawnp(), for when nothing needs
+ * to be done in the child but redirecting stdin, stdout and stderr to
+ * /dev/null, when "use_null" is TRUE.  "mask" is the signal mask for the
+ * child.
+ * Returns the process ID, -1 when failed.
+ */
+    static pid_t
+spawn_shell(char **argv, sigset_t *mask, int use_null)
+{
+    extern char			**environ;
+    posix_spawn_file_actions_t	actions;
+    pid_t			pid = -1;
+    int				fd;
+
+    if (posix_spawn_file_actions_init(&actions) != 0)
+	return -1;
+    for (fd = 0; use_null && fd < 3; ++fd)
+	if (posix_spawn_file_actions_addopen(&actions, fd, "/dev/null",
+						     O_RDWR | O_EXTRA, 0) != 0)
+	    goto theend;
+    pid = spawn_child(argv, &actions, environ, mask, FALSE);
+
+theend:
+    posix_spawn_file_actions_destroy(&actions);
+    return pid;
+}
+# endif
+
 /*
  * Don't use system(), use fork()/exec().
  */
@@ -4645,7 +5050,20 @@ mch_call_shell_fork(
     {
 	SIGSET_DECL(curset)
 	BLOCK_SIGNALS(&curset);
-	pid = fork();	// maybe we should use vfork()
+# ifdef USE_POSIX_SPAWN
+	pid = -1;
+	if (!(options & (SHELL_READ|SHELL_WRITE))
+#  ifdef FEAT_GUI
+		&& !(gui.in_use && show_shell_mess)
+#  endif
+		)
+	    // No pipe or pty to set up, use posix_spawn().  When it fails
+	    // fork() will give the same error messages as before.
+	    pid = spawn_shell(argv, &curset,
+				   !show_shell_mess || (options & SHELL_EXPAND));
+	if (pid == -1)
+# endif
+	    pid = fork();	// maybe we should use vfork()
 	if (pid == -1)
 	{
 	    UNBLOCK_SIGNALS(&curset);
@@ -5387,6 +5805,9 @@ mch_call_shell(
     char_u	*cmd,
     int		options)	// SHELL_*, see vim.h
 {
+    // The command may write to the terminal, queued output goes first.
+    mch_tty_out_flush();
+
 #if defined(FEAT_GUI) && defined(FEAT_TERMINAL)
     if (gui.in_use && vim_strchr(p_go, GO_TERMINAL) != NULL)
 	return mch_call_shell_terminal(cmd, options);
@@ -5399,6 +5820,247 @@ mch_call_shell(
 }
 
 #if defined(FEAT_JOB_CHANNEL) || defined(PROTO)
+# ifdef USE_POSIX_SPAWN
+/*
+ * Add "name=value" to the environment "env" of a job, replacing an existing
+ * entry for "name".  The allocated string is added to "alloced".
+ */
+    static int
+spawn_env_set(garray_T *env, garray_T *alloced, char *name, char *value)
+{
+    size_t	namelen = STRLEN(name);
+    char	**items;
+    char	*entry;
+    int		i;
+
+    if (ga_grow(alloced, 1) == FAIL || ga_grow(env, 2) == FAIL)
+	return FAIL;
+    entry = alloc(namelen + STRLEN(value) + 2);
+    if (entry == NULL)
+	return FAIL;
+    sprintf(entry, "%s=%s", name, value);
+    ((char **)alloced->ga_data)[alloced->ga_len++] = entry;
+
+    items = (char **)env->ga_data;
+    for (i = 0; i < env->ga_len; ++i)
+	if (STRNCMP(items[i], name, namelen) == 0 && items[i][namelen] == '=')
+	{
+	    items[i] = entry;
+	    return OK;
+	}
+    items[env->ga_len++] = entry;
+    items[env->ga_len] = NULL;
+    return OK;
+}
+
+/*
+ * Build the environment of a job in "env", what set_child_environment() and
+ * the "env" option do in the child after fork().  The child of posix_spawn()
+ * shares the memory with Vim, thus it is done here, without changing the
+ * environment of Vim.  The entries that are not changed point into
+ * "environ", the others are allocated and also added to "alloced".
+ */
+    static int
+spawn_job_env(
+	garray_T    *env,
+	garray_T    *alloced,
+	jobopt_T    *options,
+	int	    is_terminal UNUSED,
+	int	    shm_fd UNUSED)
+{
+    extern char	**environ;
+    char	numbuf[NUMBUFLEN];
+    int		i;
+
+    for (i = 0; environ[i] != NULL; ++i)
+	;
+    if (ga_grow(env, i + 1) == FAIL)
+	return FAIL;
+    mch_memmove(env->ga_data, environ, (i + 1) * sizeof(char *));
+    env->ga_len = i;
+
+    vim_snprintf(numbuf, NUMBUFLEN, "%ld", (long)Rows);
+    if (spawn_env_set(env, alloced, "TERM", "dumb") == FAIL
+	    || spawn_env_set(env, alloced, "ROWS", numbuf) == FAIL
+	    || spawn_env_set(env, alloced, "LINES", numbuf) == FAIL)
+	return FAIL;
+    vim_snprintf(numbuf, NUMBUFLEN, "%ld", (long)Columns);
+    if (spawn_env_set(env, alloced, "COLUMNS", numbuf) == FAIL)
+	return FAIL;
+    vim_snprintf(numbuf, NUMBUFLEN, "%d", t_colors);
+    if (spawn_env_set(env, alloced, "COLORS", numbuf) == FAIL)
+	return FAIL;
+#  ifdef FEAT_TERMINAL
+    if (is_terminal)
+    {
+	vim_snprintf(numbuf, NUMBUFLEN, "%ld",
+					   (long)get_vim_var_nr(VV_VERSION));
+	if (spawn_env_set(env, alloced, "VIM_TERMINAL", numbuf) == FAIL)
+	    return FAIL;
+    }
+#  endif
+#  ifdef FEAT_CLIENTSERVER
+    if (spawn_env_set(env, alloced, "VIM_SERVERNAME",
+		     serverName == NULL ? "" : (char *)serverName) == FAIL)
+	return FAIL;
+#  endif
+
+    if (options->jo_env != NULL)
+    {
+	dict_T	    *dict = options->jo_env;
+	hashitem_T  *hi;
+	int	    todo = (int)dict->dv_hashtab.ht_used;
+
+	for (hi = dict->dv_hashtab.ht_array; todo > 0; ++hi)
+	    if (!HASHITEM_EMPTY(hi))
+	    {
+		typval_T *item = &dict_lookup(hi)->di_tv;
+
+		if (spawn_env_set(env, alloced, (char *)hi->hi_key,
+					 (char *)tv_get_string(item)) == FAIL)
+		    return FAIL;
+		--todo;
+	    }
+    }
+
+#  ifdef FEAT_CHANNEL_SHM
+    // The job gets the shared memory as file descriptor 3.
+    if (shm_fd >= 0
+	    && spawn_env_set(env, alloced, "VIM_CHANNEL_SHM", "3") == FAIL)
+	return FAIL;
+#  endif
+    return OK;
+}
+
+/*
+ * Start job "argv" with posix_spawnp().  "fd_in", "fd_out" and "fd_err" are
+ * used for stdin, stdout and stderr, /dev/null when negative.  All other file
+ * descriptors are closed, except "shm_fd", which the job gets as fd 3.
+ * "mask" is the signal mask for the job.
+ * Returns the process ID, -1 when failed or when fork() has to be used.
+ */
+    static pid_t
+spawn_job(
+	char	    **argv,
+	jobopt_T    *options,
+	int	    is_terminal,
+	int	    fd_in,
+	int	    fd_out,
+	int	    fd_err,
+	int	    shm_fd,
+	sigset_t    *mask)
+{
+    posix_spawn_file_actions_t	actions;
+    garray_T			env;
+    garray_T			alloced;
+    int				fds[3];
+    int				fd;
+    pid_t			pid = -1;
+
+#  ifdef FEAT_TERMINAL
+    if (options->jo_term_rows > 0)
+	return -1;
+#  endif
+    // posix_spawnp() searches $PATH of Vim, not of the job.
+    if (options->jo_env != NULL
+			 && dict_find(options->jo_env, (char_u *)"PATH", -1) != NULL)
+	return -1;
+#  ifndef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP
+    if (options->jo_cwd != NULL)
+	return -1;
+#  endif
+
+    if (posix_spawn_file_actions_init(&actions) != 0)
+	return -1;
+    ga_init2(&env, sizeof(char *), 50);
+    ga_init2(&alloced, sizeof(char *), 10);
+    if (spawn_job_env(&env, &alloced, options, is_terminal, shm_fd) == FAIL)
+	goto theend;
+
+    fds[0] = fd_in;
+    fds[1] = fd_out;
+    fds[2] = fd_err;
+    for (fd = 0; fd < 3; ++fd)
+	if ((fds[fd] < 0
+		? posix_spawn_file_actions_addopen(&actions, fd, "/dev/null",
+							 O_RDWR | O_EXTRA, 0)
+		: posix_spawn_file_actions_adddup2(&actions, fds[fd], fd)) != 0)
+	    goto theend;
+    if (shm_fd >= 0 && posix_spawn_file_actions_adddup2(&actions,
+							     shm_fd, 3) != 0)
+	goto theend;
+    // Close all other file descriptors at once, uses close_range().
+    if (posix_spawn_file_actions_addclosefrom_np(&actions,
+						    shm_fd >= 0 ? 4 : 3) != 0)
+	goto theend;
+#  ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP
+    if (options->jo_cwd != NULL && posix_spawn_file_actions_addchdir_np(
+				   &actions, (char *)options->jo_cwd) != 0)
+	goto theend;
+#  endif
+
+    pid = spawn_child(argv, &actions, (char **)env.ga_data, mask, TRUE);
+
+theend:
+    posix_spawn_file_actions_destroy(&actions);
+    ga_clear(&env);
+    ga_clear_strings(&alloced);
+    return pid;
+}
+# endif
+
+/*
+ * In the child after fork(): set the close-on-exec flag on all file
+ * descriptors from 3 up.  Only the descriptors that are actually open are
+ * visited, looping up to the "open files" limit may take a million system
+ * calls.
+ */
+    static void
+set_cloexec_from_3(void)
+{
+    int		fd;
+    int		fd_max = 1024;
+# ifdef _SC_OPEN_MAX
+    long	open_max;
+# endif
+
+# if defined(HAVE_CLOSE_RANGE) && defined(CLOSE_RANGE_CLOEXEC)
+    if (close_range(3, ~0U, CLOSE_RANGE_CLOEXEC) == 0)
+	return;
+# endif
+# if defined(HAVE_DIRENT_H) && defined(HAVE_DIRFD)
+    {
+	// Linux lists the open file descriptors in /proc/self/fd.  Don't use
+	// /dev/fd, on some systems it only has 0, 1 and 2.
+	DIR	    *dirp = opendir("/proc/self/fd");
+	struct dirent *dp;
+
+	if (dirp != NULL)
+	{
+	    int	    dir_fd = dirfd(dirp);
+
+	    while ((dp = readdir(dirp)) != NULL)
+	    {
+		if (!VIM_ISDIGIT(dp->d_name[0]))
+		    continue;
+		fd = atoi(dp->d_name);
+		if (fd >= 3 && fd != dir_fd)
+		    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+	    }
+	    closedir(dirp);
+	    return;
+	}
+    }
+# endif
+# ifdef _SC_OPEN_MAX
+    open_max = sysconf(_SC_OPEN_MAX);
+    if (open_max > 0)
+	fd_max = open_max > INT_MAX ? INT_MAX : (int)open_max;
+# endif
+    for (fd = 3; fd < fd_max; ++fd)
+	(void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
     void
 mch_job_start(char **argv, job_T *job, jobopt_T *options, int is_terminal)
 {
@@ -5417,6 +6079,10 @@ mch_job_start(char **argv, job_T *job, jobopt_T *options, int is_terminal)
     int		use_file_for_err = options->jo_io[PART_ERR] == JIO_FILE;
     int		use_buffer_for_in = options->jo_io[PART_IN] == JIO_BUFFER;
     int		use_out_for_err = options->jo_io[PART_ERR] == JIO_OUT;
+# ifdef FEAT_CHANNEL_SHM
+    int		shm_fd = -1;
+    char_u	*shm_mem = NULL;
+# endif
     SIGSET_DECL(curset)
 
     if (use_out_for_err && use_null_for_out)
@@ -5493,13 +6159,39 @@ mch_job_start(char **argv, job_T *job, jobopt_T *options, int is_terminal)
 	    channel = add_channel();
 	if (channel == NULL)
 	    goto failed;
+# ifdef FEAT_CHANNEL_SHM
+	if (options->jo_shm)
+	{
+	    shm_fd = channel_shm_create(&shm_mem);
+	    if (shm_fd < 0)
+		goto failed;
+	}
+# endif
 	if (job->jv_tty_out != NULL)
 	    ch_log(channel, "using pty %s on fd %d",
 					       job->jv_tty_out, pty_master_fd);
     }
 
     BLOCK_SIGNALS(&curset);
-    pid = fork();	// maybe we should use vfork()
+# ifdef USE_POSIX_SPAWN
+    pid = -1;
+    if (pty_master_fd < 0)
+	// Without a pty nothing special needs to be done in the child, use
+	// posix_spawn().  When it fails fork() will report the error the
+	// usual way.
+	pid = spawn_job(argv, options, is_terminal,
+		use_null_for_in ? -1 : fd_in[0],
+		use_null_for_out ? -1 : fd_out[1],
+		use_null_for_err ? -1 : use_out_for_err ? fd_out[1] : fd_err[1],
+#  ifdef FEAT_CHANNEL_SHM
+		shm_fd,
+#  else
+		-1,
+#  endif
+		&curset);
+    if (pid == -1)
+# endif
+	pid = fork();	// maybe we should use vfork()
     if (pid == -1)
     {
 	// failed to fork
@@ -5650,6 +6342,23 @@ mch_job_start(char **argv, job_T *job, jobopt_T *options, int is_terminal)
 	if (null_fd >= 0)
 	    close(null_fd);
 
+	// Do not pass other file descriptors of Vim on to the job, like
+	// spawn_job() does.
+	set_cloexec_from_3();
+
+# ifdef FEAT_CHANNEL_SHM
+	if (shm_fd >= 0)
+	{
+	    char_u numbuf[NUMBUFLEN];
+
+	    // Pass the shared memory to the job, the variable tells it the
+	    // file descriptor.
+	    (void)fcntl(shm_fd, F_SETFD, 0);
+	    vim_snprintf((char *)numbuf, NUMBUFLEN, "%d", shm_fd);
+	    vim_setenv((char_u *)"VIM_CHANNEL_SHM", numbuf);
+	}
+# endif
+
 	if (options->jo_cwd != NULL && mch_chdir((char *)options->jo_cwd) != 0)
 	    _exit(EXEC_FAILED);
 
@@ -5704,6 +6413,13 @@ mch_job_start(char **argv, job_T *job, jobopt_T *options, int is_terminal)
 	}
 
 	channel_set_pipes(channel, in_fd, out_fd, err_fd);
+# ifdef FEAT_CHANNEL_SHM
+	if (shm_fd >= 0)
+	{
+	    close(shm_fd);  // only used by the job
+	    channel_set_shm(channel, shm_mem);
+	}
+# endif
 	channel_set_job(channel, job, options);
     }
     else
@@ -5739,6 +6455,13 @@ failed:
 	close(pty_master_fd);
     if (pty_slave_fd >= 0)
 	close(pty_slave_fd);
+# ifdef FEAT_CHANNEL_SHM
+    if (shm_fd >= 0)
+    {
+	close(shm_fd);
+	channel_shm_free(shm_mem);
+    }
+# endif
 }
 
     static char_u *
@@ -6135,6 +6858,7 @@ RealWaitForChar(int fd, long msec, int *check_for_gpm UNUSED, int *interrupted)
 # ifdef USE_XSMP
 	int		xsmp_idx = -1;
 # endif
+	int		tty_idx = -1;
 	int		towait = (int)msec;
 
 # ifdef FEAT_MZSCHEME
@@ -6177,6 +6901,14 @@ RealWaitForChar(int fd, long msec, int *check_for_gpm UNUSED, int *interrupted)
 	    nfd++;
 	}
 # endif
+	if (tty_out_pending())
+	{
+	    // write queued output when the terminal is ready for it
+	    tty_idx = nfd;
+	    fds[nfd].fd = 1;
+	    fds[nfd].events = POLLOUT;
+	    nfd++;
+	}
 #ifdef FEAT_JOB_CHANNEL
 	nfd = channel_poll_setup(nfd, &fds, &towait);
 #endif
@@ -6189,6 +6921,12 @@ RealWaitForChar(int fd, long msec, int *check_for_gpm UNUSED, int *interrupted)
 	if (result == 0 && interrupted != NULL && ret > 0)
 	    *interrupted = TRUE;
 
+	if (tty_idx >= 0 && fds[tty_idx].revents != 0)
+	{
+	    tty_out_drain();
+	    --ret;
+	}
+
 # ifdef FEAT_MZSCHEME
 	if (ret == 0 && mzquantum_used)
 	    // MzThreads scheduling is required and timeout occurred
@@ -6306,6 +7044,13 @@ select_eintr:
 		maxfd = xsmp_icefd;
 	}
 # endif
+	if (tty_out_pending())
+	{
+	    // write queued output when the terminal is ready for it
+	    FD_SET(1, &wfds);
+	    if (maxfd < 1)
+		maxfd = 1;
+	}
 # ifdef FEAT_JOB_CHANNEL
 	maxfd = channel_select_setup(maxfd, &rfds, &wfds, &tv, &tvp);
 # endif
@@ -6319,6 +7064,11 @@ select_eintr:
 	    --ret;
 	else if (interrupted != NULL && ret > 0)
 	    *interrupted = TRUE;
+	if (ret > 0 && tty_out_pending() && FD_ISSET(1, &wfds))
+	{
+	    tty_out_drain();
+	    --ret;
+	}
 
 # ifdef EINTR
 	if (ret == -1 && errno == EINTR)
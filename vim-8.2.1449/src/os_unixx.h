@@ -22,6 +22,16 @@
 # include <sys/ioctl.h>
 #endif
 
+// posix_spawn() is used to start a job or a shell command when nothing
+// special needs to be done in the child.
+#if defined(HAVE_POSIX_SPAWN) && defined(HAVE_SIGPROCMASK) \
+	&& defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP)
+# include <spawn.h>
+# ifdef POSIX_SPAWN_SETSID
+#  define USE_POSIX_SPAWN
+# endif
+#endif
+
 #ifndef USE_SYSTEM	// use fork/exec to start the shell
 
 # if defined(HAVE_SYS_WAIT_H) || defined(HAVE_UNION_WAIT)
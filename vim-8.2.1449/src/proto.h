@@ -234,6 +234,7 @@ void mbyte_im_set_active(int active_arg);
 # include "userfunc.pro"
 # include "version.pro"
 # ifdef FEAT_EVAL
+#  include "vim9cache.pro"
 #  include "vim9compile.pro"
 #  include "vim9execute.pro"
 #  include "vim9script.pro"
@@ -18,6 +18,10 @@ int chartabsize(char_u *p, colnr_T col);
 int linetabsize(char_u *s);
 int linetabsize_col(int startcol, char_u *s);
 int win_linetabsize(win_T *wp, char_u *line, colnr_T len);
+int win_line_vcols(win_T *wp, linenr_T lnum, char_u *line);
+void linewidth_cache_changed(win_T *wp, linenr_T lnum, linenr_T lnume, long xtra, varnumber_T tick);
+void linewidth_line_replaced(buf_T *buf, linenr_T lnum);
+void linewidth_cache_free(win_T *wp);
 int vim_isIDc(int c);
 int vim_iswordc(int c);
 int vim_iswordc_buf(int c, buf_T *buf);
@@ -30,6 +34,8 @@ int vim_isprintc_strict(int c);
 int lbr_chartabsize(char_u *line, unsigned char *s, colnr_T col);
 int lbr_chartabsize_adv(char_u *line, char_u **s, colnr_T col);
 int win_lbr_chartabsize(win_T *wp, char_u *line, char_u *s, colnr_T col, int *headp);
+int vcol_checkpoint(win_T *wp, linenr_T lnum, char_u *line, colnr_T col, colnr_T vcol, colnr_T *cp_col, colnr_T *cp_vcol);
+void vcol_cp_clear(win_T *wp);
 void getvcol(win_T *wp, pos_T *pos, colnr_T *start, colnr_T *cursor, colnr_T *end);
 colnr_T getvcol_nolist(pos_T *posp);
 void getvvcol(win_T *wp, pos_T *pos, colnr_T *start, colnr_T *cursor, colnr_T *end);
@@ -8,6 +8,11 @@ void update_debug_sign(buf_T *buf, linenr_T lnum);
 void updateWindow(win_T *wp);
 int redraw_asap(int type);
 void redraw_after_callback(int call_update_screen);
+void redraw_async_frame_done(void);
+int redraw_async_postpone(void);
+void redraw_after_async(void);
+long redraw_async_check(proftime_T *now, long next_due);
+void redraw_async_add_stats(dict_T *d);
 void redraw_later(int type);
 void redraw_win_later(win_T *wp, int type);
 void redraw_later_clear(void);
@@ -40,7 +40,16 @@ int eval_addlist(typval_T *tv1, typval_T *tv2);
 char_u *partial_name(partial_T *pt);
 void partial_unref(partial_T *pt);
 int get_copyID(void);
+int get_copyID_restore(void);
 int garbage_collect(int testing);
+int garbage_collect_step(int testing);
+int garbage_collect_busy(void);
+void garbage_collect_abort(void);
+void gc_mark_tv(typval_T *tv);
+void gc_mark_ht(hashtab_T *ht);
+void gc_changed_list(list_T *l);
+void gc_changed_dict(dict_T *d);
+void f_gcstats(typval_T *argvars, typval_T *rettv);
 int set_ref_in_ht(hashtab_T *ht, int copyID, list_stack_T **list_stack);
 int set_ref_in_dict(dict_T *d, int copyID);
 int set_ref_in_list(list_T *ll, int copyID);
@@ -4,6 +4,7 @@ void evalvars_clear(void);
 int garbage_collect_globvars(int copyID);
 int garbage_collect_vimvars(int copyID);
 int garbage_collect_scriptvars(int copyID);
+void gc_mark_vars(void);
 void set_internal_string_var(char_u *name, char_u *value);
 int eval_charconvert(char_u *enc_from, char_u *enc_to, char_u *fname_from, char_u *fname_to);
 int eval_printexpr(char_u *fname, char_u *args);
@@ -66,6 +67,7 @@ void vars_clear(hashtab_T *ht);
 void vars_clear_ext(hashtab_T *ht, int free_val);
 void set_var(char_u *name, typval_T *tv, int copy);
 void set_var_const(char_u *name, type_T *type, typval_T *tv, int copy, int flags);
+int append_var_string(char_u *name, typval_T *tv);
 int var_check_ro(int flags, char_u *name, int use_gettext);
 int var_check_fixed(int flags, char_u *name, int use_gettext);
 int var_wrong_func_name(char_u *name, int new_var);
@@ -3,6 +3,7 @@ void hash_init(hashtab_T *ht);
 void hash_clear(hashtab_T *ht);
 void hash_clear_all(hashtab_T *ht, int off);
 hashitem_T *hash_find(hashtab_T *ht, char_u *key);
+hashitem_T *hash_find_len(hashtab_T *ht, char_u *key, int len);
 hashitem_T *hash_lookup(hashtab_T *ht, char_u *key, hash_T hash);
 void hash_debug_results(void);
 int hash_add(hashtab_T *ht, char_u *key);
@@ -12,4 +13,5 @@ void hash_lock(hashtab_T *ht);
 void hash_lock_size(hashtab_T *ht, int size);
 void hash_unlock(hashtab_T *ht);
 hash_T hash_hash(char_u *key);
+hash_T hash_hash_len(char_u *key, int len);
 /* vim: set ft=c : */
@@ -34,6 +34,7 @@ void free_all_mem(void);
 char_u *vim_strsave(char_u *string);
 char_u *vim_strnsave(char_u *string, size_t len);
 char_u *vim_memsave(char_u *p, size_t len);
+char_u *append_str(char_u *str1, size_t *len1, size_t *size, char_u *str2, int grow);
 char_u *vim_strsave_escaped(char_u *string, char_u *esc_chars);
 char_u *vim_strsave_escaped_ext(char_u *string, char_u *esc_chars, int cc, int bsl);
 int csh_like_shell(void);
@@ -93,6 +94,7 @@ void update_mouseshape(int shape_idx);
 int vim_chdir(char_u *new_dir);
 int get_user_name(char_u *buf, int len);
 void sort_strings(char_u **files, int count);
+int radix_sort_nr(void *base, size_t count, size_t size, size_t key_off);
 int filewritable(char_u *fname);
 int get2c(FILE *fd);
 int get3c(FILE *fd);
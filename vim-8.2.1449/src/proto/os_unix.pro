@@ -1,5 +1,8 @@
 /* os_unix.c */
 int mch_chdir(char *path);
+void mch_tty_out_flush(void);
+int mch_tty_supersede(void);
+void mch_tty_add_stats(dict_T *d);
 void mch_write(char_u *s, int len);
 int mch_inchar(char_u *buf, int maxlen, long wtime, int tb_change_cnt);
 int mch_char_avail(void);
@@ -12,6 +12,11 @@ int term_is_gui(char_u *name);
 char_u *tltoa(unsigned long i);
 void termcapinit(char_u *name);
 void out_flush(void);
+void out_frame_start(void);
+int out_frame_may_drop(void);
+void out_frame_end(void);
+void free_out_buf(void);
+void f_redrawstats(typval_T *argvars, typval_T *rettv);
 void out_flush_cursor(int force, int clear_selection);
 void out_flush_check(void);
 void out_trash(void);
@@ -7,9 +7,11 @@ int term_should_restore(buf_T *buf);
 void free_terminal(buf_T *buf);
 void free_unused_terminals(void);
 void write_to_term(buf_T *buffer, char_u *msg, channel_T *channel);
+void term_postponed_redraw_done(void);
 int term_job_running(term_T *term);
 int term_none_open(term_T *term);
 int term_try_stop_job(buf_T *buf);
+void term_add_pending_lines(buf_T *buf);
 int term_check_timers(int next_due_arg, proftime_T *now);
 int term_in_normal_mode(void);
 void term_enter_job_mode(void);
@@ -44,6 +46,7 @@ void f_term_getline(typval_T *argvars, typval_T *rettv);
 void f_term_getscrolled(typval_T *argvars, typval_T *rettv);
 void f_term_getsize(typval_T *argvars, typval_T *rettv);
 void f_term_setsize(typval_T *argvars, typval_T *rettv);
+void f_term_getstats(typval_T *argvars, typval_T *rettv);
 void f_term_getstatus(typval_T *argvars, typval_T *rettv);
 void f_term_gettitle(typval_T *argvars, typval_T *rettv);
 void f_term_gettty(typval_T *argvars, typval_T *rettv);
@@ -19,6 +19,7 @@ void f_test_option_not_set(typval_T *argvars, typval_T *rettv);
 void f_test_override(typval_T *argvars, typval_T *rettv);
 void f_test_refcount(typval_T *argvars, typval_T *rettv);
 void f_test_garbagecollect_now(typval_T *argvars, typval_T *rettv);
+void f_test_garbagecollect_step(typval_T *argvars, typval_T *rettv);
 void f_test_garbagecollect_soon(typval_T *argvars, typval_T *rettv);
 void f_test_ignore_error(typval_T *argvars, typval_T *rettv);
 void f_test_null_blob(typval_T *argvars, typval_T *rettv);
@@ -0,0 +1,7 @@
+/* vim9cache.c */
+int def_cache_useful(ufunc_T *ufunc);
+int def_cache_load(ufunc_T *ufunc);
+void def_cache_store(ufunc_T *ufunc);
+void def_cache_time_msg(void);
+void free_def_cache(void);
+/* vim: set ft=c : */
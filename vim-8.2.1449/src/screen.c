@@ -56,6 +56,11 @@ static void recording_mode(int attr);
 // Ugly global: overrule attribute used by screen_char()
 static int screen_char_attr = 0;
 
+// Statistics for screen_line(), reported by redrawstats().
+static long screen_stat_cells = 0;	// cells passed to screen_line()
+static long screen_stat_skipped = 0;	// cells skipped by screen_same_cells()
+static long screen_stat_drawn = 0;	// cells output by screen_line()
+
 #if defined(FEAT_CONCEAL) || defined(PROTO)
 /*
  * Return TRUE if the cursor line in window "wp" may be concealed, according
@@ -337,6 +342,74 @@ char_needs_redraw(int off_from, int off_to, int cols)
     return FALSE;
 }
 
+// Number of cells compared at once by screen_same_cells().
+#define SAME_CELLS_BLOCK 16
+
+/*
+ * Return TRUE when "count" cells at "off_from" and "off_to" are identical in
+ * all the screen arrays.
+ */
+    static int
+cells_equal(unsigned off_from, unsigned off_to, int count)
+{
+    int	    i;
+
+    if (memcmp(ScreenLines + off_from, ScreenLines + off_to,
+					     count * sizeof(schar_T)) != 0
+	    || memcmp(ScreenAttrs + off_from, ScreenAttrs + off_to,
+					     count * sizeof(sattr_T)) != 0)
+	return FALSE;
+    if (enc_utf8)
+    {
+	if (memcmp(ScreenLinesUC + off_from, ScreenLinesUC + off_to,
+					    count * sizeof(u8char_T)) != 0)
+	    return FALSE;
+	for (i = 0; i < Screen_mco; ++i)
+	    if (memcmp(ScreenLinesC[i] + off_from, ScreenLinesC[i] + off_to,
+					    count * sizeof(u8char_T)) != 0)
+		return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Return the number of cells, up to "maxcells", that are identical at
+ * "off_from" and "off_to".  Compares blocks of cells first, memcmp() is
+ * vectorized by most C libraries, then single cells.
+ * The result never ends on the right half of a double-width character.
+ * Only to be used when "enc_dbcs" is zero.
+ */
+    static int
+screen_same_cells(unsigned off_from, unsigned off_to, int maxcells)
+{
+    int	    n = 0;
+
+    while (n + SAME_CELLS_BLOCK <= maxcells
+	       && cells_equal(off_from + n, off_to + n, SAME_CELLS_BLOCK))
+	n += SAME_CELLS_BLOCK;
+    while (n < maxcells && cells_equal(off_from + n, off_to + n, 1))
+	++n;
+
+    // For utf-8 a zero in ScreenLines[] is the right half of a double-width
+    // character, stop at its left half.
+    if (enc_utf8 && n > 0 && n < maxcells && ScreenLines[off_from + n] == 0)
+	--n;
+    return n;
+}
+
+#if defined(FEAT_EVAL) || defined(PROTO)
+/*
+ * Add the screen_line() statistics to "d", for redrawstats().
+ */
+    void
+screen_add_redrawstats(dict_T *d)
+{
+    dict_add_number(d, "cells", screen_stat_cells);
+    dict_add_number(d, "cells_skipped", screen_stat_skipped);
+    dict_add_number(d, "cells_drawn", screen_stat_drawn);
+}
+#endif
+
 #if defined(FEAT_TERMINAL) || defined(PROTO)
 /*
  * Return the index in ScreenLines[] for the current screen line.
@@ -419,6 +492,7 @@ screen_line(
     int		    clear_next = FALSE;
     int		    char_cells;		// 1: normal char
 					// 2: occupies two display cells
+    int		    fast_skip;		// can use screen_same_cells()
 # define CHAR_CELLS char_cells
 
     // Check for illegal row and col, just in case.
@@ -472,10 +546,37 @@ screen_line(
     }
 #endif
 
+    // Unchanged cells can be skipped quickly, unless the 'xs' termcap flag
+    // or the GUI requires looking at every cell.
+    fast_skip = enc_dbcs == 0 && !p_wiv
+#ifdef FEAT_GUI
+		&& !gui.in_use
+#endif
+		;
+    if (endcol > col)
+	screen_stat_cells += endcol - col;
+
     redraw_next = char_needs_redraw(off_from, off_to, endcol - col);
 
     while (col < endcol)
     {
+	if (fast_skip && !redraw_next && !force)
+	{
+	    int skip = screen_same_cells(off_from, off_to, endcol - col);
+
+	    if (skip > 0)
+	    {
+		off_from += skip;
+		off_to += skip;
+		col += skip;
+		screen_stat_skipped += skip;
+		if (col >= endcol)
+		    break;
+		redraw_next = char_needs_redraw(off_from, off_to,
+								endcol - col);
+	    }
+	}
+
 	if (has_mbyte && (col + 1 < endcol))
 	    char_cells = (*mb_off2cells)(off_from, max_off_from);
 	else
@@ -639,6 +740,7 @@ screen_line(
 		screen_char_2(off_to, row, col + coloff);
 	    else
 		screen_char(off_to, row, col + coloff);
+	    screen_stat_drawn += char_cells;
 	}
 	else if (  p_wiv
 #ifdef FEAT_GUI
@@ -716,6 +716,8 @@ typedef struct ml_chunksize
 typedef struct memline
 {
     linenr_T	ml_line_count;	// number of lines in the buffer
+    int		ml_lines_moved;	// incremented when lines are appended or
+				// deleted
 
     memfile_T	*ml_mfp;	// pointer to associated memfile
 
@@ -1250,7 +1252,7 @@ typedef struct hashtable_S
 				// array is "ht_mask" + 1)
     long_u	ht_used;	// number of items used
     long_u	ht_filled;	// number of items used + removed
-    int		ht_changed;	// incremented when adding or removing an item
+    int		ht_changed;	// changed when adding or removing an item
     int		ht_locked;	// counter for hash_lock()
     int		ht_error;	// when set growing failed, can't add more
 				// items before growing works
@@ -1406,6 +1408,9 @@ typedef struct
 // Values for "v_lock".
 #define VAR_LOCKED  1	// locked with lock(), can use unlock()
 #define VAR_FIXED   2	// locked forever
+#define VAR_APPENDED 4	// String of a variable built with ":let var ..=",
+			// "di_str_len" and "di_str_size" are valid; reset by
+			// clear_tv() and copy_tv()
 
 /*
  * Structure to hold an item of a list: an internal variable without a name.
@@ -1455,12 +1460,18 @@ struct listvar_S
     list_T	*lv_copylist;	// copied list used by deepcopy()
     list_T	*lv_used_next;	// next list in used lists list
     list_T	*lv_used_prev;	// previous list in used lists list
+    listitem_T	**lv_idx_array;	// pointers to the items, for indexing a
+				// long list, used when "lv_idx_valid" set
+    int		lv_idx_array_size; // allocated size of "lv_idx_array"
+    int		lv_idx_array_start; // index in "lv_idx_array" of the first
+				// item
     int		lv_refcount;	// reference count
     int		lv_len;		// number of items
     int		lv_with_items;	// number of items following this struct that
 				// should not be freed
     int		lv_copyID;	// ID used by deepcopy()
     char	lv_lock;	// zero, VAR_LOCKED, VAR_FIXED
+    char	lv_idx_valid;	// "lv_idx_array" has the "lv_len" items
 };
 
 /*
@@ -1479,6 +1490,8 @@ typedef struct {
 struct dictitem_S
 {
     typval_T	di_tv;		// type and value of the variable
+    size_t	di_str_len;	// length of "di_tv" String when VAR_APPENDED
+    size_t	di_str_size;	// allocated size of it when VAR_APPENDED
     char_u	di_flags;	// DI_FLAGS_ flags (only used for variable)
     char_u	di_key[1];	// key (actually longer!)
 };
@@ -1492,6 +1505,8 @@ typedef struct dictitem_S dictitem_T;
 struct dictitem16_S
 {
     typval_T	di_tv;		// type and value of the variable
+    size_t	di_str_len;	// length of "di_tv" String when VAR_APPENDED
+    size_t	di_str_size;	// allocated size of it when VAR_APPENDED
     char_u	di_flags;	// DI_FLAGS_ flags (only used for variable)
     char_u	di_key[DICTITEM16_KEY_LEN + 1];	// key
 };
@@ -1980,8 +1995,10 @@ struct jobvar_S
  */
 struct readq_S
 {
-    char_u	*rq_buffer;
-    long_u	rq_buflen;
+    char_u	*rq_buffer;	// start of the text, NUL terminated
+    long_u	rq_buflen;	// length of the text
+    char_u	*rq_alloced;	// allocated memory, "rq_buffer" points into it
+    long_u	rq_size;	// size of "rq_alloced"
     readq_T	*rq_next;
     readq_T	*rq_prev;
 };
@@ -1989,6 +2006,7 @@ struct readq_S
 struct writeq_S
 {
     garray_T	wq_ga;
+    int		wq_done;	// number of bytes in wq_ga already written
     writeq_T	*wq_next;
     writeq_T	*wq_prev;
 };
@@ -2016,6 +2034,7 @@ typedef enum
     MODE_RAW,
     MODE_JSON,
     MODE_JS,
+    MODE_LSP,	    // Language Server Protocol, Content-Length header
 } ch_mode_T;
 
 typedef enum {
@@ -2053,6 +2072,9 @@ typedef struct {
 # if defined(UNIX) && !defined(HAVE_SELECT)
     int		ch_poll_idx;	// used by channel_poll_setup()
 # endif
+#ifdef HAVE_SYS_EPOLL_H
+    sock_T	ch_epoll_fd;	// fd registered with epoll or INVALID_FD
+#endif
 
 #ifdef FEAT_GUI_X11
     XtInputId	ch_inputHandler; // Cookie for input
@@ -2083,6 +2105,9 @@ typedef struct {
 				// does not block, 1 simulate blocking
     int		ch_nonblocking;	// write() is non-blocking
     writeq_T	ch_writeque;	// header for write queue
+    long_u	ch_writeque_len; // number of bytes in the write queue
+    int		ch_writeque_full; // TRUE when ch_writeque_len went above
+				  // CH_WRITEQUE_HIGH
 
     cbq_T	ch_cb_head;	// dummy node for per-request callbacks
     callback_T	ch_callback;	// call when a msg is not handled
@@ -2090,6 +2115,8 @@ typedef struct {
     bufref_T	ch_bufref;	// buffer to read from or write to
     int		ch_nomodifiable; // TRUE when buffer can be 'nomodifiable'
     int		ch_nomod_error;	// TRUE when e_modifiable was given
+    linenr_T	ch_maxlines;	// max lines kept in the buffer, zero for no
+				// limit
     int		ch_buf_append;	// write appended lines instead top-bot
     linenr_T	ch_buf_top;	// next line to send
     linenr_T	ch_buf_bot;	// last line to send
@@ -2128,6 +2155,12 @@ struct channel_S {
 #endif
     callback_T	ch_callback;	// call when any msg is not handled
     callback_T	ch_close_cb;	// call when channel is closed
+    callback_T	ch_drain_cb;	// call when the write queue was drained
+    int		ch_drain_pending; // TRUE when ch_drain_cb is to be invoked
+#ifdef FEAT_CHANNEL_SHM
+    char_u	*ch_shm;	// shared memory for the "shm" transport, NULL
+				// when using pipes only
+#endif
     int		ch_drop_never;
     int		ch_keep_open;	// do not close on read error
     int		ch_nonblock;
@@ -2197,6 +2230,10 @@ struct channel_S {
 #define JO2_BUFNR	    0x20000	// "bufnr"
 #define JO2_TERM_API	    0x40000	// "term_api"
 #define JO2_TERM_HIGHLIGHT  0x80000	// "highlight"
+#define JO2_OUT_MAXLINES    0x100000	// "out_maxlines"
+#define JO2_ERR_MAXLINES    0x200000	// "err_maxlines" (JO2_OUT_ << 1)
+#define JO2_DRAIN_CB	    0x400000	// "drain_cb"
+#define JO2_TRANSPORT	    0x800000	// "transport"
 
 #define JO_MODE_ALL	(JO_MODE + JO_IN_MODE + JO_OUT_MODE + JO_ERR_MODE)
 #define JO_CB_ALL \
@@ -2222,8 +2259,10 @@ typedef struct
     char_u	*jo_io_name[4];	// not allocated!
     int		jo_io_buf[4];
     int		jo_pty;
+    int		jo_shm;		// "transport" is "shm"
     int		jo_modifiable[4];
     int		jo_message[4];
+    linenr_T	jo_maxlines[4];
     channel_T	*jo_channel;
 
     linenr_T	jo_in_top;
@@ -2233,6 +2272,7 @@ typedef struct
     callback_T	jo_out_cb;
     callback_T	jo_err_cb;
     callback_T	jo_close_cb;
+    callback_T	jo_drain_cb;
     callback_T	jo_exit_cb;
     int		jo_drop_never;
     int		jo_waittime;
@@ -3095,6 +3135,57 @@ typedef struct w_line
 #endif
 } wline_T;
 
+/*
+ * Virtual column checkpoints for one long line in a window.  Entry "i" holds
+ * the byte index of the first character at or after "i" times
+ * VCOL_CP_INTERVAL bytes and its virtual column.  See charset.c.
+ */
+typedef struct
+{
+    linenr_T	vc_lnum;	// line number, zero when not valid
+    int		vc_fnum;	// buffer number
+    varnumber_T	vc_changedtick;	// b:changedtick when computed
+    int		vc_lines_moved;	// b_ml.ml_lines_moved when computed
+    int		vc_ts;		// 'tabstop' used
+    int		vc_display_opt_tick; // value of "display_opt_tick"
+    int		vc_width1;	// width of first screen line when 'wrap' set
+    int		vc_width2;	// width of further screen lines
+    int		vc_cellwidth_tick; // value of "cellwidth_tick"
+    int		vc_count;	// number of valid checkpoints
+    int		vc_size;	// number of allocated checkpoints
+    int		vc_done;	// TRUE when reached the end of the line
+    colnr_T	*vc_col;	// byte index of checkpoints
+    colnr_T	*vc_vcol;	// virtual column of checkpoints
+} vcolcp_T;
+
+/*
+ * Entry in the cache of line widths of a window.
+ */
+typedef struct
+{
+    linenr_T	lw_lnum;	// buffer line number, zero when not used
+    colnr_T	lw_vcols;	// number of virtual columns the line takes
+} lwentry_T;
+
+/*
+ * Cache of the number of virtual columns buffer lines take in a window, to
+ * avoid measuring the same lines over and over when scrolling.  Lines are
+ * stored at index "lnum" modulo LINEWIDTH_CACHE_SIZE.  See charset.c.
+ */
+typedef struct
+{
+    lwentry_T	*lw_entries;	// LINEWIDTH_CACHE_SIZE entries or NULL
+    int		lw_fnum;	// buffer number
+    varnumber_T	lw_changedtick;	// b:changedtick when valid
+    int		lw_lines_moved;	// b_ml.ml_lines_moved when valid
+    int		lw_display_opt_tick; // value of "display_opt_tick"
+    int		lw_cellwidth_tick; // value of "cellwidth_tick"
+    int		lw_width1;	// width of first screen line
+    int		lw_width2;	// width of further screen lines
+    int		lw_ts;		// 'tabstop'
+    int		lw_flags;	// LW_ flags for window options
+} linewidth_T;
+
 /*
  * Windows are kept in a tree of frames.  Each frame has a column (FR_COL)
  * or row (FR_ROW) layout or is a leaf, which has a window.
@@ -3423,6 +3514,10 @@ struct window_S
 				    // column being used
 #endif
 
+    vcolcp_T	w_vcolcp;	    // virtual column checkpoints for a long
+				    // line
+    linewidth_T	w_linewidth;	    // cached widths of lines
+
     /*
      * === end of cached values ===
      */
@@ -86,6 +86,7 @@ static void del_termcode_idx(int idx);
 static int find_term_bykeys(char_u *src);
 static int term_is_builtin(char_u *name);
 static int term_7to8bit(char_u *p);
+static void out_frame_account(void);
 
 #ifdef HAVE_TGETENT
 static char *tgetent_error(char_u *, char_u *);
@@ -2489,14 +2490,33 @@ termcapinit(char_u *name)
 
 /*
  * The number of calls to ui_write is reduced by using "out_buf".
+ * While a frame is being drawn by update_screen() the buffer may grow up to
+ * OUT_FRAME_MAX bytes, so that the whole frame is written with one call.
  */
 #define OUT_SIZE	2047
+#define OUT_FRAME_MAX	(1024 * 1024)
 
 // add one to allow mch_write() in os_win32.c to append a NUL
-static char_u		out_buf[OUT_SIZE + 1];
+static char_u		out_buf_static[OUT_SIZE + 1];
+static char_u		*out_buf = out_buf_static;
+static int		out_size = OUT_SIZE;	// usable size of out_buf
 
 static int		out_pos = 0;	// number of chars in out_buf
 
+static int		out_frame_depth = 0;	// nesting of out_frame_start()
+static int		out_frame_pending = FALSE; // frame output not written yet
+static int		out_frame_mode = FALSE;	// frame output changes a mode
+static long		out_frame_start_bytes = 0;
+static long		out_frame_start_writes = 0;
+
+// Statistics about terminal output, reported by redrawstats().
+static long		out_stat_frames = 0;	// number of frames drawn
+static long		out_stat_bytes = 0;	// bytes passed to ui_write()
+static long		out_stat_writes = 0;	// number of ui_write() calls
+static long		out_stat_frame_bytes = 0;   // bytes for last frame
+static long		out_stat_frame_writes = 0;  // writes for last frame
+static long		out_stat_frame_max_bytes = 0; // largest frame in bytes
+
 // Since the maximum number of SGR parameters shown as a normal value range is
 // 16, the escape sequence length can be 4 * 16 + lead + tail.
 #define MAX_ESC_SEQ_LEN	80
@@ -2515,9 +2535,175 @@ out_flush(void)
 	len = out_pos;
 	out_pos = 0;
 	ui_write(out_buf, len);
+	out_stat_bytes += len;
+	++out_stat_writes;
     }
+    if (out_frame_pending && out_frame_depth == 0)
+	out_frame_account();
+}
+
+/*
+ * Store the number of bytes and writes used for the last frame.
+ */
+    static void
+out_frame_account(void)
+{
+    out_frame_pending = FALSE;
+    out_stat_frame_bytes = out_stat_bytes - out_frame_start_bytes;
+    out_stat_frame_writes = out_stat_writes - out_frame_start_writes;
+    if (out_stat_frame_bytes > out_stat_frame_max_bytes)
+	out_stat_frame_max_bytes = out_stat_frame_bytes;
 }
 
+/*
+ * Try making room for "needed" more bytes in "out_buf" while drawing a frame.
+ * Returns FAIL when the buffer can't grow, the caller must flush then.
+ */
+    static int
+out_grow(int needed)
+{
+    int	    new_size;
+    char_u  *p;
+
+    if (out_frame_depth == 0 || p_wd || out_size >= OUT_FRAME_MAX)
+	return FAIL;
+    new_size = out_size * 2;
+    if (new_size < out_pos + needed)
+	new_size = out_pos + needed;
+    if (new_size > OUT_FRAME_MAX)
+	new_size = OUT_FRAME_MAX;
+    if (new_size < out_pos + needed)
+	return FAIL;
+
+    // add one to allow mch_write() in os_win32.c to append a NUL
+    if (out_buf == out_buf_static)
+    {
+	p = alloc(new_size + 1);
+	if (p != NULL)
+	    mch_memmove(p, out_buf, (size_t)out_pos);
+    }
+    else
+	p = vim_realloc(out_buf, new_size + 1);
+    if (p == NULL)
+	return FAIL;
+    out_buf = p;
+    out_size = new_size;
+    return OK;
+}
+
+/*
+ * Make room for "needed" bytes in "out_buf", by growing the buffer while a
+ * frame is being drawn, or by flushing it.
+ */
+    static void
+out_make_room(int needed)
+{
+    if (out_grow(needed) == FAIL)
+	out_flush();
+}
+
+/*
+ * Called when update_screen() starts drawing a frame.  Until the matching
+ * out_frame_end() the output is collected instead of being written whenever
+ * "out_buf" is full.
+ */
+    void
+out_frame_start(void)
+{
+    if (out_frame_depth++ > 0)
+	return;
+#ifdef UNIX
+    // Output from before the frame is not part of it, it must not be dropped
+    // with the frame, see mch_tty_supersede().
+    if (p_tta && out_pos > 0)
+	out_flush();
+#endif
+    if (out_frame_pending)
+	out_frame_account();
+    ++out_stat_frames;
+    out_frame_pending = TRUE;
+    out_frame_mode = FALSE;
+    out_frame_start_bytes = out_stat_bytes + out_pos;
+    out_frame_start_writes = out_stat_writes;
+}
+
+/*
+ * Return TRUE when output for drawing a frame is being collected or written
+ * and it only draws screen cells.  It may then be dropped when a later frame
+ * redraws the whole screen.
+ */
+    int
+out_frame_may_drop(void)
+{
+    return out_frame_pending && !out_frame_mode;
+}
+
+/*
+ * Called for output that changes a terminal mode, such as the cursor
+ * visibility or shape, that Vim remembers.  The output of the current frame
+ * can then not be dropped.
+ */
+    static void
+out_mode_change(void)
+{
+    if (out_frame_pending)
+	out_frame_mode = TRUE;
+}
+
+/*
+ * Called when update_screen() finished drawing a frame.  The collected output
+ * is written by the next out_flush(), together with the cursor positioning.
+ */
+    void
+out_frame_end(void)
+{
+    if (out_frame_depth > 0)
+	--out_frame_depth;
+}
+
+#if defined(EXITFREE) || defined(PROTO)
+    void
+free_out_buf(void)
+{
+    if (out_buf != out_buf_static)
+    {
+	vim_free(out_buf);
+	out_buf = out_buf_static;
+	out_size = OUT_SIZE;
+	out_pos = 0;
+    }
+}
+#endif
+
+#if defined(FEAT_EVAL) || defined(PROTO)
+/*
+ * "redrawstats()" function
+ */
+    void
+f_redrawstats(typval_T *argvars UNUSED, typval_T *rettv)
+{
+    dict_T	*d;
+
+    if (rettv_dict_alloc(rettv) != OK)
+	return;
+    d = rettv->vval.v_dict;
+    dict_add_number(d, "frames", out_stat_frames);
+    dict_add_number(d, "bytes", out_stat_bytes);
+    dict_add_number(d, "writes", out_stat_writes);
+    dict_add_number(d, "frame_bytes", out_stat_frame_bytes);
+    dict_add_number(d, "frame_writes", out_stat_frame_writes);
+    dict_add_number(d, "frame_max_bytes", out_stat_frame_max_bytes);
+    dict_add_number(d, "bufsize", out_size);
+    screen_add_redrawstats(d);
+# ifdef FEAT_TIMERS
+    redraw_async_add_stats(d);
+# endif
+# ifdef UNIX
+    mch_tty_add_stats(d);
+# endif
+}
+#endif
+
 /*
  * out_flush_cursor(): flush the output buffer and redraw the cursor.
  * Does not flush recursively in the GUI to avoid slow drawing.
@@ -2547,8 +2733,8 @@ out_flush_cursor(
     void
 out_flush_check(void)
 {
-    if (enc_dbcs != 0 && out_pos >= OUT_SIZE - MB_MAXBYTES)
-	out_flush();
+    if (enc_dbcs != 0 && out_pos >= out_size - MB_MAXBYTES)
+	out_make_room(MB_MAXBYTES);
 }
 
 #ifdef FEAT_GUI
@@ -2579,8 +2765,10 @@ out_char(unsigned c)
     out_buf[out_pos++] = c;
 
     // For testing we flush each time.
-    if (out_pos >= OUT_SIZE || p_wd)
+    if (p_wd)
 	out_flush();
+    else if (out_pos >= out_size)
+	out_make_room(1);
 }
 
 /*
@@ -2591,8 +2779,8 @@ out_char_nf(unsigned c)
 {
     out_buf[out_pos++] = c;
 
-    if (out_pos >= OUT_SIZE)
-	out_flush();
+    if (out_pos >= out_size)
+	out_make_room(1);
 }
 
 /*
@@ -2608,8 +2796,8 @@ out_char_nf(unsigned c)
 out_str_nf(char_u *s)
 {
     // avoid terminal strings being split up
-    if (out_pos > OUT_SIZE - MAX_ESC_SEQ_LEN)
-	out_flush();
+    if (out_pos > out_size - MAX_ESC_SEQ_LEN)
+	out_make_room(MAX_ESC_SEQ_LEN);
 
     while (*s)
 	out_char_nf(*s++);
@@ -2642,8 +2830,8 @@ out_str_cf(char_u *s)
 	    return;
 	}
 #endif
-	if (out_pos > OUT_SIZE - MAX_ESC_SEQ_LEN)
-	    out_flush();
+	if (out_pos > out_size - MAX_ESC_SEQ_LEN)
+	    out_make_room(MAX_ESC_SEQ_LEN);
 #ifdef HAVE_TGETENT
 	for (p = s; *s; ++s)
 	{
@@ -2710,8 +2898,8 @@ out_str(char_u *s)
 	}
 #endif
 	// avoid terminal strings being split up
-	if (out_pos > OUT_SIZE - MAX_ESC_SEQ_LEN)
-	    out_flush();
+	if (out_pos > out_size - MAX_ESC_SEQ_LEN)
+	    out_make_room(MAX_ESC_SEQ_LEN);
 #ifdef HAVE_TGETENT
 	tputs((char *)s, 1, TPUTSFUNCAST out_char_nf);
 #else
@@ -2761,6 +2949,7 @@ term_set_winpos(int x, int y)
 	x = 0;
     if (y < 0)
 	y = 0;
+    out_mode_change();
     OUT_STR(tgoto((char *)T_CWP, y, x));
 }
 
@@ -2872,6 +3061,7 @@ term_get_winpos(int *x, int *y, varnumber_T timeout)
     void
 term_set_winsize(int height, int width)
 {
+    out_mode_change();
     OUT_STR(tgoto((char *)T_CWS, width, height));
 }
 #endif
@@ -3031,6 +3221,7 @@ term_ul_rgb_color(guicolor_T rgb)
     void
 term_settitle(char_u *title)
 {
+    out_mode_change();
     // t_ts takes one argument: column in status line
     OUT_STR(tgoto((char *)T_TS, 0, 0));	// set title start
     out_str_nf(title);
@@ -3045,6 +3236,7 @@ term_settitle(char_u *title)
     void
 term_push_title(int which)
 {
+    out_mode_change();
     if ((which & SAVE_RESTORE_TITLE) && T_CST != NULL && *T_CST != NUL)
     {
 	OUT_STR(T_CST);
@@ -3064,6 +3256,7 @@ term_push_title(int which)
     void
 term_pop_title(int which)
 {
+    out_mode_change();
     if ((which & SAVE_RESTORE_TITLE) && T_CRT != NULL && *T_CRT != NUL)
     {
 	OUT_STR(T_CRT);
@@ -3542,6 +3735,10 @@ settmode(tmode_T tmode)
 		}
 	    }
 	    out_flush();
+#ifdef UNIX
+	    // output queued for 'ttyasync' must be written first
+	    mch_tty_out_flush();
+#endif
 	    mch_settmode(tmode);	// machine specific function
 	    cur_tmode = tmode;
 	    if (tmode == TMODE_RAW)
@@ -3849,6 +4046,7 @@ static int cursor_is_off = FALSE;
     void
 cursor_on_force(void)
 {
+    out_mode_change();
     out_str(T_VE);
     cursor_is_off = FALSE;
 }
@@ -3871,6 +4069,7 @@ cursor_off(void)
 {
     if (full_screen && !cursor_is_off)
     {
+	out_mode_change();
 	out_str(T_VI);	    // disable cursor
 	cursor_is_off = TRUE;
     }
@@ -3908,6 +4107,7 @@ term_cursor_mode(int forced)
 		p = T_CSI;	// fall back to Insert mode cursor
 	    if (*p != NUL)
 	    {
+		out_mode_change();
 		out_str(p);
 		showing_mode = REPLACE;
 	    }
@@ -3917,12 +4117,14 @@ term_cursor_mode(int forced)
     {
 	if ((forced || showing_mode != INSERT) && *T_CSI != NUL)
 	{
+	    out_mode_change();
 	    out_str(T_CSI);	    // Insert mode cursor
 	    showing_mode = INSERT;
 	}
     }
     else if (forced || showing_mode != NORMAL)
     {
+	out_mode_change();
 	out_str(T_CEI);		    // non-Insert mode cursor
 	showing_mode = NORMAL;
     }
@@ -3934,6 +4136,7 @@ term_cursor_color(char_u *color)
 {
     if (*T_CSC != NUL)
     {
+	out_mode_change();
 	out_str(T_CSC);		// set cursor color start
 	out_str_nf(color);
 	out_str(T_CEC);		// set cursor color end
@@ -3960,6 +4163,7 @@ blink_state_is_inverted()
     void
 term_cursor_shape(int shape, int blink)
 {
+    out_mode_change();
     if (*T_CSH != NUL)
     {
 	OUT_STR(tgoto((char *)T_CSH, 0, shape * 2 - blink));
@@ -59,13 +59,35 @@ typedef struct {
   VTermColor		bg;
 } cellattr_T;
 
+// The attributes of the cells in a scrollback line are stored as runs of
+// cells with the same attributes.  Each different cellattr_T is stored once in
+// tl_sb_palette.  A run is two numbers: the number of cells and the index in
+// the palette.  A number is stored with 7 bits per byte, the high bit is set
+// when more bytes follow.
+//
+// The runs of older lines are packed into segments of SB_SEG_LINES lines,
+// using one allocation, and a line with the same runs as the line before it
+// shares them.  This keeps a long scrollback small.
+typedef struct sb_seg_S {
+    int		ss_refcount;	// number of lines using the segment
+    int		ss_len;		// number of bytes in ss_data
+    char_u	ss_data[1];	// actually longer
+} sb_seg_T;
+
 typedef struct sb_line_S {
     int		sb_cols;	// can differ per line
-    cellattr_T	*sb_cells;	// allocated
-    cellattr_T	sb_fill_attr;	// for short line
-    char_u	*sb_text;	// for tl_scrollback_postponed
+    int		sb_fill_attr;	// palette index, for short line
+    char_u	*sb_runs;	// runs for "sb_cols" cells, NULL when sb_cols
+				// is zero or out of memory
+    sb_seg_T	*sb_seg;	// segment that "sb_runs" points into, NULL
+				// when "sb_runs" is allocated
+    char_u	*sb_text;	// for tl_scrollback_postponed and lines not
+				// added to the buffer yet
 } sb_line_T;
 
+#define SB_SEG_LINES	1000	// number of lines in a segment
+#define SB_KEEP_LINES	1000	// number of last lines that are not packed
+
 #ifdef MSWIN
 # ifndef HPCON
 #  define HPCON VOID*
@@ -143,10 +165,24 @@ struct terminal_S {
     proftime_T	tl_timer_due;
 #endif
     int		tl_postponed_scroll;	// to be scrolled up
+    int		tl_writing_output;	// inside term_write_job_output()
+    int		tl_cursor_moved;	// cursor moved while writing output
 
     garray_T	tl_scrollback;
     int		tl_scrollback_scrolled;
+    int		tl_scrollback_pending;	// last scrolled lines that are not
+					// in the buffer yet, text is in
+					// sb_text
     garray_T	tl_scrollback_postponed;
+    garray_T	tl_sb_palette;	    // cellattr_T used in the scrollback
+    int		*tl_sb_hash;	    // palette index + 1, zero for unused
+    int		tl_sb_hash_size;
+    int		tl_sb_packed;	    // lines at the start of tl_scrollback that
+				    // were packed
+    long_u	tl_sb_runs_size;    // bytes used by allocated runs
+    long_u	tl_sb_seg_size;	    // bytes used by segments
+    garray_T	tl_sb_cells;	    // cellattr_T of the line being added
+    garray_T	tl_sb_buf;	    // runs of the line being added
 
     char_u	*tl_highlight_name; // replaces "Terminal"; allocated
 
@@ -194,11 +230,14 @@ static int term_and_job_init(term_T *term, typval_T *argvar, char **argv, jobopt
 static int create_pty_only(term_T *term, jobopt_T *opt);
 static void term_report_winsize(term_T *term, int rows, int cols);
 static void term_free_vterm(term_T *term);
+static void sb_line_free(term_T *term, sb_line_T *line);
 #ifdef FEAT_GUI
 static void update_system_term(term_T *term);
 #endif
 
 static void handle_postponed_scrollback(term_T *term);
+static void update_cursor(term_T *term, int redraw);
+static void may_toggle_cursor(term_T *term);
 
 // The character that we know (or assume) that the terminal expects for the
 // backspace key.
@@ -446,6 +485,9 @@ term_start(
 #endif
     ga_init2(&term->tl_scrollback, sizeof(sb_line_T), 300);
     ga_init2(&term->tl_scrollback_postponed, sizeof(sb_line_T), 300);
+    ga_init2(&term->tl_sb_palette, sizeof(cellattr_T), 50);
+    ga_init2(&term->tl_sb_cells, sizeof(cellattr_T), 100);
+    ga_init2(&term->tl_sb_buf, 1, 100);
     ga_init2(&term->tl_osc_buf, sizeof(char), 300);
 
     CLEAR_FIELD(split_ea);
@@ -952,11 +994,20 @@ free_scrollback(term_T *term)
     int i;
 
     for (i = 0; i < term->tl_scrollback.ga_len; ++i)
-	vim_free(((sb_line_T *)term->tl_scrollback.ga_data + i)->sb_cells);
+	sb_line_free(term, (sb_line_T *)term->tl_scrollback.ga_data + i);
     ga_clear(&term->tl_scrollback);
     for (i = 0; i < term->tl_scrollback_postponed.ga_len; ++i)
-	vim_free(((sb_line_T *)term->tl_scrollback_postponed.ga_data + i)->sb_cells);
+	sb_line_free(term,
+		       (sb_line_T *)term->tl_scrollback_postponed.ga_data + i);
     ga_clear(&term->tl_scrollback_postponed);
+    term->tl_scrollback_pending = 0;
+    term->tl_sb_packed = 0;
+
+    ga_clear(&term->tl_sb_palette);
+    VIM_CLEAR(term->tl_sb_hash);
+    term->tl_sb_hash_size = 0;
+    ga_clear(&term->tl_sb_cells);
+    ga_clear(&term->tl_sb_buf);
 }
 
 
@@ -1072,6 +1123,7 @@ term_write_job_output(term_T *term, char_u *msg, size_t len)
     VTerm	*vterm = term->tl_vterm;
     size_t	prevlen = vterm_output_get_buffer_current(vterm);
 
+    term->tl_writing_output = TRUE;
     vterm_input_write(vterm, (char *)msg, len);
 
     // flush vterm buffer when vterm responded to control sequence
@@ -1087,6 +1139,19 @@ term_write_job_output(term_T *term, char_u *msg, size_t len)
 
     // this invokes the damage callbacks
     vterm_screen_flush_damage(vterm_obtain_screen(vterm));
+    term->tl_writing_output = FALSE;
+
+    // The cursor moves for every line of output, only put it in its final
+    // position.
+    if (term->tl_cursor_moved)
+    {
+	term->tl_cursor_moved = FALSE;
+	if (term->tl_buffer == curbuf && !term->tl_normal_mode)
+	{
+	    may_toggle_cursor(term);
+	    update_cursor(term, term->tl_cursor_visible);
+	}
+    }
 }
 
     static void
@@ -1159,11 +1224,13 @@ write_to_term(buf_T *buffer, char_u *msg, channel_T *channel)
     if (!term->tl_normal_mode)
     {
 	// Don't use update_screen() when editing the command line, it gets
-	// cleared.
-	// TODO: only update once in a while.
-	ch_log(term->tl_job->jv_channel, "updating screen");
-	if (buffer == curbuf && (State & CMDLINE) == 0)
+	// cleared.  When output arrives quickly only update once in a while,
+	// see 'redrawinterval'.
+	if (redraw_async_postpone())
+	    ch_log(term->tl_job->jv_channel, "postponing screen update");
+	else if (buffer == curbuf && (State & CMDLINE) == 0)
 	{
+	    ch_log(term->tl_job->jv_channel, "updating screen");
 	    update_screen(VALID_NO_UPDATE);
 	    // update_screen() can be slow, check the terminal wasn't closed
 	    // already
@@ -1171,7 +1238,27 @@ write_to_term(buf_T *buffer, char_u *msg, channel_T *channel)
 		update_cursor(curbuf->b_term, TRUE);
 	}
 	else
+	{
+	    ch_log(term->tl_job->jv_channel, "updating screen");
 	    redraw_after_callback(TRUE);
+	}
+    }
+}
+
+/*
+ * Called after a screen update for job output was postponed and done later,
+ * see 'redrawinterval'.  Put the cursor where the job in the terminal of the
+ * current buffer has it.
+ */
+    void
+term_postponed_redraw_done(void)
+{
+    term_T	*term = curbuf->b_term;
+
+    if (term != NULL && !term->tl_normal_mode && (State & CMDLINE) == 0)
+    {
+	may_toggle_cursor(term);
+	update_cursor(term, TRUE);
     }
 }
 
@@ -1614,6 +1701,42 @@ add_scrollback_line_to_buffer(term_T *term, char_u *text, int len)
     }
 }
 
+/*
+ * Add the scrolled lines that were not added to the buffer yet.  Lines that
+ * scroll off the terminal are only added when the buffer is used, so that
+ * fast scrolling output is not slowed down by updating the buffer.
+ */
+    static void
+add_pending_scrollback_to_buffer(term_T *term)
+{
+    int		i;
+    sb_line_T	*line;
+    char_u	*text;
+
+    if (term->tl_scrollback_pending == 0)
+	return;
+    for (i = term->tl_scrollback_scrolled - term->tl_scrollback_pending;
+					 i < term->tl_scrollback_scrolled; ++i)
+    {
+	line = (sb_line_T *)term->tl_scrollback.ga_data + i;
+	text = line->sb_text == NULL ? (char_u *)"" : line->sb_text;
+	add_scrollback_line_to_buffer(term, text, (int)STRLEN(text));
+	VIM_CLEAR(line->sb_text);
+    }
+    term->tl_scrollback_pending = 0;
+}
+
+/*
+ * Make sure all the scrolled lines of terminal buffer "buf" are in the buffer.
+ * Used before getting buffer lines for a function.
+ */
+    void
+term_add_pending_lines(buf_T *buf)
+{
+    if (buf->b_term != NULL)
+	add_pending_scrollback_to_buffer(buf->b_term);
+}
+
     static void
 cell2cellattr(const VTermScreenCell *cell, cellattr_T *attr)
 {
@@ -1636,6 +1759,371 @@ equal_celattr(cellattr_T *a, cellattr_T *b)
 	&& a->bg.blue == b->bg.blue;
 }
 
+/*
+ * Store number "n" at "p" with 7 bits per byte.  Returns the number of bytes
+ * used, at most 5.
+ */
+    static int
+sb_put_number(char_u *p, int n)
+{
+    unsigned	u = (unsigned)n;
+    int		len = 0;
+
+    while (u >= 0x80)
+    {
+	p[len++] = (u & 0x7f) | 0x80;
+	u >>= 7;
+    }
+    p[len++] = u;
+    return len;
+}
+
+/*
+ * Get a number stored with sb_put_number() at "*pp" and advance "*pp".
+ */
+    static int
+sb_get_number(char_u **pp)
+{
+    char_u	*p = *pp;
+    unsigned	u = 0;
+    int		shift = 0;
+
+    while (*p & 0x80)
+    {
+	u |= (unsigned)(*p++ & 0x7f) << shift;
+	shift += 7;
+    }
+    u |= (unsigned)*p++ << shift;
+    *pp = p;
+    return (int)u;
+}
+
+/*
+ * Copy "from" to "to" so that two equal attributes have the same bytes, also
+ * padding and unused bits.
+ */
+    static void
+sb_normalize_cellattr(cellattr_T *from, cellattr_T *to)
+{
+    CLEAR_POINTER(to);
+    to->attrs.bold = from->attrs.bold;
+    to->attrs.underline = from->attrs.underline;
+    to->attrs.italic = from->attrs.italic;
+    to->attrs.blink = from->attrs.blink;
+    to->attrs.reverse = from->attrs.reverse;
+    to->attrs.conceal = from->attrs.conceal;
+    to->attrs.strike = from->attrs.strike;
+    to->attrs.font = from->attrs.font;
+    to->attrs.dwl = from->attrs.dwl;
+    to->attrs.dhl = from->attrs.dhl;
+    to->width = from->width;
+    to->fg = from->fg;
+    to->bg = from->bg;
+}
+
+    static unsigned
+sb_hash_cellattr(cellattr_T *cellattr)
+{
+    char_u	*p;
+    unsigned	hash = 0;
+
+    for (p = (char_u *)cellattr; p < (char_u *)(cellattr + 1); ++p)
+	hash = hash * 31 + *p;
+    return hash;
+}
+
+/*
+ * Return the index of normalized attributes "key" in the palette of "term",
+ * add it when it's not there yet.  Returns zero when out of memory.
+ */
+    static int
+sb_palette_index(term_T *term, cellattr_T *key)
+{
+    garray_T	*gap = &term->tl_sb_palette;
+    int		mask;
+    int		i;
+    int		idx;
+
+    if (gap->ga_len * 2 >= term->tl_sb_hash_size)
+    {
+	int	size = term->tl_sb_hash_size == 0
+					     ? 64 : term->tl_sb_hash_size * 2;
+	int	*hash = ALLOC_CLEAR_MULT(int, size);
+
+	if (hash == NULL)
+	    return 0;
+	for (idx = 0; idx < gap->ga_len; ++idx)
+	{
+	    for (i = sb_hash_cellattr((cellattr_T *)gap->ga_data + idx)
+					& (size - 1); hash[i] != 0;
+							i = (i + 1) & (size - 1))
+		;
+	    hash[i] = idx + 1;
+	}
+	vim_free(term->tl_sb_hash);
+	term->tl_sb_hash = hash;
+	term->tl_sb_hash_size = size;
+    }
+
+    mask = term->tl_sb_hash_size - 1;
+    for (i = sb_hash_cellattr(key) & mask; term->tl_sb_hash[i] != 0;
+							     i = (i + 1) & mask)
+    {
+	idx = term->tl_sb_hash[i] - 1;
+	if (memcmp((cellattr_T *)gap->ga_data + idx, key,
+						      sizeof(cellattr_T)) == 0)
+	    return idx;
+    }
+
+    if (ga_grow(gap, 1) == FAIL)
+	return 0;
+    ((cellattr_T *)gap->ga_data)[gap->ga_len] = *key;
+    term->tl_sb_hash[i] = ++gap->ga_len;
+    return gap->ga_len - 1;
+}
+
+/*
+ * Return the palette index for "cellattr".
+ */
+    static int
+sb_cellattr2index(term_T *term, cellattr_T *cellattr)
+{
+    cellattr_T	key;
+
+    sb_normalize_cellattr(cellattr, &key);
+    return sb_palette_index(term, &key);
+}
+
+/*
+ * Return the attributes for palette index "idx".
+ */
+    static cellattr_T *
+sb_index2cellattr(term_T *term, int idx)
+{
+    if (idx >= term->tl_sb_palette.ga_len)
+	// palette is empty, out of memory
+	return &term->tl_default_color;
+    return (cellattr_T *)term->tl_sb_palette.ga_data + idx;
+}
+
+/*
+ * Encode the attributes of the "cols" cells in "cells" as runs.
+ * Returns allocated memory, NULL when "cols" is zero or out of memory.
+ */
+    static char_u *
+sb_encode_cells(term_T *term, cellattr_T *cells, int cols)
+{
+    garray_T	*gap = &term->tl_sb_buf;
+    cellattr_T	key;
+    cellattr_T	prev_key;
+    int		count = 0;
+    int		col;
+    char_u	*runs;
+
+    if (cols <= 0)
+	return NULL;
+    // A run takes at most 10 bytes.
+    gap->ga_len = 0;
+    if (ga_grow(gap, cols * 10) == FAIL)
+	return NULL;
+    for (col = 0; col <= cols; ++col)
+    {
+	if (col < cols)
+	{
+	    sb_normalize_cellattr(&cells[col], &key);
+	    if (count > 0 && memcmp(&key, &prev_key, sizeof(key)) == 0)
+	    {
+		++count;
+		continue;
+	    }
+	}
+	if (count > 0)
+	{
+	    gap->ga_len += sb_put_number((char_u *)gap->ga_data + gap->ga_len,
+									count);
+	    gap->ga_len += sb_put_number((char_u *)gap->ga_data + gap->ga_len,
+					   sb_palette_index(term, &prev_key));
+	}
+	prev_key = key;
+	count = 1;
+    }
+
+    runs = vim_memsave(gap->ga_data, gap->ga_len);
+    if (runs != NULL)
+	term->tl_sb_runs_size += gap->ga_len;
+    return runs;
+}
+
+/*
+ * Return the number of bytes used by the runs of "line".
+ */
+    static int
+sb_runs_len(sb_line_T *line)
+{
+    char_u	*p = line->sb_runs;
+    int		cols = 0;
+
+    if (p == NULL)
+	return 0;
+    while (cols < line->sb_cols)
+    {
+	cols += sb_get_number(&p);
+	(void)sb_get_number(&p);
+    }
+    return (int)(p - line->sb_runs);
+}
+
+/*
+ * Return the attributes of cell "col" in scrollback line "line".
+ * Use a negative "col" to get the filler attributes.
+ */
+    static cellattr_T *
+sb_line_cellattr(term_T *term, sb_line_T *line, int col)
+{
+    char_u	*p = line->sb_runs;
+    int		count;
+    int		idx;
+
+    if (col < 0 || col >= line->sb_cols || p == NULL)
+	return sb_index2cellattr(term, line->sb_fill_attr);
+    for (;;)
+    {
+	count = sb_get_number(&p);
+	idx = sb_get_number(&p);
+	if (col < count)
+	    return sb_index2cellattr(term, idx);
+	col -= count;
+    }
+}
+
+/*
+ * Put the attributes of the cells of "line" in "gap", which must have been
+ * initialized for cellattr_T items.
+ * Returns NULL when "line" has no cells or out of memory.
+ */
+    static cellattr_T *
+sb_line_cells(term_T *term, sb_line_T *line, garray_T *gap)
+{
+    char_u	*p = line->sb_runs;
+    cellattr_T	*cellattr;
+    int		count;
+
+    gap->ga_len = 0;
+    if (p == NULL || ga_grow(gap, line->sb_cols) == FAIL)
+	return NULL;
+    while (gap->ga_len < line->sb_cols)
+    {
+	count = sb_get_number(&p);
+	cellattr = sb_index2cellattr(term, sb_get_number(&p));
+	while (count-- > 0)
+	    ((cellattr_T *)gap->ga_data)[gap->ga_len++] = *cellattr;
+    }
+    return (cellattr_T *)gap->ga_data;
+}
+
+/*
+ * Free the runs of scrollback line "line".
+ */
+    static void
+sb_line_free(term_T *term, sb_line_T *line)
+{
+    if (line->sb_seg != NULL)
+    {
+	if (--line->sb_seg->ss_refcount == 0)
+	{
+	    term->tl_sb_seg_size -=
+			 offsetof(sb_seg_T, ss_data) + line->sb_seg->ss_len;
+	    vim_free(line->sb_seg);
+	}
+    }
+    else if (line->sb_runs != NULL)
+    {
+	term->tl_sb_runs_size -= sb_runs_len(line);
+	vim_free(line->sb_runs);
+    }
+    line->sb_runs = NULL;
+    line->sb_seg = NULL;
+    VIM_CLEAR(line->sb_text);
+}
+
+/*
+ * Move the runs of SB_SEG_LINES lines in "lines" to a new segment.  Lines that
+ * have the same runs as the line before them share them.
+ */
+    static void
+sb_pack_segment(term_T *term, sb_line_T *lines)
+{
+    sb_seg_T	*seg = NULL;
+    sb_line_T	*line;
+    char_u	*prev = NULL;
+    int		prev_len = 0;
+    int		len = 0;
+    int		runs_len;
+    int		pass;
+    int		i;
+
+    // The first pass computes the size, the second pass fills the segment.
+    for (pass = 1; pass <= 2; ++pass)
+    {
+	if (pass == 2)
+	{
+	    if (len == 0)
+		return;	    // nothing to pack
+	    seg = alloc(offsetof(sb_seg_T, ss_data) + len);
+	    if (seg == NULL)
+		return;
+	    seg->ss_refcount = 0;
+	    seg->ss_len = len;
+	    term->tl_sb_seg_size += offsetof(sb_seg_T, ss_data) + len;
+	    len = 0;
+	    prev = NULL;
+	}
+	for (i = 0; i < SB_SEG_LINES; ++i)
+	{
+	    line = lines + i;
+	    if (line->sb_seg != NULL || line->sb_runs == NULL)
+		continue;
+	    runs_len = sb_runs_len(line);
+	    if (prev == NULL || runs_len != prev_len
+				  || memcmp(prev, line->sb_runs, runs_len) != 0)
+	    {
+		if (pass == 1)
+		    prev = line->sb_runs;
+		else
+		{
+		    prev = seg->ss_data + len;
+		    mch_memmove(prev, line->sb_runs, runs_len);
+		}
+		prev_len = runs_len;
+		len += runs_len;
+	    }
+	    if (pass == 2)
+	    {
+		term->tl_sb_runs_size -= runs_len;
+		vim_free(line->sb_runs);
+		line->sb_runs = prev;
+		line->sb_seg = seg;
+		++seg->ss_refcount;
+	    }
+	}
+    }
+}
+
+/*
+ * Pack the older lines of the scrollback of "term" into segments.
+ */
+    static void
+sb_pack_lines(term_T *term)
+{
+    garray_T	*gap = &term->tl_scrollback;
+
+    while (term->tl_sb_packed + SB_SEG_LINES + SB_KEEP_LINES <= gap->ga_len)
+    {
+	sb_pack_segment(term, (sb_line_T *)gap->ga_data + term->tl_sb_packed);
+	term->tl_sb_packed += SB_SEG_LINES;
+    }
+}
+
 /*
  * Add an empty scrollback line to "term".  When "lnum" is not zero, add the
  * line at this position.  Otherwise at the end.
@@ -1659,8 +2147,10 @@ add_empty_scrollback(term_T *term, cellattr_T *fill_attr, int lnum)
 	    }
 	}
 	line->sb_cols = 0;
-	line->sb_cells = NULL;
-	line->sb_fill_attr = *fill_attr;
+	line->sb_runs = NULL;
+	line->sb_seg = NULL;
+	line->sb_fill_attr = sb_cellattr2index(term, fill_attr);
+	line->sb_text = NULL;
 	++term->tl_scrollback.ga_len;
 	return OK;
     }
@@ -1685,9 +2175,11 @@ cleanup_scrollback(term_T *term)
     {
 	ml_delete(curbuf->b_ml.ml_line_count);
 	line = (sb_line_T *)gap->ga_data + gap->ga_len - 1;
-	vim_free(line->sb_cells);
+	sb_line_free(term, line);
 	--gap->ga_len;
     }
+    if (term->tl_sb_packed > gap->ga_len)
+	term->tl_sb_packed = gap->ga_len;
     curbuf = curwin->w_buffer;
     if (curbuf == term->tl_buffer)
 	check_cursor();
@@ -1714,6 +2206,9 @@ update_snapshot(term_T *term)
     // outdated.
     cleanup_scrollback(term);
 
+    // The snapshot goes below the scrolled lines.
+    add_pending_scrollback_to_buffer(term);
+
     screen = vterm_obtain_screen(term->tl_vterm);
     fill_attr = new_fill_attr = term->tl_default_color;
     for (pos.row = 0; pos.row < term->tl_rows; ++pos.row)
@@ -1742,10 +2237,10 @@ update_snapshot(term_T *term)
 		    add_scrollback_line_to_buffer(term, (char_u *)"", 0);
 	    }
 
-	    if (len == 0)
+	    if (len == 0 || ga_grow(&term->tl_sb_cells, len) == FAIL)
 		p = NULL;
 	    else
-		p = ALLOC_MULT(cellattr_T, len);
+		p = (cellattr_T *)term->tl_sb_cells.ga_data;
 	    if ((p != NULL || len == 0)
 				     && ga_grow(&term->tl_scrollback, 1) == OK)
 	    {
@@ -1767,14 +2262,19 @@ update_snapshot(term_T *term)
 		    }
 		    else
 		    {
+			int	i;
+
 			width = cell.width;
 
 			cell2cellattr(&cell, &p[pos.col]);
+			// the second half of a double-width character gets the
+			// same attributes
+			for (i = 1; i < width && pos.col + i < len; ++i)
+			    p[pos.col + i] = p[pos.col];
 
 			// Each character can be up to 6 bytes.
 			if (ga_grow(&ga, VTERM_MAX_CHARS_PER_CELL * 6) == OK)
 			{
-			    int	    i;
 			    int	    c;
 
 			    for (i = 0; (c = cell.chars[i]) > 0 || i == 0; ++i)
@@ -1784,8 +2284,10 @@ update_snapshot(term_T *term)
 		    }
 		}
 		line->sb_cols = len;
-		line->sb_cells = p;
-		line->sb_fill_attr = new_fill_attr;
+		line->sb_runs = sb_encode_cells(term, p, len);
+		line->sb_seg = NULL;
+		line->sb_fill_attr = sb_cellattr2index(term, &new_fill_attr);
+		line->sb_text = NULL;
 		fill_attr = new_fill_attr;
 		++term->tl_scrollback.ga_len;
 
@@ -1798,8 +2300,6 @@ update_snapshot(term_T *term)
 		}
 		ga_clear(&ga);
 	    }
-	    else
-		vim_free(p);
 	}
     }
 
@@ -2991,7 +3491,10 @@ handle_movecursor(
 	if (wp->w_buffer == term->tl_buffer)
 	    position_cursor(wp, &pos, FALSE);
     }
-    if (term->tl_buffer == curbuf && !term->tl_normal_mode)
+    if (term->tl_writing_output)
+	// updated once in term_write_job_output()
+	term->tl_cursor_moved = TRUE;
+    else if (term->tl_buffer == curbuf && !term->tl_normal_mode)
     {
 	may_toggle_cursor(term);
 	update_cursor(term, term->tl_cursor_visible);
@@ -3137,16 +3640,21 @@ limit_scrollback(term_T *term, garray_T *gap, int update_buffer)
     if (gap->ga_len >= term->tl_buffer->b_p_twsl)
     {
 	int	todo = term->tl_buffer->b_p_twsl / 10;
+	int	in_buffer = term->tl_scrollback_scrolled
+						 - term->tl_scrollback_pending;
 	int	i;
 
 	curbuf = term->tl_buffer;
 	for (i = 0; i < todo; ++i)
 	{
-	    vim_free(((sb_line_T *)gap->ga_data + i)->sb_cells);
-	    if (update_buffer)
+	    sb_line_free(term, (sb_line_T *)gap->ga_data + i);
+	    // Pending lines are not in the buffer.
+	    if (update_buffer && i < in_buffer)
 		ml_delete(1);
 	}
 	curbuf = curwin->w_buffer;
+	if (update_buffer && todo > in_buffer)
+	    term->tl_scrollback_pending -= todo - in_buffer;
 
 	gap->ga_len -= todo;
 	mch_memmove(gap->ga_data,
@@ -3154,6 +3662,9 @@ limit_scrollback(term_T *term, garray_T *gap, int update_buffer)
 		    sizeof(sb_line_T) * gap->ga_len);
 	if (update_buffer)
 	    term->tl_scrollback_scrolled -= todo;
+	if (gap == &term->tl_scrollback)
+	    term->tl_sb_packed = todo > term->tl_sb_packed
+					       ? 0 : term->tl_sb_packed - todo;
     }
 }
 
@@ -3192,7 +3703,6 @@ handle_pushline(int cols, const VTermScreenCell *cells, void *user)
 	int		i;
 	int		c;
 	int		col;
-	int		text_len;
 	char_u		*text;
 	sb_line_T	*line;
 	garray_T	ga;
@@ -3206,8 +3716,8 @@ handle_pushline(int cols, const VTermScreenCell *cells, void *user)
 		cell2cellattr(&cells[i], &fill_attr);
 
 	ga_init2(&ga, 1, 100);
-	if (len > 0)
-	    p = ALLOC_MULT(cellattr_T, len);
+	if (len > 0 && ga_grow(&term->tl_sb_cells, len) == OK)
+	    p = (cellattr_T *)term->tl_sb_cells.ga_data;
 	if (p != NULL)
 	{
 	    for (col = 0; col < len; col += cells[col].width)
@@ -3221,41 +3731,38 @@ handle_pushline(int cols, const VTermScreenCell *cells, void *user)
 		    ga.ga_len += utf_char2bytes(c == NUL ? ' ' : c,
 					     (char_u *)ga.ga_data + ga.ga_len);
 		cell2cellattr(&cells[col], &p[col]);
+		// the second half of a double-width character gets the same
+		// attributes
+		for (i = 1; i < cells[col].width && col + i < len; ++i)
+		    p[col + i] = p[col];
 	    }
 	}
 	if (ga_grow(&ga, 1) == FAIL)
 	{
-	    if (update_buffer)
-		text = (char_u *)"";
-	    else
-		text = vim_strsave((char_u *)"");
-	    text_len = 0;
+	    ga_clear(&ga);
+	    text = NULL;
 	}
 	else
 	{
 	    text = ga.ga_data;
-	    text_len = ga.ga_len;
-	    *(text + text_len) = NUL;
+	    *(text + ga.ga_len) = NUL;
 	}
-	if (update_buffer)
-	    add_scrollback_line_to_buffer(term, text, text_len);
 
+	// The text is kept in the line, it is added to the buffer when
+	// needed, see add_pending_scrollback_to_buffer().
 	line = (sb_line_T *)gap->ga_data + gap->ga_len;
-	line->sb_cols = len;
-	line->sb_cells = p;
-	line->sb_fill_attr = fill_attr;
+	line->sb_cols = p == NULL ? 0 : len;
+	line->sb_runs = sb_encode_cells(term, p, line->sb_cols);
+	line->sb_seg = NULL;
+	line->sb_fill_attr = sb_cellattr2index(term, &fill_attr);
+	line->sb_text = text;
+	++gap->ga_len;
 	if (update_buffer)
 	{
-	    line->sb_text = NULL;
 	    ++term->tl_scrollback_scrolled;
-	    ga_clear(&ga);  // free the text
+	    ++term->tl_scrollback_pending;
+	    sb_pack_lines(term);
 	}
-	else
-	{
-	    line->sb_text = text;
-	    ga_init(&ga);  // text is kept in tl_scrollback_postponed
-	}
-	++gap->ga_len;
     }
     return 0; // ignored
 }
@@ -3277,34 +3784,30 @@ handle_postponed_scrollback(term_T *term)
     // above it.
     cleanup_scrollback(term);
 
+    // The lines become pending, they are added to the buffer when needed.
     for (i = 0; i < term->tl_scrollback_postponed.ga_len; ++i)
     {
-	char_u		*text;
 	sb_line_T	*pp_line;
-	sb_line_T	*line;
 
 	if (ga_grow(&term->tl_scrollback, 1) == FAIL)
+	{
+	    // Free the lines that can't be moved.
+	    for ( ; i < term->tl_scrollback_postponed.ga_len; ++i)
+		sb_line_free(term,
+		       (sb_line_T *)term->tl_scrollback_postponed.ga_data + i);
 	    break;
+	}
 	pp_line = (sb_line_T *)term->tl_scrollback_postponed.ga_data + i;
-
-	text = pp_line->sb_text;
-	if (text == NULL)
-	    text = (char_u *)"";
-	add_scrollback_line_to_buffer(term, text, (int)STRLEN(text));
-	vim_free(pp_line->sb_text);
-
-	line = (sb_line_T *)term->tl_scrollback.ga_data
-						 + term->tl_scrollback.ga_len;
-	line->sb_cols = pp_line->sb_cols;
-	line->sb_cells = pp_line->sb_cells;
-	line->sb_fill_attr = pp_line->sb_fill_attr;
-	line->sb_text = NULL;
+	*((sb_line_T *)term->tl_scrollback.ga_data
+				       + term->tl_scrollback.ga_len) = *pp_line;
 	++term->tl_scrollback_scrolled;
+	++term->tl_scrollback_pending;
 	++term->tl_scrollback.ga_len;
     }
 
     ga_clear(&term->tl_scrollback_postponed);
     limit_scrollback(term, &term->tl_scrollback, TRUE);
+    sb_pack_lines(term);
 }
 
 static VTermScreenCallbacks screen_callbacks = {
@@ -3517,11 +4020,15 @@ term_line2screenline(
 	VTermPos	*pos,
 	int		max_col)
 {
-    int off = screen_get_current_line_off();
+    int			off = screen_get_current_line_off();
+    VTermScreenCell	cell;
+    VTermScreenCell	prev_cell;
+    int			prev_attr = -1;
 
+    // Cleared once, so that unused bits compare equal below.
+    CLEAR_FIELD(cell);
     for (pos->col = 0; pos->col < max_col; )
     {
-	VTermScreenCell cell;
 	int		c;
 
 	if (vterm_screen_get_cell(screen, *pos, &cell) == 0)
@@ -3580,7 +4087,17 @@ term_line2screenline(
 	    else
 		ScreenLines[off] = c;
 	}
-	ScreenAttrs[off] = cell2attr(term, wp, cell.attrs, cell.fg, cell.bg);
+	// Most cells have the same attributes as the one before it, avoid
+	// looking up the highlighting for every cell.
+	if (prev_attr < 0
+		|| memcmp(&cell.attrs, &prev_cell.attrs, sizeof(cell.attrs)) != 0
+		|| memcmp(&cell.fg, &prev_cell.fg, sizeof(cell.fg)) != 0
+		|| memcmp(&cell.bg, &prev_cell.bg, sizeof(cell.bg)) != 0)
+	{
+	    prev_attr = cell2attr(term, wp, cell.attrs, cell.fg, cell.bg);
+	    prev_cell = cell;
+	}
+	ScreenAttrs[off] = prev_attr;
 
 	++pos->col;
 	++off;
@@ -3815,19 +4332,13 @@ term_get_attr(win_T *wp, linenr_T lnum, int col)
 {
     buf_T	*buf = wp->w_buffer;
     term_T	*term = buf->b_term;
-    sb_line_T	*line;
     cellattr_T	*cellattr;
 
     if (lnum > term->tl_scrollback.ga_len)
 	cellattr = &term->tl_default_color;
     else
-    {
-	line = (sb_line_T *)term->tl_scrollback.ga_data + lnum - 1;
-	if (col < 0 || col >= line->sb_cols)
-	    cellattr = &line->sb_fill_attr;
-	else
-	    cellattr = line->sb_cells + col;
-    }
+	cellattr = sb_line_cellattr(term,
+		      (sb_line_T *)term->tl_scrollback.ga_data + lnum - 1, col);
     return cell2attr(term, wp, cellattr->attrs, cellattr->fg, cellattr->bg);
 }
 
@@ -4238,6 +4749,7 @@ parse_osc(int command, VTermStringFragment frag, void *user)
 
     ((char *)gap->ga_data)[gap->ga_len] = 0;
     reader.js_buf = gap->ga_data;
+    reader.js_end = reader.js_buf + gap->ga_len;
     reader.js_fill = NULL;
     reader.js_used = 0;
     if (json_decode(&reader, &tv, 0) == OK
@@ -4389,6 +4901,9 @@ create_vterm(term_T *term, int rows, int cols)
     }
 
     vterm_screen_set_callbacks(screen, &screen_callbacks, term);
+    // Only the rows that changed are used, merge damage for each row instead
+    // of getting a callback for every character.
+    vterm_screen_set_damage_merge(screen, VTERM_DAMAGE_ROW);
     // TODO: depends on 'encoding'.
     vterm_set_utf8(vterm, 1);
 
@@ -4826,10 +5341,14 @@ read_dump_file(FILE *fd, VTermPos *cursor_pos)
 		if (max_cells < ga_cell.ga_len)
 		    max_cells = ga_cell.ga_len;
 		line->sb_cols = ga_cell.ga_len;
-		line->sb_cells = ga_cell.ga_data;
-		line->sb_fill_attr = term->tl_default_color;
+		line->sb_runs = sb_encode_cells(term, ga_cell.ga_data,
+							      ga_cell.ga_len);
+		line->sb_seg = NULL;
+		line->sb_fill_attr = sb_cellattr2index(term,
+						       &term->tl_default_color);
+		line->sb_text = NULL;
 		++term->tl_scrollback.ga_len;
-		ga_init(&ga_cell);
+		ga_cell.ga_len = 0;
 
 		ga_append(&ga_text, NUL);
 		ml_append(curbuf->b_ml.ml_line_count, ga_text.ga_data,
@@ -5236,9 +5755,10 @@ term_load_dump(typval_T *argvars, typval_T *rettv, int do_diff)
 		char_u *p2;
 		int	col;
 		sb_line_T   *sb_line = (sb_line_T *)term->tl_scrollback.ga_data;
-		cellattr_T *cellattr1 = (sb_line + lnum - 1)->sb_cells;
-		cellattr_T *cellattr2 = (sb_line + lnum + bot_lnum - 1)
-								    ->sb_cells;
+		garray_T    ga_cells1;
+		garray_T    ga_cells2;
+		cellattr_T  *cellattr1;
+		cellattr_T  *cellattr2;
 
 		// Make a copy, getting the second line will invalidate it.
 		line1 = vim_strsave(ml_get(lnum));
@@ -5246,6 +5766,12 @@ term_load_dump(typval_T *argvars, typval_T *rettv, int do_diff)
 		    break;
 		p1 = line1;
 
+		ga_init2(&ga_cells1, sizeof(cellattr_T), 100);
+		ga_init2(&ga_cells2, sizeof(cellattr_T), 100);
+		cellattr1 = sb_line_cells(term, sb_line + lnum - 1, &ga_cells1);
+		cellattr2 = sb_line_cells(term, sb_line + lnum + bot_lnum - 1,
+								  &ga_cells2);
+
 		line2 = ml_get(lnum + bot_lnum);
 		p2 = line2;
 		for (col = 0; col < width && *p1 != NUL && *p2 != NUL; ++col)
@@ -5307,6 +5833,8 @@ term_load_dump(typval_T *argvars, typval_T *rettv, int do_diff)
 		}
 
 		vim_free(line1);
+		ga_clear(&ga_cells1);
+		ga_clear(&ga_cells2);
 	    }
 	    if (add_empty_scrollback(term, &term->tl_default_color,
 						 term->tl_top_diff_rows) == OK)
@@ -5689,6 +6217,61 @@ f_term_setsize(typval_T *argvars UNUSED, typval_T *rettv UNUSED)
     term_report_winsize(term, term->tl_rows, term->tl_cols);
 }
 
+/*
+ * "term_getstats(buf)" function
+ */
+    void
+f_term_getstats(typval_T *argvars, typval_T *rettv)
+{
+    buf_T	*buf;
+    term_T	*term;
+    dict_T	*d;
+    garray_T	*gap;
+    sb_line_T	*line;
+    long_u	cells = 0;
+    long	packed = 0;
+    long_u	size;
+    int		i;
+
+    if (rettv_dict_alloc(rettv) == FAIL)
+	return;
+    buf = term_get_buf(argvars, "term_getstats()");
+    if (buf == NULL)
+	return;
+    term = buf->b_term;
+    d = rettv->vval.v_dict;
+
+    gap = &term->tl_scrollback;
+    for (i = 0; i < gap->ga_len; ++i)
+    {
+	line = (sb_line_T *)gap->ga_data + i;
+	cells += line->sb_cols;
+	if (line->sb_seg != NULL)
+	    ++packed;
+    }
+    gap = &term->tl_scrollback_postponed;
+    for (i = 0; i < gap->ga_len; ++i)
+	cells += ((sb_line_T *)gap->ga_data + i)->sb_cols;
+
+    size = (term->tl_scrollback.ga_maxlen
+			  + term->tl_scrollback_postponed.ga_maxlen)
+							   * sizeof(sb_line_T)
+	    + term->tl_sb_runs_size
+	    + term->tl_sb_seg_size
+	    + (term->tl_sb_palette.ga_maxlen + term->tl_sb_cells.ga_maxlen)
+							  * sizeof(cellattr_T)
+	    + term->tl_sb_hash_size * sizeof(int)
+	    + term->tl_sb_buf.ga_maxlen;
+
+    dict_add_number(d, "lines",
+	      term->tl_scrollback.ga_len + term->tl_scrollback_postponed.ga_len);
+    dict_add_number(d, "packed", packed);
+    dict_add_number(d, "palette", term->tl_sb_palette.ga_len);
+    dict_add_number(d, "memory", (varnumber_T)size);
+    dict_add_number(d, "cells_memory",
+				     (varnumber_T)(cells * sizeof(cellattr_T)));
+}
+
 /*
  * "term_getstatus(buf)" function
  */
@@ -5843,7 +6426,7 @@ f_term_scrape(typval_T *argvars, typval_T *rettv)
 	    // vterm has finished, get the cell from scrollback
 	    if (pos.col >= line->sb_cols)
 		break;
-	    cellattr = line->sb_cells + pos.col;
+	    cellattr = sb_line_cellattr(term, line, pos.col);
 	    width = cellattr->width;
 	    attrs = cellattr->attrs;
 	    fg = cellattr->fg;
@@ -44,7 +44,10 @@ TEST_VIM9_RES = \
 	test_vim9_script.res
 
 # Benchmark scripts.
-SCRIPTS_BENCH = test_bench_regexp.res
+SCRIPTS_BENCH = test_bench_channel.res test_bench_dict.res \
+	test_bench_json.res test_bench_list.res test_bench_regexp.res \
+	test_bench_sort.res test_bench_string.res \
+	test_bench_terminal.res test_bench_vim9.res
 
 # Individual tests, including the ones part of test_alot.
 # Please keep sorted up to test_alot.
@@ -151,7 +151,16 @@ test_gui_init.res: test_gui_init.vim
 opt_test.vim: ../optiondefs.h gen_opt_test.vim
 	$(VIMPROG) -u NONE -S gen_opt_test.vim --noplugin --not-a-term ../optiondefs.h
 
+test_bench_channel.res: test_bench_channel.vim
+test_bench_dict.res: test_bench_dict.vim
+test_bench_json.res: test_bench_json.vim
+test_bench_list.res: test_bench_list.vim
 test_bench_regexp.res: test_bench_regexp.vim
+test_bench_sort.res: test_bench_sort.vim
+test_bench_string.res: test_bench_string.vim
+test_bench_terminal.res: test_bench_terminal.vim
+test_bench_vim9.res: test_bench_vim9.vim
+$(SCRIPTS_BENCH):
 	-$(DEL) benchmark.out
 	@echo $(VIMPROG) > vimcmd
 	$(VIMPROG) -u NONE $(NO_INITS) -S runtest.vim $*.vim
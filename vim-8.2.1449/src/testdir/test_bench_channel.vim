@@ -0,0 +1,134 @@
+" Test for benchmarking reading from a channel
+
+source check.vim
+source shared.vim
+CheckFeature job
+CheckFeature reltime
+CheckUnix
+CheckExecutable cat
+
+func Measure(name, start)
+  call writefile([a:name .. ': ' .. reltimestr(reltime(a:start))],
+        \ 'benchmark.out', 'a')
+endfunc
+
+func Test_Channel_Read_Benchmark()
+  " A large JSON reply, e.g. a language server listing symbols.
+  let job = job_start('cat', {'mode': 'json', 'noblock': 1})
+  let symbols = map(range(200000), {i -> #{name: 'symbol_' .. i, line: i}})
+  let start = reltime()
+  call assert_equal(symbols, ch_evalexpr(job, symbols, {'timeout': 60000}))
+  call Measure('json reply', start)
+  call job_stop(job)
+
+  " Many lines in NL mode, e.g. output of a build.
+  let g:count = 0
+  let job = job_start('cat', {'mode': 'nl', 'noblock': 1,
+        \ 'callback': {ch, msg -> execute('let g:count += 1')}})
+  let text = repeat("some output of a command\n", 200000)
+  let start = reltime()
+  call ch_sendraw(job, text)
+  call WaitForAssert({-> assert_equal(200000, g:count)}, 60000)
+  call Measure('nl lines', start)
+  call job_stop(job)
+  unlet g:count
+endfunc
+
+func Test_Channel_Buffer_Benchmark()
+  " Many lines appended to a buffer shown in a window, e.g. a build log.
+  let job = job_start('cat', {'out_io': 'buffer', 'out_name': 'Xbenchbuf',
+        \ 'out_msg': 0, 'noblock': 1})
+  sp Xbenchbuf
+  let text = repeat("some output of a build command\n", 200000)
+  let start = reltime()
+  call ch_sendraw(job, text)
+  call WaitForAssert({-> assert_equal(200000, line('$'))}, 60000)
+  call Measure('lines to buffer', start)
+  call job_stop(job)
+  bwipe!
+endfunc
+
+func Test_Channel_Idle_Benchmark()
+  " Checking for typed keys while many channels are open but idle, e.g. a
+  " language server and a linter for every buffer.
+  let jobs = map(range(200), {-> job_start('cat', {'err_io': 'out'})})
+  let start = reltime()
+  for i in range(100000)
+    call getchar(0)
+  endfor
+  call Measure('200 idle channels', start)
+
+  " Only one of them is busy.
+  let g:count = 0
+  let job = job_start('cat', {'mode': 'nl',
+        \ 'callback': {ch, msg -> execute('let g:count += 1')}})
+  let start = reltime()
+  for i in range(20000)
+    call ch_sendraw(job, "a line\n")
+    call getchar(0)
+  endfor
+  call WaitForAssert({-> assert_equal(20000, g:count)}, 60000)
+  call Measure('200 idle and one busy channel', start)
+
+  for job in jobs + [job]
+    call job_stop(job)
+  endfor
+  unlet g:count
+endfunc
+
+func Test_Channel_Shm_Benchmark()
+  " A helper sending back a lot of text, e.g. a formatter.  The same client
+  " is used with pipes and with shared memory.
+  let python = PythonProg()
+  if python == ''
+    throw 'Skipped: Python command missing'
+  endif
+  let cmd = [python, '../../runtime/tools/shmclient.py']
+  let text = repeat(repeat('x', 999) .. "\n", 50000)
+  for transport in ['pipe', 'shm']
+    try
+      let job = job_start(transport == 'pipe' ? cmd + ['--pipe'] : cmd,
+            \ {'transport': transport, 'mode': 'raw', 'noblock': 1})
+    catch /E475:/
+      throw 'Skipped: shm transport not supported'
+    endtry
+    let start = reltime()
+    for i in range(4)
+      call ch_sendraw(job, text)
+    endfor
+    " Reading blocks until there is something, sleeping in between would
+    " hide the difference.
+    let received = 0
+    while received < 4 * len(text)
+      let received += len(ch_readraw(job, {'timeout': 10000}))
+    endwhile
+    call Measure('200 Mbyte through ' .. transport, start)
+    call assert_equal(4 * len(text), received)
+    call job_stop(job)
+  endfor
+endfunc
+
+func Test_Job_Start_Benchmark()
+  CheckExecutable true
+  " Many short jobs while a large buffer is loaded, e.g. a linter that runs
+  " on every save.  Starting a job used to copy the page tables of Vim.
+  new
+  setlocal noswapfile
+  call setline(1, repeat(['a line of text in a large buffer'], 2000000))
+  let start = reltime()
+  for i in range(1000)
+    let job = job_start('true')
+    while job_status(job) == 'run'
+    endwhile
+  endfor
+  call Measure('1000 jobs', start)
+
+  let start = reltime()
+  for i in range(200)
+    call system('true')
+  endfor
+  call Measure('200 system() calls', start)
+  bwipe!
+endfunc
+
+" vim: shiftwidth=2 sts=2 expandtab
@@ -0,0 +1,32 @@
+" Test for benchmarking Dictionary operations
+
+source check.vim
+CheckFeature reltime
+
+func Measure(name, cmd)
+  let start = reltime()
+  exe a:cmd
+  call writefile([a:name .. ': ' .. reltimestr(reltime(start))],
+        \ 'benchmark.out', 'a')
+endfunc
+
+func Test_Dict_Benchmark()
+  " Do about the same number of lookups for each size, so that the times can
+  " be compared.
+  let g:lookups = 100000
+  for g:n in [10, 1000, 100000, 1000000]
+    let g:rep = g:lookups / g:n
+    call Measure(g:n .. ' keys: build', 'let g:d = {} | for i in range(g:n) | let g:d["key" .. i] = i | endfor')
+    let g:keys = keys(g:d)
+    call Measure(g:n .. ' keys: lookup', 'for r in range(g:rep) | for k in g:keys | let x = g:d[k] | endfor | endfor')
+    call Measure(g:n .. ' keys: has_key() miss', 'for r in range(g:rep) | for k in g:keys | let x = has_key(g:d, k .. "x") | endfor | endfor')
+    call Measure(g:n .. ' keys: remove()', 'for k in g:keys | call remove(g:d, k) | endfor')
+  endfor
+  let g:d = {'alpha': 1, 'beta': 2, 'gamma': 3}
+  call Measure('member access', 'for i in range(g:lookups) | let x = g:d.alpha + g:d.beta + g:d.gamma | endfor')
+  let g:var = 0
+  call Measure('global variable', 'for i in range(g:lookups) | let g:var = g:var + 1 | endfor')
+  unlet g:d g:keys g:n g:rep g:lookups g:var
+endfunc
+
+" vim: shiftwidth=2 sts=2 expandtab
@@ -0,0 +1,54 @@
+" Test for benchmarking encoding and decoding large JSON messages
+
+source check.vim
+CheckFeature reltime
+
+func Measure(name, json)
+  let start = reltime()
+  let res = json_decode(a:json)
+  call writefile([a:name .. ' (' .. strlen(a:json) .. ' bytes): '
+        \ .. reltimestr(reltime(start))], 'benchmark.out', 'a')
+  return res
+endfunc
+
+func MeasureEncode(name, val)
+  let start = reltime()
+  let res = json_encode(a:val)
+  call writefile([a:name .. ' encode (' .. strlen(res) .. ' bytes): '
+        \ .. reltimestr(reltime(start))], 'benchmark.out', 'a')
+  return res
+endfunc
+
+func Test_Json_Benchmark()
+  " Similar to a language server reply with workspace symbols.
+  let symbols = []
+  for i in range(50000)
+    call add(symbols, #{name: 'symbol_name_' .. i, kind: i % 26,
+          \ containerName: 'SomeContainer',
+          \ location: #{uri: 'file:///home/user/project/src/module'
+          \   .. (i % 100) .. '/file.c',
+          \ range: #{start: #{line: i, character: 4},
+          \   end: #{line: i, character: 20}}}})
+  endfor
+  call assert_equal(symbols, Measure('symbols', json_encode(symbols)))
+
+  " Similar to a reply with semantic tokens.
+  let tokens = #{resultId: '1', data: range(1000000)}
+  call assert_equal(tokens, Measure('semantic tokens', json_encode(tokens)))
+
+  " Lines of text with escaped and multi-byte characters.
+  let lines = map(range(100000),
+        \ {i -> "some text with \"quotes\"\tand éè " .. i})
+  call assert_equal(lines, Measure('strings', json_encode(lines)))
+endfunc
+
+func Test_Json_Encode_Benchmark()
+  " Similar to sending the text of a buffer to a language server.
+  let lines = map(range(200000),
+        \ {i -> "    if (ptr->field_" .. i .. " != NULL)\t// check \"it\""})
+  let json = MeasureEncode('buffer lines', #{text: join(lines, "\n")})
+  call assert_equal(#{text: join(lines, "\n")}, json_decode(json))
+  call assert_equal(lines, json_decode(MeasureEncode('list of lines', lines)))
+endfunc
+
+" vim: shiftwidth=2 sts=2 expandtab
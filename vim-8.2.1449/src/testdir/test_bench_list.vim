@@ -0,0 +1,29 @@
+" Test for benchmarking List operations
+
+source check.vim
+CheckFeature reltime
+
+func Measure(name, cmd)
+  let start = reltime()
+  exe a:cmd
+  call writefile([a:name .. ': ' .. reltimestr(reltime(start))],
+        \ 'benchmark.out', 'a')
+endfunc
+
+func Test_List_Benchmark()
+  let g:n = 1000000
+  call Measure('build with add()', 'let g:l = [] | for i in range(g:n) | call add(g:l, i) | endfor')
+  call Measure('build with range()', 'let g:l = range(g:n) | let g:l[0] = 0')
+  call Measure('index in order', 'for i in range(g:n) | let x = g:l[i] | endfor')
+  call Measure('index randomly', 'for i in range(g:n) | let x = g:l[(i * 7919) % g:n] | endfor')
+  call Measure('reverse()', 'call reverse(g:l)')
+  call Measure('sort()', 'call sort(g:l, "n")')
+  call Measure('sort() with func', 'call sort(g:l, {a, b -> a - b})')
+  call Measure('remove() from end', 'for i in range(1000) | call remove(g:l, -1) | endfor')
+  call Measure('remove() from start', 'for i in range(100000) | call remove(g:l, 0) | endfor')
+  call Measure('insert() and index', 'for i in range(20000) | call insert(g:l, i) | let x = g:l[i] | endfor')
+  call Measure('insert() in the middle', 'for i in range(20000) | call insert(g:l, i, len(g:l) / 2) | let x = g:l[i] | endfor')
+  unlet g:l g:n
+endfunc
+
+" vim: shiftwidth=2 sts=2 expandtab
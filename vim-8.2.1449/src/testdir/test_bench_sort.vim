@@ -0,0 +1,33 @@
+" Test for benchmarking sort() and :sort
+
+source check.vim
+CheckFeature reltime
+
+func Measure(name, cmd)
+  let start = reltime()
+  exe a:cmd
+  call writefile([a:name .. ': ' .. reltimestr(reltime(start))],
+        \ 'benchmark.out', 'a')
+endfunc
+
+func Test_Sort_Benchmark()
+  let g:n = 1000000
+  let g:nums = map(range(g:n), {i -> (i * 7919) % g:n - g:n / 2})
+  let g:strs = map(copy(g:nums), {i, v -> 'Item ' .. v})
+  call Measure('sort() numbers with "N"', 'let g:l = sort(copy(g:nums), "N")')
+  call assert_equal(-g:n / 2, g:l[0])
+  call Measure('sort() numbers with "n"', 'let g:l = sort(copy(g:nums), "n")')
+  call Measure('sort() strings', 'let g:l = sort(copy(g:strs))')
+  call Measure('sort() strings with "i"', 'let g:l = sort(copy(g:strs), "i")')
+
+  new
+  call setline(1, g:strs[: 299999])
+  call Measure(':sort', 'sort')
+  call Measure(':sort i', 'sort i')
+  call Measure(':sort n', 'sort n')
+  call assert_equal('Item ' .. min(g:nums[: 299999]), getline(1))
+  bwipe!
+  unlet g:l g:n g:nums g:strs
+endfunc
+
+" vim: shiftwidth=2 sts=2 expandtab
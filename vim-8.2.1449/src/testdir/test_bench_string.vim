@@ -0,0 +1,59 @@
+" Test for benchmarking building a String from many pieces
+
+source check.vim
+CheckFeature reltime
+
+func Measure(name, func)
+  let start = reltime()
+  let s = call(a:func, [])
+  call writefile([a:name .. ': ' .. reltimestr(reltime(start))],
+        \ 'benchmark.out', 'a')
+  call assert_equal(s:count * 50, strlen(s))
+endfunc
+
+" 1M pieces of 50 bytes make a 50 Mbyte string.
+let s:count = 1000000
+let s:piece = repeat('x', 49) .. "\n"
+
+func LegacyAppend()
+  let s = ''
+  for i in range(s:count)
+    let s ..= s:piece
+  endfor
+  return s
+endfunc
+
+func LegacyJoin()
+  let l = []
+  for i in range(s:count)
+    call add(l, s:piece)
+  endfor
+  return join(l, '')
+endfunc
+
+def Vim9Append(): string
+  let s = ''
+  let p = s:piece
+  for i in range(s:count)
+    s ..= p
+  endfor
+  return s
+enddef
+
+def Vim9Concat(): string
+  let s = ''
+  let p = repeat('x', 24)
+  for i in range(s:count)
+    s ..= p .. i % 10 .. p .. "\n"
+  endfor
+  return s
+enddef
+
+func Test_String_Benchmark()
+  call Measure('legacy ..=', 'LegacyAppend')
+  call Measure('legacy join()', 'LegacyJoin')
+  call Measure('vim9 ..=', 'Vim9Append')
+  call Measure('vim9 ..= with ..', 'Vim9Concat')
+endfunc
+
+" vim: shiftwidth=2 sts=2 expandtab
@@ -0,0 +1,47 @@
+" Test for benchmarking the terminal scrollback
+
+source check.vim
+source shared.vim
+CheckFeature terminal
+CheckFeature reltime
+CheckUnix
+CheckExecutable cat
+
+func Measure(name, start)
+  call writefile([a:name .. ': ' .. reltimestr(reltime(a:start))],
+        \ 'benchmark.out', 'a')
+endfunc
+
+func Test_Terminal_Scrollback_Benchmark()
+  " Colored output scrolling by, e.g. a build with highlighted warnings.
+  call writefile(map(range(100000), {i -> "\e[1;33mwarning:\e[0m file"
+        \ .. i .. ".c:" .. i .. ": \e[32msomething\e[0m is not right"}),
+        \ 'Xbenchtext')
+  set termwinscroll=200000
+  let start = reltime()
+  let buf = term_start(['cat', 'Xbenchtext'], {'term_rows': 20})
+  while term_getstatus(buf) != 'finished'
+    call term_wait(buf, 1)
+  endwhile
+  call Measure('100000 scrollback lines', start)
+
+  let stats = term_getstats(buf)
+  call writefile(['scrollback memory: ' .. stats.memory
+        \ .. ' bytes, as cells: ' .. stats.cells_memory .. ' bytes'],
+        \ 'benchmark.out', 'a')
+
+  " Going through the scrollback, e.g. searching the build log.
+  let start = reltime()
+  for lnum in range(1, line('$'), 10)
+    for cell in term_scrape(buf, lnum)
+      call term_getattr(cell.attr, 'bold')
+    endfor
+  endfor
+  call Measure('scraping scrollback', start)
+
+  exe buf .. 'bwipe'
+  set termwinscroll&
+  call delete('Xbenchtext')
+endfunc
+
+" vim: shiftwidth=2 sts=2 expandtab
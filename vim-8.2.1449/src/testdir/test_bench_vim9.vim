@@ -0,0 +1,78 @@
+" Test for benchmarking Vim9 script loops
+
+source check.vim
+CheckFeature reltime
+
+func Measure(name, func)
+  let start = reltime()
+  call call(a:func, [])
+  call writefile([a:name .. ': ' .. reltimestr(reltime(start))],
+        \ 'benchmark.out', 'a')
+endfunc
+
+let s:count = 1000000
+let s:svar = 1
+
+func LegacyFunc(x)
+  return a:x
+endfunc
+
+def LoadGlobal()
+  let sum = 0
+  for i in range(s:count)
+    sum += g:gvar
+  endfor
+enddef
+
+def LoadBuffer()
+  let sum = 0
+  for i in range(s:count)
+    sum += b:bvar
+  endfor
+enddef
+
+def LoadScript()
+  let sum = 0
+  for i in range(s:count)
+    sum += s:svar
+  endfor
+enddef
+
+def CallLegacy()
+  let sum = 0
+  for i in range(s:count / 10)
+    sum += LegacyFunc(i)
+  endfor
+enddef
+
+def WhileLoop()
+  let sum = 0
+  let i = 0
+  while i < s:count
+    if i % 2 == 0
+      sum += 1
+    endif
+    i += 1
+  endwhile
+enddef
+
+def ForLoop()
+  let sum = 0
+  for i in range(s:count)
+    sum += i
+  endfor
+enddef
+
+func Test_Vim9_Benchmark()
+  let g:gvar = 1
+  let b:bvar = 1
+  call Measure('load g: variable', 'LoadGlobal')
+  call Measure('load b: variable', 'LoadBuffer')
+  call Measure('load s: variable', 'LoadScript')
+  call Measure('call legacy function', 'CallLegacy')
+  call Measure('while loop', 'WhileLoop')
+  call Measure('for loop over range()', 'ForLoop')
+  unlet g:gvar b:bvar
+endfunc
+
+" vim: shiftwidth=2 sts=2 expandtab
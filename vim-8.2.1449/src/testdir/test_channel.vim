@@ -989,6 +989,32 @@ func Test_pipe_to_nameless_buffer()
   endtry
 endfunc
 
+func Test_pipe_to_buffer_maxlines()
+  CheckExecutable cat
+
+  let job = job_start('cat', {'out_io': 'buffer', 'out_name': 'Xmaxlines',
+	\ 'out_msg': 0, 'out_maxlines': 100})
+  try
+    sp Xmaxlines
+    " Many lines arrive at once, only the last 100 are kept.
+    call ch_sendraw(job, join(range(1, 1000), "\n") .. "\n")
+    call WaitForAssert({-> assert_equal('1000', getline('$'))})
+    call assert_equal(map(range(901, 1000), 'string(v:val)'), getline(1, '$'))
+    " The cursor follows the output.
+    call assert_equal(100, line('.'))
+
+    call ch_sendraw(job, "one\ntwo\n")
+    call WaitForAssert({-> assert_equal('two', getline('$'))})
+    call assert_equal(['903', 'one', 'two'], [getline(1), getline(99), getline(100)])
+    call assert_equal(100, line('.'))
+    bwipe!
+  finally
+    call job_stop(job)
+  endtry
+
+  call assert_fails("call job_start('cat', {'out_io': 'buffer', 'out_maxlines': -1})", 'E475:')
+endfunc
+
 func Test_pipe_to_buffer_json()
   CheckFunction reltimefloat
 
@@ -1643,6 +1669,7 @@ func Test_job_start_fails()
   call assert_fails("call job_start('ls', {'out_cb' : -1})", 'E921:')
   call assert_fails("call job_start('ls', {'err_cb' : -1})", 'E921:')
   call assert_fails("call job_start('ls', {'close_cb' : -1})", 'E921:')
+  call assert_fails("call job_start('ls', {'drain_cb' : -1})", 'E921:')
   call assert_fails("call job_start('ls', {'exit_cb' : -1})", 'E921:')
   call assert_fails("call job_start('ls', {'term_name' : []})", 'E475:')
   call assert_fails("call job_start('ls', {'term_finish' : 'run'})", 'E475:')
@@ -1890,6 +1917,29 @@ func Test_cwd()
   endtry
 endfunc
 
+" A job only gets stdin, stdout and stderr, not file descriptors of Vim, such
+" as the pipes of another job.
+func Test_job_fds()
+  if !isdirectory('/proc/self/fd')
+    throw 'Skipped: /proc/self/fd not available'
+  endif
+  let job = job_start('cat')
+  let g:fds = []
+  let job2 = job_start(['ls', '/proc/self/fd'],
+        \ {'callback': {ch, msg -> add(g:fds, msg)}})
+  call WaitForAssert({-> assert_equal('dead', job_status(job2))})
+  call WaitForAssert({-> assert_equal(['0', '1', '2', '3'], g:fds)})
+
+  " Setting $PATH for the job makes it use fork().
+  let g:fds = []
+  let job2 = job_start(['ls', '/proc/self/fd'],
+        \ {'callback': {ch, msg -> add(g:fds, msg)}, 'env': {'PATH': $PATH}})
+  call WaitForAssert({-> assert_equal('dead', job_status(job2))})
+  call WaitForAssert({-> assert_equal(['0', '1', '2', '3'], g:fds)})
+  call job_stop(job)
+  unlet g:fds
+endfunc
+
 function Ch_test_close_lambda(port)
   let handle = ch_open(s:localhost . a:port, s:chopt)
   if ch_status(handle) == "fail"
@@ -2028,6 +2078,242 @@ func Test_raw_large_data()
   endtry
 endfunc
 
+func Test_json_large_data()
+  CheckUnix
+  CheckExecutable cat
+
+  " A message much larger than the pipe buffer goes through the write queue.
+  try
+    let g:out = []
+    let job = job_start('cat',
+          \ {'in_mode': 'json', 'out_mode': 'nl', 'noblock': 1,
+          \  'callback': {ch, msg -> add(g:out, msg)}})
+
+    let text = repeat('X', 100000) . "\t\"\\é" . repeat('Y', 100000)
+    call ch_sendexpr(job, text)
+    call ch_sendexpr(job, {'key': [text, 123]})
+    call WaitForAssert({-> assert_equal(2, len(g:out))}, 10000)
+    call assert_equal([1, text], json_decode(g:out[0]))
+    call assert_equal([2, {'key': [text, 123]}], json_decode(g:out[1]))
+  finally
+    call job_stop(job)
+    unlet g:out
+  endtry
+endfunc
+
+func Test_read_large_messages()
+  CheckUnix
+  CheckExecutable cat
+
+  " A JSON reply that arrives in many pieces.
+  let job = job_start('cat', {'mode': 'json', 'noblock': 1})
+  try
+    let text = repeat('X', 100000) . "\t\"\\é" . repeat('Y', 400000)
+    call assert_equal(text, ch_evalexpr(job, text, {'timeout': 10000}))
+    call assert_equal({'key': [text, 123]},
+          \ ch_evalexpr(job, {'key': [text, 123]}, {'timeout': 10000}))
+  finally
+    call job_stop(job)
+  endtry
+
+  " Many lines in NL mode, some of them long.
+  try
+    let g:out = []
+    let job = job_start('cat', {'mode': 'nl', 'noblock': 1,
+          \ 'callback': {ch, msg -> add(g:out, msg)}})
+    let lines = map(range(20000), {i -> i % 1000 == 0
+          \ ? repeat('a', 100000) : 'line ' .. i})
+    call ch_sendraw(job, join(lines, "\n") .. "\n")
+    call WaitForAssert({-> assert_equal(len(lines), len(g:out))}, 10000)
+    call assert_equal(lines, g:out)
+  finally
+    call job_stop(job)
+    unlet g:out
+  endtry
+endfunc
+
+func Test_write_queue_drain()
+  CheckUnix
+  CheckExecutable cat
+
+  let g:drained = 0
+  let g:count = 0
+  let job = job_start('cat', {'mode': 'nl', 'noblock': 1,
+	\ 'callback': {ch, msg -> execute('let g:count += 1')},
+	\ 'drain_cb': {ch -> execute('let g:drained += 1')}})
+  try
+    let info = ch_info(job)
+    call assert_equal(0, info.in_pending)
+    call assert_false(info.in_full)
+
+    " Much more than fits in a pipe, most of it is queued.
+    call ch_sendraw(job, repeat(repeat('x', 99) .. "\n", 40000))
+    let info = ch_info(job)
+    call assert_true(info.in_pending > 1024 * 1024)
+    call assert_true(info.in_full)
+
+    call WaitForAssert({-> assert_equal(1, g:drained)}, 10000)
+    call assert_false(ch_info(job).in_full)
+    call WaitForAssert({-> assert_equal(40000, g:count)}, 10000)
+    call assert_equal(0, ch_info(job).in_pending)
+    call assert_equal(1, g:drained)
+  finally
+    call job_stop(job)
+    unlet g:drained g:count
+  endtry
+endfunc
+
+func Test_shm_transport()
+  let cmd = [s:python, '../../runtime/tools/shmclient.py']
+  call assert_fails("call job_start(cmd, {'transport': 'xxx'})", 'E475:')
+  try
+    let job = job_start(cmd, {'transport': 'shm', 'mode': 'json'})
+  catch /E475:/
+    throw 'Skipped: shm transport not supported'
+  endtry
+  call assert_fails("call job_start(cmd, {'transport': 'shm', 'pty': 1})",
+	\ 'E475:')
+  call assert_fails("call job_start(cmd, {'transport': 'shm', "
+	\ .. "'out_io': 'null'})", 'E475:')
+  call assert_fails("call job_start(cmd, {'transport': 'shm', "
+	\ .. "'err_io': 'out'})", 'E475:')
+  try
+    " The client sends back what it receives, a JSON message is the reply to
+    " itself.
+    call assert_equal('hello', ch_evalexpr(job, 'hello'))
+
+    " More than fits in the rings, both sides have to wait for room.
+    let big = map(range(300000), {i -> 'item ' .. i})
+    call assert_equal(big, ch_evalexpr(job, big, {'timeout': 20000}))
+    call assert_equal(0, ch_info(job).in_pending)
+
+    call ch_close_in(job)
+    call WaitForAssert({-> assert_equal('dead', job_status(job))})
+  finally
+    call job_stop(job)
+  endtry
+endfunc
+
+" A job that puts a wrong position in a ring must not make Vim access memory
+" outside of it.
+func Test_shm_bad_position()
+  let script =<< trim END
+    import mmap, os, struct, sys, time
+    fd = int(os.environ['VIM_CHANNEL_SHM'])
+    mem = mmap.mmap(fd, os.fstat(fd).st_size)
+    # offset of the tail of the ring to the job or the head of the ring
+    # from the job
+    struct.pack_into('I', mem, int(sys.argv[1]), 0x80000000)
+    sys.stderr.write('ready\n')
+    sys.stderr.flush()
+    if sys.argv[1] == '256':
+      os.write(1, b'x')
+    time.sleep(5)
+  END
+  call writefile(script, 'Xshmbad.py')
+
+  let g:ready = 0
+  let opts = {'transport': 'shm', 'mode': 'raw',
+        \ 'err_cb': {ch, msg -> execute('let g:ready = 1')}}
+  try
+    let job = job_start([s:python, 'Xshmbad.py', '128'], opts)
+  catch /E475:/
+    call delete('Xshmbad.py')
+    throw 'Skipped: shm transport not supported'
+  endtry
+  try
+    call WaitForAssert({-> assert_equal(1, g:ready)})
+    call assert_fails('call ch_sendraw(job, "text")', 'E631:')
+    call assert_equal('closed', ch_info(job).in_status)
+  finally
+    call job_stop(job)
+  endtry
+
+  let g:ready = 0
+  let job = job_start([s:python, 'Xshmbad.py', '256'], opts)
+  try
+    call WaitForAssert({-> assert_equal('closed',
+          \ ch_status(job, {'part': 'out'}))})
+    call assert_equal('', ch_readraw(job, {'timeout': 0}))
+  finally
+    call job_stop(job)
+  endtry
+
+  unlet g:ready
+  call delete('Xshmbad.py')
+endfunc
+
+func LspCb(chan, msg)
+  call add(g:lspNotif, a:msg)
+endfunc
+
+func LspOtCb(chan, msg)
+  call add(g:lspOtMsgs, a:msg)
+endfunc
+
+" Test for the 'lsp' channel mode
+func Test_channel_lsp_mode()
+  let g:lspNotif = []
+  let g:lspOtMsgs = []
+  let job = job_start([s:python, 'test_channel_lsp.py'],
+        \ #{mode: 'lsp', callback: 'LspCb'})
+  let ch = job_getchannel(job)
+  call assert_equal('LSP', ch_info(ch).out_mode)
+  call assert_fails('call ch_sendexpr(ch, "text")', 'E715:')
+
+  " A request gets an "id" and "jsonrpc", the Dict itself is not changed.
+  let req = #{method: 'echo', params: #{text: 'héllo', list: [1, 2]}}
+  let resp = ch_evalexpr(ch, req)
+  call assert_equal(#{method: 'echo', params: #{text: 'héllo', list: [1, 2]}},
+        \ req)
+  call assert_true(resp.id > 0)
+  call assert_equal(#{jsonrpc: '2.0', id: resp.id, method: 'echo',
+        \ params: req.params}, resp.result)
+
+  " The reply to a request with a callback.
+  call ch_sendexpr(ch, #{method: 'echo', params: 'cb'},
+        \ #{callback: 'LspOtCb'})
+  call WaitForAssert({-> assert_equal(1, len(g:lspOtMsgs))})
+  call assert_equal('cb', g:lspOtMsgs[0].result.params)
+  call assert_equal(g:lspOtMsgs[0].id, g:lspOtMsgs[0].result.id)
+
+  " A notification does not get an "id", the reply without an ID goes to the
+  " channel callback.
+  call ch_sendexpr(ch, #{method: 'echo', params: 'notif'})
+  call WaitForAssert({-> assert_equal(1, len(g:lspNotif))})
+  call assert_false(has_key(g:lspNotif[0].result, 'id'))
+  call assert_equal(v:null, g:lspNotif[0].id)
+
+  " A notification and a request from the server go to the channel callback.
+  let g:lspNotif = []
+  call ch_sendexpr(ch, #{method: 'notify', params: 'progress'})
+  call WaitForAssert({-> assert_equal(2, len(g:lspNotif))})
+  call assert_equal(#{jsonrpc: '2.0', method: 'progress', params: 'progress'},
+        \ g:lspNotif[0])
+  call assert_equal('srv-1', g:lspNotif[1].id)
+
+  " A message that arrives in pieces.
+  call assert_equal(#{a: [1, 2]},
+        \ ch_evalexpr(ch, #{method: 'split', params: #{a: [1, 2]}}).result)
+
+  " Many messages at once, the reply is last.
+  let g:lspNotif = []
+  call assert_equal(100, ch_evalexpr(ch, #{method: 'many', params: 100}).result)
+  call WaitForAssert({-> assert_equal(100, len(g:lspNotif))})
+  call assert_equal(range(100), map(copy(g:lspNotif), 'v:val.params'))
+
+  " Other header fields are ignored, the name is not case sensitive.
+  call assert_equal('extra', ch_evalexpr(ch, #{method: 'extra-header'}).result)
+
+  " A message that can't be decoded is dropped.
+  call assert_true(has_key(ch_evalexpr(ch, #{method: 'invalid'}), 'id'))
+  call assert_equal(-32601, ch_evalexpr(ch, #{method: 'xxx'}).error.code)
+
+  call ch_sendexpr(ch, #{method: 'quit'})
+  call WaitForAssert({-> assert_equal('dead', job_status(job))})
+  unlet g:lspNotif g:lspOtMsgs
+endfunc
+
 func Test_no_hang_windows()
   CheckMSWindows
 
@@ -0,0 +1,87 @@
+#!/usr/bin/python
+#
+# Server that communicates over stdin/stdout using the Language Server
+# Protocol: a header with the Content-Length followed by a JSON message.
+#
+# This requires Python 2.6 or later.
+
+from __future__ import print_function
+import json
+import sys
+import time
+
+if sys.version_info[0] >= 3:
+    stdin = sys.stdin.buffer
+    stdout = sys.stdout.buffer
+else:
+    stdin = sys.stdin
+    stdout = sys.stdout
+
+
+def encode(msg, header='Content-Length: %d\r\n\r\n'):
+    body = json.dumps(msg).encode('utf-8')
+    return (header % len(body)).encode('utf-8') + body
+
+
+def send(data):
+    stdout.write(data)
+    stdout.flush()
+
+
+def read_message():
+    length = -1
+    while True:
+        line = stdin.readline()
+        if not line:
+            return None
+        line = line.decode('utf-8').strip()
+        if line == '':
+            break
+        if line.lower().startswith('content-length:'):
+            length = int(line[15:])
+    return json.loads(stdin.read(length).decode('utf-8'))
+
+
+if __name__ == "__main__":
+
+    while True:
+        req = read_message()
+        if req is None or req.get('method') == 'quit':
+            break
+        method = req.get('method')
+        params = req.get('params')
+        resp = {'jsonrpc': '2.0', 'id': req.get('id')}
+
+        if method == 'echo':
+            # Send the request back, to check what Vim sent.
+            resp['result'] = req
+            send(encode(resp))
+        elif method == 'notify':
+            # Send a notification and a request from the server.
+            send(encode({'jsonrpc': '2.0', 'method': 'progress',
+                         'params': params}))
+            send(encode({'jsonrpc': '2.0', 'id': 'srv-1',
+                         'method': 'workspace/configuration'}))
+        elif method == 'split':
+            # Send the header and the message in pieces.
+            data = encode(dict(resp, result=params))
+            for i in range(0, len(data), 7):
+                send(data[i:i + 7])
+                time.sleep(0.02)
+        elif method == 'many':
+            # Several messages in one write, the reply last.
+            data = b''
+            for i in range(params):
+                data += encode({'jsonrpc': '2.0', 'method': 'item',
+                                'params': i})
+            send(data + encode(dict(resp, result=params)))
+        elif method == 'extra-header':
+            header = 'Content-Type: application/vscode-jsonrpc; ' \
+                     'charset=utf-8\r\ncontent-length: %d\r\n\r\n'
+            send(encode(dict(resp, result='extra'), header))
+        elif method == 'invalid':
+            # A message that is not valid JSON, then the reply.
+            send(b'Content-Length: 5\r\n\r\n{"a":' + encode(resp))
+        else:
+            resp['error'] = {'code': -32601, 'message': 'unknown method'}
+            send(encode(resp))
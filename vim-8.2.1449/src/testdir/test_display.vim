@@ -245,4 +245,191 @@ func Test_visual_block_scroll()
   call delete(filename)
 endfunc
 
+" Test virtual columns and drawing in a very long line, which uses
+" checkpoints to avoid going over the whole line.
+func Test_display_long_line()
+  new
+  set nowrap
+  let unit = "ab\tcd\u3042ef"
+  let line = repeat(unit, 3000)
+  call setline(1, line)
+  for ts in [8, 3]
+    let &l:tabstop = ts
+    for k in [0, 150, 1000, 2999, 500]
+      let col = k * len(unit) + 1
+      let expect = strdisplaywidth(strpart(line, 0, col - 1)) + 1
+      call assert_equal(expect, virtcol([1, col]))
+      call cursor(1, col)
+      redraw
+      let pos = win_screenpos(0)
+      call assert_equal('a', screenstring(pos[0] + winline() - 1,
+            \ pos[1] + wincol() - 1))
+    endfor
+  endfor
+  call assert_equal(strdisplaywidth(line), virtcol([1, '$']) - 1)
+
+  " changing the text must not use stale checkpoints
+  call setline(1, "\t" .. line)
+  let col = 2000 * len(unit) + 2
+  call assert_equal(strdisplaywidth(strpart(getline(1), 0, col - 1)) + 1,
+        \ virtcol([1, col]))
+  set wrap&
+  bwipe!
+endfunc
+
+" Test that the cached widths of lines are updated when the text or options
+" change.
+func Test_display_line_width_cache()
+  new
+  10wincmd _
+  set wrap
+  call setline(1, repeat([repeat('x', 70)], 20))
+  vnew
+  setlocal nowrap
+  wincmd p
+  let width = winwidth(0)
+  let lines_per_line = (70 + width - 1) / width
+  normal! gg
+  redraw
+  call assert_equal((10 + lines_per_line - 1) / lines_per_line, line('w$'))
+  call assert_equal(71, virtcol([3, '$']))
+
+  " make the first lines short, more lines fit in the window
+  call setline(1, ['x', 'x', 'x', 'x'])
+  redraw
+  call assert_equal(2, virtcol([3, '$']))
+  call assert_equal(4 + (6 + lines_per_line - 1) / lines_per_line, line('w$'))
+
+  " insert a line, line numbers move
+  call append(0, repeat('y', 3 * width))
+  redraw
+  call assert_equal(3 * width + 1, virtcol([1, '$']))
+  call assert_equal(2, virtcol([4, '$']))
+  call assert_equal(71, virtcol([6, '$']))
+  1,5delete
+  redraw
+  call assert_equal(71, virtcol([3, '$']))
+
+  " a tab depends on 'tabstop'
+  call setline(2, "\tx")
+  call assert_equal(10, virtcol([2, '$']))
+  setlocal tabstop=4
+  call assert_equal(6, virtcol([2, '$']))
+  setlocal tabstop&
+
+  " and on 'vartabstop'
+  if has('vartabs')
+    call setline(2, "\t\tx")
+    call assert_equal(18, virtcol([2, '$']))
+    setlocal vartabstop=3,5
+    call assert_equal(10, virtcol([2, '$']))
+    setlocal vartabstop=2
+    call assert_equal(6, virtcol([2, '$']))
+    setlocal vartabstop&
+    call assert_equal(18, virtcol([2, '$']))
+  endif
+
+  " 'showbreak' changes the width of wrapped lines
+  set showbreak=>>>
+  call assert_equal(71 + 3 * (lines_per_line - 1), virtcol([4, '$']))
+  set showbreak&
+  call assert_equal(71, virtcol([4, '$']))
+
+  only!
+  bwipe!
+endfunc
+
+func Test_redrawstats()
+  new
+  call setline(1, repeat(['some text for the redraw statistics'], 20))
+  redraw!
+  let before = redrawstats()
+  call setline(10, 'changed')
+  redraw
+  let after = redrawstats()
+  call assert_equal(before.frames + 1, after.frames)
+  call assert_true(after.cells_skipped > before.cells_skipped)
+  call assert_true(after.cells_drawn > before.cells_drawn)
+  call assert_true(after.frame_bytes > 0)
+  call assert_equal(1, after.frame_writes)
+  call assert_true(after.frame_max_bytes >= after.frame_bytes)
+  bwipe!
+endfunc
+
+func Test_display_ttyasync()
+  CheckUnix
+  CheckRunVimInTerminal
+
+  let lines =<< trim END
+    set ttyasync scrolloff=0
+    call setline(1, range(1, 100))
+    " Return 1 when O_NONBLOCK is set on stdout, that would affect the shell.
+    func StdoutNonblock()
+      let info = '/proc/' .. getpid() .. '/fdinfo/1'
+      if !filereadable(info)
+        return 0
+      endif
+      let flags = matchstr(filter(readfile(info), 'v:val =~ "^flags"')[0], '\d\+$')
+      return and(str2nr(flags, 8), 0x800) != 0
+    endfunc
+  END
+  call writefile(lines, 'XtestTtyasync')
+  let buf = RunVimInTerminal('-S XtestTtyasync', #{rows: 8})
+  call term_sendkeys(buf, "50Gzt")
+  call WaitForAssert({-> assert_equal('50', term_getline(buf, 1))})
+  call term_sendkeys(buf, ":call setline('.', 'changed')\<CR>")
+  call WaitForAssert({-> assert_equal('changed', term_getline(buf, 1))})
+  call term_sendkeys(buf, ":echo 'blocked:' redrawstats().tty_blocked\<CR>")
+  call WaitForAssert({-> assert_match('^blocked: 0 ', term_getline(buf, 8))})
+  call term_sendkeys(buf, ":echo 'nonblock:' StdoutNonblock()\<CR>")
+  call WaitForAssert({-> assert_match('^nonblock: 0 ', term_getline(buf, 8))})
+
+  call StopVimInTerminal(buf)
+  call delete('XtestTtyasync')
+endfunc
+
+" Let the terminal be slow by sending the output through a pipe that is only
+" read after a second, the output must then be queued and superseded.
+func Test_display_ttyasync_queue()
+  CheckUnix
+
+  let after =<< trim END
+    set ttyasync
+    call setline(1, map(range(1, 3000), {_, v -> 'line ' .. v .. repeat(' x', 35)}))
+    for i in range(300)
+      exe 'normal! ' .. (i * 9 + 1) .. 'Gzt'
+      redraw!
+    endfor
+    call setline(1, 'the end')
+    1
+    redraw
+    let s = redrawstats()
+    " O_NONBLOCK on stdout must not be left set
+    let info = '/proc/' .. getpid() .. '/fdinfo/1'
+    let flags = filereadable(info) ? matchstr(filter(readfile(info), 'v:val =~ "^flags"')[0], '\d\+$') : '0'
+    let nonblock = and(str2nr(flags, 8), 0x800)
+    call writefile([s.tty_queued, s.tty_superseded, s.tty_blocked, nonblock], 'XttyasyncStats')
+    qa!
+  END
+  if !RunVimPiped([], after, '-i NONE | (sleep 1; cat > XttyasyncOut)',
+        \ 'TERM=xterm ')
+    return
+  endif
+
+  let [queued, superseded, blocked, nonblock] = readfile('XttyasyncStats')
+  call assert_true(queued > 0)
+  call assert_true(superseded > 0)
+  call assert_equal('0', blocked)
+  call assert_equal('0', nonblock)
+
+  " Queued output was written on exit, including the last frame and the
+  " cursor made visible again.
+  let out = join(readfile('XttyasyncOut', 'b'), "\n")
+  call assert_match('the end', out)
+  call assert_true(strridx(out, "\e[?25h") > strridx(out, "\e[?25l"))
+
+  call delete('XttyasyncStats')
+  call delete('XttyasyncOut')
+endfunc
+
 " vim: shiftwidth=2 sts=2 expandtab
@@ -151,6 +151,16 @@ func Test_json_decode()
   " Character in string after \ is ignored if not special.
   call assert_equal("x", json_decode('"\x"'))
 
+  " Plain text mixed with escapes and multi-byte characters.
+  call assert_equal("ab\tcd\"é\nxyz", json_decode('"ab\tcd\"é\nxyz"'))
+
+  if has('num64')
+    call assert_equal([123456789012345678, -123456789012345678,
+          \ 9223372036854775807],
+          \ json_decode('[123456789012345678, -123456789012345678, '
+          \ .. '12345678901234567890123]'))
+  endif
+
   " JSON is always encoded in utf-8 regardless of 'encoding' value.
   let save_encoding = &encoding
   set encoding=latin1
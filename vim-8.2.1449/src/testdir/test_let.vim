@@ -235,6 +235,52 @@ func Test_let_no_type_checking()
   let v = 'hello'
 endfunc
 
+func Test_let_append_string()
+  let s = ''
+  let other = 'x'
+  for i in range(100)
+    let s ..= 'ab'
+    let other .= i
+  endfor
+  call assert_equal(repeat('ab', 100), s)
+  call assert_equal(191, len(other))
+
+  let copy = s
+  let s ..= s
+  call assert_equal(repeat('ab', 100), copy)
+  call assert_equal(repeat('ab', 200), s)
+
+  let d = #{key: 'a'}
+  let d.key ..= 'b'
+  let d.key ..= 3
+  call assert_equal('ab3', d.key)
+
+  lockvar s
+  call assert_fails('let s ..= "x"', 'E741:')
+  call assert_equal(repeat('ab', 200), s)
+  unlockvar s
+  const c = 'abc'
+  call assert_fails('let c ..= "x"', 'E741:')
+  call assert_equal('abc', c)
+
+  " value replaced without ":let var =" after appending
+  let g:Xappend = 'abc'
+  let g:Xappend ..= 'def'
+  let g:['Xappend'] = 'x'
+  let g:Xappend ..= 'y'
+  call assert_equal('xy', g:Xappend)
+  call extend(g:, #{Xappend: 'p'})
+  let g:Xappend ..= 'q'
+  call assert_equal('pq', g:Xappend)
+  let moved = remove(g:, 'Xappend')
+  let moved ..= 'r'
+  call assert_equal('pqr', moved)
+  let v:errmsg = 'one'
+  let v:errmsg ..= 'two'
+  call assert_equal('onetwo', v:errmsg)
+  call assert_fails('let v:version ..= "x"', 'E46:')
+endfunc
+
 func Test_let_termcap()
   " Terminal code
   let old_t_te = &t_te
@@ -168,6 +168,68 @@ func Test_list_add()
   call assert_equal(1, add(test_null_list(), 4))
 endfunc
 
+" Indexing a long list after changing it
+func Test_list_index_long()
+  let l = range(1000)
+  call assert_equal(500, l[500])
+  call add(l, 1000)
+  call assert_equal(1000, l[-1])
+  call assert_equal(1000, l[1000])
+  call insert(l, -1)
+  call assert_equal(499, l[500])
+  call assert_equal(-1, l[0])
+  call remove(l, 0, 9)
+  call assert_equal(509, l[500])
+  call remove(l, -1)
+  call assert_equal(999, l[-1])
+  call add(l, 'end')
+  call assert_equal('end', l[-1])
+  call assert_equal(992, len(l))
+  call reverse(l)
+  call assert_equal('end', l[0])
+  call assert_equal(9, l[-1])
+  call remove(l, 0)
+  call sort(l, 'n')
+  call assert_equal(range(9, 999), l)
+  call assert_equal(509, l[500])
+  call filter(l, 'v:val % 2')
+  call assert_equal(509, l[250])
+  let l[250] = 'x'
+  call assert_equal('x', l[250])
+  call assert_equal([507, 'x', 511], l[249 : 251])
+endfunc
+
+" Inserting and removing in a long list that was indexed, the items found by
+" index must match the items in order.
+func Test_list_index_insert_remove()
+  let l = range(200)
+  call assert_equal(100, l[100])
+  let expect = range(200)
+  for i in range(100)
+    call remove(l, 0)
+    call add(l, i)
+    call insert(l, -i)
+    call insert(l, 'x', 50)
+    call remove(l, 60)
+    call remove(l, -3, -2)
+  endfor
+  for i in range(100)
+    call remove(expect, 0)
+    call add(expect, i)
+    call insert(expect, -i)
+    call insert(expect, 'x', 50)
+    call remove(expect, 60)
+    call remove(expect, -3, -2)
+  endfor
+  call assert_equal(expect, l)
+  call assert_equal(expect, map(range(len(l)), 'l[v:val]'))
+  call extend(l, [1, 2, 3], 10)
+  call assert_equal(1, l[10])
+  call assert_equal(3, l[12])
+  call uniq(l)
+  call assert_equal(copy(l), map(range(len(l)), 'l[v:val]'))
+endfunc
+
 " Tests for Dictionary type
 
 func Test_dict()
@@ -275,6 +337,24 @@ func Test_dict_big()
   unlet d
 endfunc
 
+" Looking up a key with a given length, e.g. for d.key
+func Test_dict_key_len()
+  let d = {'a': 1, 'ab': 2, 'abc': 3, 'abcde': 5}
+  call assert_equal(1, d.a)
+  call assert_equal(2, d.ab)
+  call assert_equal(3, d.abc)
+  call assert_equal(5, d.abcde)
+  call assert_fails('let x = d.abcd', 'E716:')
+  let key = repeat('x', 300)
+  let d[key] = 300
+  let d[key .. 'y'] = 301
+  exe 'call assert_equal(300, d.' .. key .. ')'
+  exe 'call assert_equal(301, d.' .. key .. 'y)'
+  exe 'let d.' .. key .. ' = 303'
+  call assert_equal(303, d[key])
+  call assert_equal(6, len(d))
+endfunc
+
 " Dictionary function
 func Test_dict_func()
   let d = {}
@@ -1050,4 +1130,92 @@ func Test_null_dict()
   unlockvar d
 endfunc
 
+" Test for gcstats()
+func Test_gcstats()
+  let before = gcstats()
+  let l = [1, 2]
+  let d = {'l': l}
+  let l[1] = d
+  unlet l d
+  call test_garbagecollect_now()
+  let after = gcstats()
+  call assert_equal(before.count + 1, after.count)
+  call assert_true(after.lastfreed >= 2)
+  call assert_true(after.freed >= before.freed + 2)
+  if has('reltime') && has('float')
+    call assert_equal(v:t_float, type(after.lastpause))
+    call assert_true(after.maxpause >= after.lastpause)
+    call assert_true(after.totalpause >= before.totalpause + after.lastpause)
+  endif
+endfunc
+
+func s:MakeCycle()
+  let l = [1]
+  let d = {'l': l}
+  call add(l, d)
+endfunc
+
+func s:GetClosure()
+  let d = {'v': []}
+  return {-> d}
+endfunc
+
+" Test for an incremental garbage collection, with lists and dicts changed in
+" between the steps.
+func Test_garbagecollect_step()
+  let before = gcstats()
+  let g:Xgc_list = [[0]]
+  let g:Xgc_dict = {'0': {'l': [0]}}
+  let g:Xgc_nested = [{'l': []}]
+  let g:Xgc_get = s:GetClosure()
+  call s:MakeCycle()
+  let n = 0
+  while test_garbagecollect_step()
+    let n += 1
+    if n > 20
+      continue
+    endif
+    " The new values are only referenced from lists and dicts that may have
+    " been marked already.
+    call add(g:Xgc_list, [n])
+    let g:Xgc_list[0] = [n]
+    let g:Xgc_dict[n] = {'l': [n]}
+    let g:Xgc_dict['0'] = {'l': [n]}
+    call extend(g:Xgc_nested[0].l, [[n]])
+    call map(g:Xgc_nested, {_, v -> {'l': v.l}})
+    if n == 1
+      let g:Xgc_get2 = s:GetClosure()
+    endif
+    call add(g:Xgc_get().v, [n])
+    call add(g:Xgc_get2().v, [n])
+    " Does not stop the garbage collection.
+    call json_encode(g:Xgc_dict)
+  endwhile
+  let after = gcstats()
+  call assert_true(n > 20)
+  call assert_true(after.count > before.count)
+  call assert_true(after.steps > before.steps + 20)
+  call assert_true(after.lastfreed >= 2)
+
+  let expected = map(range(1, 20), '[v:val]')
+  call assert_equal([[20]] + expected, g:Xgc_list)
+  call assert_equal({'l': [20]}, g:Xgc_dict['0'])
+  for i in range(1, 20)
+    call assert_equal({'l': [i]}, g:Xgc_dict[i])
+  endfor
+  call assert_equal([{'l': expected}], g:Xgc_nested)
+  call assert_equal(expected, g:Xgc_get().v)
+  call assert_equal(expected, g:Xgc_get2().v)
+
+  " Using a copyID for something else makes it start over.
+  call assert_true(test_garbagecollect_step())
+  call deepcopy(g:Xgc_list)
+  let before = gcstats()
+  call assert_false(test_garbagecollect_step())
+  call assert_true(gcstats().count > before.count)
+  call assert_equal([[20]] + expected, g:Xgc_list)
+
+  unlet g:Xgc_list g:Xgc_dict g:Xgc_nested g:Xgc_get g:Xgc_get2
+endfunc
+
 " vim: shiftwidth=2 sts=2 expandtab
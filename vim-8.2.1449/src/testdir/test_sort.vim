@@ -34,6 +34,23 @@ func Test_sort_float()
   call assert_equal([0.28, 3, 13.5], sort([13.5, 0.28, 3], 'f'))
 endfunc
 
+func Test_sort_numbers_many()
+  " "N" on a List of Numbers uses a radix sort, check it against a compare
+  " function, also for negative and big numbers.
+  let l = map(range(1000), {i -> (i * 7919) % 1000 - 500})
+  let l += [9223372036854775807, -9223372036854775807 - 1, 0, 256, -256]
+  let l += map(range(100), {i -> i * 123456789012 - 6000000000000})
+  call assert_equal(sort(copy(l), {a, b -> a > b ? 1 : a < b ? -1 : 0}),
+        \ sort(copy(l), 'N'))
+  call assert_equal(sort(copy(l), {a, b -> a > b ? 1 : a < b ? -1 : 0}),
+        \ sort(copy(l), 'n'))
+
+  " equal strings keep their order, both with and without ignoring case
+  let l = ['b', 'B', 'a', 'A', 'b', 'a', 'B']
+  call assert_equal(['A', 'B', 'B', 'a', 'a', 'b', 'b'], sort(copy(l)))
+  call assert_equal(['a', 'A', 'a', 'b', 'B', 'b', 'B'], sort(copy(l), 'i'))
+endfunc
+
 func Test_sort_nested()
   " test ability to call sort() from a compare function
   call assert_equal([1, 3, 5], sort([3, 1, 5], 'Compare1'))
@@ -568,6 +568,62 @@ func Test_startuptime()
   call delete('Xtestout')
 endfunc
 
+func Test_startuptime_compile_def()
+  CheckFeature startuptime
+  let lines =<< trim END
+    vim9script
+    def StartupFunc(): number
+      return 42
+    enddef
+    g:startup_result = StartupFunc()
+  END
+  call writefile(lines, 'Xstartupdef.vim')
+  let before = ['source Xstartupdef.vim']
+  let after = ['call writefile([g:startup_result], "Xresult")', 'qall']
+  if RunVim(before, after, '--startuptime Xtestout')
+    call assert_equal(['42'], readfile('Xresult'))
+    let lines = readfile('Xtestout')
+    call assert_match('compiling :def function <SNR>\d\+_StartupFunc',
+	  \ join(lines, "\n"))
+  endif
+  call delete('Xstartupdef.vim')
+  call delete('Xtestout')
+  call delete('Xresult')
+endfunc
+
+func Test_startuptime_def_cache()
+  CheckFeature startuptime
+  let lines =<< trim END
+    vim9script
+    def StartupFunc(): number
+      return 42
+    enddef
+    g:startup_result = StartupFunc()
+  END
+  call writefile(lines, 'Xstartupdef.vim')
+  call mkdir('Xdefcache')
+  let before = ['set defcachedir=Xdefcache', 'source Xstartupdef.vim']
+  let after = ['call writefile([g:startup_result], "Xresult")', 'qall']
+  if RunVim(before, after, '--startuptime Xtestout')
+    call assert_equal(['42'], readfile('Xresult'))
+    call assert_match('compiling :def function <SNR>\d\+_StartupFunc',
+	  \ join(readfile('Xtestout'), "\n"))
+    call delete('Xtestout')
+
+    " The second time the function is loaded from the cache.
+    call RunVim(before, after, '--startuptime Xtestout')
+    call assert_equal(['42'], readfile('Xresult'))
+    let out = join(readfile('Xtestout'), "\n")
+    call assert_match('loading :def function <SNR>\d\+_StartupFunc from cache',
+	  \ out)
+    call assert_notmatch('compiling :def function', out)
+  endif
+  call delete('Xstartupdef.vim')
+  call delete('Xdefcache', 'rf')
+  call delete('Xtestout')
+  call delete('Xresult')
+endfunc
+
 func Test_read_stdin()
   let after =<< trim [CODE]
     write Xtestout
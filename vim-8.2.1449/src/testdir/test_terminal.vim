@@ -328,6 +328,86 @@ func Test_terminal_scrollback()
   call delete('Xtext')
 endfunc
 
+" Scrolled lines are added to the buffer when they are asked for.
+" When the screen update for terminal output is postponed because of
+" 'redrawinterval', the cursor must be put at the job's cursor when it is done,
+" also when the job made it invisible.
+func Test_terminal_redrawinterval_cursor()
+  CheckRunVimInTerminal
+  CheckExecutable sh
+
+  " the second output arrives before 'redrawinterval' has passed and hides
+  " the cursor
+  call writefile(['printf one', 'sleep 0.3',
+        \ "printf '\\033[?25l two three'", 'sleep 10'], 'XtermRedraw.sh')
+  let lines =<< trim END
+    set redrawinterval=1000
+    term ++curwin sh XtermRedraw.sh
+  END
+  call writefile(lines, 'XtermRedrawinterval')
+  let buf = RunVimInTerminal('-S XtermRedrawinterval', #{rows: 8})
+  call WaitForAssert({-> assert_match('^one two three', term_getline(buf, 1))})
+  call WaitForAssert({-> assert_equal([1, 14], term_getcursor(buf)[0:1])})
+  call WaitForAssert({-> assert_equal(0, term_getcursor(buf)[2].visible)})
+
+  call term_sendkeys(buf, "\<C-W>:qa!\<CR>")
+  call WaitForAssert({-> assert_equal('finished', term_getstatus(buf))})
+  exe buf .. 'bwipe!'
+  call delete('XtermRedrawinterval')
+  call delete('XtermRedraw.sh')
+endfunc
+
+func Test_terminal_scrollback_pending()
+  CheckUnix
+  call writefile(range(50), 'Xtext')
+  let buf = term_start(['sh', '-c', 'cat Xtext; sleep 10'], {'term_rows': 5})
+  call WaitForAssert({-> assert_match('49', term_getline(buf, 4))})
+  call assert_equal(['0', '1'], getbufline(buf, 1, 2))
+  call assert_equal(['45'], getbufline(buf, 46))
+  call assert_equal(46, getbufinfo(buf)[0].linecount)
+  call assert_equal('0', getline(1))
+  call assert_equal(46, line('$'))
+
+  call job_stop(term_getjob(buf))
+  call WaitForAssert({-> assert_equal('finished', term_getstatus(buf))})
+  exe buf .. 'bwipe'
+  call delete('Xtext')
+endfunc
+
+func Test_terminal_scrollback_stats()
+  CheckUnix
+  call assert_equal({}, term_getstats(bufnr()))
+
+  " Lines with a red word, most of them get packed.
+  call writefile(map(range(3000), {i -> "\e[31mred\e[0m line " .. i}),
+	\ 'Xtext')
+  let buf = term_start(['cat', 'Xtext'], {'term_rows': 5})
+  call WaitForAssert({-> assert_equal('finished', term_getstatus(buf))})
+  call TermWait(buf)
+  call assert_equal('red line 9', getline(10))
+
+  let stats = term_getstats(buf)
+  call assert_equal(line('$'), stats.lines)
+  call assert_inrange(1000, 2000, stats.packed)
+  call assert_inrange(2, 5, stats.palette)
+  call assert_true(stats.memory * 4 < stats.cells_memory)
+
+  " Colors of a packed line are the same as of a line at the end.
+  10
+  normal! zt
+  redraw
+  let red = screenattr(1, 1)
+  call assert_notequal(red, screenattr(1, 5))
+  $
+  normal! zb
+  redraw
+  call assert_equal(red, screenattr(winheight(0), 1))
+  call assert_equal(screenattr(1, 5), screenattr(winheight(0), 5))
+
+  exe buf .. 'bwipe'
+  call delete('Xtext')
+endfunc
+
 func Test_terminal_postponed_scrollback()
   " tail -f only works on Unix
   CheckUnix
@@ -449,4 +449,24 @@ func Test_timer_changing_function_list()
   call delete('XTest_timerchange')
 endfunc
 
+" Test that redraws for timer callbacks are limited by 'redrawinterval'
+func Test_timer_redrawinterval()
+  set redrawinterval=1000
+  new
+  redraw!
+  let before = redrawstats()
+  call timer_start(0, {-> setline(1, 'changed')})
+  sleep 50m
+  let stats = redrawstats()
+  call assert_equal(before.async_skipped + 1, stats.async_skipped)
+  call assert_equal(1, stats.async_pending)
+
+  " the postponed redraw is done when the interval has passed
+  call WaitForAssert({-> assert_equal(0, redrawstats().async_pending)})
+  call assert_equal(before.async_redraws + 1, redrawstats().async_redraws)
+
+  set redrawinterval&
+  bwipe!
+endfunc
+
 " vim: shiftwidth=2 sts=2 expandtab
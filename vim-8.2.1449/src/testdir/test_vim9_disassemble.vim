@@ -782,8 +782,7 @@ def Test_disassemble_for_loop()
         '\d STORE -1 in $1\_s*' ..
         '\d PUSHNR 3\_s*' ..
         '\d BCALL range(argc 1)\_s*' ..
-        '\d FOR $1 -> \d\+\_s*' ..
-        '\d STORE $2\_s*' ..
+        '\d FOR $1 -> \d\+ in $2\_s*' ..
         'res->add(i)\_s*' ..
         '\d LOAD $0\_s*' ..
         '\d LOAD $2\_s*' ..
@@ -815,14 +814,11 @@ def Test_disassemble_for_loop_eval()
         '\d PUSHS "\["one", "two"\]"\_s*' ..
         '\d BCALL eval(argc 1)\_s*' ..
         '\d CHECKTYPE list stack\[-1\]\_s*' ..
-        '\d FOR $1 -> \d\+\_s*' ..
-        '\d STORE $2\_s*' ..
+        '\d FOR $1 -> \d\+ in $2\_s*' ..
         'res ..= str\_s*' ..
-        '\d\+ LOAD $0\_s*' ..
         '\d\+ LOAD $2\_s*' ..
         '\d\+ CHECKTYPE string stack\[-1\]\_s*' ..
-        '\d\+ CONCAT\_s*' ..
-        '\d\+ STORE $0\_s*' ..
+        '\d\+ APPENDSTR $0\_s*' ..
         'endfor\_s*' ..
         '\d\+ JUMP -> 6\_s*' ..
         '\d\+ DROP\_s*' ..
@@ -832,6 +828,59 @@ def Test_disassemble_for_loop_eval()
         instr)
 enddef
 
+def WhileLoop(n: number): number
+  let sum = 0
+  let i = 0
+  while i < n
+    sum += i
+    i += 1
+  endwhile
+  if sum > 100 || sum < 10
+    sum -= 5
+  endif
+  return sum
+enddef
+
+def Test_disassemble_fused()
+  assert_equal(45, WhileLoop(10))
+  assert_equal(-5, WhileLoop(0))
+  let instr = execute('disassemble WhileLoop')
+  assert_match('WhileLoop\_s*' ..
+        'let sum = 0\_s*' ..
+        '\d STORE 0 in $0\_s*' ..
+        'let i = 0\_s*' ..
+        '\d STORE 0 in $1\_s*' ..
+        'while i < n\_s*' ..
+        '\d LOAD $1\_s*' ..
+        '\d LOAD arg\[-1\]\_s*' ..
+        '\d COMPARENR < JUMP_IF_FALSE -> 11\_s*' ..
+        'sum += i\_s*' ..
+        '\d LOAD $0\_s*' ..
+        '\d LOAD $1\_s*' ..
+        '\d OPNR +\_s*' ..
+        '\d STORE $0\_s*' ..
+        'i += 1\_s*' ..
+        '\d INCNR 1 in $1\_s*' ..
+        'endwhile\_s*' ..
+        '\d\+ JUMP -> 2\_s*' ..
+        'if sum > 100 || sum < 10\_s*' ..
+        '\d\+ LOAD $0\_s*' ..
+        '\d\+ PUSHNR 100\_s*' ..
+        '\d\+ COMPARENR >\_s*' ..
+        '\d\+ JUMP_AND_KEEP_IF_TRUE -> 18\_s*' ..
+        '\d\+ LOAD $0\_s*' ..
+        '\d\+ PUSHNR 10\_s*' ..
+        '\d\+ COMPARENR <\_s*' ..
+        '\d\+ JUMP_IF_FALSE -> 20\_s*' ..
+        'sum -= 5\_s*' ..
+        '\d\+ INCNR -5 in $0\_s*' ..
+        'endif\_s*' ..
+        'return sum\_s*' ..
+        '\d\+ LOAD $0\_s*' ..
+        '\d\+ RETURN',
+        instr)
+enddef
+
 let g:number = 42
 
 def TypeCast()
@@ -971,6 +1020,37 @@ def Test_disassemble_concat()
   assert_equal('aabb', ConcatString())
 enddef
 
+def AppendString(): string
+  let res = 'a'
+  if len(res) > 5
+    res = ''
+  endif
+  res ..= 'b' .. res
+  res ..= string(len(res))
+  return res
+enddef
+
+def Test_disassemble_append()
+  let instr = execute('disassemble AppendString')
+  assert_match('AppendString.*' ..
+        'endif\_s*' ..
+        'res ..= ''b'' .. res\_s*' ..
+        '\d\+ PUSHS "b"\_s*' ..
+        '\d\+ LOAD $0\_s*' ..
+        '\d\+ CONCAT\_s*' ..
+        '\d\+ APPENDSTR $0\_s*' ..
+        'res ..= string(len(res))\_s*' ..
+        '\d\+ LOAD $0\_s*' ..
+        '\d\+ LOAD $0\_s*' ..
+        '\d\+ BCALL len(argc 1)\_s*' ..
+        '\d\+ BCALL string(argc 1)\_s*' ..
+        '\d\+ CONCAT\_s*' ..
+        '\d\+ STORE $0\_s*' ..
+        'return res.*',
+        instr)
+  assert_equal('aba3', AppendString())
+enddef
+
 def StringIndex(): number
   let s = "abcd"
   let res = s[1]
@@ -1188,7 +1268,7 @@ def Test_disassemble_compare()
         '\d \(PUSH\|FUNCREF\).*' ..
         '\d \(PUSH\|FUNCREF\|LOAD\).*' ..
         '\d ' .. case[1] .. '.*' ..
-        '\d JUMP_IF_FALSE -> \d\+.*',
+        'JUMP_IF_FALSE -> \d\+.*',
         instr)
 
     nr += 1
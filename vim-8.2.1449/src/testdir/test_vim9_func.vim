@@ -385,6 +385,29 @@ func DefinedLater(arg)
   return a:arg
 endfunc
 
+def CallCachedFunc(): string
+  return CachedFunc()
+enddef
+
+func Test_call_ufunc_cached()
+  func! CachedFunc()
+    return 'first'
+  endfunc
+  call assert_equal('first', CallCachedFunc())
+  call assert_equal('first', CallCachedFunc())
+  func! CachedFunc()
+    return 'second'
+  endfunc
+  call assert_equal('second', CallCachedFunc())
+  delfunc CachedFunc
+  call assert_fails('call CallCachedFunc()', 'E117:')
+  func CachedFunc()
+    return 'third'
+  endfunc
+  call assert_equal('third', CallCachedFunc())
+  delfunc CachedFunc
+endfunc
+
 def Test_call_funcref()
   assert_equal(3, g:SomeFunc('abc'))
   assert_fails('NotAFunc()', 'E117:') # comment after call
@@ -1448,5 +1471,52 @@ def Test_restore_modifiers()
   assert_equal('', g:ei_after)
 enddef
 
+def Test_def_cache()
+  mkdir('Xdefcache')
+  set defcachedir=Xdefcache
+  let lines =<< trim END
+      vim9script
+      let s:total = 0
+      def Add(n: number, m: number = 1): number
+        s:total += n + m
+        return s:total
+      enddef
+      def g:DefCacheTest(): list<any>
+        let res = []
+        for i in range(3)
+          res->add(Add(i))
+        endfor
+        try
+          throw 'oops'
+        catch /oops/
+          res->add(v:exception)
+        endtry
+        res->add(0z00ff)
+        res->add({'key': [s:total]})
+        return res
+      enddef
+  END
+  writefile(lines, 'XdefCache.vim')
+  source XdefCache.vim
+  let expected = [1, 3, 6, 'oops', 0z00ff, {'key': [6]}]
+  assert_equal(expected, g:DefCacheTest())
+  assert_equal(1, len(readdir('Xdefcache')))
+
+  # Sourcing the script again uses the cached instructions.
+  source XdefCache.vim
+  assert_equal(expected, g:DefCacheTest())
+
+  # After a change the function is compiled again.
+  lines[3] = '  s:total += n * 2 + m'
+  writefile(lines, 'XdefCache.vim')
+  source XdefCache.vim
+  assert_equal([1, 4, 9, 'oops', 0z00ff, {'key': [9]}], g:DefCacheTest())
+
+  set defcachedir&
+  delete('XdefCache.vim')
+  delete('Xdefcache', 'rf')
+  delfunc g:DefCacheTest
+enddef
+
 
 " vim: ts=8 sw=2 sts=2 expandtab tw=80 fdm=marker
@@ -605,6 +605,32 @@ def Test_unlet()
   assert_equal('', $ENVVAR)
 enddef
 
+def GetBufCached(): any
+  return b:cached
+enddef
+
+def Test_load_var_cached()
+  g:cached = 1
+  let res: list<number> = []
+  for i in range(3)
+    add(res, g:cached)
+    unlet g:cached
+    g:cached = i + 10
+  endfor
+  assert_equal([1, 10, 11], res)
+  unlet g:cached
+
+  b:cached = 'one'
+  assert_equal('one', GetBufCached())
+  new
+  b:cached = 'two'
+  assert_equal('two', GetBufCached())
+  bwipe!
+  assert_equal('one', GetBufCached())
+  unlet b:cached
+  assert_fails('call GetBufCached()', 'E121:')
+enddef
+
 def Test_delfunction()
   # Check function is defined in script namespace
   CheckScriptSuccess([
@@ -2213,6 +2239,80 @@ def Test_for_loop()
     concat ..= str
   endfor
   assert_equal('onetwo', concat)
+
+  let nrs: list<number> = []
+  for nr in range(10, 1, -3)
+    nrs->add(nr)
+  endfor
+  assert_equal([10, 7, 4, 1], nrs)
+
+  let lists: list<list<number>> = []
+  for l in [[1], [2, 3]]
+    lists->add(l)
+  endfor
+  assert_equal([[1], [2, 3]], lists)
+enddef
+
+def Test_while_compare_nr()
+  let count = 0
+  let i = 10
+  while i > 0 && i != 5
+    i -= 1
+    count += 1
+  endwhile
+  assert_equal(5, i)
+  assert_equal(5, count)
+
+  let res: list<number> = []
+  for n in range(6)
+    if n < 2 || n >= 4
+      res->add(n)
+    elseif n == 2
+      res->add(20)
+    endif
+  endfor
+  assert_equal([0, 1, 20, 4, 5], res)
+enddef
+
+def Test_append_string()
+  let s: string
+  let other = ''
+  for i in range(100)
+    s ..= 'ab'
+    other ..= 'xyz'
+  endfor
+  assert_equal(repeat('ab', 100), s)
+  assert_equal(repeat('xyz', 100), other)
+
+  let copy = s
+  s ..= s
+  assert_equal(repeat('ab', 100), copy)
+  assert_equal(repeat('ab', 200), s)
+
+  s = 'x'
+  s ..= s .. '-' .. s[0]
+  assert_equal('xx-x', s)
+
+  # assigning or calling a function in between must not use the old size
+  for i in range(20)
+    s = repeat('y', i)
+    s ..= 'z'
+    assert_equal(repeat('y', i) .. 'z', s)
+    s ..= AppendStringTo('-', i)
+    assert_equal(repeat('y', i) .. 'z-' .. repeat('a', i), s)
+  endfor
+  for w in ['one', 'two']
+    w ..= '!'
+    assert_true(w == 'one!' || w == 'two!')
+  endfor
+enddef
+
+def AppendStringTo(s: string, count: number): string
+  let res = s
+  for i in range(count)
+    res ..= 'a'
+  endfor
+  return res
 enddef
 
 def Test_for_loop_fails()
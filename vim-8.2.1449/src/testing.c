@@ -1005,6 +1005,17 @@ f_test_garbagecollect_now(typval_T *argvars UNUSED, typval_T *rettv UNUSED)
     garbage_collect(TRUE);
 }
 
+/*
+ * "test_garbagecollect_step()" function
+ */
+    void
+f_test_garbagecollect_step(typval_T *argvars UNUSED, typval_T *rettv)
+{
+    // This is dangerous, any Lists and Dicts used internally may be freed
+    // while still in use.
+    rettv->vval.v_number = garbage_collect_step(TRUE);
+}
+
 /*
  * "test_garbagecollect_soon()" function
  */
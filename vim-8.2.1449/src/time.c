@@ -543,8 +543,11 @@ check_due_timer(void)
 	    next_due = this_due;
     }
 
-    if (did_one)
+    // When timers fire quickly don't redraw more often than
+    // 'redrawinterval' allows.
+    if (did_one && !redraw_async_postpone())
 	redraw_after_callback(need_update_screen);
+    next_due = redraw_async_check(&now, next_due);
 
 #ifdef FEAT_BEVAL_TERM
     if (bevalexpr_due_set)
@@ -294,8 +294,20 @@ inchar_loop(
 	}
 #endif
 	if (wtime < 0 && did_start_blocking)
+	{
 	    // blocking and already waited for p_ut
 	    wait_time = -1;
+#ifdef FEAT_EVAL
+	    // Do the next step of garbage collection when no character
+	    // arrived, only wait shortly in between.
+	    if (may_garbage_collect && garbage_collect_busy()
+						&& !typebuf_changed(tb_change_cnt))
+	    {
+		(void)garbage_collect_step(FALSE);
+		wait_time = 1L;
+	    }
+#endif
+	}
 	else
 	{
 	    if (wtime >= 0)
@@ -1877,6 +1877,7 @@ free_all_functions(void)
 	hash_clear(&func_hashtab);
 
     free_def_functions();
+    free_def_cache();
 }
 #endif
 
@@ -4669,6 +4670,9 @@ set_ref_in_previous_funccal(int copyID)
 
     for (fc = previous_funccal; !abort && fc != NULL; fc = fc->caller)
     {
+	// Already marked by an incremental garbage collection.
+	if (fc->fc_copyID == copyID)
+	    continue;
 	fc->fc_copyID = copyID + 1;
 	abort = abort
 	    || set_ref_in_ht(&fc->l_vars.dv_hashtab, copyID + 1, NULL)
@@ -4683,7 +4687,9 @@ set_ref_in_funccal(funccall_T *fc, int copyID)
 {
     int abort = FALSE;
 
-    if (fc->fc_copyID != copyID)
+    // When marking for previous_funccal with "copyID" + 1, a funccal that
+    // was already found to be referenced with "copyID" stays referenced.
+    if (fc->fc_copyID != copyID && fc->fc_copyID != (copyID & COPYID_MASK))
     {
 	fc->fc_copyID = copyID;
 	abort = abort
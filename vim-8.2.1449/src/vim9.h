@@ -22,10 +22,10 @@ typedef enum {
     // get and set variables
     ISN_LOAD,	    // push local variable isn_arg.number
     ISN_LOADV,	    // push v: variable isn_arg.number
-    ISN_LOADG,	    // push g: variable isn_arg.string
-    ISN_LOADB,	    // push b: variable isn_arg.string
-    ISN_LOADW,	    // push w: variable isn_arg.string
-    ISN_LOADT,	    // push t: variable isn_arg.string
+    ISN_LOADG,	    // push g: variable isn_arg.loadvar
+    ISN_LOADB,	    // push b: variable isn_arg.loadvar
+    ISN_LOADW,	    // push w: variable isn_arg.loadvar
+    ISN_LOADT,	    // push t: variable isn_arg.loadvar
     ISN_LOADGDICT,  // push g: dict
     ISN_LOADBDICT,  // push b: dict
     ISN_LOADWDICT,  // push w: dict
@@ -52,6 +52,10 @@ typedef enum {
     // ISN_STOREOTHER, // pop into other script variable isn_arg.other.
 
     ISN_STORENR,    // store number into local variable isn_arg.storenr.stnr_idx
+    ISN_INCNR,	    // add isn_arg.storenr.stnr_val to number in local variable
+		    // isn_arg.storenr.stnr_idx
+    ISN_APPENDSTR,  // pop string and append it to string in local variable
+		    // isn_arg.number
     ISN_STORELIST,	// store into list, value/index/varable on stack
     ISN_STOREDICT,	// store into dictionary, value/index/variable on stack
 
@@ -83,9 +87,12 @@ typedef enum {
 
     // expression operations
     ISN_JUMP,	    // jump if condition is matched isn_arg.jump
+    ISN_JUMP_CMPNR, // compare two numbers with isn_arg.jump.jump_cmp, jump
+		    // if false
 
     // loop
-    ISN_FOR,	    // get next item from a list, uses isn_arg.forloop
+    ISN_FOR,	    // get next item from a list into a variable, uses
+		    // isn_arg.forloop
 
     ISN_TRY,	    // add entry to ec_trystack, uses isn_arg.try
     ISN_THROW,	    // pop value of stack, store in v:exception
@@ -158,6 +165,9 @@ typedef struct {
 typedef struct {
     char_u  *cuf_name;
     int	    cuf_argcount;   // number of arguments on top of stack
+    ufunc_T *cuf_ufunc;	    // function found for "cuf_name" when
+			    // func_hashtab.ht_changed was "cuf_changed"
+    int	    cuf_changed;
 } cufunc_T;
 
 typedef enum {
@@ -167,15 +177,17 @@ typedef enum {
     JUMP_AND_KEEP_IF_FALSE,	// jump if top of stack is false, drop if not
 } jumpwhen_T;
 
-// arguments to ISN_JUMP
+// arguments to ISN_JUMP and ISN_JUMP_CMPNR
 typedef struct {
     jumpwhen_T	jump_when;
     int		jump_where;	    // position to jump to
+    exptype_T	jump_cmp;	    // ISN_JUMP_CMPNR: how to compare
 } jump_T;
 
 // arguments to ISN_FOR
 typedef struct {
-    int	    for_idx;	    // loop variable index
+    int	    for_idx;	    // loop index variable index
+    int	    for_var;	    // index of variable to store the item in
     int	    for_end;	    // position to jump to after done
 } forloop_T;
 
@@ -215,10 +227,25 @@ typedef struct {
     int		so_flags;
 } storeopt_T;
 
+// Cache for a variable found in a hashtab.  Valid while "vc_ht" has not
+// changed, see find_var_cached().
+typedef struct {
+    hashtab_T	*vc_ht;		// hashtab where "vc_di" was found
+    int		vc_changed;	// ht_changed of "vc_ht" at that time
+    dictitem_T	*vc_di;		// the found variable
+} varcache_T;
+
+// arguments to ISN_LOADG, ISN_LOADB, ISN_LOADW and ISN_LOADT
+typedef struct {
+    char_u	*lv_name;	// variable name without g:, b:, etc.
+    varcache_T	lv_cache;
+} loadvar_T;
+
 // arguments to ISN_LOADS and ISN_STORES
 typedef struct {
     char_u	*ls_name;	// variable name (with s: for ISN_STORES)
     int		ls_sid;		// script ID
+    varcache_T	ls_cache;	// only used for ISN_LOADS
 } loadstore_T;
 
 // arguments to ISN_LOADSCRIPT and ISN_STORESCRIPT
@@ -285,6 +312,7 @@ struct isn_S {
 	checktype_T	    type;
 	storenr_T	    storenr;
 	storeopt_T	    storeopt;
+	loadvar_T	    loadvar;
 	loadstore_T	    loadstore;
 	script_T	    script;
 	unlet_T		    unlet;
@@ -0,0 +1,1333 @@
+/* vi:set ts=8 sts=4 sw=4 noet:
+ *
+ * VIM - Vi IMproved	by Bram Moolenaar
+ *
+ * Do ":help uganda"  in Vim to read copying and usage conditions.
+ * Do ":help credits" in Vim to see a list of people who contributed.
+ * See README.txt for an overview of the Vim source code.
+ */
+
+/*
+ * vim9cache.c: cache of compiled :def function instructions, see
+ * 'defcachedir'.
+ *
+ * There is one cache file for each script.  It starts with a header that
+ * holds the Vim version and the path, size and modification time of the
+ * script.  When any of these do not match the file is ignored and written
+ * again.  Then follows one entry for each compiled function: the function
+ * name, the text of the function, the number of local variables, the
+ * default argument indexes and the instructions.  Numbers are stored MSB
+ * first.
+ *
+ * Only instructions that do not depend on the current session are cached.
+ * Script IDs of the function's own script are stored without the number, a
+ * function using anything from another script is not cached.  A call to a
+ * compiled function is stored with the function name, the function is looked
+ * up and compiled when loading, like the compiler does.
+ */
+
+#define USING_FLOAT_STUFF
+#include "vim.h"
+
+#if defined(FEAT_EVAL) || defined(PROTO)
+
+#ifdef VMS
+# include <float.h>
+#endif
+
+#include "vim9.h"
+
+#define DEFCACHE_MAGIC	    "VimDef\001\n"  // magic and format version
+#define DEFCACHE_MAGIC_LEN  8
+
+#define DEFCACHE_NULL	    -1		// length of a NULL string
+
+// Information about the cache file of one script.
+typedef struct {
+    int		dc_sid;		// script ID
+    time_T	dc_mtime;	// script modification time when checked
+    off_T	dc_size;	// script size when checked
+    int		dc_checked;	// cache file was read
+    int		dc_valid;	// cache file header matches the script
+    garray_T	dc_entries;	// entries of the cache file
+} defcache_T;
+
+static garray_T defcaches = {0, 0, sizeof(defcache_T), 10, NULL};
+
+static int def_cache_hits = 0;	    // functions loaded from the cache
+static int def_cache_misses = 0;    // functions not found in the cache
+
+// Reading position in the cache file contents.
+typedef struct {
+    char_u	*dr_p;		// next byte to read
+    char_u	*dr_end;	// end of the data
+    int		dr_error;	// TRUE when reading past the end
+} defreader_T;
+
+/*
+ * Append "len" bytes "p" to "gap".
+ */
+    static void
+wr_bytes(garray_T *gap, void *p, int len)
+{
+    if (ga_grow(gap, len) == OK)
+    {
+	mch_memmove((char_u *)gap->ga_data + gap->ga_len, p, (size_t)len);
+	gap->ga_len += len;
+    }
+}
+
+/*
+ * Append four bytes "n" to "gap".
+ */
+    static void
+wr_int(garray_T *gap, int n)
+{
+    char_u  buf[4];
+    int	    i;
+
+    for (i = 3; i >= 0; --i)
+    {
+	buf[i] = (char_u)(n & 0xff);
+	n = (int)((unsigned)n >> 8);
+    }
+    wr_bytes(gap, buf, 4);
+}
+
+/*
+ * Append eight bytes "n" to "gap".
+ */
+    static void
+wr_nr(garray_T *gap, varnumber_T n)
+{
+    uvarnumber_T    un = (uvarnumber_T)n;
+
+    wr_int(gap, (int)(un >> 16 >> 16));
+    wr_int(gap, (int)(un & 0xffffffffUL));
+}
+
+/*
+ * Append string "s" with its length to "gap".  "s" can be NULL.
+ * When "sid" is not zero a "<SNR>{sid}_" prefix is stored without the
+ * number.  Returns FAIL when "s" contains a reference to another script.
+ */
+    static int
+wr_string(garray_T *gap, char_u *s, int sid)
+{
+    int		len_idx = gap->ga_len;
+    int		len;
+    char_u	*p;
+    char_u	*start;
+
+    wr_int(gap, DEFCACHE_NULL);
+    if (s == NULL)
+	return OK;
+    for (p = s, start = s; *p != NUL; ++p)
+	if (sid != 0 && p[0] == K_SPECIAL && p[1] == KS_EXTRA
+							  && p[2] == KE_SNR)
+	{
+	    char_u  *n = p + 3;
+
+	    if (!VIM_ISDIGIT(*n) || getdigits(&n) != sid || *n != '_')
+		return FAIL;
+	    wr_bytes(gap, start, (int)(p - start) + 3);
+	    start = n;
+	    p = n - 1;
+	}
+    wr_bytes(gap, start, (int)(p - start));
+
+    len = gap->ga_len - len_idx - 4;
+    gap->ga_len = len_idx;
+    wr_int(gap, len);
+    gap->ga_len += len;
+    return OK;
+}
+
+/*
+ * Return a pointer to the next "len" bytes and advance.
+ * Returns NULL when there are not enough bytes.
+ */
+    static char_u *
+rd_bytes(defreader_T *dr, long len)
+{
+    char_u *p = dr->dr_p;
+
+    if (len < 0 || dr->dr_end - dr->dr_p < len)
+    {
+	dr->dr_error = TRUE;
+	return NULL;
+    }
+    dr->dr_p += len;
+    return p;
+}
+
+/*
+ * Read four bytes written with wr_int().
+ */
+    static int
+rd_int(defreader_T *dr)
+{
+    char_u	*p = rd_bytes(dr, 4);
+    unsigned	n = 0;
+    int		i;
+
+    if (p == NULL)
+	return 0;
+    for (i = 0; i < 4; ++i)
+	n = (n << 8) + p[i];
+    return (int)n;
+}
+
+/*
+ * Read eight bytes written with wr_nr().
+ */
+    static varnumber_T
+rd_nr(defreader_T *dr)
+{
+    uvarnumber_T    n = (unsigned)rd_int(dr);
+
+    n = (n << 16 << 16) + (unsigned)rd_int(dr);
+    return (varnumber_T)n;
+}
+
+/*
+ * Read a string written with wr_string() into allocated memory.  When "sid"
+ * is not zero it is inserted in a "<SNR>_" prefix.
+ * Returns NULL for a NULL string, sets "dr_error" for an error.
+ */
+    static char_u *
+rd_string(defreader_T *dr, int sid)
+{
+    int		len = rd_int(dr);
+    char_u	*p;
+    char_u	*end;
+    garray_T	ga;
+    char_u	buf[NUMBUFLEN];
+
+    if (len == DEFCACHE_NULL)
+	return NULL;
+    p = rd_bytes(dr, len);
+    if (p == NULL)
+	return NULL;
+    end = p + len;
+
+    ga_init2(&ga, 1, len + 10);
+    vim_snprintf((char *)buf, NUMBUFLEN, "%d", sid);
+    while (p < end)
+    {
+	char_u *s = p;
+
+	while (s < end && !(sid != 0 && end - s >= 3 && s[0] == K_SPECIAL
+				       && s[1] == KS_EXTRA && s[2] == KE_SNR))
+	    ++s;
+	if (s < end)
+	{
+	    s += 3;
+	    wr_bytes(&ga, p, (int)(s - p));
+	    wr_bytes(&ga, buf, (int)STRLEN(buf));
+	}
+	else
+	    wr_bytes(&ga, p, (int)(s - p));
+	p = s;
+    }
+    ga_append(&ga, NUL);
+    if (ga.ga_data == NULL)
+	dr->dr_error = TRUE;
+    return ga.ga_data;
+}
+
+/*
+ * Return the text of function "ufunc" as it matters for compiling: the
+ * arguments with their types, the return type and the lines.
+ * Returns NULL when out of memory.
+ */
+    static char_u *
+func_signature(ufunc_T *ufunc)
+{
+    garray_T	ga;
+    char	*tofree;
+    int		i;
+
+    ga_init2(&ga, 1, 500);
+    for (i = 0; i < ufunc->uf_args.ga_len; ++i)
+    {
+	ga_concat(&ga, ((char_u **)ufunc->uf_args.ga_data)[i]);
+	if (ufunc->uf_arg_types != NULL)
+	{
+	    ga_append(&ga, ':');
+	    ga_concat(&ga, (char_u *)type_name(ufunc->uf_arg_types[i],
+								     &tofree));
+	    vim_free(tofree);
+	}
+	ga_append(&ga, ',');
+    }
+    for (i = 0; i < ufunc->uf_def_args.ga_len; ++i)
+    {
+	ga_concat(&ga, ((char_u **)ufunc->uf_def_args.ga_data)[i]);
+	ga_append(&ga, ',');
+    }
+    if (ufunc->uf_va_name != NULL)
+    {
+	ga_concat(&ga, (char_u *)"...");
+	ga_concat(&ga, ufunc->uf_va_name);
+	if (ufunc->uf_va_type != NULL)
+	{
+	    ga_append(&ga, ':');
+	    ga_concat(&ga, (char_u *)type_name(ufunc->uf_va_type, &tofree));
+	    vim_free(tofree);
+	}
+    }
+    ga_concat(&ga, (char_u *)"):");
+    if (ufunc->uf_ret_type != NULL)
+    {
+	ga_concat(&ga, (char_u *)type_name(ufunc->uf_ret_type, &tofree));
+	vim_free(tofree);
+    }
+    ga_append(&ga, '\n');
+    for (i = 0; i < ufunc->uf_lines.ga_len; ++i)
+    {
+	char_u *line = ((char_u **)ufunc->uf_lines.ga_data)[i];
+
+	if (line != NULL)
+	    ga_concat(&ga, line);
+	ga_append(&ga, '\n');
+    }
+    ga_append(&ga, NUL);
+    return ga.ga_data;
+}
+
+/*
+ * Store the name and type of script variable "idx" of script "sid".
+ */
+    static int
+wr_script_var(garray_T *gap, int sid, int idx)
+{
+    scriptitem_T    *si = SCRIPT_ITEM(sid);
+    svar_T	    *sv;
+    char	    *tofree;
+    int		    ret;
+
+    if (idx < 0 || idx >= si->sn_var_vals.ga_len)
+	return FAIL;
+    sv = ((svar_T *)si->sn_var_vals.ga_data) + idx;
+    wr_int(gap, idx);
+    if (wr_string(gap, sv->sv_name, 0) == FAIL)
+	return FAIL;
+    ret = wr_string(gap, sv->sv_type == NULL ? NULL
+			  : (char_u *)type_name(sv->sv_type, &tofree), 0);
+    if (sv->sv_type != NULL)
+	vim_free(tofree);
+    return ret;
+}
+
+/*
+ * Read what wr_script_var() wrote and check that the variable is still at
+ * the same index with the same type.
+ */
+    static int
+rd_script_var(defreader_T *dr, int sid, int *idx)
+{
+    scriptitem_T    *si = SCRIPT_ITEM(sid);
+    svar_T	    *sv;
+    char_u	    *name;
+    char_u	    *type;
+    char	    *tofree = NULL;
+    int		    ret = FAIL;
+
+    *idx = rd_int(dr);
+    name = rd_string(dr, 0);
+    type = rd_string(dr, 0);
+    if (!dr->dr_error && *idx >= 0 && *idx < si->sn_var_vals.ga_len)
+    {
+	sv = ((svar_T *)si->sn_var_vals.ga_data) + *idx;
+	if (name != NULL && STRCMP(sv->sv_name, name) == 0
+		&& (sv->sv_type == NULL
+		    ? type == NULL
+		    : type != NULL && STRCMP(type_name(sv->sv_type, &tofree),
+								  type) == 0))
+	    ret = OK;
+	vim_free(tofree);
+    }
+    vim_free(name);
+    vim_free(type);
+    return ret;
+}
+
+/*
+ * Append instruction "isn" of a function in script "sid" to "gap".
+ * Returns FAIL when the instruction cannot be cached.
+ */
+    static int
+wr_instr(garray_T *gap, isn_T *isn, int sid)
+{
+    isntype_T	type = isn->isn_type;
+
+    wr_int(gap, type);
+    wr_int(gap, isn->isn_lnum);
+    switch (type)
+    {
+	case ISN_EXEC:
+	case ISN_LOADENV:
+	case ISN_LOADOPT:
+	case ISN_PUSHS:
+	case ISN_STOREB:
+	case ISN_STOREENV:
+	case ISN_STOREG:
+	case ISN_STORET:
+	case ISN_STOREW:
+	case ISN_STRINGMEMBER:
+	    return wr_string(gap, isn->isn_arg.string, sid);
+
+	case ISN_PUSHFUNC:
+	    if (isn->isn_arg.string != NULL
+			 && STRNCMP(isn->isn_arg.string, "<lambda>", 8) == 0)
+		return FAIL;
+	    return wr_string(gap, isn->isn_arg.string, sid);
+
+	case ISN_LOADB:
+	case ISN_LOADG:
+	case ISN_LOADT:
+	case ISN_LOADW:
+	    return wr_string(gap, isn->isn_arg.loadvar.lv_name, sid);
+
+	case ISN_LOADS:
+	case ISN_STORES:
+	    if (isn->isn_arg.loadstore.ls_sid != sid)
+		return FAIL;
+	    return wr_string(gap, isn->isn_arg.loadstore.ls_name, sid);
+
+	case ISN_LOADSCRIPT:
+	case ISN_STORESCRIPT:
+	    if (isn->isn_arg.script.script_sid != sid)
+		return FAIL;
+	    return wr_script_var(gap, sid, isn->isn_arg.script.script_idx);
+
+	case ISN_UNLET:
+	case ISN_UNLETENV:
+	    wr_int(gap, isn->isn_arg.unlet.ul_forceit);
+	    return wr_string(gap, isn->isn_arg.unlet.ul_name, sid);
+
+	case ISN_STOREOPT:
+	    wr_int(gap, isn->isn_arg.storeopt.so_flags);
+	    return wr_string(gap, isn->isn_arg.storeopt.so_name, sid);
+
+	case ISN_PUSHBLOB:
+	    {
+		blob_T *b = isn->isn_arg.blob;
+
+		if (b == NULL)
+		    wr_int(gap, DEFCACHE_NULL);
+		else
+		{
+		    wr_int(gap, b->bv_ga.ga_len);
+		    wr_bytes(gap, b->bv_ga.ga_data, b->bv_ga.ga_len);
+		}
+	    }
+	    break;
+
+	case ISN_PUSHCHANNEL:
+	case ISN_PUSHJOB:
+	    // only null_channel and null_job
+	    if (isn->isn_arg.channel != NULL)
+		return FAIL;
+	    break;
+
+	case ISN_PUSHF:
+#ifdef FEAT_FLOAT
+	    // Floats are stored as they are in memory, the Vim version in the
+	    // header is for the same binary.
+	    wr_bytes(gap, &isn->isn_arg.fnumber, (int)sizeof(float_T));
+	    break;
+#else
+	    return FAIL;
+#endif
+
+	case ISN_UCALL:
+	    if (STRNCMP(isn->isn_arg.ufunc.cuf_name, "<lambda>", 8) == 0)
+		return FAIL;
+	    wr_int(gap, isn->isn_arg.ufunc.cuf_argcount);
+	    return wr_string(gap, isn->isn_arg.ufunc.cuf_name, sid);
+
+	case ISN_DCALL:
+	    {
+		ufunc_T *ufunc = (((dfunc_T *)def_functions.ga_data)
+					 + isn->isn_arg.dfunc.cdf_idx)->df_ufunc;
+
+		// The index in "def_functions" differs, use the name.  Only
+		// for a function in the same script.
+		if (ufunc->uf_script_ctx.sc_sid != sid)
+		    return FAIL;
+		wr_int(gap, isn->isn_arg.dfunc.cdf_argcount);
+		return wr_string(gap, ufunc->uf_name, sid);
+	    }
+
+	case ISN_BCALL:
+	    // the index in the table of functions may change, use the name
+	    wr_int(gap, isn->isn_arg.bfunc.cbf_argcount);
+	    return wr_string(gap,
+		       (char_u *)internal_func_name(isn->isn_arg.bfunc.cbf_idx),
+									    0);
+
+	case ISN_PCALL:
+	    wr_int(gap, isn->isn_arg.pfunc.cpf_top);
+	    wr_int(gap, isn->isn_arg.pfunc.cpf_argcount);
+	    break;
+
+	case ISN_2BOOL:
+	case ISN_2STRING:
+	case ISN_2STRING_ANY:
+	case ISN_APPENDSTR:
+	case ISN_ECHOERR:
+	case ISN_ECHOMSG:
+	case ISN_EXECCONCAT:
+	case ISN_EXECUTE:
+	case ISN_GETITEM:
+	case ISN_LOAD:
+	case ISN_LOADREG:
+	case ISN_LOADV:
+	case ISN_NEWDICT:
+	case ISN_NEWLIST:
+	case ISN_PUSHBOOL:
+	case ISN_PUSHNR:
+	case ISN_PUSHSPEC:
+	case ISN_SLICE:
+	case ISN_STORE:
+	case ISN_STOREREG:
+	case ISN_STOREV:
+	    wr_nr(gap, isn->isn_arg.number);
+	    break;
+
+	case ISN_ECHO:
+	    wr_int(gap, isn->isn_arg.echo.echo_with_white);
+	    wr_int(gap, isn->isn_arg.echo.echo_count);
+	    break;
+
+	case ISN_JUMP:
+	case ISN_JUMP_CMPNR:
+	    wr_int(gap, isn->isn_arg.jump.jump_when);
+	    wr_int(gap, isn->isn_arg.jump.jump_where);
+	    wr_int(gap, isn->isn_arg.jump.jump_cmp);
+	    break;
+
+	case ISN_FOR:
+	    wr_int(gap, isn->isn_arg.forloop.for_idx);
+	    wr_int(gap, isn->isn_arg.forloop.for_var);
+	    wr_int(gap, isn->isn_arg.forloop.for_end);
+	    break;
+
+	case ISN_TRY:
+	    wr_int(gap, isn->isn_arg.try.try_catch);
+	    wr_int(gap, isn->isn_arg.try.try_finally);
+	    break;
+
+	case ISN_COMPAREANY:
+	case ISN_COMPAREBLOB:
+	case ISN_COMPAREBOOL:
+	case ISN_COMPAREDICT:
+	case ISN_COMPAREFLOAT:
+	case ISN_COMPAREFUNC:
+	case ISN_COMPARELIST:
+	case ISN_COMPARENR:
+	case ISN_COMPARESPECIAL:
+	case ISN_COMPARESTRING:
+	case ISN_OPANY:
+	case ISN_OPFLOAT:
+	case ISN_OPNR:
+	    wr_int(gap, isn->isn_arg.op.op_type);
+	    wr_int(gap, isn->isn_arg.op.op_ic);
+	    break;
+
+	case ISN_CHECKTYPE:
+	    wr_int(gap, isn->isn_arg.type.ct_type);
+	    wr_int(gap, isn->isn_arg.type.ct_off);
+	    break;
+
+	case ISN_STORENR:
+	case ISN_INCNR:
+	    wr_int(gap, isn->isn_arg.storenr.stnr_idx);
+	    wr_nr(gap, isn->isn_arg.storenr.stnr_val);
+	    break;
+
+	case ISN_CHECKLEN:
+	    wr_int(gap, isn->isn_arg.checklen.cl_min_len);
+	    wr_int(gap, isn->isn_arg.checklen.cl_more_OK);
+	    break;
+
+	case ISN_SHUFFLE:
+	    wr_int(gap, isn->isn_arg.shuffle.shfl_item);
+	    wr_int(gap, isn->isn_arg.shuffle.shfl_up);
+	    break;
+
+	case ISN_ADDBLOB:
+	case ISN_ADDLIST:
+	case ISN_CATCH:
+	case ISN_CHECKNR:
+	case ISN_CONCAT:
+	case ISN_DROP:
+	case ISN_ENDTRY:
+	case ISN_LISTINDEX:
+	case ISN_LOADBDICT:
+	case ISN_LOADGDICT:
+	case ISN_LOADTDICT:
+	case ISN_LOADWDICT:
+	case ISN_MEMBER:
+	case ISN_NEGATENR:
+	case ISN_PCALL_END:
+	case ISN_PUSHEXC:
+	case ISN_RETURN:
+	case ISN_STOREDICT:
+	case ISN_STORELIST:
+	case ISN_STRINDEX:
+	case ISN_THROW:
+	    break;
+
+	// These refer to other functions in this session.
+	case ISN_FUNCREF:
+	case ISN_LOADOUTER:
+	case ISN_NEWFUNC:
+	case ISN_STOREOUTER:
+	    return FAIL;
+    }
+    return OK;
+}
+
+/*
+ * Read an instruction written with wr_instr() into "isn", which must be
+ * cleared.  "count" is the number of instructions of the function.
+ * Returns FAIL when the data is invalid or the instruction can no longer be
+ * used.  "isn" can be passed to delete_instr() in any case.
+ */
+    static int
+rd_instr(defreader_T *dr, isn_T *isn, int sid, int count)
+{
+    int	    type = rd_int(dr);
+
+    isn->isn_lnum = rd_int(dr);
+    if (dr->dr_error || type < 0 || type > ISN_DROP)
+    {
+	isn->isn_type = ISN_DROP;
+	return FAIL;
+    }
+    isn->isn_type = type;
+    switch (isn->isn_type)
+    {
+	case ISN_EXEC:
+	case ISN_LOADENV:
+	case ISN_LOADOPT:
+	case ISN_PUSHFUNC:
+	case ISN_PUSHS:
+	case ISN_STOREB:
+	case ISN_STOREENV:
+	case ISN_STOREG:
+	case ISN_STORET:
+	case ISN_STOREW:
+	case ISN_STRINGMEMBER:
+	    isn->isn_arg.string = rd_string(dr, sid);
+	    break;
+
+	case ISN_LOADB:
+	case ISN_LOADG:
+	case ISN_LOADT:
+	case ISN_LOADW:
+	    isn->isn_arg.loadvar.lv_name = rd_string(dr, sid);
+	    break;
+
+	case ISN_LOADS:
+	case ISN_STORES:
+	    isn->isn_arg.loadstore.ls_sid = sid;
+	    isn->isn_arg.loadstore.ls_name = rd_string(dr, sid);
+	    break;
+
+	case ISN_LOADSCRIPT:
+	case ISN_STORESCRIPT:
+	    isn->isn_arg.script.script_sid = sid;
+	    if (rd_script_var(dr, sid, &isn->isn_arg.script.script_idx)
+								       == FAIL)
+		return FAIL;
+	    break;
+
+	case ISN_UNLET:
+	case ISN_UNLETENV:
+	    isn->isn_arg.unlet.ul_forceit = rd_int(dr);
+	    isn->isn_arg.unlet.ul_name = rd_string(dr, sid);
+	    break;
+
+	case ISN_STOREOPT:
+	    isn->isn_arg.storeopt.so_flags = rd_int(dr);
+	    isn->isn_arg.storeopt.so_name = rd_string(dr, sid);
+	    break;
+
+	case ISN_PUSHBLOB:
+	    {
+		int	len = rd_int(dr);
+		char_u	*p;
+
+		if (len == DEFCACHE_NULL)
+		    break;
+		p = rd_bytes(dr, len);
+		if (p == NULL)
+		    return FAIL;
+		isn->isn_arg.blob = blob_alloc();
+		if (isn->isn_arg.blob == NULL)
+		    return FAIL;
+		++isn->isn_arg.blob->bv_refcount;
+		if (ga_grow(&isn->isn_arg.blob->bv_ga, len) == FAIL)
+		    return FAIL;
+		if (len > 0)
+		    mch_memmove(isn->isn_arg.blob->bv_ga.ga_data, p, len);
+		isn->isn_arg.blob->bv_ga.ga_len = len;
+	    }
+	    break;
+
+	case ISN_PUSHF:
+#ifdef FEAT_FLOAT
+	    {
+		char_u *p = rd_bytes(dr, (long)sizeof(float_T));
+
+		if (p != NULL)
+		    mch_memmove(&isn->isn_arg.fnumber, p, sizeof(float_T));
+	    }
+	    break;
+#else
+	    return FAIL;
+#endif
+
+	case ISN_UCALL:
+	    isn->isn_arg.ufunc.cuf_argcount = rd_int(dr);
+	    isn->isn_arg.ufunc.cuf_name = rd_string(dr, sid);
+	    if (isn->isn_arg.ufunc.cuf_name == NULL)
+		return FAIL;
+	    break;
+
+	case ISN_DCALL:
+	    {
+		char_u	*name;
+		ufunc_T	*ufunc;
+
+		isn->isn_arg.dfunc.cdf_argcount = rd_int(dr);
+		name = rd_string(dr, sid);
+		ufunc = name == NULL ? NULL : find_func(name, TRUE, NULL);
+		vim_free(name);
+		if (ufunc == NULL || ufunc->uf_def_status == UF_NOT_COMPILED)
+		    return FAIL;
+		if (ufunc->uf_def_status == UF_TO_BE_COMPILED
+			&& compile_def_function(ufunc,
+					ufunc->uf_ret_type == NULL, NULL) == FAIL)
+		    return FAIL;
+		isn->isn_arg.dfunc.cdf_idx = ufunc->uf_dfunc_idx;
+	    }
+	    break;
+
+	case ISN_BCALL:
+	    {
+		char_u *name;
+
+		isn->isn_arg.bfunc.cbf_argcount = rd_int(dr);
+		name = rd_string(dr, 0);
+		isn->isn_arg.bfunc.cbf_idx = name == NULL ? -1
+						     : find_internal_func(name);
+		vim_free(name);
+		if (isn->isn_arg.bfunc.cbf_idx < 0)
+		    return FAIL;
+	    }
+	    break;
+
+	case ISN_PCALL:
+	    isn->isn_arg.pfunc.cpf_top = rd_int(dr);
+	    isn->isn_arg.pfunc.cpf_argcount = rd_int(dr);
+	    break;
+
+	case ISN_2BOOL:
+	case ISN_2STRING:
+	case ISN_2STRING_ANY:
+	case ISN_APPENDSTR:
+	case ISN_ECHOERR:
+	case ISN_ECHOMSG:
+	case ISN_EXECCONCAT:
+	case ISN_EXECUTE:
+	case ISN_GETITEM:
+	case ISN_LOAD:
+	case ISN_LOADREG:
+	case ISN_LOADV:
+	case ISN_NEWDICT:
+	case ISN_NEWLIST:
+	case ISN_PUSHBOOL:
+	case ISN_PUSHNR:
+	case ISN_PUSHSPEC:
+	case ISN_SLICE:
+	case ISN_STORE:
+	case ISN_STOREREG:
+	case ISN_STOREV:
+	    isn->isn_arg.number = rd_nr(dr);
+	    break;
+
+	case ISN_ECHO:
+	    isn->isn_arg.echo.echo_with_white = rd_int(dr);
+	    isn->isn_arg.echo.echo_count = rd_int(dr);
+	    break;
+
+	case ISN_JUMP:
+	case ISN_JUMP_CMPNR:
+	    isn->isn_arg.jump.jump_when = rd_int(dr);
+	    isn->isn_arg.jump.jump_where = rd_int(dr);
+	    isn->isn_arg.jump.jump_cmp = rd_int(dr);
+	    if (isn->isn_arg.jump.jump_where < 0
+				      || isn->isn_arg.jump.jump_where > count)
+		return FAIL;
+	    break;
+
+	case ISN_FOR:
+	    isn->isn_arg.forloop.for_idx = rd_int(dr);
+	    isn->isn_arg.forloop.for_var = rd_int(dr);
+	    isn->isn_arg.forloop.for_end = rd_int(dr);
+	    if (isn->isn_arg.forloop.for_end < 0
+				       || isn->isn_arg.forloop.for_end > count)
+		return FAIL;
+	    break;
+
+	case ISN_TRY:
+	    isn->isn_arg.try.try_catch = rd_int(dr);
+	    isn->isn_arg.try.try_finally = rd_int(dr);
+	    if (isn->isn_arg.try.try_catch < 0
+		    || isn->isn_arg.try.try_catch > count
+		    || isn->isn_arg.try.try_finally < 0
+		    || isn->isn_arg.try.try_finally > count)
+		return FAIL;
+	    break;
+
+	case ISN_COMPAREANY:
+	case ISN_COMPAREBLOB:
+	case ISN_COMPAREBOOL:
+	case ISN_COMPAREDICT:
+	case ISN_COMPAREFLOAT:
+	case ISN_COMPAREFUNC:
+	case ISN_COMPARELIST:
+	case ISN_COMPARENR:
+	case ISN_COMPARESPECIAL:
+	case ISN_COMPARESTRING:
+	case ISN_OPANY:
+	case ISN_OPFLOAT:
+	case ISN_OPNR:
+	    isn->isn_arg.op.op_type = rd_int(dr);
+	    isn->isn_arg.op.op_ic = rd_int(dr);
+	    break;
+
+	case ISN_CHECKTYPE:
+	    isn->isn_arg.type.ct_type = rd_int(dr);
+	    isn->isn_arg.type.ct_off = rd_int(dr);
+	    break;
+
+	case ISN_STORENR:
+	case ISN_INCNR:
+	    isn->isn_arg.storenr.stnr_idx = rd_int(dr);
+	    isn->isn_arg.storenr.stnr_val = rd_nr(dr);
+	    break;
+
+	case ISN_CHECKLEN:
+	    isn->isn_arg.checklen.cl_min_len = rd_int(dr);
+	    isn->isn_arg.checklen.cl_more_OK = rd_int(dr);
+	    break;
+
+	case ISN_SHUFFLE:
+	    isn->isn_arg.shuffle.shfl_item = rd_int(dr);
+	    isn->isn_arg.shuffle.shfl_up = rd_int(dr);
+	    break;
+
+	case ISN_ADDBLOB:
+	case ISN_ADDLIST:
+	case ISN_CATCH:
+	case ISN_CHECKNR:
+	case ISN_CONCAT:
+	case ISN_DROP:
+	case ISN_ENDTRY:
+	case ISN_LISTINDEX:
+	case ISN_LOADBDICT:
+	case ISN_LOADGDICT:
+	case ISN_LOADTDICT:
+	case ISN_LOADWDICT:
+	case ISN_MEMBER:
+	case ISN_NEGATENR:
+	case ISN_PCALL_END:
+	case ISN_PUSHCHANNEL:
+	case ISN_PUSHEXC:
+	case ISN_PUSHJOB:
+	case ISN_RETURN:
+	case ISN_STOREDICT:
+	case ISN_STORELIST:
+	case ISN_STRINDEX:
+	case ISN_THROW:
+	    break;
+
+	case ISN_FUNCREF:
+	case ISN_LOADOUTER:
+	case ISN_NEWFUNC:
+	case ISN_STOREOUTER:
+	    isn->isn_type = ISN_DROP;
+	    return FAIL;
+    }
+    return dr->dr_error ? FAIL : OK;
+}
+
+/*
+ * Return the name of the cache file for script "si" in allocated memory.
+ */
+    static char_u *
+def_cache_fname(scriptitem_T *si)
+{
+    return make_percent_swname(p_dcdir, si->sn_name);
+}
+
+/*
+ * Append the header of the cache file for script "si" to "gap".
+ */
+    static void
+wr_header(garray_T *gap, scriptitem_T *si, defcache_T *dc)
+{
+    wr_bytes(gap, DEFCACHE_MAGIC, DEFCACHE_MAGIC_LEN);
+    init_longVersion();
+    (void)wr_string(gap, (char_u *)longVersion, 0);
+    wr_int(gap, highest_patch());
+    wr_nr(gap, (varnumber_T)dc->dc_mtime);
+    wr_nr(gap, (varnumber_T)dc->dc_size);
+    (void)wr_string(gap, si->sn_name, 0);
+}
+
+/*
+ * Read the cache file for script "si" into "dc->dc_entries".  Sets
+ * "dc->dc_valid" when the header matches the script.
+ */
+    static void
+def_cache_read(defcache_T *dc, scriptitem_T *si)
+{
+    char_u	*fname;
+    FILE	*fd;
+    stat_T	st;
+    char_u	*data = NULL;
+    defreader_T	dr;
+    char_u	*s;
+    int		ok;
+
+    ga_clear(&dc->dc_entries);
+    dc->dc_valid = FALSE;
+    fname = def_cache_fname(si);
+    if (fname == NULL)
+	return;
+    if (mch_stat((char *)fname, &st) >= 0 && st.st_size > 0
+	    && (fd = mch_fopen((char *)fname, READBIN)) != NULL)
+    {
+	data = alloc(st.st_size);
+	if (data != NULL
+		&& fread(data, 1, (size_t)st.st_size, fd) == (size_t)st.st_size)
+	{
+	    dr.dr_p = data;
+	    dr.dr_end = data + st.st_size;
+	    dr.dr_error = FALSE;
+
+	    s = rd_bytes(&dr, DEFCACHE_MAGIC_LEN);
+	    ok = s != NULL && memcmp(s, DEFCACHE_MAGIC, DEFCACHE_MAGIC_LEN) == 0;
+	    if (ok)
+	    {
+		s = rd_string(&dr, 0);
+		init_longVersion();
+		ok = s != NULL && STRCMP(s, longVersion) == 0;
+		vim_free(s);
+	    }
+	    ok = ok && rd_int(&dr) == highest_patch()
+		    && rd_nr(&dr) == (varnumber_T)dc->dc_mtime
+		    && rd_nr(&dr) == (varnumber_T)dc->dc_size;
+	    if (ok)
+	    {
+		s = rd_string(&dr, 0);
+		ok = s != NULL && STRCMP(s, si->sn_name) == 0;
+		vim_free(s);
+	    }
+	    if (ok && !dr.dr_error)
+	    {
+		dc->dc_valid = TRUE;
+		wr_bytes(&dc->dc_entries, dr.dr_p, (int)(dr.dr_end - dr.dr_p));
+	    }
+	}
+	vim_free(data);
+	fclose(fd);
+    }
+    vim_free(fname);
+}
+
+/*
+ * Get the cache information for script "sid", reading the cache file when
+ * needed.  Returns NULL when the script file cannot be found.
+ */
+    static defcache_T *
+def_cache_get(int sid)
+{
+    scriptitem_T    *si = SCRIPT_ITEM(sid);
+    defcache_T	    *dc = NULL;
+    stat_T	    st;
+    int		    i;
+
+    if (mch_stat((char *)si->sn_name, &st) < 0)
+	return NULL;
+
+    for (i = 0; i < defcaches.ga_len; ++i)
+	if (((defcache_T *)defcaches.ga_data)[i].dc_sid == sid)
+	{
+	    dc = ((defcache_T *)defcaches.ga_data) + i;
+	    break;
+	}
+    if (dc == NULL)
+    {
+	if (ga_grow(&defcaches, 1) == FAIL)
+	    return NULL;
+	dc = ((defcache_T *)defcaches.ga_data) + defcaches.ga_len++;
+	CLEAR_POINTER(dc);
+	dc->dc_sid = sid;
+	ga_init2(&dc->dc_entries, 1, 1000);
+    }
+
+    // Read the file again when the script was changed.
+    if (!dc->dc_checked || dc->dc_mtime != (time_T)st.st_mtime
+					       || dc->dc_size != st.st_size)
+    {
+	dc->dc_checked = TRUE;
+	dc->dc_mtime = (time_T)st.st_mtime;
+	dc->dc_size = st.st_size;
+	def_cache_read(dc, si);
+    }
+    return dc;
+}
+
+/*
+ * Return TRUE if the instructions of "ufunc" can be found in and added to the
+ * cache in 'defcachedir'.  Must be checked before compiling.
+ */
+    int
+def_cache_useful(ufunc_T *ufunc)
+{
+    int	    sid = ufunc->uf_script_ctx.sc_sid;
+    int	    i;
+
+    if (*p_dcdir == NUL || sid <= 0 || sid > script_items.ga_len
+	    || SCRIPT_ITEM(sid)->sn_name == NULL
+	    || (ufunc->uf_flags & FC_CLOSURE)
+	    || STRNCMP(ufunc->uf_name, "<lambda>", 8) == 0)
+	return FALSE;
+
+    // The type of an argument taken from the default value is only known
+    // after compiling.
+    if (ufunc->uf_arg_types != NULL)
+	for (i = 0; i < ufunc->uf_args.ga_len; ++i)
+	    if (ufunc->uf_arg_types[i] == &t_unknown)
+		return FALSE;
+    return TRUE;
+}
+
+/*
+ * Decode the instructions for "ufunc" from the entry at "dr" into its
+ * "def_functions" entry.  This may compile called functions.
+ */
+    static int
+def_cache_decode(defreader_T *dr, ufunc_T *ufunc)
+{
+    int		sid = ufunc->uf_script_ctx.sc_sid;
+    dfunc_T	*dfunc;
+    int		varcount;
+    int		def_arg_count;
+    int		*def_arg_idx = NULL;
+    int		count;
+    isn_T	*instr;
+    int		i;
+    int		ret = OK;
+
+    varcount = rd_int(dr);
+    def_arg_count = rd_int(dr);
+    if (def_arg_count != ufunc->uf_def_args.ga_len)
+	return FAIL;
+    if (def_arg_count > 0)
+    {
+	def_arg_idx = ALLOC_MULT(int, def_arg_count + 1);
+	if (def_arg_idx == NULL)
+	    return FAIL;
+	for (i = 0; i <= def_arg_count; ++i)
+	    def_arg_idx[i] = rd_int(dr);
+    }
+    count = rd_int(dr);
+
+    // Every instruction takes at least eight bytes.
+    if (dr->dr_error || varcount < 0 || count <= 0
+					   || count > (dr->dr_end - dr->dr_p) / 8)
+    {
+	vim_free(def_arg_idx);
+	return FAIL;
+    }
+    for (i = 0; i <= def_arg_count && def_arg_idx != NULL; ++i)
+	if (def_arg_idx[i] < 0 || def_arg_idx[i] > count)
+	{
+	    vim_free(def_arg_idx);
+	    return FAIL;
+	}
+
+    instr = ALLOC_CLEAR_MULT(isn_T, count);
+    if (instr == NULL)
+    {
+	vim_free(def_arg_idx);
+	return FAIL;
+    }
+    for (i = 0; i < count; ++i)
+	if (rd_instr(dr, instr + i, sid, count) == FAIL)
+	{
+	    ret = FAIL;
+	    ++i;
+	    break;
+	}
+    if (ret == FAIL)
+    {
+	while (--i >= 0)
+	    delete_instr(instr + i);
+	vim_free(instr);
+	vim_free(def_arg_idx);
+	return FAIL;
+    }
+
+    // Compiling a called function may have reallocated "def_functions".
+    dfunc = ((dfunc_T *)def_functions.ga_data) + ufunc->uf_dfunc_idx;
+    dfunc->df_deleted = FALSE;
+    dfunc->df_instr = instr;
+    dfunc->df_instr_count = count;
+    dfunc->df_varcount = varcount;
+    dfunc->df_closure_count = 0;
+    vim_free(ufunc->uf_def_arg_idx);
+    ufunc->uf_def_arg_idx = def_arg_idx;
+    ufunc->uf_def_status = UF_COMPILED;
+    return OK;
+}
+
+/*
+ * Find the entry for "ufunc" in "dc" with the same function text.
+ * Returns a copy of what follows the function text in allocated memory and
+ * sets "lenp" to its length.  Returns NULL when not found.
+ */
+    static char_u *
+def_cache_find(defcache_T *dc, ufunc_T *ufunc, long *lenp)
+{
+    int		sid = ufunc->uf_script_ctx.sc_sid;
+    defreader_T	dr;
+    char_u	*sig = NULL;
+    char_u	*found = NULL;
+
+    dr.dr_p = dc->dc_entries.ga_data;
+    dr.dr_end = dr.dr_p + dc->dc_entries.ga_len;
+    dr.dr_error = FALSE;
+    while (found == NULL && dr.dr_p < dr.dr_end)
+    {
+	int		len = rd_int(&dr);
+	char_u		*entry = rd_bytes(&dr, len);
+	defreader_T	edr;
+	char_u		*name;
+	char_u		*esig;
+
+	if (entry == NULL)
+	{
+	    // Invalid entry, e.g. when two Vims were writing.  Write the file
+	    // again.
+	    dc->dc_valid = FALSE;
+	    break;
+	}
+	edr.dr_p = entry;
+	edr.dr_end = entry + len;
+	edr.dr_error = FALSE;
+	name = rd_string(&edr, sid);
+	if (name != NULL && STRCMP(name, ufunc->uf_name) == 0)
+	{
+	    if (sig == NULL)
+		sig = func_signature(ufunc);
+	    esig = rd_string(&edr, 0);
+	    if (sig != NULL && esig != NULL && STRCMP(sig, esig) == 0)
+	    {
+		*lenp = (long)(edr.dr_end - edr.dr_p);
+		found = vim_memsave(edr.dr_p, (size_t)*lenp);
+	    }
+	    vim_free(esig);
+	}
+	vim_free(name);
+    }
+    vim_free(sig);
+    return found;
+}
+
+/*
+ * Find the instructions for "ufunc" in the cache and use them.
+ * "ufunc" must have an entry in "def_functions".
+ * Returns OK when found, FAIL when the function must be compiled.
+ */
+    int
+def_cache_load(ufunc_T *ufunc)
+{
+    defcache_T	*dc = def_cache_get(ufunc->uf_script_ctx.sc_sid);
+    char_u	*entry = NULL;
+    long	len;
+    int		ret = FAIL;
+#ifdef STARTUPTIME
+    struct timeval  tv_rel;
+    struct timeval  tv_start;
+
+    if (time_fd != NULL)
+	time_push(&tv_rel, &tv_start);
+#endif
+
+    // Use a copy of the entry, compiling a called function may change
+    // "dc_entries".
+    if (dc != NULL && dc->dc_valid)
+	entry = def_cache_find(dc, ufunc, &len);
+    if (entry != NULL)
+    {
+	defreader_T	dr;
+	int		status = ufunc->uf_def_status;
+
+	dr.dr_p = entry;
+	dr.dr_end = entry + len;
+	dr.dr_error = FALSE;
+
+	// A recursive call finds the function being compiled.
+	ufunc->uf_def_status = UF_COMPILING;
+	ret = def_cache_decode(&dr, ufunc);
+	if (ret == FAIL)
+	    ufunc->uf_def_status = status;
+	vim_free(entry);
+    }
+
+    if (ret == OK)
+	++def_cache_hits;
+    else
+	++def_cache_misses;
+#ifdef STARTUPTIME
+    if (time_fd != NULL)
+    {
+	if (ret == OK)
+	{
+	    vim_snprintf((char *)IObuff, IOSIZE,
+			      "loading :def function %s from cache",
+						  printable_func_name(ufunc));
+	    time_msg((char *)IObuff, &tv_start);
+	}
+	time_pop(&tv_rel);
+    }
+#endif
+    return ret;
+}
+
+/*
+ * Add the compiled instructions of "ufunc" to the cache file.  Nothing
+ * happens when an instruction cannot be cached.
+ */
+    void
+def_cache_store(ufunc_T *ufunc)
+{
+    int		sid = ufunc->uf_script_ctx.sc_sid;
+    dfunc_T	*dfunc = ((dfunc_T *)def_functions.ga_data)
+							 + ufunc->uf_dfunc_idx;
+    defcache_T	*dc;
+    garray_T	ga;
+    garray_T	header;
+    char_u	*sig;
+    char_u	*fname;
+    FILE	*fd;
+    int		len;
+    int		i;
+
+    if (dfunc->df_closure_count > 0 || (ufunc->uf_flags & FC_CLOSURE))
+	return;
+
+    ga_init2(&ga, 1, 1000);
+    wr_int(&ga, 0);	// length of the entry, filled in below
+    if (wr_string(&ga, ufunc->uf_name, sid) == FAIL)
+	goto theend;
+    sig = func_signature(ufunc);
+    if (sig == NULL)
+	goto theend;
+    (void)wr_string(&ga, sig, 0);
+    vim_free(sig);
+    wr_int(&ga, dfunc->df_varcount);
+    wr_int(&ga, ufunc->uf_def_args.ga_len);
+    if (ufunc->uf_def_args.ga_len > 0)
+	for (i = 0; i <= ufunc->uf_def_args.ga_len; ++i)
+	    wr_int(&ga, ufunc->uf_def_arg_idx[i]);
+    wr_int(&ga, dfunc->df_instr_count);
+    for (i = 0; i < dfunc->df_instr_count; ++i)
+	if (wr_instr(&ga, dfunc->df_instr + i, sid) == FAIL)
+	    goto theend;
+
+    len = ga.ga_len - 4;
+    ga.ga_len = 0;
+    wr_int(&ga, len);
+    ga.ga_len = len + 4;
+
+    dc = def_cache_get(sid);
+    if (dc == NULL)
+	goto theend;
+    fname = def_cache_fname(SCRIPT_ITEM(sid));
+    if (fname == NULL)
+	goto theend;
+    if (dc->dc_valid)
+	fd = mch_fopen((char *)fname, APPENDBIN);
+    else
+    {
+	// Start a new file when the script was changed.
+	fd = mch_fopen((char *)fname, WRITEBIN);
+	if (fd != NULL)
+	{
+	    ga_init2(&header, 1, 200);
+	    wr_header(&header, SCRIPT_ITEM(sid), dc);
+	    if (fwrite(header.ga_data, 1, (size_t)header.ga_len, fd)
+						   == (size_t)header.ga_len)
+	    {
+		dc->dc_valid = TRUE;
+		ga_clear(&dc->dc_entries);
+	    }
+	    ga_clear(&header);
+	}
+    }
+    if (fd != NULL)
+    {
+	if (dc->dc_valid && fwrite(ga.ga_data, 1, (size_t)ga.ga_len, fd)
+						       == (size_t)ga.ga_len)
+	    // Also use the entry when the script is sourced again.
+	    wr_bytes(&dc->dc_entries, ga.ga_data, ga.ga_len);
+	fclose(fd);
+    }
+    vim_free(fname);
+
+theend:
+    ga_clear(&ga);
+}
+
+/*
+ * Report how many functions were loaded from the cache in the --startuptime
+ * output.
+ */
+    void
+def_cache_time_msg(void)
+{
+#ifdef STARTUPTIME
+    if (time_fd != NULL && def_cache_hits + def_cache_misses > 0)
+    {
+	vim_snprintf((char *)IObuff, IOSIZE,
+		      "%d of %d :def functions loaded from cache",
+			     def_cache_hits, def_cache_hits + def_cache_misses);
+	time_msg((char *)IObuff, NULL);
+    }
+#endif
+}
+
+#if defined(EXITFREE) || defined(PROTO)
+    void
+free_def_cache(void)
+{
+    int i;
+
+    for (i = 0; i < defcaches.ga_len; ++i)
+	ga_clear(&((defcache_T *)defcaches.ga_data)[i].dc_entries);
+    ga_clear(&defcaches);
+}
+#endif
+
+#endif // FEAT_EVAL
@@ -139,6 +139,8 @@ struct cctx_S {
 				    // function
     int		ctx_outer_used;	    // var in ctx_outer was used
 
+    int		ctx_used_has;	    // has() was evaluated at compile time
+
     garray_T	ctx_type_stack;	    // type of each item on the stack
     garray_T	*ctx_type_list;	    // list of pointers to allocated types
 };
@@ -1023,7 +1025,13 @@ generate_LOAD(
     RETURN_OK_IF_SKIP(cctx);
     if ((isn = generate_instr_type(cctx, isn_type, type)) == NULL)
 	return FAIL;
-    if (name != NULL)
+    if (isn_type == ISN_LOADG || isn_type == ISN_LOADB
+				|| isn_type == ISN_LOADW || isn_type == ISN_LOADT)
+    {
+	isn->isn_arg.loadvar.lv_name = vim_strsave(name);
+	CLEAR_FIELD(isn->isn_arg.loadvar.lv_cache);
+    }
+    else if (name != NULL)
 	isn->isn_arg.string = vim_strsave(name);
     else
 	isn->isn_arg.number = idx;
@@ -1095,6 +1103,7 @@ generate_OLDSCRIPT(
 	return FAIL;
     isn->isn_arg.loadstore.ls_name = vim_strsave(name);
     isn->isn_arg.loadstore.ls_sid = sid;
+    CLEAR_FIELD(isn->isn_arg.loadstore.ls_cache);
 
     return OK;
 }
@@ -1257,22 +1266,127 @@ generate_JUMP(cctx_T *cctx, jumpwhen_T when, int where)
     return OK;
 }
 
+/*
+ * Return TRUE if an ISN_JUMP instruction from "start" up to the end jumps to
+ * instruction "where".
+ */
     static int
-generate_FOR(cctx_T *cctx, int loop_idx)
+jumps_to(cctx_T *cctx, int start, int where)
 {
-    isn_T	*isn;
+    garray_T	*instr = &cctx->ctx_instr;
+    int		idx;
+
+    for (idx = start; idx < instr->ga_len; ++idx)
+    {
+	isn_T *isn = ((isn_T *)instr->ga_data) + idx;
+
+	if (isn->isn_type == ISN_JUMP && isn->isn_arg.jump.jump_where == where)
+	    return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+ * Return TRUE if the instructions from "start" up to the end are simple: they
+ * only push and convert values, thus cannot change a local variable, and do
+ * not jump.
+ */
+    static int
+instr_is_simple(cctx_T *cctx, int start)
+{
+    garray_T	*instr = &cctx->ctx_instr;
+    int		idx;
+
+    for (idx = start; idx < instr->ga_len; ++idx)
+	switch (((isn_T *)instr->ga_data)[idx].isn_type)
+	{
+	    case ISN_LOAD:
+	    case ISN_LOADV:
+	    case ISN_LOADG:
+	    case ISN_LOADB:
+	    case ISN_LOADW:
+	    case ISN_LOADT:
+	    case ISN_LOADS:
+	    case ISN_LOADSCRIPT:
+	    case ISN_LOADOPT:
+	    case ISN_LOADENV:
+	    case ISN_LOADREG:
+	    case ISN_PUSHNR:
+	    case ISN_PUSHBOOL:
+	    case ISN_PUSHSPEC:
+	    case ISN_PUSHF:
+	    case ISN_PUSHS:
+	    case ISN_OPNR:
+	    case ISN_NEGATENR:
+	    case ISN_CONCAT:
+	    case ISN_STRINDEX:
+	    case ISN_LISTINDEX:
+	    case ISN_MEMBER:
+	    case ISN_STRINGMEMBER:
+	    case ISN_2STRING:
+	    case ISN_2STRING_ANY:
+	    case ISN_CHECKNR:
+	    case ISN_CHECKTYPE:
+		break;
+	    default:
+		return FALSE;
+	}
+    return TRUE;
+}
+
+/*
+ * Generate an ISN_JUMP instruction with JUMP_IF_FALSE for a condition that
+ * starts at instruction "instr_count".
+ * Optimization: when the condition ends in ISN_COMPARENR it is combined with
+ * the jump into ISN_JUMP_CMPNR, unless another jump in the condition goes to
+ * where the ISN_JUMP would be.
+ * Returns the index of the jump instruction, to fill in the "where" later.
+ * Returns -1 when out of memory.
+ */
+    static int
+generate_JUMP_IF_FALSE(cctx_T *cctx, int instr_count)
+{
+    garray_T	*instr = &cctx->ctx_instr;
     garray_T	*stack = &cctx->ctx_type_stack;
+    int		idx = instr->ga_len;
+    isn_T	*isn;
+
+    if (cctx->ctx_skip != SKIP_YES && idx > instr_count)
+    {
+	isn = ((isn_T *)instr->ga_data) + idx - 1;
+	if (isn->isn_type == ISN_COMPARENR
+					&& !jumps_to(cctx, instr_count, idx))
+	{
+	    exptype_T	type = isn->isn_arg.op.op_type;
+
+	    isn->isn_type = ISN_JUMP_CMPNR;
+	    isn->isn_arg.jump.jump_when = JUMP_IF_FALSE;
+	    isn->isn_arg.jump.jump_where = 0;
+	    isn->isn_arg.jump.jump_cmp = type;
+	    if (stack->ga_len > 0)
+		--stack->ga_len;
+	    return idx - 1;
+	}
+    }
+    if (generate_JUMP(cctx, JUMP_IF_FALSE, 0) == FAIL)
+	return -1;
+    return idx;
+}
+
+/*
+ * Generate an ISN_FOR instruction.  The item is stored in local variable
+ * "var_idx" right away, instead of using a separate ISN_STORE.
+ */
+    static int
+generate_FOR(cctx_T *cctx, int loop_idx, int var_idx)
+{
+    isn_T	*isn;
 
     RETURN_OK_IF_SKIP(cctx);
     if ((isn = generate_instr(cctx, ISN_FOR)) == NULL)
 	return FAIL;
     isn->isn_arg.forloop.for_idx = loop_idx;
-
-    if (ga_grow(stack, 1) == FAIL)
-	return FAIL;
-    // type doesn't matter, will be stored next
-    ((type_T **)stack->ga_data)[stack->ga_len] = &t_any;
-    ++stack->ga_len;
+    isn->isn_arg.forloop.for_var = var_idx;
 
     return OK;
 }
@@ -1391,6 +1505,7 @@ generate_CALL(cctx_T *cctx, ufunc_T *ufunc, int pushed_argcount)
 	// ufunc pointer, need to look it up again at runtime.
 	isn->isn_arg.ufunc.cuf_name = vim_strsave(ufunc->uf_name);
 	isn->isn_arg.ufunc.cuf_argcount = argcount;
+	isn->isn_arg.ufunc.cuf_ufunc = NULL;
     }
 
     stack->ga_len -= argcount; // drop the arguments
@@ -1417,6 +1532,7 @@ generate_UCALL(cctx_T *cctx, char_u *name, int argcount)
 	return FAIL;
     isn->isn_arg.ufunc.cuf_name = vim_strsave(name);
     isn->isn_arg.ufunc.cuf_argcount = argcount;
+    isn->isn_arg.ufunc.cuf_ufunc = NULL;
 
     stack->ga_len -= argcount; // drop the arguments
     if (ga_grow(stack, 1) == FAIL)
@@ -2274,6 +2390,7 @@ compile_call(
 	    f_has(argvars, tv);
 	    clear_tv(&argvars[0]);
 	    ++ppconst->pp_used;
+	    cctx->ctx_used_has = TRUE;
 	    return OK;
 	}
 	clear_tv(&argvars[0]);
@@ -5152,6 +5269,56 @@ compile_assignment(char_u *arg, exarg_T *eap, cmdidx_T cmdidx, cctx_T *cctx)
 			    if (stack->ga_len > 0)
 				--stack->ga_len;
 			}
+			// optimization: turn "var += 123" from ISN_LOAD +
+			// ISN_PUSHNR + ISN_OPNR + ISN_STORE into ISN_INCNR
+			else if (!lvar->lv_from_outer
+				&& (*op == '+' || *op == '-')
+				&& lvar->lv_type->tt_type == VAR_NUMBER
+				&& instr->ga_len == instr_count + 2
+				&& isn->isn_type == ISN_OPNR
+				&& isn->isn_arg.op.op_type
+					   == (*op == '+' ? EXPR_ADD : EXPR_SUB)
+				&& (isn - 1)->isn_type == ISN_PUSHNR
+				&& (isn - 2)->isn_type == ISN_LOAD
+				&& (isn - 2)->isn_arg.number == lvar->lv_idx)
+			{
+			    varnumber_T val = (isn - 1)->isn_arg.number;
+
+			    isn -= 2;
+			    isn->isn_type = ISN_INCNR;
+			    isn->isn_arg.storenr.stnr_idx = lvar->lv_idx;
+			    isn->isn_arg.storenr.stnr_val =
+						       *op == '+' ? val : -val;
+			    instr->ga_len -= 2;
+			    if (stack->ga_len > 0)
+				--stack->ga_len;
+			}
+			// optimization: turn "var ..= expr" from ISN_LOAD + expr
+			// + ISN_CONCAT + ISN_STORE into expr + ISN_APPENDSTR, the
+			// string in the variable is then not copied.  Only when
+			// "expr" cannot change the variable.
+			else if (!lvar->lv_from_outer
+				&& !lvar->lv_arg
+				&& *op == '.'
+				&& lvar->lv_type->tt_type == VAR_STRING
+				&& instr_count > 0
+				&& isn->isn_type == ISN_CONCAT
+				&& (isn = ((isn_T *)instr->ga_data)
+					   + instr_count - 1)->isn_type == ISN_LOAD
+				&& isn->isn_arg.number == lvar->lv_idx
+				&& instr_is_simple(cctx, instr_count))
+			{
+			    // Drop the ISN_LOAD, jumps to it now go to the
+			    // start of "expr".
+			    mch_memmove(isn, isn + 1,
+				  (instr->ga_len - instr_count) * sizeof(isn_T));
+			    --instr->ga_len;
+			    isn = ((isn_T *)instr->ga_data) + instr->ga_len - 1;
+			    isn->isn_type = ISN_APPENDSTR;
+			    isn->isn_arg.number = lvar->lv_idx;
+			    if (stack->ga_len > 0)
+				--stack->ga_len;
+			}
 			else if (lvar->lv_from_outer)
 			    generate_STORE(cctx, ISN_STOREOUTER, lvar->lv_idx,
 									 NULL);
@@ -5436,8 +5603,10 @@ compile_if(char_u *arg, cctx_T *cctx)
     if (cctx->ctx_skip == SKIP_UNKNOWN)
     {
 	// "where" is set when ":elseif", "else" or ":endif" is found
-	scope->se_u.se_if.is_if_label = instr->ga_len;
-	generate_JUMP(cctx, JUMP_IF_FALSE, 0);
+	scope->se_u.se_if.is_if_label =
+				     generate_JUMP_IF_FALSE(cctx, instr_count);
+	if (scope->se_u.se_if.is_if_label < 0)
+	    return NULL;
     }
     else
 	scope->se_u.se_if.is_if_label = -1;
@@ -5499,8 +5668,10 @@ compile_elseif(char_u *arg, cctx_T *cctx)
 	    return NULL;
 
 	// "where" is set when ":elseif", "else" or ":endif" is found
-	scope->se_u.se_if.is_if_label = instr->ga_len;
-	generate_JUMP(cctx, JUMP_IF_FALSE, 0);
+	scope->se_u.se_if.is_if_label =
+				     generate_JUMP_IF_FALSE(cctx, instr_count);
+	if (scope->se_u.se_if.is_if_label < 0)
+	    return NULL;
     }
 
     return p;
@@ -5596,10 +5767,9 @@ compile_endif(char_u *arg, cctx_T *cctx)
  *       PUSHNR -1
  *       STORE loop-idx		Set index to -1
  *       EVAL expr		Push result of "expr"
- * top:  FOR loop-idx, end	Increment index, use list on bottom of stack
+ * top:  FOR loop-idx, end, var	Increment index, use list on bottom of stack
  *				- if beyond end, jump to "end"
- *				- otherwise get item from list and push it
- *       STORE var		Store item in "var"
+ *				- otherwise store item from list in "var"
  *       ... body ...
  *       JUMP top		Jump back to repeat
  * end:	 DROP			Drop the result of "expr"
@@ -5685,8 +5855,7 @@ compile_for(char_u *arg, cctx_T *cctx)
     // "for_end" is set when ":endfor" is found
     scope->se_u.se_for.fs_top_label = instr->ga_len;
 
-    generate_FOR(cctx, loop_lvar->lv_idx);
-    generate_STORE(cctx, ISN_STORE, var_lvar->lv_idx, NULL);
+    generate_FOR(cctx, loop_lvar->lv_idx, var_lvar->lv_idx);
 
     return arg;
 }
@@ -5747,6 +5916,7 @@ compile_while(char_u *arg, cctx_T *cctx)
     char_u	*p = arg;
     garray_T	*instr = &cctx->ctx_instr;
     scope_T	*scope;
+    endlabel_T	*endlabel;
 
     scope = new_scope(cctx, WHILE_SCOPE);
     if (scope == NULL)
@@ -5759,9 +5929,15 @@ compile_while(char_u *arg, cctx_T *cctx)
 	return NULL;
 
     // "while_end" is set when ":endwhile" is found
-    if (compile_jump_to_end(&scope->se_u.se_while.ws_end_label,
-						  JUMP_IF_FALSE, cctx) == FAIL)
-	return FAIL;
+    endlabel = ALLOC_CLEAR_ONE(endlabel_T);
+    if (endlabel == NULL)
+	return NULL;
+    endlabel->el_next = scope->se_u.se_while.ws_end_label;
+    scope->se_u.se_while.ws_end_label = endlabel;
+    endlabel->el_end_label = generate_JUMP_IF_FALSE(cctx,
+					   scope->se_u.se_while.ws_top_label);
+    if (endlabel->el_end_label < 0)
+	return NULL;
 
     return p;
 }
@@ -6342,6 +6518,11 @@ compile_def_function(ufunc_T *ufunc, int set_return_type, cctx_T *outer_cctx)
     int		do_estack_push;
     int		emsg_before = called_emsg;
     int		new_def_function = FALSE;
+    int		use_cache;
+#ifdef STARTUPTIME
+    struct timeval  tv_rel;
+    struct timeval  tv_start;
+#endif
 
     // When using a function that was compiled before: Free old instructions.
     // Otherwise add a new entry in "def_functions".
@@ -6358,7 +6539,18 @@ compile_def_function(ufunc_T *ufunc, int set_return_type, cctx_T *outer_cctx)
 	new_def_function = TRUE;
     }
 
+    // Use the instructions from 'defcachedir' when possible.  This must be
+    // checked before compiling changes the argument types.
+    use_cache = !set_return_type && outer_cctx == NULL
+						   && def_cache_useful(ufunc);
+    if (use_cache && def_cache_load(ufunc) == OK)
+	return OK;
+
     ufunc->uf_def_status = UF_COMPILING;
+#ifdef STARTUPTIME
+    if (time_fd != NULL)
+	time_push(&tv_rel, &tv_start);
+#endif
 
     CLEAR_FIELD(cctx);
     cctx.ctx_ufunc = ufunc;
@@ -6854,6 +7046,10 @@ compile_def_function(ufunc_T *ufunc, int set_return_type, cctx_T *outer_cctx)
 	ufunc->uf_def_status = UF_COMPILED;
     }
 
+    // The result of has() may be different next time.
+    if (use_cache && !cctx.ctx_used_has)
+	def_cache_store(ufunc);
+
     ret = OK;
 
 erret:
@@ -6896,6 +7092,16 @@ erret:
     free_imported(&cctx);
     free_locals(&cctx);
     ga_clear(&cctx.ctx_type_stack);
+
+#ifdef STARTUPTIME
+    if (time_fd != NULL)
+    {
+	vim_snprintf((char *)IObuff, IOSIZE, "compiling :def function %s",
+						  printable_func_name(ufunc));
+	time_msg((char *)IObuff, &tv_start);
+	time_pop(&tv_rel);
+    }
+#endif
     return ret;
 }
 
@@ -6956,10 +7162,6 @@ delete_instr(isn_T *isn)
     {
 	case ISN_EXEC:
 	case ISN_LOADENV:
-	case ISN_LOADG:
-	case ISN_LOADB:
-	case ISN_LOADW:
-	case ISN_LOADT:
 	case ISN_LOADOPT:
 	case ISN_STRINGMEMBER:
 	case ISN_PUSHEXC:
@@ -6973,6 +7175,13 @@ delete_instr(isn_T *isn)
 	    vim_free(isn->isn_arg.string);
 	    break;
 
+	case ISN_LOADG:
+	case ISN_LOADB:
+	case ISN_LOADW:
+	case ISN_LOADT:
+	    vim_free(isn->isn_arg.loadvar.lv_name);
+	    break;
+
 	case ISN_LOADS:
 	case ISN_STORES:
 	    vim_free(isn->isn_arg.loadstore.ls_name);
@@ -7070,6 +7279,7 @@ delete_instr(isn_T *isn)
 	case ISN_SLICE:
 	case ISN_MEMBER:
 	case ISN_JUMP:
+	case ISN_JUMP_CMPNR:
 	case ISN_LOAD:
 	case ISN_LOADBDICT:
 	case ISN_LOADGDICT:
@@ -7096,6 +7306,8 @@ delete_instr(isn_T *isn)
 	case ISN_STOREOUTER:
 	case ISN_STOREV:
 	case ISN_STORENR:
+	case ISN_INCNR:
+	case ISN_APPENDSTR:
 	case ISN_STOREREG:
 	case ISN_STORESCRIPT:
 	case ISN_STOREDICT:
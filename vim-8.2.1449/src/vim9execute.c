@@ -67,8 +67,20 @@ typedef struct {
     int		ec_dfunc_idx;	// current function index
     isn_T	*ec_instr;	// array with instructions
     int		ec_iidx;	// index in ec_instr: instruction to execute
+
+    // String in a local variable built with ISN_APPENDSTR, with its length
+    // and allocated size, so that the next append uses the spare room.
+    char_u	*ec_append_str;
+    int		ec_append_var;	// index in ec_stack of the variable
+    int		ec_append_store; // value of outer_store_count at the time
+    size_t	ec_append_len;
+    size_t	ec_append_size;
 } ectx_T;
 
+// Incremented for every ISN_STOREOUTER.  A closure may change a variable of
+// another execution context.
+static int outer_store_count = 0;
+
 // Get pointer to item relative to the bottom of the stack, -1 is the last one.
 #define STACK_TV_BOT(idx) (((typval_T *)ectx->ec_stack.ga_data) + ectx->ec_stack.ga_len + idx)
 
@@ -78,6 +90,17 @@ to_string_error(vartype_T vartype)
     semsg(_("E1105: Cannot convert %s to string"), vartype_name(vartype));
 }
 
+/*
+ * Local variable "tv" is going to be changed: forget the string built by
+ * ISN_APPENDSTR when it is in "tv", it may be freed.
+ */
+    static void
+append_str_forget(ectx_T *ectx, typval_T *tv)
+{
+    if (tv->v_type == VAR_STRING && tv->vval.v_string == ectx->ec_append_str)
+	ectx->ec_append_str = NULL;
+}
+
 /*
  * Return the number of arguments, including optional arguments and any vararg.
  */
@@ -384,6 +407,11 @@ handle_closure_in_use(ectx_T *ectx, int free_arguments)
 		}
 	    }
 	}
+
+	// The closures may have been marked by an incremental garbage
+	// collection before they had the variables.
+	for (idx = 0; idx < funcstack->fs_ga.ga_len; ++idx)
+	    GC_STORED_TV(stack + idx);
     }
 
     return OK;
@@ -410,6 +438,10 @@ func_return(ectx_T *ectx)
     if (handle_closure_in_use(ectx, TRUE) == FAIL)
 	return FAIL;
 
+    // The local variables go away.
+    if (ectx->ec_append_var >= top)
+	ectx->ec_append_str = NULL;
+
     // Clear the arguments.
     for (idx = top; idx < ectx->ec_frame_idx; ++idx)
 	clear_tv(STACK_TV(idx));
@@ -500,6 +532,28 @@ call_bfunc(int func_idx, int argcount, ectx_T *ectx)
     return OK;
 }
 
+/*
+ * Find variable "name" in hashtab "ht", using cache "vc".  Avoids the hashtab
+ * lookup when executing the same instruction again, e.g. in a loop.
+ * Returns NULL when not found.
+ */
+    static dictitem_T *
+find_var_cached(hashtab_T *ht, char_u *name, varcache_T *vc)
+{
+    dictitem_T	*di;
+
+    if (vc->vc_ht == ht && vc->vc_changed == ht->ht_changed)
+	return vc->vc_di;
+    di = find_var_in_ht(ht, 0, name, TRUE);
+    if (di != NULL)
+    {
+	vc->vc_ht = ht;
+	vc->vc_changed = ht->ht_changed;
+	vc->vc_di = di;
+    }
+    return di;
+}
+
 /*
  * Execute a user defined function.
  * "iptr" can be used to replace the instruction with a more efficient one.
@@ -573,7 +627,16 @@ vim9_aborting(int prev_called_emsg)
     static int
 call_by_name(char_u *name, int argcount, ectx_T *ectx, isn_T *iptr)
 {
-    ufunc_T *ufunc;
+    ufunc_T	*ufunc;
+    cufunc_T	*cufunc = iptr == NULL ? NULL : &iptr->isn_arg.ufunc;
+    hashtab_T	*functbl = func_tbl_get();
+
+    // Use the function found the previous time, unless a function was
+    // defined or deleted since then.
+    if (cufunc != NULL && cufunc->cuf_ufunc != NULL
+	    && cufunc->cuf_changed == functbl->ht_changed
+	    && (cufunc->cuf_ufunc->uf_flags & FC_DEAD) == 0)
+	return call_ufunc(cufunc->cuf_ufunc, argcount, ectx, iptr);
 
     if (builtin_function(name, -1))
     {
@@ -600,7 +663,14 @@ call_by_name(char_u *name, int argcount, ectx_T *ectx, isn_T *iptr)
     }
 
     if (ufunc != NULL)
+    {
+	if (cufunc != NULL)
+	{
+	    cufunc->cuf_ufunc = ufunc;
+	    cufunc->cuf_changed = functbl->ht_changed;
+	}
 	return call_ufunc(ufunc, argcount, ectx, iptr);
+    }
 
     return FAIL;
 }
@@ -1118,7 +1188,8 @@ call_def_function(
 		    hashtab_T	*ht = &SCRIPT_VARS(
 					       iptr->isn_arg.loadstore.ls_sid);
 		    char_u	*name = iptr->isn_arg.loadstore.ls_name;
-		    dictitem_T	*di = find_var_in_ht(ht, 0, name, TRUE);
+		    dictitem_T	*di = find_var_cached(ht, name,
+					       &iptr->isn_arg.loadstore.ls_cache);
 
 		    if (di == NULL)
 		    {
@@ -1167,13 +1238,14 @@ call_def_function(
 			default:  // Cannot reach here
 			    goto failed;
 		    }
-		    di = find_var_in_ht(ht, 0, iptr->isn_arg.string, TRUE);
+		    di = find_var_cached(ht, iptr->isn_arg.loadvar.lv_name,
+					       &iptr->isn_arg.loadvar.lv_cache);
 
 		    if (di == NULL)
 		    {
 			SOURCING_LNUM = iptr->isn_lnum;
 			semsg(_("E121: Undefined variable: %c:%s"),
-					     namespace, iptr->isn_arg.string);
+				      namespace, iptr->isn_arg.loadvar.lv_name);
 			goto on_error;
 		    }
 		    else
@@ -1261,6 +1333,7 @@ call_def_function(
 	    case ISN_STORE:
 		--ectx.ec_stack.ga_len;
 		tv = STACK_TV_VAR(iptr->isn_arg.number);
+		append_str_forget(&ectx, tv);
 		clear_tv(tv);
 		*tv = *STACK_TV_BOT(0);
 		break;
@@ -1269,8 +1342,10 @@ call_def_function(
 	    case ISN_STOREOUTER:
 		--ectx.ec_stack.ga_len;
 		tv = STACK_OUT_TV_VAR(iptr->isn_arg.number);
+		++outer_store_count;
 		clear_tv(tv);
 		*tv = *STACK_TV_BOT(0);
+		GC_STORED_TV(tv);
 		break;
 
 	    // store s: variable in old script
@@ -1400,6 +1475,7 @@ call_def_function(
 		    {
 			clear_tv(&di->di_tv);
 			di->di_tv = *STACK_TV_BOT(0);
+			GC_STORED_TV(&di->di_tv);
 		    }
 		}
 		break;
@@ -1407,11 +1483,66 @@ call_def_function(
 	    // store number in local variable
 	    case ISN_STORENR:
 		tv = STACK_TV_VAR(iptr->isn_arg.storenr.stnr_idx);
+		append_str_forget(&ectx, tv);
 		clear_tv(tv);
 		tv->v_type = VAR_NUMBER;
 		tv->vval.v_number = iptr->isn_arg.storenr.stnr_val;
 		break;
 
+	    // add number to local number variable
+	    case ISN_INCNR:
+		tv = STACK_TV_VAR(iptr->isn_arg.storenr.stnr_idx);
+		tv->vval.v_number += iptr->isn_arg.storenr.stnr_val;
+		break;
+
+	    // append string to local string variable
+	    case ISN_APPENDSTR:
+		{
+		    typval_T	*tv2 = STACK_TV_BOT(-1);
+		    int		var = ectx.ec_frame_idx + STACK_FRAME_SIZE
+						       + iptr->isn_arg.number;
+		    size_t	len;
+		    size_t	size;
+		    char_u	*res;
+
+		    tv = STACK_TV_VAR(iptr->isn_arg.number);
+		    if (tv->vval.v_string == NULL)
+			*tv = *tv2;
+		    else
+		    {
+			if (tv2->vval.v_string != NULL)
+			{
+			    if (tv->vval.v_string == ectx.ec_append_str
+				    && var == ectx.ec_append_var
+				    && ectx.ec_append_store
+							 == outer_store_count)
+			    {
+				len = ectx.ec_append_len;
+				size = ectx.ec_append_size;
+			    }
+			    else
+			    {
+				len = STRLEN(tv->vval.v_string);
+				size = len + 1;
+			    }
+			    res = append_str(tv->vval.v_string, &len, &size,
+						       tv2->vval.v_string, TRUE);
+			    if (res != NULL)
+			    {
+				tv->vval.v_string = res;
+				ectx.ec_append_str = res;
+				ectx.ec_append_var = var;
+				ectx.ec_append_store = outer_store_count;
+				ectx.ec_append_len = len;
+				ectx.ec_append_size = size;
+			    }
+			}
+			clear_tv(tv2);
+		    }
+		    --ectx.ec_stack.ga_len;
+		}
+		break;
+
 	    // store value in list variable
 	    case ISN_STORELIST:
 		{
@@ -1437,6 +1568,7 @@ call_def_function(
 			// overwrite existing list item
 			clear_tv(&li->li_tv);
 			li->li_tv = *tv;
+			GC_STORED_TV(&li->li_tv);
 		    }
 		    else
 		    {
@@ -1475,6 +1607,7 @@ call_def_function(
 			// overwrite existing value
 			clear_tv(&di->di_tv);
 			di->di_tv = *tv;
+			GC_STORED_TV(&di->di_tv);
 		    }
 		    else
 		    {
@@ -1806,6 +1939,29 @@ call_def_function(
 		}
 		break;
 
+	    // compare two numbers and jump if false
+	    case ISN_JUMP_CMPNR:
+		{
+		    varnumber_T arg1 = STACK_TV_BOT(-2)->vval.v_number;
+		    varnumber_T arg2 = STACK_TV_BOT(-1)->vval.v_number;
+		    int		res;
+
+		    switch (iptr->isn_arg.jump.jump_cmp)
+		    {
+			case EXPR_EQUAL: res = arg1 == arg2; break;
+			case EXPR_NEQUAL: res = arg1 != arg2; break;
+			case EXPR_GREATER: res = arg1 > arg2; break;
+			case EXPR_GEQUAL: res = arg1 >= arg2; break;
+			case EXPR_SMALLER: res = arg1 < arg2; break;
+			case EXPR_SEQUAL: res = arg1 <= arg2; break;
+			default: res = 0; break;
+		    }
+		    ectx.ec_stack.ga_len -= 2;
+		    if (!res)
+			ectx.ec_iidx = iptr->isn_arg.jump.jump_where;
+		}
+		break;
+
 	    // top of a for loop
 	    case ISN_FOR:
 		{
@@ -1813,28 +1969,32 @@ call_def_function(
 		    typval_T	*idxtv =
 				   STACK_TV_VAR(iptr->isn_arg.forloop.for_idx);
 
-		    // push the next item from the list
-		    if (GA_GROW(&ectx.ec_stack, 1) == FAIL)
-			goto failed;
+		    // store the next item from the list in the loop variable
 		    if (++idxtv->vval.v_number >= list->lv_len)
 			// past the end of the list, jump to "endfor"
 			ectx.ec_iidx = iptr->isn_arg.forloop.for_end;
-		    else if (list->lv_first == &range_list_item)
-		    {
-			// non-materialized range() list
-			tv = STACK_TV_BOT(0);
-			tv->v_type = VAR_NUMBER;
-			tv->v_lock = 0;
-			tv->vval.v_number = list_find_nr(
-					     list, idxtv->vval.v_number, NULL);
-			++ectx.ec_stack.ga_len;
-		    }
 		    else
 		    {
-			listitem_T *li = list_find(list, idxtv->vval.v_number);
+			tv = STACK_TV_VAR(iptr->isn_arg.forloop.for_var);
+			append_str_forget(&ectx, tv);
+			clear_tv(tv);
+			if (list->lv_first == &range_list_item)
+			{
+			    // non-materialized range() list: compute the
+			    // number, no need to find an item
+			    tv->v_type = VAR_NUMBER;
+			    tv->v_lock = 0;
+			    tv->vval.v_number = list->lv_u.nonmat.lv_start
+					       + idxtv->vval.v_number
+						  * list->lv_u.nonmat.lv_stride;
+			}
+			else
+			{
+			    listitem_T *li = list_find(list,
+							idxtv->vval.v_number);
 
-			copy_tv(&li->li_tv, STACK_TV_BOT(0));
-			++ectx.ec_stack.ga_len;
+			    copy_tv(&li->li_tv, tv);
+			}
 		    }
 		}
 		break;
@@ -2220,7 +2380,20 @@ call_def_function(
 		    char_u *str2 = STACK_TV_BOT(-1)->vval.v_string;
 		    char_u *res;
 
-		    res = concat_str(str1, str2);
+		    // Append to "str1" when possible, saves copying it.
+		    if (str1 != NULL && str2 != NULL)
+		    {
+			size_t	len = STRLEN(str1);
+			size_t	size = len + 1;
+
+			res = append_str(str1, &len, &size, str2, FALSE);
+		    }
+		    else
+			res = NULL;
+		    if (res != NULL)
+			STACK_TV_BOT(-2)->vval.v_string = NULL;
+		    else
+			res = concat_str(str1, str2);
 		    clear_tv(STACK_TV_BOT(-2));
 		    clear_tv(STACK_TV_BOT(-1));
 		    --ectx.ec_stack.ga_len;
@@ -2602,6 +2775,28 @@ failed_early:
     return ret;
 }
 
+/*
+ * Return the operator for a comparison, for ":disassemble".
+ */
+    static char *
+exptype_name(exptype_T type)
+{
+    switch (type)
+    {
+	case EXPR_EQUAL:    return "==";
+	case EXPR_NEQUAL:   return "!=";
+	case EXPR_GREATER:  return ">";
+	case EXPR_GEQUAL:   return ">=";
+	case EXPR_SMALLER:  return "<";
+	case EXPR_SEQUAL:   return "<=";
+	case EXPR_MATCH:    return "=~";
+	case EXPR_IS:	    return "is";
+	case EXPR_ISNOT:    return "isnot";
+	case EXPR_NOMATCH:  return "!~";
+	default:	    return "???";
+    }
+}
+
 /*
  * ":dissassemble".
  * We don't really need this at runtime, but we do have tests that require it,
@@ -2751,16 +2946,20 @@ ex_disassemble(exarg_T *eap)
 		}
 		break;
 	    case ISN_LOADG:
-		smsg("%4d LOADG g:%s", current, iptr->isn_arg.string);
+		smsg("%4d LOADG g:%s", current,
+					       iptr->isn_arg.loadvar.lv_name);
 		break;
 	    case ISN_LOADB:
-		smsg("%4d LOADB b:%s", current, iptr->isn_arg.string);
+		smsg("%4d LOADB b:%s", current,
+					       iptr->isn_arg.loadvar.lv_name);
 		break;
 	    case ISN_LOADW:
-		smsg("%4d LOADW w:%s", current, iptr->isn_arg.string);
+		smsg("%4d LOADW w:%s", current,
+					       iptr->isn_arg.loadvar.lv_name);
 		break;
 	    case ISN_LOADT:
-		smsg("%4d LOADT t:%s", current, iptr->isn_arg.string);
+		smsg("%4d LOADT t:%s", current,
+					       iptr->isn_arg.loadvar.lv_name);
 		break;
 	    case ISN_LOADGDICT:
 		smsg("%4d LOAD g:", current);
@@ -2848,6 +3047,15 @@ ex_disassemble(exarg_T *eap)
 				iptr->isn_arg.storenr.stnr_val,
 				iptr->isn_arg.storenr.stnr_idx);
 		break;
+	    case ISN_INCNR:
+		smsg("%4d INCNR %lld in $%d", current,
+				iptr->isn_arg.storenr.stnr_val,
+				iptr->isn_arg.storenr.stnr_idx);
+		break;
+	    case ISN_APPENDSTR:
+		smsg("%4d APPENDSTR $%lld", current,
+					    (long long)(iptr->isn_arg.number));
+		break;
 
 	    case ISN_STORELIST:
 		smsg("%4d STORELIST", current);
@@ -3027,12 +3235,18 @@ ex_disassemble(exarg_T *eap)
 		}
 		break;
 
+	    case ISN_JUMP_CMPNR:
+		smsg("%4d COMPARENR %s JUMP_IF_FALSE -> %d", current,
+				     exptype_name(iptr->isn_arg.jump.jump_cmp),
+				     iptr->isn_arg.jump.jump_where);
+		break;
+
 	    case ISN_FOR:
 		{
 		    forloop_T *forloop = &iptr->isn_arg.forloop;
 
-		    smsg("%4d FOR $%d -> %d", current,
-					   forloop->for_idx, forloop->for_end);
+		    smsg("%4d FOR $%d -> %d in $%d", current,
+			 forloop->for_idx, forloop->for_end, forloop->for_var);
 		}
 		break;
 
@@ -3094,25 +3308,10 @@ ex_disassemble(exarg_T *eap)
 	    case ISN_COMPAREFUNC:
 	    case ISN_COMPAREANY:
 		   {
-		       char *p;
 		       char buf[10];
 		       char *type;
 
-		       switch (iptr->isn_arg.op.op_type)
-		       {
-			   case EXPR_EQUAL:	 p = "=="; break;
-			   case EXPR_NEQUAL:    p = "!="; break;
-			   case EXPR_GREATER:   p = ">"; break;
-			   case EXPR_GEQUAL:    p = ">="; break;
-			   case EXPR_SMALLER:   p = "<"; break;
-			   case EXPR_SEQUAL:    p = "<="; break;
-			   case EXPR_MATCH:	 p = "=~"; break;
-			   case EXPR_IS:	 p = "is"; break;
-			   case EXPR_ISNOT:	 p = "isnot"; break;
-			   case EXPR_NOMATCH:	 p = "!~"; break;
-			   default:  p = "???"; break;
-		       }
-		       STRCPY(buf, p);
+		       STRCPY(buf, exptype_name(iptr->isn_arg.op.op_type));
 		       if (iptr->isn_arg.op.op_ic == TRUE)
 			   strcat(buf, "?");
 		       switch(iptr->isn_type)
@@ -5000,6 +5000,8 @@ win_free(
 		ttp->tp_prevwin = NULL;
     }
     win_free_lsize(wp);
+    vcol_cp_clear(wp);
+    linewidth_cache_free(wp);
 
     for (i = 0; i < wp->w_tagstacklen; ++i)
     {